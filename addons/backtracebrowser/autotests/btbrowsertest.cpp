@@ -19,9 +19,13 @@
  */
 
 #include "btbrowsertest.h"
+#include "btdatabase.h"
+#include "btfileindexer.h"
 #include "btparser.h"
 
+#include <QDir>
 #include <QFileInfo>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QtTestWidgets>
 
@@ -94,4 +98,72 @@ void KateBtBrowserTest::testParser()
     QVERIFY(info.empty());
 }
 
+void KateBtBrowserTest::testDatabase()
+{
+    KateBtDatabaseBuilder builder;
+    builder.add(QStringLiteral("/src/qt/kernel"), QStringList() << QStringLiteral("qapplication.cpp") << QStringLiteral("main.cpp"));
+    builder.add(QStringLiteral("/src/kate/app/"), QStringList() << QStringLiteral("main.cpp"));
+    builder.add(QStringLiteral("/src/kate/app"), QStringList() << QStringLiteral("main.cpp"));
+
+    KateBtDatabase db;
+    db.setData(builder.build());
+    QCOMPARE(db.size(), 3);
+
+    // the file matching most trailing path components wins, the first one if only the name matches
+    QCOMPARE(db.value(QStringLiteral("kernel/qapplication.cpp")), QStringLiteral("/src/qt/kernel/qapplication.cpp"));
+    QCOMPARE(db.value(QStringLiteral("qapplication.cpp")), QStringLiteral("/src/qt/kernel/qapplication.cpp"));
+    QCOMPARE(db.value(QStringLiteral("kernel/main.cpp")), QStringLiteral("/src/qt/kernel/main.cpp"));
+    QCOMPARE(db.value(QStringLiteral("../kate/app/main.cpp")), QStringLiteral("/src/kate/app/main.cpp"));
+    QCOMPARE(db.value(QStringLiteral("main.cpp")), QStringLiteral("/src/kate/app/main.cpp"));
+    QCOMPARE(db.value(QStringLiteral("other/main.cpp")), QStringLiteral("/src/kate/app/main.cpp"));
+    QCOMPARE(db.value(QStringLiteral("main.c")), QString());
+    QCOMPARE(db.value(QString()), QString());
+
+    // the saved image is loaded as it is
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("backtracedatabase.db"));
+    db.saveToFile(fileName);
+
+    KateBtDatabase loaded;
+    loaded.loadFromFile(fileName);
+    QCOMPARE(loaded.size(), 3);
+    QCOMPARE(loaded.value(QStringLiteral("kernel/main.cpp")), QStringLiteral("/src/qt/kernel/main.cpp"));
+
+    // broken files are ignored
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    file.write("garbage");
+    file.close();
+    KateBtDatabase broken;
+    broken.loadFromFile(fileName);
+    QCOMPARE(broken.size(), 0);
+    QCOMPARE(broken.value(QStringLiteral("main.cpp")), QString());
+}
+
+void KateBtBrowserTest::testFileIndexer()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString root = QDir(dir.path()).canonicalPath();
+    QVERIFY(QDir(root).mkpath(QStringLiteral("a/src")));
+    QVERIFY(QDir(root).mkpath(QStringLiteral("b/src/deep")));
+    for (const QString &name : {QStringLiteral("a/src/main.cpp"), QStringLiteral("b/src/deep/main.cpp"), QStringLiteral("b/src/readme.txt")}) {
+        QFile file(root + QLatin1Char('/') + name);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    KateBtDatabase db;
+    BtFileIndexer indexer(&db);
+    indexer.setSearchPaths(QStringList(root));
+    indexer.setFilter(QStringList(QStringLiteral("*.cpp")));
+    indexer.start();
+    QVERIFY(indexer.wait(10000));
+
+    QCOMPARE(db.size(), 2);
+    QCOMPARE(db.value(QStringLiteral("a/src/main.cpp")), root + QStringLiteral("/a/src/main.cpp"));
+    QCOMPARE(db.value(QStringLiteral("deep/main.cpp")), root + QStringLiteral("/b/src/deep/main.cpp"));
+    QCOMPARE(db.value(QStringLiteral("readme.txt")), QString());
+}
+
 // kate: space-indent on; indent-width 4; replace-tabs on;
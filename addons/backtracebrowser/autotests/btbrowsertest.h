@@ -33,6 +33,8 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void testParser();
+    void testDatabase();
+    void testFileIndexer();
 };
 
 #endif
@@ -22,71 +22,405 @@
 #include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+/**
+ * image layout, all words in native byte order:
+ * header: magic, version, number of directories, number of files, size of the names
+ * directories: parent, name offset, name length
+ * files: directory, name offset, name length
+ * names: UTF-8, not terminated
+ */
+static const quint32 Magic = 0x4b425444; // "KBTD"
+static const quint32 Version = 1;
+static const int HeaderWords = 5;
+static const int RecordWords = 3;
+static const quint32 NoParent = 0xffffffff;
+
+static inline int compareNames(const char *a, int aLength, const char *b, int bLength)
+{
+    const int diff = memcmp(a, b, qMin(aLength, bLength));
+    return diff ? diff : aLength - bLength;
+}
+
+static inline int compareNames(const QByteArray &a, const QByteArray &b)
+{
+    return compareNames(a.constData(), a.size(), b.constData(), b.size());
+}
+
+static inline void appendWord(QByteArray &image, quint32 word)
+{
+    image.append(reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+void KateBtDatabaseBuilder::add(const QString &folder, const QStringList &files)
+{
+    if (files.isEmpty()) {
+        return;
+    }
+
+    QVector<QByteArray> names;
+    names.reserve(files.size());
+    for (const QString &file : files) {
+        names.append(file.toUtf8());
+    }
+    const QString path = QDir::cleanPath(QDir::fromNativeSeparators(folder));
+
+    QMutexLocker locker(&mutex);
+    const quint32 id = directory(path);
+    for (const QByteArray &name : qAsConst(names)) {
+        fileEntries.append({id, name});
+    }
+}
+
+quint32 KateBtDatabaseBuilder::directory(const QString &path)
+{
+    const auto it = directoryIds.constFind(path);
+    if (it != directoryIds.cend()) {
+        return it.value();
+    }
+
+    // the parents are interned first, "/" is the empty root of all absolute paths
+    if (path == QLatin1String("/")) {
+        return directory(QString());
+    }
+
+    Directory entry = {NoParent, QByteArray()};
+    const int slash = path.lastIndexOf(QLatin1Char('/'));
+    if (slash >= 0) {
+        entry.parent = directory(path.left(slash));
+    }
+    entry.name = path.mid(slash + 1).toUtf8();
+
+    const quint32 id = directories.size();
+    directories.append(entry);
+    directoryIds.insert(path, id);
+    return id;
+}
+
+QByteArray KateBtDatabaseBuilder::build() const
+{
+    QMutexLocker locker(&mutex);
+
+    /**
+     * sort by reversed path, names first, then the directories upwards
+     * interned directories are equal if their ids are
+     */
+    auto compare = [this](const File &a, const File &b) {
+        int diff = compareNames(a.name, b.name);
+        quint32 directoryA = a.directory;
+        quint32 directoryB = b.directory;
+        while (!diff && directoryA != directoryB) {
+            if (directoryA == NoParent) {
+                return -1;
+            }
+            if (directoryB == NoParent) {
+                return 1;
+            }
+            diff = compareNames(directories[directoryA].name, directories[directoryB].name);
+            directoryA = directories[directoryA].parent;
+            directoryB = directories[directoryB].parent;
+        }
+        return diff;
+    };
+
+    QVector<int> order(fileEntries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this, &compare](int a, int b) {
+        return compare(fileEntries[a], fileEntries[b]) < 0;
+    });
+    order.erase(std::unique(order.begin(),
+                            order.end(),
+                            [this, &compare](int a, int b) {
+                                return compare(fileEntries[a], fileEntries[b]) == 0;
+                            }),
+                order.end());
+
+    /**
+     * names are stored once, common ones like main.cpp or src are shared by all their users
+     */
+    QByteArray names;
+    QHash<QByteArray, quint32> nameOffsets;
+    auto intern = [&names, &nameOffsets](const QByteArray &name) -> quint32 {
+        const auto it = nameOffsets.constFind(name);
+        if (it != nameOffsets.cend()) {
+            return it.value();
+        }
+        const quint32 offset = names.size();
+        nameOffsets.insert(name, offset);
+        names.append(name);
+        return offset;
+    };
+
+    QByteArray image;
+    image.reserve((HeaderWords + RecordWords * (directories.size() + order.size())) * sizeof(quint32));
+    appendWord(image, Magic);
+    appendWord(image, Version);
+    appendWord(image, directories.size());
+    appendWord(image, order.size());
+    appendWord(image, 0);
+
+    for (const Directory &directory : directories) {
+        appendWord(image, directory.parent);
+        appendWord(image, intern(directory.name));
+        appendWord(image, directory.name.size());
+    }
+    for (int index : qAsConst(order)) {
+        const File &file = fileEntries[index];
+        appendWord(image, file.directory);
+        appendWord(image, intern(file.name));
+        appendWord(image, file.name.size());
+    }
+
+    const quint32 namesSize = names.size();
+    memcpy(image.data() + (HeaderWords - 1) * sizeof(quint32), &namesSize, sizeof(namesSize));
+    image.append(names);
+    return image;
+}
 
 void KateBtDatabase::loadFromFile(const QString &url)
 {
-    QFile file(url);
-    if (file.open(QIODevice::ReadOnly)) {
-        QMutexLocker locker(&mutex);
-        QDataStream ds(&file);
-        ds >> db;
+    QMutexLocker locker(&mutex);
+    detach();
+
+    mappedFile.setFileName(url);
+    if (!mappedFile.open(QIODevice::ReadOnly)) {
+        return;
     }
-    //     qDebug() << "Number of entries in the backtrace database" << url << ":" << db.size();
+
+    /**
+     * the image is used as it is on disk, read it if it can't be mapped
+     */
+    const qint64 fileSize = mappedFile.size();
+    uchar *mapped = fileSize > 0 ? mappedFile.map(0, fileSize) : nullptr;
+    if (mapped) {
+        if (attach(reinterpret_cast<const char *>(mapped), fileSize)) {
+            return;
+        }
+        mappedFile.unmap(mapped);
+    } else {
+        buffer = mappedFile.readAll();
+        if (attach(buffer.constData(), buffer.size())) {
+            mappedFile.close();
+            return;
+        }
+        buffer.clear();
+    }
+
+    /**
+     * database of older versions, a hash of file names to their paths
+     */
+    mappedFile.seek(0);
+    QHash<QString, QStringList> db;
+    QDataStream ds(&mappedFile);
+    ds >> db;
+    mappedFile.close();
+    if (ds.status() != QDataStream::Ok || db.isEmpty()) {
+        return;
+    }
+
+    KateBtDatabaseBuilder builder;
+    for (const QStringList &paths : qAsConst(db)) {
+        for (const QString &path : paths) {
+            const int slash = path.lastIndexOf(QLatin1Char('/'));
+            builder.add(slash < 0 ? QString() : path.left(slash), QStringList(path.mid(slash + 1)));
+        }
+    }
+    buffer = builder.build();
+    attach(buffer.constData(), buffer.size());
+    modified = true;
+    //     qDebug() << "Number of entries in the backtrace database" << url << ":" << fileCount;
 }
 
 void KateBtDatabase::saveToFile(const QString &url) const
 {
-    QFile file(url);
+    QMutexLocker locker(&mutex);
+
+    // an unmodified database is still what is on disk
+    if (!modified || !data) {
+        return;
+    }
+
+    QSaveFile file(url);
     if (file.open(QIODevice::WriteOnly)) {
-        QMutexLocker locker(&mutex);
-        QDataStream ds(&file);
-        ds << db;
+        file.write(data, dataSize);
+        file.commit();
     }
     //     qDebug() << "Saved backtrace database to" << url;
 }
 
-QString KateBtDatabase::value(const QString &key)
+void KateBtDatabase::setData(const QByteArray &image)
 {
-    // key is either of the form "foo/bar.txt" or only "bar.txt"
-    QString file = key;
-    QStringList sl = key.split(QLatin1Char('/'));
-    if (sl.size() > 1) {
-        file = sl[1];
+    QMutexLocker locker(&mutex);
+    detach();
+    buffer = image;
+    if (!attach(buffer.constData(), buffer.size())) {
+        buffer.clear();
     }
+    modified = true;
+}
 
-    QMutexLocker locker(&mutex);
-    if (db.contains(file)) {
-        const QStringList &sl = db.value(file);
-        for (int i = 0; i < sl.size(); ++i) {
-            if (sl[i].indexOf(key) != -1) {
-                return sl[i];
-            }
+bool KateBtDatabase::attach(const char *image, qint64 size)
+{
+    const qint64 headerSize = HeaderWords * sizeof(quint32);
+    if (size < headerSize) {
+        return false;
+    }
+
+    const quint32 *header = reinterpret_cast<const quint32 *>(image);
+    if (header[0] != Magic || header[1] != Version) {
+        return false;
+    }
+
+    const quint32 directories = header[2];
+    const quint32 files = header[3];
+    const quint32 namesLength = header[4];
+    const qint64 recordsSize = qint64(RecordWords) * sizeof(quint32) * (qint64(directories) + files);
+    if (headerSize + recordsSize + namesLength != size) {
+        return false;
+    }
+
+    /**
+     * check all records once, lookups rely on them
+     * parents come before their children, there are no cycles
+     */
+    const quint32 *directoryWords = header + HeaderWords;
+    const quint32 *fileWords = directoryWords + RecordWords * directories;
+    for (quint32 i = 0; i < directories; ++i) {
+        const quint32 *record = directoryWords + RecordWords * i;
+        if ((record[0] != NoParent && record[0] >= i) || qint64(record[1]) + record[2] > namesLength) {
+            return false;
         }
-        // try to use the first one
-        if (!sl.empty()) {
-            return sl[0];
+    }
+    for (quint32 i = 0; i < files; ++i) {
+        const quint32 *record = fileWords + RecordWords * i;
+        if (record[0] >= directories || qint64(record[1]) + record[2] > namesLength) {
+            return false;
         }
     }
 
-    return QString();
+    data = image;
+    dataSize = size;
+    directoryRecords = directoryWords;
+    fileRecords = fileWords;
+    names = image + headerSize + recordsSize;
+    directoryCount = directories;
+    fileCount = files;
+    namesSize = namesLength;
+    return true;
+}
+
+void KateBtDatabase::detach()
+{
+    // closing the file unmaps it
+    mappedFile.close();
+    buffer.clear();
+    modified = false;
+    data = nullptr;
+    dataSize = 0;
+    directoryRecords = nullptr;
+    fileRecords = nullptr;
+    names = nullptr;
+    directoryCount = 0;
+    fileCount = 0;
+    namesSize = 0;
+}
+
+QByteArray KateBtDatabase::name(quint32 offset, quint32 length) const
+{
+    return QByteArray::fromRawData(names + offset, length);
+}
+
+QString KateBtDatabase::path(quint32 file) const
+{
+    const quint32 *record = fileRecords + RecordWords * file;
+    QStringList components(QString::fromUtf8(name(record[1], record[2])));
+    for (quint32 directory = record[0]; directory != NoParent; directory = directoryRecords[RecordWords * directory]) {
+        const quint32 *directoryRecord = directoryRecords + RecordWords * directory;
+        components.prepend(QString::fromUtf8(name(directoryRecord[1], directoryRecord[2])));
+    }
+    return components.join(QLatin1Char('/'));
+}
+
+int KateBtDatabase::compareComponent(quint32 file, int depth, const QByteArray &component) const
+{
+    const quint32 *record = fileRecords + RecordWords * file;
+    if (depth > 0) {
+        // paths with less components sort first
+        quint32 directory = record[0];
+        for (int i = 1; i < depth && directory != NoParent; ++i) {
+            directory = directoryRecords[RecordWords * directory];
+        }
+        if (directory == NoParent) {
+            return -1;
+        }
+        record = directoryRecords + RecordWords * directory;
+    }
+    return compareNames(names + record[1], record[2], component.constData(), component.size());
 }
 
-void KateBtDatabase::add(const QString &folder, const QStringList &files)
+QString KateBtDatabase::value(const QString &key)
 {
+    // key is either of the form "foo/bar.txt" or only "bar.txt", maybe with more leading directories
+    const QStringList parts = QDir::fromNativeSeparators(key).split(QLatin1Char('/'), QString::SkipEmptyParts);
+    QVector<QByteArray> components;
+    for (auto it = parts.crbegin(); it != parts.crend(); ++it) {
+        components.append(it->toUtf8());
+    }
+
     QMutexLocker locker(&mutex);
-    for (const QString &file : files) {
-        QStringList &sl = db[file];
-        QString entry = QDir::fromNativeSeparators(folder + QLatin1Char('/') + file);
-        if (!sl.contains(entry)) {
-            sl << entry;
+
+    /**
+     * narrow down the range of files ending with the key, one more path component each step
+     * the first file of the last non empty range matches best
+     */
+    quint32 first = 0;
+    quint32 last = fileCount;
+    quint32 best = NoParent;
+    for (int depth = 0; depth < components.size(); ++depth) {
+        const QByteArray &component = components[depth];
+        quint32 lower = first;
+        quint32 count = last - first;
+        while (count > 0) {
+            const quint32 step = count / 2;
+            if (compareComponent(lower + step, depth, component) < 0) {
+                lower += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        quint32 upper = lower;
+        count = last - lower;
+        while (count > 0) {
+            const quint32 step = count / 2;
+            if (compareComponent(upper + step, depth, component) <= 0) {
+                upper += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
         }
+
+        if (lower == upper) {
+            break;
+        }
+        first = lower;
+        last = upper;
+        best = first;
     }
+
+    return best == NoParent ? QString() : path(best);
 }
 
 int KateBtDatabase::size() const
 {
     QMutexLocker locker(&mutex);
-    return db.size();
+    return fileCount;
 }
 
 // kate: space-indent on; indent-width 4; replace-tabs on;
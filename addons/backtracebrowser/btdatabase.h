@@ -19,11 +19,56 @@
 #ifndef BTDATABASE_H
 #define BTDATABASE_H
 
+#include <QByteArray>
+#include <QFile>
 #include <QHash>
 #include <QMutex>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
+/**
+ * Collects the files found by the indexer and builds the image of a KateBtDatabase.
+ * Directories are interned, every directory is stored once with its parent and its
+ * last path component only. Several threads can add files at once.
+ */
+class KateBtDatabaseBuilder
+{
+public:
+    void add(const QString &folder, const QStringList &files);
+
+    /**
+     * @return database image, see KateBtDatabase
+     */
+    QByteArray build() const;
+
+private:
+    quint32 directory(const QString &path);
+
+    struct Directory {
+        quint32 parent;
+        QByteArray name;
+    };
+
+    struct File {
+        quint32 directory;
+        QByteArray name;
+    };
+
+    mutable QMutex mutex;
+    QHash<QString, quint32> directoryIds;
+    QVector<Directory> directories;
+    QVector<File> fileEntries;
+};
+
+/**
+ * Read only database of source files, used to find the files of a backtrace.
+ *
+ * The database is one flat image that is mapped from disk as it is: a header,
+ * the directory and file records and a pool of all names. Files are sorted by
+ * their reversed path, file name first and then the directories upwards, so
+ * the files ending with some path suffix are one range found by binary search.
+ */
 class KateBtDatabase
 {
 public:
@@ -37,15 +82,56 @@ public:
     void loadFromFile(const QString &url);
     void saveToFile(const QString &url) const;
 
+    /**
+     * @param key file path as in the backtrace, e.g. "kernel/qapplication.cpp" or only "qapplication.cpp"
+     * @return the file matching the most trailing path components of @p key, empty if no file has the same name
+     */
     QString value(const QString &key);
 
-    void add(const QString &folder, const QStringList &files);
+    /**
+     * Replace the content, e.g. by the result of an indexer run.
+     * @param image database image built by KateBtDatabaseBuilder
+     */
+    void setData(const QByteArray &image);
 
+    /**
+     * @return number of files
+     */
     int size() const;
 
 private:
+    /**
+     * Check @p image for a valid image and use it.
+     */
+    bool attach(const char *image, qint64 size);
+    void detach();
+
+    QByteArray name(quint32 offset, quint32 length) const;
+    QString path(quint32 file) const;
+
+    /**
+     * Compare the @p depth'th component of the reversed path of @p file with @p component,
+     * 0 is the file name.
+     */
+    int compareComponent(quint32 file, int depth, const QByteArray &component) const;
+
     mutable QMutex mutex;
-    QHash<QString, QStringList> db;
+
+    /**
+     * image, mapped from the database file or built in memory
+     */
+    QFile mappedFile;
+    QByteArray buffer;
+    bool modified = false;
+
+    const char *data = nullptr;
+    qint64 dataSize = 0;
+    const quint32 *directoryRecords = nullptr;
+    const quint32 *fileRecords = nullptr;
+    const char *names = nullptr;
+    quint32 directoryCount = 0;
+    quint32 fileCount = 0;
+    quint32 namesSize = 0;
 };
 
 #endif // BTDATABASE_H
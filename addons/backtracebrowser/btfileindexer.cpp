@@ -21,6 +21,32 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <functional>
+
+/**
+ * Runs a function in a thread pool, QRunnable::create() needs Qt 5.15
+ */
+class BtIndexRunnable : public QRunnable
+{
+public:
+    explicit BtIndexRunnable(const std::function<void()> &function)
+        : function(function)
+    {
+    }
+
+    void run() override
+    {
+        function();
+    }
+
+private:
+    std::function<void()> function;
+};
 
 BtFileIndexer::BtFileIndexer(KateBtDatabase *database)
     : QThread()
@@ -57,12 +83,51 @@ void BtFileIndexer::run()
     }
 
     cancelAsap = false;
-    for (int i = 0; i < searchPaths.size(); ++i) {
-        if (cancelAsap) {
-            break;
+
+    /**
+     * directories still to be listed, shared by all workers
+     * a worker waits for more while others are still listing, they might find sub directories
+     */
+    KateBtDatabaseBuilder builder;
+    QMutex mutex;
+    QWaitCondition condition;
+    QStringList pending = searchPaths;
+    int busy = 0;
+
+    auto work = [this, &builder, &mutex, &condition, &pending, &busy]() {
+        QMutexLocker locker(&mutex);
+        while (true) {
+            while (pending.isEmpty() && busy > 0 && !cancelAsap) {
+                condition.wait(&mutex);
+            }
+            if (pending.isEmpty() || cancelAsap) {
+                condition.wakeAll();
+                return;
+            }
+
+            const QString url = pending.takeLast();
+            ++busy;
+            locker.unlock();
+            const QStringList subdirs = indexFiles(url, builder);
+            locker.relock();
+            pending += subdirs;
+            --busy;
+            condition.wakeAll();
         }
-        indexFiles(searchPaths[i]);
+    };
+
+    // listing directories mostly waits for the disk, use some threads even on a single core
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    for (int i = 0; i < pool.maxThreadCount(); ++i) {
+        pool.start(new BtIndexRunnable(work));
     }
+    pool.waitForDone();
+
+    if (cancelAsap) {
+        return;
+    }
+    db->setData(builder.build());
     qDebug() << QStringLiteral("Backtrace file database contains %1 files").arg(db->size());
 }
 
@@ -71,23 +136,21 @@ void BtFileIndexer::cancel()
     cancelAsap = true;
 }
 
-void BtFileIndexer::indexFiles(const QString &url)
+QStringList BtFileIndexer::indexFiles(const QString &url, KateBtDatabaseBuilder &builder)
 {
     QDir dir(url);
     if (!dir.exists()) {
-        return;
+        return QStringList();
     }
 
     QStringList files = dir.entryList(filter, QDir::Files | QDir::NoSymLinks | QDir::Readable | QDir::NoDotAndDotDot | QDir::CaseSensitive);
-    db->add(url, files);
+    builder.add(url, files);
 
     QStringList subdirs = dir.entryList(QDir::Dirs | QDir::NoSymLinks | QDir::Readable | QDir::NoDotAndDotDot | QDir::CaseSensitive);
-    for (int i = 0; i < subdirs.size(); ++i) {
-        if (cancelAsap) {
-            break;
-        }
-        indexFiles(url + QLatin1Char('/') + subdirs[i]);
+    for (QString &subdir : subdirs) {
+        subdir.prepend(url + QLatin1Char('/'));
     }
+    return subdirs;
 }
 
 // kate: space-indent on; indent-width 4; replace-tabs on;
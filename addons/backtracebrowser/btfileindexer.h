@@ -23,7 +23,16 @@
 #include <QStringList>
 #include <QThread>
 
+#include <atomic>
+
 class KateBtDatabase;
+class KateBtDatabaseBuilder;
+
+/**
+ * Indexes the search paths for the backtrace database.
+ * The directories are listed by a pool of threads, the database content is
+ * replaced once all of them are done. A canceled run keeps the old content.
+ */
 
 class BtFileIndexer : public QThread
 {
@@ -39,10 +48,15 @@ public:
 
 protected:
     void run() override;
-    void indexFiles(const QString &url);
+
+    /**
+     * Add the files of one directory.
+     * @return sub directories
+     */
+    QStringList indexFiles(const QString &url, KateBtDatabaseBuilder &builder);
 
 private:
-    bool cancelAsap;
+    std::atomic<bool> cancelAsap;
     QStringList searchPaths;
     QStringList filter;
 
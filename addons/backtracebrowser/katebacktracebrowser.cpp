@@ -226,22 +226,12 @@ void KateBtBrowserWidget::itemActivated(QTreeWidgetItem *item, int column)
         QString path = file;
         // if not absolute path + exists, try to find with index
         if (!QFile::exists(path)) {
-            // try to match the backtrace forms ".*/foo/bar.txt" and "foo/bar.txt"
-            static const QRegularExpression rx1(QStringLiteral("/([^/]+)/([^/]+)$"));
-            QRegularExpressionMatch match = rx1.match(file);
-            if (match.hasMatch()) {
-                file = match.captured(1) + QLatin1Char('/') + match.captured(2);
-            } else {
-                static const QRegularExpression rx2(QStringLiteral("([^/]+)/([^/]+)$"));
-                if (rx2.match(file).hasMatch()) {
-                    // file is of correct form
-                } else {
-                    qDebug() << "file patter did not match:" << file;
-                    setStatus(i18n("File not found: %1", file));
-                    return;
-                }
-            }
+            // the indexed file ending with most of the path components of the backtrace wins
             path = KateBtBrowserPlugin::self().database().value(file);
+            if (path.isEmpty()) {
+                setStatus(i18n("File not found: %1", file));
+                return;
+            }
         }
 
         if (!path.isEmpty() && QFile::exists(path)) {
@@ -32,6 +32,8 @@
 #include "kate_ctags_view.h"
 #include "ui_CTagsGlobalConfig.h"
 
+#include <QProcess>
+
 //******************************************************************/
 class KateCTagsPlugin : public KTextEditor::Plugin
 {
@@ -23,12 +23,17 @@
 #include "kate_ctags_debug.h"
 #include "kate_ctags_plugin.h"
 
+#include "ctagsgenerator.h"
+
+#include <QDirIterator>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QKeyEvent>
 
 #include <KActionCollection>
 #include <KConfigGroup>
+#include <KShell>
+#include <KTextEditor/Editor>
 #include <KXMLGUIFactory>
 #include <QMenu>
 
@@ -37,10 +42,36 @@
 #include <kmessagebox.h>
 #include <kstringhandler.h>
 
+// hits shown for a lookup without prefix matches
+static const int MaxFuzzyHits = 100;
+
+// delay between saving a file and refreshing its tags, batches saving all documents
+static const int SavedFilesDelay = 100;
+
+/**
+ * All files inside of the targets, the default command excludes hidden ones
+ */
+static QStringList targetFiles(const QStringList &targets)
+{
+    QStringList files;
+    for (const QString &target : targets) {
+        const QFileInfo info(target);
+        if (info.isFile()) {
+            files.append(info.absoluteFilePath());
+            continue;
+        }
+
+        QDirIterator it(target, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files.append(it.next());
+        }
+    }
+    return files;
+}
+
 /******************************************************************/
 KateCTagsView::KateCTagsView(KTextEditor::Plugin *plugin, KTextEditor::MainWindow *mainWin)
     : QObject(mainWin)
-    , m_proc(nullptr)
 {
     KXMLGUIClient::setComponentName(QStringLiteral("katectags"), i18n("Kate CTag"));
     setXMLFile(QStringLiteral("ui.rc"));
@@ -123,7 +154,16 @@ KateCTagsView::KateCTagsView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
     connect(m_ctagsUi.delButton, &QPushButton::clicked, this, &KateCTagsView::delTagTarget);
     connect(m_ctagsUi.updateButton, &QPushButton::clicked, this, &KateCTagsView::updateSessionDB);
     connect(m_ctagsUi.updateButton2, &QPushButton::clicked, this, &KateCTagsView::updateSessionDB);
-    connect(&m_proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateCTagsView::updateDone);
+
+    m_updateContext.moveToThread(&m_updateThread);
+    m_updateThread.setObjectName(QStringLiteral("KateCTagsView update"));
+    m_updateThread.start();
+
+    // refresh the tags of saved files
+    connect(KTextEditor::Editor::instance()->application(), &KTextEditor::Application::documentCreated, this, &KateCTagsView::documentCreated);
+    for (auto document : KTextEditor::Editor::instance()->application()->documents()) {
+        documentCreated(document);
+    }
 
     connect(m_ctagsUi.inputEdit, &QLineEdit::textChanged, this, &KateCTagsView::startEditTmr);
 
@@ -145,6 +185,9 @@ KateCTagsView::KateCTagsView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
 /******************************************************************/
 KateCTagsView::~KateCTagsView()
 {
+    m_updateThread.quit();
+    m_updateThread.wait();
+
     if (m_mWin && m_mWin->guiFactory()) {
         m_mWin->guiFactory()->removeClient(this);
     }
@@ -248,6 +291,11 @@ void KateCTagsView::editLookUp()
     Tags::TagList list = Tags::getPartialMatches(m_ctagsUi.tagsFile->text(), m_ctagsUi.inputEdit->text());
     if (list.empty())
         list = Tags::getPartialMatches(m_commonDB, m_ctagsUi.inputEdit->text());
+    // nothing starts with the input, fall back to names containing its characters
+    if (list.empty())
+        list = Tags::getFuzzyMatches(m_ctagsUi.tagsFile->text(), m_ctagsUi.inputEdit->text(), MaxFuzzyHits);
+    if (list.empty())
+        list = Tags::getFuzzyMatches(m_commonDB, m_ctagsUi.inputEdit->text(), MaxFuzzyHits);
     displayHits(list);
 }
 
@@ -482,22 +530,46 @@ void KateCTagsView::startEditTmr()
 }
 
 /******************************************************************/
-void KateCTagsView::updateSessionDB()
+bool KateCTagsView::ctagsCommand(QString *program, QStringList *arguments) const
 {
-    if (m_proc.state() != QProcess::NotRunning) {
-        return;
-    }
+    KShell::Errors errors;
+    *arguments = KShell::splitArgs(m_ctagsUi.cmdEdit->text(), KShell::NoOptions, &errors);
+    if (errors != KShell::NoError || arguments->isEmpty()) {
+        return false;
+    }
+    *program = arguments->takeFirst();
+
+    // the files to index are listed for ctags, recursing is done here
+    arguments->removeAll(QStringLiteral("-R"));
+    arguments->removeAll(QStringLiteral("--recurse"));
+    arguments->removeAll(QStringLiteral("--recurse=yes"));
+    return true;
+}
 
-    QString targets;
+/******************************************************************/
+QStringList KateCTagsView::targets() const
+{
+    QStringList targets;
     QString target;
     for (int i = 0; i < m_ctagsUi.targetList->count(); i++) {
         target = m_ctagsUi.targetList->item(i)->text();
         if (target.endsWith(QLatin1Char('/')) || target.endsWith(QLatin1Char('\\'))) {
             target = target.left(target.size() - 1);
         }
-        targets += target + QLatin1Char(' ');
+        targets << target;
+    }
+    return targets;
+}
+
+/******************************************************************/
+void KateCTagsView::updateSessionDB()
+{
+    if (m_updateRunning) {
+        return;
     }
 
+    const QStringList targets = this->targets();
+
     QString pluginFolder = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QLatin1String("/katectags");
     QDir().mkpath(pluginFolder);
 
@@ -514,31 +586,107 @@ void KateCTagsView::updateSessionDB()
         return;
     }
 
-    QString command = QStringLiteral("%1 -f %2 %3").arg(m_ctagsUi.cmdEdit->text(), m_ctagsUi.tagsFile->text(), targets);
-
-    m_proc.start(command, QStringList());
-
-    if (!m_proc.waitForStarted(500)) {
-        KMessageBox::error(nullptr, i18n("Failed to run \"%1\". exitStatus = %2", command, m_proc.exitStatus()));
+    QString program;
+    QStringList arguments;
+    if (!ctagsCommand(&program, &arguments)) {
+        KMessageBox::error(nullptr, i18n("Failed to run \"%1\".", m_ctagsUi.cmdEdit->text()));
         return;
     }
+
+    // only new and changed files are indexed again, by several ctags processes in parallel
+    const QString tagsFile = m_ctagsUi.tagsFile->text();
+    m_updateRunning = true;
+    m_savedFiles.clear();
+    QMetaObject::invokeMethod(
+        &m_updateContext,
+        [this, tagsFile, program, arguments, targets]() {
+            CTagsGenerator generator(tagsFile, program, arguments);
+            const bool success = generator.update(targetFiles(targets));
+            const QString error = generator.errorString();
+            QMetaObject::invokeMethod(
+                this, [this, success, error]() { updateDone(success, error); }, Qt::QueuedConnection);
+        },
+        Qt::QueuedConnection);
+
     QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
     m_ctagsUi.updateButton->setDisabled(true);
     m_ctagsUi.updateButton2->setDisabled(true);
 }
 
 /******************************************************************/
-void KateCTagsView::updateDone(int exitCode, QProcess::ExitStatus status)
+void KateCTagsView::updateDone(bool success, const QString &error)
 {
-    if (status == QProcess::CrashExit) {
-        KMessageBox::error(m_toolView, i18n("The CTags executable crashed."));
-    } else if (exitCode != 0) {
-        KMessageBox::error(m_toolView, i18n("The CTags program exited with code %1: %2", exitCode, QString::fromLocal8Bit(m_proc.readAllStandardError())));
+    m_updateRunning = false;
+
+    if (!success) {
+        KMessageBox::error(m_toolView, i18n("The CTags program failed: %1", error));
     }
 
     m_ctagsUi.updateButton->setDisabled(false);
     m_ctagsUi.updateButton2->setDisabled(false);
     QApplication::restoreOverrideCursor();
+
+    // files saved during the update
+    updateSavedFiles();
+}
+
+/******************************************************************/
+void KateCTagsView::documentCreated(KTextEditor::Document *document)
+{
+    connect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateCTagsView::documentSaved);
+}
+
+/******************************************************************/
+void KateCTagsView::documentSaved(KTextEditor::Document *document)
+{
+    const QString file = document->url().toLocalFile();
+    if (file.isEmpty() || m_ctagsUi.tagsFile->text().isEmpty()) {
+        return;
+    }
+
+    // only files inside of the targets are in the session database
+    const QStringList targets = this->targets();
+    for (const QString &target : targets) {
+        if (file == target || file.startsWith(target + QLatin1Char('/'))) {
+            m_savedFiles.insert(file);
+            QTimer::singleShot(SavedFilesDelay, this, &KateCTagsView::updateSavedFiles);
+            return;
+        }
+    }
+}
+
+/******************************************************************/
+void KateCTagsView::updateSavedFiles()
+{
+    if (m_updateRunning || m_savedFiles.isEmpty()) {
+        return;
+    }
+
+    QString program;
+    QStringList arguments;
+    if (!ctagsCommand(&program, &arguments)) {
+        m_savedFiles.clear();
+        return;
+    }
+
+    // refresh the tags of the saved files only, errors are shown on the next full update
+    const QString tagsFile = m_ctagsUi.tagsFile->text();
+    const QStringList files = m_savedFiles.values();
+    m_savedFiles.clear();
+    m_updateRunning = true;
+    QMetaObject::invokeMethod(
+        &m_updateContext,
+        [this, tagsFile, program, arguments, files]() {
+            CTagsGenerator(tagsFile, program, arguments).updateFiles(files);
+            QMetaObject::invokeMethod(
+                this,
+                [this]() {
+                    m_updateRunning = false;
+                    updateSavedFiles();
+                },
+                Qt::QueuedConnection);
+        },
+        Qt::QueuedConnection);
 }
 
 /******************************************************************/
@@ -29,11 +29,12 @@
 #include <ktexteditor/sessionconfiginterface.h>
 
 #include <KXMLGUIClient>
-#include <QProcess>
 
 #include <KActionMenu>
 #include <QPointer>
+#include <QSet>
 #include <QStack>
+#include <QThread>
 #include <QTimer>
 
 #include "tags.h"
@@ -75,7 +76,7 @@ public Q_SLOTS:
     void delTagTarget();
 
     void updateSessionDB();
-    void updateDone(int exitCode, QProcess::ExitStatus status);
+    void updateDone(bool success, const QString &error);
 
 protected:
     bool eventFilter(QObject *obj, QEvent *ev) override;
@@ -83,12 +84,18 @@ protected:
 private Q_SLOTS:
     void resetCMD();
     void handleEsc(QEvent *e);
+    void documentCreated(KTextEditor::Document *document);
+    void documentSaved(KTextEditor::Document *document);
+    void updateSavedFiles();
 
 private:
     bool listContains(const QString &target);
 
     QString currentWord();
 
+    bool ctagsCommand(QString *program, QStringList *arguments) const;
+    QStringList targets() const;
+
     void setNewLookupText(const QString &newText);
     void displayHits(const Tags::TagList &list);
 
@@ -104,7 +111,11 @@ private:
     QAction *m_gotoDec;
     QAction *m_lookup;
 
-    QProcess m_proc;
+    // ctags runs in the update thread, only one update at a time
+    QThread m_updateThread;
+    QObject m_updateContext;
+    bool m_updateRunning = false;
+    QSet<QString> m_savedFiles;
     QString m_commonDB;
 
     QTimer m_editTimer;
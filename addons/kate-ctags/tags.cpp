@@ -9,15 +9,12 @@
  *                                                                         *
  ***************************************************************************/
 #include "tags.h"
-#include <stdio.h>
-
-namespace ctags
-{
-#include "readtags.h"
-}
 
+#include "ctagsdatabase.h"
 #include "ctagskinds.h"
 
+#include <QHash>
+
 QString Tags::_tagsfile;
 
 Tags::TagEntry::TagEntry()
@@ -32,85 +29,68 @@ Tags::TagEntry::TagEntry(const QString &tag, const QString &type, const QString
 {
 }
 
-bool Tags::hasTag(const QString &tag)
+/**
+ * The databases stay loaded between lookups, they are only read again after the file changed.
+ */
+static QSharedPointer<CTagsDatabase> database()
 {
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    bool found = (ctags::tagsFind(file, &entry, tag.toLocal8Bit().constData(), TAG_FULLMATCH | TAG_OBSERVECASE) == ctags::TagSuccess);
-
-    ctags::tagsClose(file);
+    static QHash<QString, QSharedPointer<CTagsDatabase>> databases;
+    QSharedPointer<CTagsDatabase> &database = databases[Tags::getTagsFile()];
+    database = CTagsDatabase::open(Tags::getTagsFile());
+    return database;
+}
 
-    return found;
+bool Tags::hasTag(const QString &tag)
+{
+    return database()->count(tag.toLocal8Bit()) > 0;
 }
 
 bool Tags::hasTag(const QString &fileName, const QString &tag)
 {
     setTagsFile(fileName);
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    bool found = (ctags::tagsFind(file, &entry, tag.toLocal8Bit().constData(), TAG_FULLMATCH | TAG_OBSERVECASE) == ctags::TagSuccess);
-
-    ctags::tagsClose(file);
-
-    return found;
+    return hasTag(tag);
 }
 
 unsigned int Tags::numberOfMatches(const QString &tagpart, bool partial)
 {
-    unsigned int n = 0;
-
     if (tagpart.isEmpty())
         return 0;
 
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
+    return database()->count(tagpart.toLocal8Bit(), partial ? CTagsDatabase::PartialMatch : CTagsDatabase::FullMatch);
+}
 
-    QByteArray tagpartBArray = tagpart.toLocal8Bit(); // for holding the char *
-    if (ctags::tagsFind(file, &entry, tagpartBArray.data(), TAG_OBSERVECASE | (partial ? TAG_PARTIALMATCH : TAG_FULLMATCH)) == ctags::TagSuccess) {
-        do {
-            n++;
-        } while (ctags::tagsFindNext(file, &entry) == ctags::TagSuccess);
+static Tags::TagList toTagList(const QVector<CTagsDatabase::Entry> &entries, const QStringList &types)
+{
+    Tags::TagList list;
+    for (const CTagsDatabase::Entry &entry : entries) {
+        QString type(CTagsKinds::findKind(entry.kind.constData(), QString::fromLocal8Bit(entry.file).section(QLatin1Char('.'), -1)));
+        QString file = QString::fromLocal8Bit(entry.file);
+
+        if (type.isEmpty() && file.endsWith(QLatin1String("Makefile"))) {
+            type = QStringLiteral("macro");
+        }
+        if (types.isEmpty() || types.contains(QString::fromLocal8Bit(entry.kind))) {
+            list << Tags::TagEntry(QString::fromLocal8Bit(entry.name), type, file, QString::fromLocal8Bit(entry.pattern));
+        }
     }
-
-    ctags::tagsClose(file);
-
-    return n;
+    return list;
 }
 
 Tags::TagList Tags::getMatches(const QString &tagpart, bool partial, const QStringList &types)
 {
-    Tags::TagList list;
-
     if (tagpart.isEmpty())
-        return list;
-
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    QByteArray tagpartBArray = tagpart.toLocal8Bit(); // for holding the char *
-    if (ctags::tagsFind(file, &entry, tagpartBArray.data(), TAG_OBSERVECASE | (partial ? TAG_PARTIALMATCH : TAG_FULLMATCH)) == ctags::TagSuccess) {
-        do {
-            QString type(CTagsKinds::findKind(entry.kind, QString::fromLocal8Bit(entry.file).section(QLatin1Char('.'), -1)));
-            QString file = QString::fromLocal8Bit(entry.file);
-
-            if (type.isEmpty() && file.endsWith(QLatin1String("Makefile"))) {
-                type = QStringLiteral("macro");
-            }
-            if (types.isEmpty() || types.contains(QString::fromLocal8Bit(entry.kind))) {
-                list << TagEntry(QString::fromLocal8Bit(entry.name), type, file, QString::fromLocal8Bit(entry.address.pattern));
-            }
-        } while (ctags::tagsFindNext(file, &entry) == ctags::TagSuccess);
-    }
+        return Tags::TagList();
 
-    ctags::tagsClose(file);
+    return toTagList(database()->find(tagpart.toLocal8Bit(), partial ? CTagsDatabase::PartialMatch : CTagsDatabase::FullMatch), types);
+}
 
-    return list;
+Tags::TagList Tags::getFuzzyMatches(const QString &file, const QString &tagpart, int maxResults)
+{
+    setTagsFile(file);
+    if (tagpart.isEmpty())
+        return Tags::TagList();
+
+    return toTagList(database()->findFuzzy(tagpart.toLocal8Bit(), maxResults), QStringList());
 }
 
 void Tags::setTagsFile(const QString &file)
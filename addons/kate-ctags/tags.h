@@ -59,6 +59,15 @@ public:
     static TagList getExactMatches(const QString &file, const QString &tag);
     static TagList getMatches(const QString &file, const QString &tagpart, bool partial, const QStringList &types = QStringList());
 
+    /**
+     *    Method to look up tags whose names contain the characters of 'tagpart' in order
+     * @param file the tag database filename
+     * @param tagpart characters to look for, case is ignored
+     * @param maxResults maximal number of tags, one per name
+     * @return returns the best matching tags first
+     */
+    static TagList getFuzzyMatches(const QString &file, const QString &tagpart, int maxResults);
+
 private:
     static QString _tagsfile;
 };
@@ -0,0 +1,167 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   Copyright 2020 Kate Developers <kwrite-devel@kde.org>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "BuildOutputParser.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpressionMatch>
+
+BuildOutputParser::BuildOutputParser()
+    // NOTE this will not allow spaces in file names.
+    // e.g. from gcc: "main.cpp:14: error: cannot convert ‘std::string’ to ‘int’ in return"
+    : m_filenameDetector(QStringLiteral("(([a-np-zA-Z]:[\\\\/])?[a-zA-Z0-9_\\.\\+\\-/\\\\]+\\.[a-zA-Z0-9]+):([0-9]+)(.*)"))
+    // e.g. from icpc: "main.cpp(14): error: no suitable conversion function from "std::string" to "int" exists"
+    , m_filenameDetectorIcpc(QStringLiteral("(([a-np-zA-Z]:[\\\\/])?[a-zA-Z0-9_\\.\\+\\-/\\\\]+\\.[a-zA-Z0-9]+)\\(([0-9]+)\\)(:.*)"))
+    , m_newDirDetector(QStringLiteral("make\\[.+\\]: .+ '(.*)'"))
+{
+}
+
+QString BuildOutputParser::ninjaPrefix()
+{
+    return QStringLiteral("[ninja]");
+}
+
+void BuildOutputParser::reset(const QString &workDir)
+{
+    m_stdOut.clear();
+    m_stdErr.clear();
+    m_makeDir = workDir;
+    m_makeDirStack.clear();
+    m_makeDirStack.push(workDir);
+    m_filenameDetectorGccWorked = false;
+    m_ninjaBuildDetected = false;
+    m_resolvedPaths.clear();
+}
+
+void BuildOutputParser::parse(const QByteArray &data, bool stdErr, Result &result)
+{
+    QByteArray &buffer = stdErr ? m_stdErr : m_stdOut;
+    buffer += data;
+    parseLines(buffer, stdErr, false, result);
+}
+
+void BuildOutputParser::finish(Result &result)
+{
+    parseLines(m_stdOut, false, true, result);
+    parseLines(m_stdErr, true, true, result);
+}
+
+void BuildOutputParser::parseLines(QByteArray &buffer, bool stdErr, bool final, Result &result)
+{
+    // handle one line at a time, the buffer is only shortened once per chunk
+    int start = 0;
+    for (int end = buffer.indexOf('\n'); end >= 0; end = buffer.indexOf('\n', start)) {
+        // FIXME This works for utf8 but not for all charsets
+        parseLine(QString::fromUtf8(buffer.constData() + start, end - start), stdErr, result);
+        start = end + 1;
+    }
+
+    if (final && start < buffer.size()) {
+        parseLine(QString::fromUtf8(buffer.constData() + start, buffer.size() - start), stdErr, result);
+        start = buffer.size();
+    }
+    buffer.remove(0, start);
+}
+
+void BuildOutputParser::parseLine(QString line, bool stdErr, Result &result)
+{
+    line.remove(QLatin1Char('\r'));
+
+    if (stdErr) {
+        result.lines.append(line);
+        result.diagnostics.append(processLine(line));
+        return;
+    }
+
+    const bool ninjaOutput = line.startsWith(ninjaPrefix());
+    m_ninjaBuildDetected |= ninjaOutput;
+    if (ninjaOutput) {
+        line = line.mid(ninjaPrefix().length());
+    }
+    result.lines.append(line);
+
+    QRegularExpressionMatch match = m_newDirDetector.match(line);
+    if (match.hasMatch()) {
+        QString newDir = match.captured(1);
+
+        if ((m_makeDirStack.size() > 1) && (m_makeDirStack.top() == newDir)) {
+            m_makeDirStack.pop();
+            newDir = m_makeDirStack.top();
+        } else {
+            m_makeDirStack.push(newDir);
+        }
+
+        m_makeDir = newDir;
+    } else if (m_ninjaBuildDetected && !ninjaOutput) {
+        result.diagnostics.append(processLine(line));
+    }
+}
+
+BuildDiagnostic BuildOutputParser::processLine(const QString &line)
+{
+    // look for a filename
+    QRegularExpressionMatch match = m_filenameDetector.match(line);
+
+    if (match.hasMatch()) {
+        m_filenameDetectorGccWorked = true;
+    } else {
+        if (!m_filenameDetectorGccWorked) {
+            // let's see whether the icpc regexp works:
+            // so for icpc users error detection will be a bit slower,
+            // since always both regexps are checked.
+            // But this should be the minority, for gcc and clang users
+            // both regexes will only be checked until the first regex
+            // matched the first time.
+            match = m_filenameDetectorIcpc.match(line);
+        }
+    }
+
+    if (!match.hasMatch()) {
+        return {QString(), QStringLiteral("0"), QString(), line};
+    }
+
+    return {resolvePath(match.captured(1)), match.captured(3), QStringLiteral("1"), match.captured(4)};
+}
+
+QString BuildOutputParser::resolvePath(const QString &filename)
+{
+    QHash<QString, QString> &paths = m_resolvedPaths[m_makeDir];
+    const auto it = paths.constFind(filename);
+    if (it != paths.cend()) {
+        return it.value();
+    }
+
+    // add path to file
+    QString path = filename;
+    const QString inMakeDir = m_makeDir + QLatin1Char('/') + filename;
+    if (QFile::exists(inMakeDir)) {
+        path = inMakeDir;
+    }
+
+    // get canonical path, if possible, to avoid duplicated opened files
+    const QString canonicalFilePath = QFileInfo(path).canonicalFilePath();
+    if (!canonicalFilePath.isEmpty()) {
+        path = canonicalFilePath;
+    }
+
+    paths.insert(filename, path);
+    return path;
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   Copyright 2020 Kate Developers <kwrite-devel@kde.org>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef BuildOutputParser_h
+#define BuildOutputParser_h
+
+#include <QByteArray>
+#include <QHash>
+#include <QRegularExpression>
+#include <QStack>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * One line of build output for the error list.
+ * Lines without a file name are kept as info with an empty file.
+ */
+struct BuildDiagnostic {
+    QString file;
+    QString line;
+    QString column;
+    QString message;
+};
+
+/**
+ * Splits the raw output of a build into lines and finds the file names, line
+ * numbers and messages in them.
+ *
+ * Doesn't touch any widget, the build view runs it in a separate thread and
+ * only adds the results. Resolved file names are cached per make directory for
+ * one build, the compilers report the same files over and over again.
+ */
+class BuildOutputParser
+{
+public:
+    /**
+     * Everything parsed from one chunk of output
+     */
+    struct Result {
+        QStringList lines;
+        QVector<BuildDiagnostic> diagnostics;
+    };
+
+    BuildOutputParser();
+
+    /**
+     * Forget the state of the last build.
+     * @param workDir directory the build runs in
+     */
+    void reset(const QString &workDir);
+
+    /**
+     * Parse the complete lines of a chunk of output, the rest is kept for the next chunk.
+     * @param data raw output, UTF-8
+     * @param stdErr data is from stderr, not stdout
+     */
+    void parse(const QByteArray &data, bool stdErr, Result &result);
+
+    /**
+     * Parse the last lines without line break after the build exited.
+     */
+    void finish(Result &result);
+
+    /**
+     * marker prepended to the ninja status lines via NINJA_STATUS
+     */
+    static QString ninjaPrefix();
+
+private:
+    void parseLines(QByteArray &buffer, bool stdErr, bool final, Result &result);
+    void parseLine(QString line, bool stdErr, Result &result);
+    BuildDiagnostic processLine(const QString &line);
+    QString resolvePath(const QString &filename);
+
+private:
+    QByteArray m_stdOut;
+    QByteArray m_stdErr;
+    QString m_makeDir;
+    QStack<QString> m_makeDirStack;
+    QRegularExpression m_filenameDetector;
+    QRegularExpression m_filenameDetectorIcpc;
+    QRegularExpression m_newDirDetector;
+    bool m_filenameDetectorGccWorked = false;
+    bool m_ninjaBuildDetected = false;
+
+    /**
+     * make directory => file name as reported => resolved path
+     */
+    QHash<QString, QHash<QString, QString>> m_resolvedPaths;
+};
+
+#endif
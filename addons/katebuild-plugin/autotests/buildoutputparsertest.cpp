@@ -0,0 +1,175 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   Copyright 2020 Kate Developers <kwrite-devel@kde.org>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "buildoutputparsertest.h"
+#include "BuildOutputParser.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+QTEST_MAIN(BuildOutputParserTest)
+
+static bool createFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly);
+}
+
+void BuildOutputParserTest::testChunks()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(createFile(dir.path() + QStringLiteral("/main.cpp")));
+    const QString mainFile = QFileInfo(dir.path() + QStringLiteral("/main.cpp")).canonicalFilePath();
+
+    BuildOutputParser parser;
+    parser.reset(dir.path());
+
+    // a line split over chunks is only parsed once it is complete
+    BuildOutputParser::Result result;
+    parser.parse("main.cpp:1", true, result);
+    QVERIFY(result.lines.isEmpty());
+    QVERIFY(result.diagnostics.isEmpty());
+
+    parser.parse("4: error: bad\r\nmain.cpp:2", true, result);
+    QCOMPARE(result.lines, QStringList(QStringLiteral("main.cpp:14: error: bad")));
+    QCOMPARE(result.diagnostics.size(), 1);
+    QCOMPARE(result.diagnostics[0].file, mainFile);
+    QCOMPARE(result.diagnostics[0].line, QStringLiteral("14"));
+    QCOMPARE(result.diagnostics[0].column, QStringLiteral("1"));
+    QCOMPARE(result.diagnostics[0].message, QStringLiteral(": error: bad"));
+
+    // stdout and stderr are split on their own
+    parser.parse("some ", false, result);
+    parser.parse("0: warning: w\n", true, result);
+    parser.parse("output\n", false, result);
+    QCOMPARE(result.lines, QStringList({QStringLiteral("main.cpp:14: error: bad"), QStringLiteral("main.cpp:20: warning: w"), QStringLiteral("some output")}));
+    QCOMPARE(result.diagnostics.size(), 2);
+    QCOMPARE(result.diagnostics[1].line, QStringLiteral("20"));
+
+    // lines without a file name are kept as info
+    result = BuildOutputParser::Result();
+    parser.parse("linking\n", true, result);
+    QCOMPARE(result.diagnostics.size(), 1);
+    QVERIFY(result.diagnostics[0].file.isEmpty());
+    QCOMPARE(result.diagnostics[0].message, QStringLiteral("linking"));
+}
+
+void BuildOutputParserTest::testMakeDirectories()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("sub")));
+    QVERIFY(createFile(dir.path() + QStringLiteral("/a.cpp")));
+    QVERIFY(createFile(dir.path() + QStringLiteral("/sub/a.cpp")));
+    const QString topFile = QFileInfo(dir.path() + QStringLiteral("/a.cpp")).canonicalFilePath();
+    const QString subFile = QFileInfo(dir.path() + QStringLiteral("/sub/a.cpp")).canonicalFilePath();
+    const QString subDir = dir.path() + QStringLiteral("/sub");
+
+    BuildOutputParser parser;
+    parser.reset(dir.path());
+
+    // file names are resolved in the directory make is in
+    BuildOutputParser::Result result;
+    parser.parse("make[1]: Entering directory '" + subDir.toUtf8() + "'\n", false, result);
+    parser.parse("a.cpp:3: error: in sub\n", true, result);
+    QCOMPARE(result.diagnostics.size(), 1);
+    QCOMPARE(result.diagnostics[0].file, subFile);
+
+    // leaving it goes back to the one before
+    parser.parse("make[1]: Leaving directory '" + subDir.toUtf8() + "'\n", false, result);
+    parser.parse("a.cpp:5: error: on top\n", true, result);
+    QCOMPARE(result.diagnostics.size(), 2);
+    QCOMPARE(result.diagnostics[1].file, topFile);
+
+    // the directory lines are no diagnostics, but are shown
+    QCOMPARE(result.lines.size(), 4);
+
+    // a new build starts in the work directory again
+    parser.parse("make[1]: Entering directory '" + subDir.toUtf8() + "'\n", false, result);
+    parser.reset(dir.path());
+    result = BuildOutputParser::Result();
+    parser.parse("a.cpp:7: error: after reset\n", true, result);
+    QCOMPARE(result.diagnostics.size(), 1);
+    QCOMPARE(result.diagnostics[0].file, topFile);
+}
+
+void BuildOutputParserTest::testNinjaPrefix()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    BuildOutputParser parser;
+    parser.reset(dir.path());
+
+    // without ninja the output on stdout is no diagnostic
+    BuildOutputParser::Result result;
+    parser.parse("x.cpp:1: warning: make\n", false, result);
+    QCOMPARE(result.lines.size(), 1);
+    QVERIFY(result.diagnostics.isEmpty());
+
+    // the status lines of ninja lose their prefix and are no diagnostics either
+    const QByteArray prefix = BuildOutputParser::ninjaPrefix().toUtf8();
+    parser.parse(prefix + "[1/2] Building CXX object x.o\n", false, result);
+    QCOMPARE(result.lines.last(), QStringLiteral("[1/2] Building CXX object x.o"));
+    QVERIFY(result.diagnostics.isEmpty());
+
+    // ninja prints the compiler output on stdout
+    parser.parse("x.cpp:7: warning: ninja\n", false, result);
+    QCOMPARE(result.lines.last(), QStringLiteral("x.cpp:7: warning: ninja"));
+    QCOMPARE(result.diagnostics.size(), 1);
+    QCOMPARE(result.diagnostics[0].line, QStringLiteral("7"));
+    QCOMPARE(result.diagnostics[0].message, QStringLiteral(": warning: ninja"));
+
+    // the next build has to detect ninja again
+    parser.reset(dir.path());
+    result = BuildOutputParser::Result();
+    parser.parse("x.cpp:8: warning: make\n", false, result);
+    QVERIFY(result.diagnostics.isEmpty());
+}
+
+void BuildOutputParserTest::testFinalLine()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    BuildOutputParser parser;
+    parser.reset(dir.path());
+
+    // a last line without line break is only parsed after the build
+    BuildOutputParser::Result result;
+    parser.parse("x.cpp:9: error: last", true, result);
+    parser.parse("done", false, result);
+    QVERIFY(result.lines.isEmpty());
+    QVERIFY(result.diagnostics.isEmpty());
+
+    parser.finish(result);
+    QCOMPARE(result.lines, QStringList({QStringLiteral("done"), QStringLiteral("x.cpp:9: error: last")}));
+    QCOMPARE(result.diagnostics.size(), 1);
+    QCOMPARE(result.diagnostics[0].line, QStringLiteral("9"));
+
+    // nothing is left for a second call
+    result = BuildOutputParser::Result();
+    parser.finish(result);
+    QVERIFY(result.lines.isEmpty());
+}
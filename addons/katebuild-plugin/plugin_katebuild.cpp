@@ -27,7 +27,9 @@
 
 #include "plugin_katebuild.h"
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 
 #include <QCompleter>
 #include <QDir>
@@ -36,7 +38,6 @@
 #include <QFileInfo>
 #include <QIcon>
 #include <QKeyEvent>
-#include <QRegularExpressionMatch>
 #include <QScrollBar>
 #include <QString>
 
@@ -65,7 +66,21 @@ static const QString DefConfClean;
 static const QString DefTargetName = QStringLiteral("all");
 static const QString DefBuildCmd = QStringLiteral("make");
 static const QString DefCleanCmd = QStringLiteral("make clean");
-static const QString NinjaPrefix = QStringLiteral("[ninja]");
+
+/**
+ * delay between updates of the output widgets while building
+ */
+static const int FlushInterval = 40;
+
+/**
+ * lines kept in the full output view, the oldest ones are dropped
+ */
+static const int MaxOutputLines = 100000;
+
+/**
+ * info items in the error list, the lines after these are only in the full output view
+ */
+static const unsigned int MaxInfoItems = 10000;
 
 static QIcon messageIcon(KateBuildView::ErrorCategory severity)
 {
@@ -112,17 +127,8 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
     , m_buildWidget(nullptr)
     , m_outputWidgetWidth(0)
     , m_proc(this)
-    , m_stdOut()
-    , m_stdErr()
     , m_buildCancelled(false)
     , m_displayModeBeforeBuild(1)
-    // NOTE this will not allow spaces in file names.
-    // e.g. from gcc: "main.cpp:14: error: cannot convert ‘std::string’ to ‘int’ in return"
-    , m_filenameDetector(QStringLiteral("(([a-np-zA-Z]:[\\\\/])?[a-zA-Z0-9_\\.\\+\\-/\\\\]+\\.[a-zA-Z0-9]+):([0-9]+)(.*)"))
-    // e.g. from icpc: "main.cpp(14): error: no suitable conversion function from "std::string" to "int" exists"
-    , m_filenameDetectorIcpc(QStringLiteral("(([a-np-zA-Z]:[\\\\/])?[a-zA-Z0-9_\\.\\+\\-/\\\\]+\\.[a-zA-Z0-9]+)\\(([0-9]+)\\)(:.*)"))
-    , m_filenameDetectorGccWorked(false)
-    , m_newDirDetector(QStringLiteral("make\\[.+\\]: .+ '(.*)'"))
 {
     KXMLGUIClient::setComponentName(QStringLiteral("katebuild"), i18n("Kate Build Plugin"));
     setXMLFile(QStringLiteral("ui.rc"));
@@ -185,6 +191,8 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
 
     m_buildUi.plainTextEdit->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
     m_buildUi.plainTextEdit->setReadOnly(true);
+    m_buildUi.plainTextEdit->setMaximumBlockCount(MaxOutputLines);
+    m_buildUi.errTreeWidget->setUniformRowHeights(true);
     slotDisplayMode(FullOutput);
 
     connect(m_buildUi.displayModeSlider, &QSlider::valueChanged, this, &KateBuildView::slotDisplayMode);
@@ -207,6 +215,14 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
     connect(&m_proc, &KProcess::readyReadStandardError, this, &KateBuildView::slotReadReadyStdErr);
     connect(&m_proc, &KProcess::readyReadStandardOutput, this, &KateBuildView::slotReadReadyStdOut);
 
+    m_parseContext.moveToThread(&m_parseThread);
+    m_parseThread.setObjectName(QStringLiteral("KateBuildView parser"));
+    m_parseThread.start();
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FlushInterval);
+    connect(&m_flushTimer, &QTimer::timeout, this, &KateBuildView::slotFlushOutput);
+
     connect(m_win, &KTextEditor::MainWindow::unhandledShortcutOverride, this, &KateBuildView::handleEsc);
     connect(m_win, &KTextEditor::MainWindow::viewChanged, this, &KateBuildView::slotViewChanged);
 
@@ -226,6 +242,8 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
 /******************************************************************/
 KateBuildView::~KateBuildView()
 {
+    m_parseThread.quit();
+    m_parseThread.wait();
     m_win->guiFactory()->removeClient(this);
     delete m_toolView;
 }
@@ -342,53 +360,71 @@ void KateBuildView::writeSessionConfig(KConfigGroup &cg)
 /******************************************************************/
 void KateBuildView::slotNext()
 {
-    const int itemCount = m_buildUi.errTreeWidget->topLevelItemCount();
-    if (itemCount == 0) {
-        return;
-    }
+    selectError(adjacentError(m_buildUi.errTreeWidget->currentItem(), true));
+}
 
-    QTreeWidgetItem *item = m_buildUi.errTreeWidget->currentItem();
-    if (item && item->isHidden())
-        item = nullptr;
+/******************************************************************/
+void KateBuildView::slotPrev()
+{
+    selectError(adjacentError(m_buildUi.errTreeWidget->currentItem(), false));
+}
 
-    int i = (item == nullptr) ? -1 : m_buildUi.errTreeWidget->indexOfTopLevelItem(item);
+/******************************************************************/
+QTreeWidgetItem *KateBuildView::adjacentError(QTreeWidgetItem *current, bool forward) const
+{
+    // Search item which fit view settings and has desired data
+    // the visible categories are searched by position, the nearest hit wins
+    const int mode = m_buildUi.displayModeSlider->value();
+    const int position = current ? current->data(0, PositionRole).toInt() : (forward ? -1 : std::numeric_limits<int>::max());
+    auto positionOf = [](const QTreeWidgetItem *item) {
+        return item->data(0, PositionRole).toInt();
+    };
+
+    QTreeWidgetItem *result = nullptr;
+    for (int category = CategoryInfo; category <= CategoryError; ++category) {
+        if ((category == CategoryInfo && mode > 1) || (category == CategoryWarning && mode > 2)) {
+            continue;
+        }
 
-    while (++i < itemCount) {
-        item = m_buildUi.errTreeWidget->topLevelItem(i);
-        // Search item which fit view settings and has desired data
-        if (!item->text(1).isEmpty() && !item->isHidden() && item->data(1, Qt::UserRole).toInt()) {
-            m_buildUi.errTreeWidget->setCurrentItem(item);
-            m_buildUi.errTreeWidget->scrollToItem(item);
-            slotErrorSelected(item);
-            return;
+        const QVector<QTreeWidgetItem *> &items = m_categoryErrors[category];
+        QTreeWidgetItem *candidate = nullptr;
+        if (forward) {
+            const auto it = std::upper_bound(items.cbegin(), items.cend(), position, [positionOf](int pos, const QTreeWidgetItem *item) {
+                return pos < positionOf(item);
+            });
+            candidate = (it != items.cend()) ? *it : nullptr;
+        } else {
+            const auto it = std::lower_bound(items.cbegin(), items.cend(), position, [positionOf](const QTreeWidgetItem *item, int pos) {
+                return positionOf(item) < pos;
+            });
+            candidate = (it != items.cbegin()) ? *(it - 1) : nullptr;
+        }
+
+        if (candidate && (!result || (forward == (positionOf(candidate) < positionOf(result))))) {
+            result = candidate;
         }
     }
+    return result;
 }
 
 /******************************************************************/
-void KateBuildView::slotPrev()
+void KateBuildView::selectError(QTreeWidgetItem *item)
 {
-    const int itemCount = m_buildUi.errTreeWidget->topLevelItemCount();
-    if (itemCount == 0) {
+    if (!item) {
         return;
     }
 
-    QTreeWidgetItem *item = m_buildUi.errTreeWidget->currentItem();
-    if (item && item->isHidden())
-        item = nullptr;
-
-    int i = (item == nullptr) ? itemCount : m_buildUi.errTreeWidget->indexOfTopLevelItem(item);
+    m_buildUi.errTreeWidget->setCurrentItem(item);
+    m_buildUi.errTreeWidget->scrollToItem(item);
+    slotErrorSelected(item);
+}
 
-    while (--i >= 0) {
-        item = m_buildUi.errTreeWidget->topLevelItem(i);
-        // Search item which fit view settings and has desired data
-        if (!item->text(1).isEmpty() && !item->isHidden() && item->data(1, Qt::UserRole).toInt()) {
-            m_buildUi.errTreeWidget->setCurrentItem(item);
-            m_buildUi.errTreeWidget->scrollToItem(item);
-            slotErrorSelected(item);
-            return;
-        }
-    }
+/******************************************************************/
+int KateBuildView::errorLine(const QTreeWidgetItem *item)
+{
+    // prefer moving cursor's opinion if so available
+    const auto data = item->data(0, DataRole).value<ItemData>();
+    return data.cursor ? data.cursor->line() : item->data(1, Qt::UserRole).toInt();
 }
 
 /******************************************************************/
@@ -435,18 +471,33 @@ void KateBuildView::slotErrorSelected(QTreeWidgetItem *item)
 /******************************************************************/
 void KateBuildView::addError(const QString &filename, const QString &line, const QString &column, const QString &message)
 {
+    // The strings are twice in case kate is translated but not make.
+    const bool isError = message.contains(QLatin1String("error")) || message.contains(i18nc("The same word as 'make' uses to mark an error.", "error")) ||
+        message.contains(QLatin1String("undefined reference")) || message.contains(i18nc("The same word as 'ld' uses to mark an ...", "undefined reference"));
+    const bool isWarning = message.contains(QLatin1String("warning")) || message.contains(i18nc("The same word as 'make' uses to mark a warning.", "warning"));
+
+    // a build printing lots of other lines doesn't fill the list with them, the errors and warnings are still added
+    if (!isError && !isWarning) {
+        if (m_numInfos > MaxInfoItems) {
+            return;
+        }
+        // the last info item tells where the other lines are, it is counted once more to stop here
+        if (++m_numInfos == MaxInfoItems) {
+            addError(QString(), QStringLiteral("0"), QString(), i18n("Further messages are only shown in the output."));
+            return;
+        }
+    }
+
     ErrorCategory errorCategory = CategoryInfo;
     QTreeWidgetItem *item = new QTreeWidgetItem(m_buildUi.errTreeWidget);
     item->setBackground(1, Qt::gray);
-    // The strings are twice in case kate is translated but not make.
-    if (message.contains(QLatin1String("error")) || message.contains(i18nc("The same word as 'make' uses to mark an error.", "error")) || message.contains(QLatin1String("undefined reference")) ||
-        message.contains(i18nc("The same word as 'ld' uses to mark an ...", "undefined reference"))) {
+    if (isError) {
         errorCategory = CategoryError;
         item->setForeground(1, Qt::red);
         m_numErrors++;
         item->setHidden(false);
     }
-    if (message.contains(QLatin1String("warning")) || message.contains(i18nc("The same word as 'make' uses to mark a warning.", "warning"))) {
+    if (isWarning) {
         errorCategory = CategoryWarning;
         item->setForeground(1, Qt::yellow);
         m_numWarnings++;
@@ -472,6 +523,19 @@ void KateBuildView::addError(const QString &filename, const QString &line, const
     }
 
     item->setData(0, ErrorRole, errorCategory);
+    item->setData(0, PositionRole, m_buildUi.errTreeWidget->topLevelItemCount() - 1);
+
+    // index the items with a location, the lines of a file mostly come in order
+    const int lineNumber = line.toInt();
+    if (!filename.isEmpty() && lineNumber) {
+        m_categoryErrors[errorCategory].append(item);
+
+        QVector<QTreeWidgetItem *> &fileErrors = m_fileErrors[QUrl::fromLocalFile(filename)];
+        const auto it = std::upper_bound(fileErrors.begin(), fileErrors.end(), lineNumber, [](int l, const QTreeWidgetItem *other) {
+            return l < other->data(1, Qt::UserRole).toInt();
+        });
+        fileErrors.insert(it, item);
+    }
 
     // add tooltips in all columns
     // The enclosing <qt>...</qt> enables word-wrap for long error messages
@@ -511,16 +575,9 @@ void KateBuildView::addMarks(KTextEditor::Document *doc, bool mark)
     if (!iface || m_markedDocs.contains(doc))
         return;
 
-    QTreeWidgetItemIterator it(m_buildUi.errTreeWidget, QTreeWidgetItemIterator::All);
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        ++it;
-
-        auto filename = item->data(0, Qt::UserRole).toString();
-        auto url = QUrl::fromLocalFile(filename);
-        if (url != doc->url())
-            continue;
-
+    const QUrl url = doc->url();
+    const QVector<QTreeWidgetItem *> items = m_fileErrors.value(url);
+    for (QTreeWidgetItem *item : items) {
         auto line = item->data(1, Qt::UserRole).toInt();
         if (mark) {
             ErrorCategory category = static_cast<ErrorCategory>(item->data(0, ErrorRole).toInt());
@@ -559,6 +616,7 @@ void KateBuildView::addMarks(KTextEditor::Document *doc, bool mark)
                 QVariant var;
                 var.setValue(data);
                 item->setData(0, DataRole, var);
+                m_cursorDocs.insert(doc, url);
             }
         }
     }
@@ -574,11 +632,15 @@ void KateBuildView::addMarks(KTextEditor::Document *doc, bool mark)
 
 void KateBuildView::slotInvalidateMoving(KTextEditor::Document *doc)
 {
-    QTreeWidgetItemIterator it(m_buildUi.errTreeWidget, QTreeWidgetItemIterator::All);
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        ++it;
+    // the cursors were created for the url the document had back then
+    const auto it = m_cursorDocs.find(doc);
+    if (it == m_cursorDocs.end()) {
+        return;
+    }
 
+    const QVector<QTreeWidgetItem *> items = m_fileErrors.value(it.value());
+    m_cursorDocs.erase(it);
+    for (QTreeWidgetItem *item : items) {
         auto data = item->data(0, DataRole).value<ItemData>();
         if (data.cursor && data.cursor->document() == doc) {
             item->setData(0, DataRole, 0);
@@ -588,28 +650,21 @@ void KateBuildView::slotInvalidateMoving(KTextEditor::Document *doc)
 
 void KateBuildView::slotMarkClicked(KTextEditor::Document *doc, KTextEditor::Mark mark, bool &handled)
 {
-    auto tree = m_buildUi.errTreeWidget;
-    QTreeWidgetItemIterator it(tree, QTreeWidgetItemIterator::All);
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        ++it;
-
-        auto filename = item->data(0, Qt::UserRole).toString();
-        auto line = item->data(1, Qt::UserRole).toInt();
-        // prefer moving cursor's opinion if so available
-        auto data = item->data(0, DataRole).value<ItemData>();
-        if (data.cursor) {
-            line = data.cursor->line();
-        }
-        if (line - 1 == mark.line && QUrl::fromLocalFile(filename) == doc->url()) {
-            tree->blockSignals(true);
-            tree->setCurrentItem(item);
-            tree->scrollToItem(item, QAbstractItemView::PositionAtCenter);
-            tree->blockSignals(false);
-            handled = true;
-            break;
-        }
+    // the items of a file stay sorted by the moving cursors, too
+    const QVector<QTreeWidgetItem *> items = m_fileErrors.value(doc->url());
+    const auto it = std::lower_bound(items.cbegin(), items.cend(), mark.line + 1, [](const QTreeWidgetItem *item, int line) {
+        return errorLine(item) < line;
+    });
+    if (it == items.cend() || errorLine(*it) != mark.line + 1) {
+        return;
     }
+
+    auto tree = m_buildUi.errTreeWidget;
+    tree->blockSignals(true);
+    tree->setCurrentItem(*it);
+    tree->scrollToItem(*it, QAbstractItemView::PositionAtCenter);
+    tree->blockSignals(false);
+    handled = true;
 }
 
 void KateBuildView::slotViewChanged()
@@ -669,11 +724,18 @@ void KateBuildView::clearBuildResults()
     clearMarks();
     m_buildUi.plainTextEdit->clear();
     m_buildUi.errTreeWidget->clear();
-    m_stdOut.clear();
-    m_stdErr.clear();
+    m_fileErrors.clear();
+    for (auto &items : m_categoryErrors) {
+        items.clear();
+    }
+    m_cursorDocs.clear();
+    m_pendingLines.clear();
+    m_pendingDiagnostics.clear();
+    m_flushTimer.stop();
+    ++m_build;
     m_numErrors = 0;
     m_numWarnings = 0;
-    m_make_dir_stack.clear();
+    m_numInfos = 0;
 }
 
 /******************************************************************/
@@ -694,7 +756,6 @@ bool KateBuildView::startProcess(const QString &dir, const QString &command)
 
     // set working directory
     m_make_dir = dir;
-    m_make_dir_stack.push(m_make_dir);
 
     if (!QFile::exists(m_make_dir)) {
         KMessageBox::error(nullptr, i18n("Cannot run command: %1\nWork path does not exist: %2", command, m_make_dir));
@@ -707,8 +768,11 @@ bool KateBuildView::startProcess(const QString &dir, const QString &command)
     const auto nstatus = QStringLiteral("NINJA_STATUS");
     auto curr = env.value(nstatus, QStringLiteral("[%f/%t] "));
     // add marker to search on later on
-    env.insert(nstatus, NinjaPrefix + curr);
-    m_ninjaBuildDetected = false;
+    env.insert(nstatus, BuildOutputParser::ninjaPrefix() + curr);
+
+    // start parsing from scratch, results for the last build still in the queue are dropped
+    QMetaObject::invokeMethod(
+        &m_parseContext, [this, dir]() { m_parser.reset(dir); }, Qt::QueuedConnection);
 
     m_proc.setProcessEnvironment(env);
     m_proc.setWorkingDirectory(m_make_dir);
@@ -836,7 +900,6 @@ bool KateBuildView::buildCurrentTarget()
         buildCmd.replace(QStringLiteral("%f"), docFInfo.absoluteFilePath());
         buildCmd.replace(QStringLiteral("%d"), docFInfo.absolutePath());
     }
-    m_filenameDetectorGccWorked = false;
     m_currentlyBuildingTarget = QStringLiteral("%1: %2").arg(targetSet, cmdName);
     m_buildCancelled = false;
     QString msg = i18n("Building target <b>%1</b> ...", m_currentlyBuildingTarget);
@@ -864,6 +927,33 @@ void KateBuildView::displayBuildResult(const QString &msg, KTextEditor::Message:
 
 /******************************************************************/
 void KateBuildView::slotProcExited(int exitCode, QProcess::ExitStatus)
+{
+    // the output not read yet and the last lines without line break are still to parse
+    slotReadReadyStdOut();
+    slotReadReadyStdErr();
+
+    const int build = m_build;
+    QMetaObject::invokeMethod(
+        &m_parseContext,
+        [this, build, exitCode]() {
+            BuildOutputParser::Result result;
+            m_parser.finish(result);
+            QMetaObject::invokeMethod(
+                this,
+                [this, build, exitCode, result]() {
+                    addParseResult(build, result);
+                    if (build == m_build) {
+                        slotFlushOutput();
+                        buildFinished(exitCode);
+                    }
+                },
+                Qt::QueuedConnection);
+        },
+        Qt::QueuedConnection);
+}
+
+/******************************************************************/
+void KateBuildView::buildFinished(int exitCode)
 {
     QApplication::restoreOverrideCursor();
     m_buildUi.cancelBuildButton->setEnabled(false);
@@ -915,119 +1005,70 @@ void KateBuildView::slotProcExited(int exitCode, QProcess::ExitStatus)
 /******************************************************************/
 void KateBuildView::slotReadReadyStdOut()
 {
-    // read data from procs stdout and add
-    // the text to the end of the output
-    // FIXME This works for utf8 but not for all charsets
-    QString l = QString::fromUtf8(m_proc.readAllStandardOutput());
-    l.remove(QLatin1Char('\r'));
-    m_stdOut += l;
-
-    // handle one line at a time
-    do {
-        const int end = m_stdOut.indexOf(QLatin1Char('\n'));
-        if (end < 0)
-            break;
-
-        QString line = m_stdOut.mid(0, end);
-        const bool ninjaOutput = line.startsWith(NinjaPrefix);
-        m_ninjaBuildDetected |= ninjaOutput;
-        if (ninjaOutput) {
-            line = line.mid(NinjaPrefix.length());
-        }
-        m_buildUi.plainTextEdit->appendPlainText(line);
-        // qDebug() << line;
-
-        QRegularExpressionMatch match = m_newDirDetector.match(line);
-
-        if (match.hasMatch()) {
-            // qDebug() << "Enter/Exit dir found";
-            QString newDir = match.captured(1);
-            // qDebug () << "New dir = " << newDir;
-
-            if ((m_make_dir_stack.size() > 1) && (m_make_dir_stack.top() == newDir)) {
-                m_make_dir_stack.pop();
-                newDir = m_make_dir_stack.top();
-            } else {
-                m_make_dir_stack.push(newDir);
-            }
-
-            m_make_dir = newDir;
-        } else if (m_ninjaBuildDetected && !ninjaOutput) {
-            processLine(line);
-        }
-
-        m_stdOut.remove(0, end + 1);
-    } while (1);
+    parseOutput(m_proc.readAllStandardOutput(), false);
 }
 
 /******************************************************************/
 void KateBuildView::slotReadReadyStdErr()
 {
-    // FIXME This works for utf8 but not for all charsets
-    QString l = QString::fromUtf8(m_proc.readAllStandardError());
-    l.remove(QLatin1Char('\r'));
-    m_stdErr += l;
-
-    do {
-        const int end = m_stdErr.indexOf(QLatin1Char('\n'));
-        if (end < 0)
-            break;
-
-        const QString line = m_stdErr.mid(0, end);
-        m_buildUi.plainTextEdit->appendPlainText(line);
-
-        processLine(line);
-
-        m_stdErr.remove(0, end + 1);
-    } while (1);
+    parseOutput(m_proc.readAllStandardError(), true);
 }
 
 /******************************************************************/
-void KateBuildView::processLine(const QString &line)
+void KateBuildView::parseOutput(const QByteArray &data, bool stdErr)
 {
-    // qDebug() << line ;
+    if (data.isEmpty()) {
+        return;
+    }
 
-    // look for a filename
-    QRegularExpressionMatch match = m_filenameDetector.match(line);
+    // the parser thread handles the chunks in order, stdout and stderr stay interleaved as read
+    const int build = m_build;
+    QMetaObject::invokeMethod(
+        &m_parseContext,
+        [this, build, data, stdErr]() {
+            BuildOutputParser::Result result;
+            m_parser.parse(data, stdErr, result);
+            if (result.lines.isEmpty()) {
+                return;
+            }
+            QMetaObject::invokeMethod(
+                this, [this, build, result]() { addParseResult(build, result); }, Qt::QueuedConnection);
+        },
+        Qt::QueuedConnection);
+}
 
-    if (match.hasMatch()) {
-        m_filenameDetectorGccWorked = true;
-    } else {
-        if (!m_filenameDetectorGccWorked) {
-            // let's see whether the icpc regexp works:
-            // so for icpc users error detection will be a bit slower,
-            // since always both regexps are checked.
-            // But this should be the minority, for gcc and clang users
-            // both regexes will only be checked until the first regex
-            // matched the first time.
-            match = m_filenameDetectorIcpc.match(line);
-        }
+/******************************************************************/
+void KateBuildView::addParseResult(int build, const BuildOutputParser::Result &result)
+{
+    if (build != m_build) {
+        return;
     }
 
-    if (!match.hasMatch()) {
-        addError(QString(), QStringLiteral("0"), QString(), line);
-        // kDebug() << "A filename was not found in the line ";
-        return;
+    m_pendingLines += result.lines;
+    m_pendingDiagnostics += result.diagnostics;
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
     }
+}
 
-    QString filename = match.captured(1);
-    const QString line_n = match.captured(3);
-    const QString msg = match.captured(4);
+/******************************************************************/
+void KateBuildView::slotFlushOutput()
+{
+    m_flushTimer.stop();
 
-    // qDebug() << "File Name:"<<filename<< " msg:"<< msg;
-    // add path to file
-    if (QFile::exists(m_make_dir + QLatin1Char('/') + filename)) {
-        filename = m_make_dir + QLatin1Char('/') + filename;
+    if (!m_pendingLines.isEmpty()) {
+        m_buildUi.plainTextEdit->appendPlainText(m_pendingLines.join(QLatin1Char('\n')));
+        m_pendingLines.clear();
     }
 
-    // get canonical path, if possible, to avoid duplicated opened files
-    auto canonicalFilePath(QFileInfo(filename).canonicalFilePath());
-    if (!canonicalFilePath.isEmpty()) {
-        filename = canonicalFilePath;
+    if (!m_pendingDiagnostics.isEmpty()) {
+        m_buildUi.errTreeWidget->setUpdatesEnabled(false);
+        for (const BuildDiagnostic &diagnostic : qAsConst(m_pendingDiagnostics)) {
+            addError(diagnostic.file, diagnostic.line, diagnostic.column, diagnostic.message);
+        }
+        m_buildUi.errTreeWidget->setUpdatesEnabled(true);
+        m_pendingDiagnostics.clear();
     }
-
-    // Now we have the data we need show the error/warning
-    addError(filename, line_n, QStringLiteral("1"), msg);
 }
 
 /******************************************************************/
@@ -28,9 +28,12 @@
 #include <KProcess>
 #include <QHash>
 #include <QPointer>
-#include <QRegularExpression>
-#include <QStack>
 #include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
 
 #include <KTextEditor/Document>
 #include <KTextEditor/MainWindow>
@@ -43,6 +46,7 @@
 #include <KConfigGroup>
 #include <KXMLGUIClient>
 
+#include "BuildOutputParser.h"
 #include "targets.h"
 #include "ui_build.h"
 
@@ -56,7 +60,7 @@ class KateBuildView : public QObject, public KXMLGUIClient, public KTextEditor::
 public:
     enum ResultDetails { FullOutput, ParsedOutput, ErrorsAndWarnings, OnlyErrors };
 
-    enum TreeWidgetRoles { ErrorRole = Qt::UserRole + 1, DataRole };
+    enum TreeWidgetRoles { ErrorRole = Qt::UserRole + 1, DataRole, PositionRole };
 
     enum ErrorCategory { CategoryInfo, CategoryWarning, CategoryError };
 
@@ -101,6 +105,8 @@ private Q_SLOTS:
 
     void handleEsc(QEvent *e);
 
+    void slotFlushOutput();
+
     void slotViewChanged();
     void slotDisplayOption();
     void slotMarkClicked(KTextEditor::Document *doc, KTextEditor::Mark mark, bool &handled);
@@ -117,7 +123,9 @@ protected:
     bool eventFilter(QObject *obj, QEvent *ev) override;
 
 private:
-    void processLine(const QString &);
+    void parseOutput(const QByteArray &data, bool stdErr);
+    void addParseResult(int build, const BuildOutputParser::Result &result);
+    void buildFinished(int exitCode);
     void addError(const QString &filename, const QString &line, const QString &column, const QString &message);
     bool startProcess(const QString &dir, const QString &command);
     bool checkLocal(const QUrl &dir);
@@ -128,6 +136,10 @@ private:
     void clearMarks();
     void addMarks(KTextEditor::Document *doc, bool mark);
 
+    QTreeWidgetItem *adjacentError(QTreeWidgetItem *current, bool forward) const;
+    void selectError(QTreeWidgetItem *item);
+    static int errorLine(const QTreeWidgetItem *item);
+
     KTextEditor::MainWindow *m_win;
     QWidget *m_toolView;
     Ui::build m_buildUi;
@@ -135,26 +147,41 @@ private:
     int m_outputWidgetWidth;
     TargetsUi *m_targetsUi;
     KProcess m_proc;
-    QString m_stdOut;
-    QString m_stdErr;
     QString m_currentlyBuildingTarget;
     bool m_buildCancelled;
     int m_displayModeBeforeBuild;
     QString m_make_dir;
-    QStack<QString> m_make_dir_stack;
-    QRegularExpression m_filenameDetector;
-    QRegularExpression m_filenameDetectorIcpc;
-    bool m_filenameDetectorGccWorked;
-    bool m_ninjaBuildDetected;
-    QRegularExpression m_newDirDetector;
+
+    /**
+     * the output is parsed in the parser thread, results of older builds are dropped
+     * parsed lines and errors are added to the widgets in batches, a few times per second
+     */
+    QThread m_parseThread;
+    QObject m_parseContext;
+    BuildOutputParser m_parser;
+    int m_build = 0;
+    QStringList m_pendingLines;
+    QVector<BuildDiagnostic> m_pendingDiagnostics;
+    QTimer m_flushTimer;
+
     unsigned int m_numErrors;
     unsigned int m_numWarnings;
+    unsigned int m_numInfos = 0;
     QString m_prevItemContent;
     QModelIndex m_previousIndex;
     QPointer<KTextEditor::Message> m_infoMessage;
     QPointer<QAction> m_showMarks;
     QHash<KTextEditor::Document *, QPointer<KTextEditor::Document>> m_markedDocs;
 
+    /**
+     * index of the error list items with a location
+     * per file sorted by line, the moving cursors of a document keep that order
+     * per category in the order of the list, the position is stored in the PositionRole
+     */
+    QHash<QUrl, QVector<QTreeWidgetItem *>> m_fileErrors;
+    QVector<QTreeWidgetItem *> m_categoryErrors[CategoryError + 1];
+    QHash<KTextEditor::Document *, QUrl> m_cursorDocs;
+
     /**
      * current project plugin view, if any
      */
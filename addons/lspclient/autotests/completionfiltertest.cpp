@@ -0,0 +1,83 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "completionfiltertest.h"
+#include "lspclientcompletionfilter.h"
+
+#include <QtTest>
+
+QTEST_MAIN(CompletionFilterTest)
+
+void CompletionFilterTest::testScore()
+{
+    const QString text = QStringLiteral("setCurrentIndex");
+
+    QCOMPARE(LSPCompletionFilter::score(QString(), text), 0);
+    QCOMPARE(LSPCompletionFilter::score(QStringLiteral("xyz"), text), -1);
+    QVERIFY(LSPCompletionFilter::score(QStringLiteral("sci"), text) >= 0);
+    QVERIFY(LSPCompletionFilter::score(QStringLiteral("SCI"), text) >= 0);
+
+    // prefix over word starts over anything else
+    QVERIFY(LSPCompletionFilter::score(QStringLiteral("setc"), text) > LSPCompletionFilter::score(QStringLiteral("setc"), QStringLiteral("resetCurrent")));
+    QVERIFY(LSPCompletionFilter::score(QStringLiteral("ind"), text) > LSPCompletionFilter::score(QStringLiteral("ind"), QStringLiteral("ainxd")));
+
+    // matching case is a tie breaker
+    QVERIFY(LSPCompletionFilter::score(QStringLiteral("setC"), text) > LSPCompletionFilter::score(QStringLiteral("setc"), text));
+}
+
+void CompletionFilterTest::testFilter()
+{
+    LSPCompletionFilter filter;
+    filter.setItems({QStringLiteral("resize"), QStringLiteral("reserve"), QStringLiteral("size"), QStringLiteral("capacity"), QStringLiteral("rbegin")});
+
+    // no prefix keeps the given order
+    QCOMPARE(filter.filter(QString()), QVector<int>({0, 1, 2, 3, 4}));
+
+    // equal scores keep the given order as well
+    QCOMPARE(filter.filter(QStringLiteral("res")), QVector<int>({0, 1}));
+
+    // a prefix match ranks before an inner one
+    filter.setItems({QStringLiteral("isEmpty"), QStringLiteral("empty")});
+    QCOMPARE(filter.filter(QStringLiteral("emp")), QVector<int>({1, 0}));
+}
+
+void CompletionFilterTest::testNarrowing()
+{
+    LSPCompletionFilter filter;
+    filter.setItems({QStringLiteral("append"), QStringLiteral("at"), QStringLiteral("apply"), QStringLiteral("back")});
+
+    QCOMPARE(filter.filter(QStringLiteral("a")), QVector<int>({0, 1, 2, 3}));
+    QCOMPARE(filter.filter(QStringLiteral("ap")), QVector<int>({0, 2}));
+    QCOMPARE(filter.filter(QStringLiteral("app")), QVector<int>({0, 2}));
+    QCOMPARE(filter.filter(QStringLiteral("appe")), QVector<int>({0}));
+
+    // going back filters all items again
+    QCOMPARE(filter.filter(QStringLiteral("a")).size(), 4);
+    QCOMPARE(filter.filter(QStringLiteral("b")), QVector<int>({3}));
+
+    // new items start over
+    filter.setItems({QStringLiteral("data")});
+    QCOMPARE(filter.filter(QStringLiteral("b")), QVector<int>());
+}
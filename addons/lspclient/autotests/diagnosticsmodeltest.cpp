@@ -0,0 +1,148 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "diagnosticsmodeltest.h"
+#include "lspclientdiagnosticsmodel.h"
+
+#include <QtTest>
+
+QTEST_MAIN(DiagnosticsModelTest)
+
+static LSPDiagnostic makeDiagnostic(int line, const QString &message, const QList<LSPDiagnosticRelatedInformation> &related = {})
+{
+    LSPDiagnostic diagnostic;
+    diagnostic.range = LSPRange(line, 0, line, 4);
+    diagnostic.severity = LSPDiagnosticSeverity::Warning;
+    diagnostic.source = QStringLiteral("clang");
+    diagnostic.message = message;
+    diagnostic.relatedInformation = related;
+    return diagnostic;
+}
+
+static const QUrl FileA = QUrl::fromLocalFile(QStringLiteral("/src/a.cpp"));
+static const QUrl FileB = QUrl::fromLocalFile(QStringLiteral("/src/b.cpp"));
+
+void DiagnosticsModelTest::testTree()
+{
+    LSPDiagnosticsModel model;
+
+    // related information without location is not shown
+    LSPDiagnosticRelatedInformation related;
+    related.location = {FileB, LSPRange(7, 1, 7, 2)};
+    related.message = QStringLiteral("declared here");
+    const auto fileIndex = model.setDiagnostics(FileA, {makeDiagnostic(3, QStringLiteral("unused")), makeDiagnostic(5, QStringLiteral("shadows"), {related, {}})});
+
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(fileIndex, model.index(0, 0));
+    QCOMPARE(fileIndex.data().toString(), FileA.path());
+    QCOMPARE(model.rowCount(fileIndex), 2);
+
+    const auto first = model.index(0, 0, fileIndex);
+    QCOMPARE(first.data().toString(), QStringLiteral("[clang] unused"));
+    QCOMPARE(first.data(LSPDiagnosticsModel::FileUrlRole).toUrl(), FileA);
+    QCOMPARE(first.data(LSPDiagnosticsModel::RangeRole).value<LSPRange>(), LSPRange(3, 0, 3, 4));
+    QCOMPARE(model.rowCount(first), 0);
+    QCOMPARE(first.parent(), fileIndex);
+
+    const auto second = model.index(1, 0, fileIndex);
+    QCOMPARE(model.rowCount(second), 1);
+    const auto relatedIndex = model.index(0, 0, second);
+    QCOMPARE(relatedIndex.data().toString(), QStringLiteral("[b.cpp:7] declared here"));
+    QCOMPARE(relatedIndex.data(LSPDiagnosticsModel::FileUrlRole).toUrl(), FileB);
+    QCOMPARE(relatedIndex.parent(), second);
+    QCOMPARE(relatedIndex.parent().parent(), fileIndex);
+    QVERIFY(!model.index(1, 0, second).isValid());
+
+    QCOMPARE(model.diagnosticIndex(FileA, 5), second);
+    QVERIFY(!model.diagnosticIndex(FileA, 4).isValid());
+    QVERIFY(!model.diagnosticIndex(FileB, 7).isValid());
+    QCOMPARE(model.diagnostic(second)->message, QStringLiteral("shadows"));
+    QVERIFY(!model.diagnostic(fileIndex));
+    QVERIFY(!model.diagnostic(relatedIndex));
+}
+
+void DiagnosticsModelTest::testReplace()
+{
+    LSPDiagnosticsModel model;
+    model.setDiagnostics(FileA, {makeDiagnostic(1, QStringLiteral("a1"))});
+    model.setDiagnostics(FileB, {makeDiagnostic(2, QStringLiteral("b1")), makeDiagnostic(3, QStringLiteral("b2"))});
+    QCOMPARE(model.rowCount(), 2);
+
+    // replacing keeps the file row
+    const auto fileIndex = model.setDiagnostics(FileA, {makeDiagnostic(4, QStringLiteral("a2")), makeDiagnostic(6, QStringLiteral("a3"))});
+    QCOMPARE(fileIndex.row(), 0);
+    QCOMPARE(model.rowCount(fileIndex), 2);
+    QCOMPARE(model.index(1, 0, fileIndex).data().toString(), QStringLiteral("[clang] a3"));
+
+    // no diagnostics remove it
+    QVERIFY(!model.setDiagnostics(FileA, {}).isValid());
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.fileIndex(FileB).row(), 0);
+    QVERIFY(!model.fileIndex(FileA).isValid());
+    QCOMPARE(model.fileCount(), 1);
+    QCOMPARE(model.fileUrl(0), FileB);
+    QCOMPARE(model.diagnostics(0).size(), 2);
+}
+
+void DiagnosticsModelTest::testCodeActions()
+{
+    LSPDiagnosticsModel model;
+    LSPDiagnosticRelatedInformation related;
+    related.location = {FileA, LSPRange(1, 0, 1, 1)};
+    const auto fileIndex = model.setDiagnostics(FileA, {makeDiagnostic(3, QStringLiteral("unused"), {related})});
+    const auto diagnosticIndex = model.index(0, 0, fileIndex);
+    QVERIFY(!model.hasCodeActions(diagnosticIndex));
+
+    LSPCodeAction fix;
+    fix.title = QStringLiteral("remove variable");
+    fix.kind = QStringLiteral("quickfix");
+    model.addCodeActions(diagnosticIndex, {fix}, {});
+    QVERIFY(model.hasCodeActions(diagnosticIndex));
+
+    // after the related information
+    QCOMPARE(model.rowCount(diagnosticIndex), 2);
+    QVERIFY(!model.codeAction(model.index(0, 0, diagnosticIndex)));
+    const auto actionIndex = model.index(1, 0, diagnosticIndex);
+    QCOMPARE(actionIndex.data().toString(), QStringLiteral("[quickfix] remove variable"));
+    QCOMPARE(model.codeAction(actionIndex)->action.title, fix.title);
+    QVERIFY(!model.codeAction(diagnosticIndex));
+
+    // no actions still counts as done
+    const auto otherIndex = model.setDiagnostics(FileB, {makeDiagnostic(1, QStringLiteral("b"))});
+    model.addCodeActions(model.index(0, 0, otherIndex), {}, {});
+    QVERIFY(model.hasCodeActions(model.index(0, 0, otherIndex)));
+    QCOMPARE(model.rowCount(model.index(0, 0, otherIndex)), 0);
+}
+
+void DiagnosticsModelTest::testRetainFiles()
+{
+    LSPDiagnosticsModel model;
+    model.setDiagnostics(FileA, {makeDiagnostic(1, QStringLiteral("a"))});
+    model.setDiagnostics(FileB, {makeDiagnostic(1, QStringLiteral("b"))});
+
+    model.retainFiles({FileB.path()});
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.index(0, 0).data().toString(), FileB.path());
+}
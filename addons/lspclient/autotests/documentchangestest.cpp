@@ -0,0 +1,222 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "documentchangestest.h"
+#include "lspclientdocumentchanges.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+QTEST_MAIN(DocumentChangesTest)
+
+static int offsetOf(const QString &text, const LSPPosition &pos)
+{
+    int offset = 0;
+    for (int line = 0; line < pos.line(); ++line) {
+        offset = text.indexOf(QLatin1Char('\n'), offset) + 1;
+    }
+    return offset + pos.column();
+}
+
+static LSPPosition positionOf(const QString &text, int offset)
+{
+    const int line = text.leftRef(offset).count(QLatin1Char('\n'));
+    const int lineStart = offset > 0 ? text.lastIndexOf(QLatin1Char('\n'), offset - 1) + 1 : 0;
+    return {line, offset - lineStart};
+}
+
+/**
+ * Stands in for a language server, applies the received changes to its copy of the text.
+ */
+class FakeServer
+{
+public:
+    explicit FakeServer(const QString &text)
+        : m_text(text)
+    {
+    }
+
+    void didChange(const QList<LSPTextDocumentContentChangeEvent> &changes)
+    {
+        for (const auto &change : changes) {
+            const int start = offsetOf(m_text, change.range.start());
+            const int end = offsetOf(m_text, change.range.end());
+            m_text.replace(start, end - start, change.text);
+        }
+    }
+
+    const QString &text() const
+    {
+        return m_text;
+    }
+
+private:
+    QString m_text;
+};
+
+/**
+ * Document edited like the editor would, every edit is recorded as a change.
+ */
+class Document
+{
+public:
+    explicit Document(const QString &text)
+        : m_text(text)
+    {
+    }
+
+    void replace(int start, int end, const QString &text)
+    {
+        m_changes.add({positionOf(m_text, start), positionOf(m_text, end)}, text);
+        m_text.replace(start, end - start, text);
+    }
+
+    const QString &text() const
+    {
+        return m_text;
+    }
+
+    LSPDocumentChanges &changes()
+    {
+        return m_changes;
+    }
+
+private:
+    QString m_text;
+    LSPDocumentChanges m_changes;
+};
+
+static const QString InitialText = QStringLiteral("int main()\n{\n    return 0;\n}\n");
+
+void DocumentChangesTest::testTyping()
+{
+    Document doc(InitialText);
+    FakeServer server(InitialText);
+
+    int cursor = offsetOf(doc.text(), {2, 4});
+    for (const QChar c : QStringLiteral("int x = 1;\n    ")) {
+        doc.replace(cursor, cursor, QString(c));
+        cursor++;
+    }
+
+    QCOMPARE(doc.changes().changes().size(), 1);
+    server.didChange(doc.changes().changes());
+    QCOMPARE(server.text(), doc.text());
+}
+
+void DocumentChangesTest::testBackspace()
+{
+    Document doc(InitialText);
+    FakeServer server(InitialText);
+
+    // type, then backspace over the typed text and beyond into the old text
+    int cursor = offsetOf(doc.text(), {2, 10});
+    for (const QChar c : QStringLiteral("ab\nc")) {
+        doc.replace(cursor, cursor, QString(c));
+        cursor++;
+    }
+    for (int i = 0; i < 8; ++i) {
+        doc.replace(cursor - 1, cursor, QString());
+        cursor--;
+    }
+
+    QCOMPARE(doc.changes().changes().size(), 1);
+    server.didChange(doc.changes().changes());
+    QCOMPARE(server.text(), doc.text());
+}
+
+void DocumentChangesTest::testDeleteForward()
+{
+    Document doc(InitialText);
+    FakeServer server(InitialText);
+
+    // type, then delete forward past the typed text and across a line break
+    int cursor = offsetOf(doc.text(), {1, 1});
+    doc.replace(cursor, cursor, QStringLiteral("xy"));
+    for (int i = 0; i < 6; ++i) {
+        doc.replace(cursor, cursor + 1, QString());
+    }
+
+    QCOMPARE(doc.changes().changes().size(), 1);
+    server.didChange(doc.changes().changes());
+    QCOMPARE(server.text(), doc.text());
+}
+
+void DocumentChangesTest::testSeparateEdits()
+{
+    Document doc(InitialText);
+    FakeServer server(InitialText);
+
+    // edits in different places stay separate changes
+    doc.replace(0, 3, QStringLiteral("long"));
+    doc.replace(offsetOf(doc.text(), {2, 11}), offsetOf(doc.text(), {2, 12}), QStringLiteral("42"));
+
+    QCOMPARE(doc.changes().changes().size(), 2);
+    server.didChange(doc.changes().changes());
+    QCOMPARE(server.text(), doc.text());
+}
+
+void DocumentChangesTest::testRandomEdits()
+{
+    QRandomGenerator random(4711);
+
+    for (int round = 0; round < 200; ++round) {
+        Document doc(InitialText);
+        FakeServer server(InitialText);
+
+        // mostly typing and deleting around a cursor, sometimes jumping elsewhere
+        int cursor = random.bounded(doc.text().size() + 1);
+        int edits = 0;
+        for (int i = 0; i < 50; ++i) {
+            if (random.bounded(10) == 0) {
+                cursor = random.bounded(doc.text().size() + 1);
+            }
+            const int kind = random.bounded(4);
+            if (kind == 0 && cursor > 0) {
+                doc.replace(cursor - 1, cursor, QString());
+                cursor--;
+            } else if (kind == 1 && cursor < doc.text().size()) {
+                const int end = qMin(doc.text().size(), cursor + 1 + random.bounded(5));
+                doc.replace(cursor, end, random.bounded(2) ? QString() : QStringLiteral("z\n"));
+            } else {
+                const QString text = random.bounded(5) == 0 ? QStringLiteral("\n") : QString(QChar(QLatin1Char('a' + random.bounded(26))));
+                doc.replace(cursor, cursor, text);
+                cursor += text.size();
+            }
+            edits++;
+
+            // flush now and then, like the debounce timer would
+            if (random.bounded(15) == 0) {
+                server.didChange(doc.changes().changes());
+                doc.changes().clear();
+                QCOMPARE(server.text(), doc.text());
+            }
+        }
+
+        server.didChange(doc.changes().changes());
+        QCOMPARE(server.text(), doc.text());
+        QVERIFY(doc.changes().changes().size() <= edits);
+    }
+}
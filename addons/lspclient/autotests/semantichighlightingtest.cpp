@@ -0,0 +1,156 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "semantichighlightingtest.h"
+#include "lspclientsemantichighlighting.h"
+
+#include <KTextEditor/Document>
+#include <KTextEditor/Editor>
+
+#include <QtTest>
+
+QTEST_MAIN(SemanticHighlightingTest)
+
+void SemanticHighlightingTest::testDecode()
+{
+    KTextEditor::Attribute::Ptr type(new KTextEditor::Attribute);
+    KTextEditor::Attribute::Ptr variable(new KTextEditor::Attribute);
+
+    // type 2 has no attribute and is dropped
+    const QVector<int> data {1, 2, 3, 0, 0, 0, 5, 1, 1, 0, 0, 2, 1, 2, 0, 2, 0, 4, 1, 0};
+    const auto tokens = LSPSemanticHighlighting::decode(data, {type, variable});
+
+    QCOMPARE(tokens.size(), 3);
+    QCOMPARE(tokens[0].line, 1);
+    QCOMPARE(tokens[0].column, 2);
+    QCOMPARE(tokens[0].length, 3);
+    QVERIFY(tokens[0].attribute == type);
+    QCOMPARE(tokens[1].line, 1);
+    QCOMPARE(tokens[1].column, 7);
+    QCOMPARE(tokens[1].length, 1);
+    QVERIFY(tokens[1].attribute == variable);
+    QCOMPARE(tokens[2].line, 3);
+    QCOMPARE(tokens[2].column, 0);
+    QCOMPARE(tokens[2].length, 4);
+    QVERIFY(tokens[2].attribute == variable);
+}
+
+void SemanticHighlightingTest::testDelta()
+{
+    LSPSemanticHighlighting highlighting(nullptr);
+
+    LSPSemanticTokensDelta full;
+    full.resultId = QStringLiteral("1");
+    full.data = {0, 4, 1, 0, 0, 1, 4, 1, 1, 0, 1, 4, 1, 1, 0};
+    QVERIFY(highlighting.applyTokens(full));
+    QCOMPARE(highlighting.resultId(), QStringLiteral("1"));
+
+    // edits refer to the data before any of them
+    LSPSemanticTokensDelta delta;
+    delta.resultId = QStringLiteral("2");
+    delta.isDelta = true;
+    delta.edits = {{0, 1, {2}}, {5, 5, {}}, {13, 1, {0, 7}}};
+    QVERIFY(highlighting.applyTokens(delta));
+    QCOMPARE(highlighting.resultId(), QStringLiteral("2"));
+    QCOMPARE(highlighting.tokenData(), QVector<int>({2, 4, 1, 0, 0, 1, 4, 1, 0, 7, 0}));
+
+    // a delta request may be answered in full
+    full.resultId = QStringLiteral("3");
+    full.data = {0, 0, 1, 0, 0};
+    QVERIFY(highlighting.applyTokens(full));
+    QCOMPARE(highlighting.resultId(), QStringLiteral("3"));
+    QCOMPARE(highlighting.tokenData(), full.data);
+}
+
+void SemanticHighlightingTest::testInvalidDelta()
+{
+    LSPSemanticHighlighting highlighting(nullptr);
+
+    // nothing to apply a delta to
+    LSPSemanticTokensDelta delta;
+    delta.resultId = QStringLiteral("2");
+    delta.isDelta = true;
+    delta.edits = {{0, 0, {0, 0, 1, 0, 0}}};
+    QVERIFY(!highlighting.applyTokens(delta));
+    QVERIFY(highlighting.resultId().isEmpty());
+
+    LSPSemanticTokensDelta full;
+    full.resultId = QStringLiteral("1");
+    full.data = {0, 4, 1, 0, 0};
+    QVERIFY(highlighting.applyTokens(full));
+
+    // edit beyond the data, start over
+    delta.edits = {{3, 5, {}}};
+    QVERIFY(!highlighting.applyTokens(delta));
+    QVERIFY(highlighting.resultId().isEmpty());
+    QVERIFY(highlighting.tokenData().isEmpty());
+}
+
+void SemanticHighlightingTest::testRecycleRanges()
+{
+    QScopedPointer<KTextEditor::Document> doc(KTextEditor::Editor::instance()->createDocument(nullptr));
+    doc->setText(QStringLiteral("int a;\nint b;\nint c;\n"));
+
+    KTextEditor::Attribute::Ptr type(new KTextEditor::Attribute);
+    KTextEditor::Attribute::Ptr variable(new KTextEditor::Attribute);
+    using Token = LSPSemanticHighlighting::Token;
+
+    LSPSemanticHighlighting highlighting(doc.data());
+    const QVector<Token> tokens {{0, 0, 3, type}, {0, 4, 1, variable}, {1, 0, 3, type}, {1, 4, 1, variable}, {2, 0, 3, type}, {2, 4, 1, variable}};
+    highlighting.setAll(tokens);
+    QCOMPARE(highlighting.rangeCount(), 6);
+    QCOMPARE(highlighting.pooledRangeCount(), 0);
+
+    // the same again keeps everything
+    highlighting.setAll(tokens);
+    QCOMPARE(highlighting.rangeCount(), 6);
+    QCOMPARE(highlighting.pooledRangeCount(), 0);
+
+    // a line losing its tokens hands its ranges to the pool
+    highlighting.setLines({1}, {});
+    QCOMPARE(highlighting.rangeCount(), 4);
+    QCOMPARE(highlighting.pooledRangeCount(), 2);
+
+    // and the next tokens take them from there
+    highlighting.setLines({1}, {{1, 4, 1, type}});
+    QCOMPARE(highlighting.rangeCount(), 5);
+    QCOMPARE(highlighting.pooledRangeCount(), 1);
+
+    // ranges follow the edits, line 2 is line 3 now
+    doc->insertText({0, 0}, QStringLiteral("\n"));
+    highlighting.setLines({3}, {{3, 0, 3, variable}, {3, 4, 1, type}});
+    QCOMPARE(highlighting.rangeCount(), 5);
+    QCOMPARE(highlighting.pooledRangeCount(), 1);
+
+    // deleting the text of a token invalidates its range, it is recycled on the next update
+    doc->removeText({1, 4, 1, 5});
+    highlighting.setLines({3}, {{3, 0, 3, variable}, {3, 4, 1, type}});
+    QCOMPARE(highlighting.rangeCount(), 4);
+    QCOMPARE(highlighting.pooledRangeCount(), 2);
+
+    highlighting.setAll({});
+    QCOMPARE(highlighting.rangeCount(), 0);
+    QCOMPARE(highlighting.pooledRangeCount(), 6);
+}
@@ -0,0 +1,153 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "serverstatisticstest.h"
+#include "lspclientserverstatistics.h"
+
+#include <QJsonArray>
+#include <QtTest>
+
+QTEST_MAIN(ServerStatisticsTest)
+
+static LSPServerStatistics::Message makeMessage(int size, qint64 received, qint64 decodeTime, qint64 dispatched, qint64 handled)
+{
+    LSPServerStatistics::Message message;
+    message.size = size;
+    message.received = received;
+    message.decodeTime = decodeTime;
+    message.dispatched = dispatched;
+    message.handled = handled;
+    return message;
+}
+
+static const QString Hover = QStringLiteral("textDocument/hover");
+
+void ServerStatisticsTest::testRequests()
+{
+    LSPServerStatistics stats;
+
+    stats.sent(Hover, 1, 100, 0);
+    stats.sent(Hover, 2, 100, 1000);
+    stats.sent(QStringLiteral("textDocument/didChange"), -1, 50, 1000);
+    QCOMPARE(stats.pendingRequests(), 2);
+
+    // 3 ms in the server, 1 ms decoding, 1 ms waiting, 2 ms handling
+    stats.replied(1, makeMessage(400, 3000, 1000, 5000, 7000));
+    QCOMPARE(stats.pendingRequests(), 1);
+
+    // unknown ids are ignored
+    stats.replied(42, makeMessage(400, 3000, 1000, 5000, 7000));
+
+    const auto &hover = stats.methods().value(Hover);
+    QCOMPARE(hover.requests, 2);
+    QCOMPARE(hover.replies, 1);
+    QCOMPARE(hover.bytesSent, qint64(200));
+    QCOMPARE(hover.bytesReceived, qint64(400));
+    QCOMPARE(hover.latencyTotal, qint64(3000));
+    QCOMPARE(hover.latencyMax, qint64(3000));
+    QCOMPARE(hover.decodeTotal, qint64(1000));
+    QCOMPARE(hover.waitTotal, qint64(1000));
+    QCOMPARE(hover.handleTotal, qint64(2000));
+    // 3 ms are in the <= 5 ms bucket
+    QCOMPARE(hover.histogram.at(2), 1);
+
+    const auto &change = stats.methods().value(QStringLiteral("textDocument/didChange"));
+    QCOMPARE(change.notifications, 1);
+    QCOMPARE(change.requests, 0);
+
+    stats.notified(QStringLiteral("textDocument/publishDiagnostics"), makeMessage(1000, 0, 10, 20, 30));
+    QCOMPARE(stats.methods().value(QStringLiteral("textDocument/publishDiagnostics")).received, 1);
+    QCOMPARE(stats.pendingRequests(), 1);
+
+    stats.payloadQueued();
+    stats.payloadQueued();
+    stats.payloadDequeued();
+    QCOMPARE(stats.decodeQueue(), 1);
+}
+
+void ServerStatisticsTest::testCancel()
+{
+    LSPServerStatistics stats;
+
+    stats.sent(Hover, 1, 10, 0);
+    stats.sent(Hover, 2, 10, 0);
+    stats.sent(Hover, 3, 10, 0);
+    stats.cancelled(1, false);
+    stats.cancelled(2, true);
+    // already gone
+    stats.cancelled(2, false);
+    QCOMPARE(stats.pendingRequests(), 1);
+
+    // a late reply to a cancelled request is not counted
+    stats.replied(1, makeMessage(10, 10, 0, 10, 10));
+
+    const auto &hover = stats.methods().value(Hover);
+    QCOMPARE(hover.cancelled, 1);
+    QCOMPARE(hover.expired, 1);
+    QCOMPARE(hover.replies, 0);
+
+    stats.abandonPending();
+    QCOMPARE(stats.pendingRequests(), 0);
+}
+
+void ServerStatisticsTest::testPercentile()
+{
+    const int buckets = LSPServerStatistics::latencyBuckets().size();
+    QVector<int> histogram(buckets + 1);
+    QCOMPARE(LSPServerStatistics::percentile(histogram, 50), -1);
+
+    // 6 replies <= 1 ms, 3 <= 10 ms, 1 too slow for any bucket
+    histogram[0] = 6;
+    histogram[3] = 3;
+    histogram[buckets] = 1;
+    QCOMPARE(LSPServerStatistics::percentile(histogram, 50), 1);
+    QCOMPARE(LSPServerStatistics::percentile(histogram, 60), 1);
+    QCOMPARE(LSPServerStatistics::percentile(histogram, 90), 10);
+    QCOMPARE(LSPServerStatistics::percentile(histogram, 100), -1);
+}
+
+void ServerStatisticsTest::testJson()
+{
+    LSPServerStatistics stats;
+    stats.sent(Hover, 1, 10, 0);
+    stats.sent(Hover, 2, 10, 0);
+    stats.replied(1, makeMessage(20, 2000, 0, 2000, 2000));
+
+    const auto json = stats.toJson();
+    QCOMPARE(json.value(QStringLiteral("pendingRequests")).toInt(), 1);
+    QCOMPARE(json.value(QStringLiteral("maxPendingRequests")).toInt(), 2);
+
+    const auto hover = json.value(QStringLiteral("methods")).toObject().value(Hover).toObject();
+    QCOMPARE(hover.value(QStringLiteral("requests")).toInt(), 2);
+    QCOMPARE(hover.value(QStringLiteral("latencyAverage")).toDouble(), 2.0);
+    QCOMPARE(hover.value(QStringLiteral("latencyHistogram")).toArray().size(), LSPServerStatistics::latencyBuckets().size() + 1);
+
+    // clearing keeps the pending requests
+    stats.clear();
+    QVERIFY(stats.methods().isEmpty());
+    QCOMPARE(stats.pendingRequests(), 1);
+    stats.replied(2, makeMessage(20, 4000, 0, 4000, 4000));
+    QCOMPARE(stats.methods().value(Hover).replies, 1);
+}
@@ -0,0 +1,141 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "symbolindextest.h"
+#include "lspclientsymbolindex.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+QTEST_MAIN(SymbolIndexTest)
+
+static const QUrl FileA = QUrl::fromLocalFile(QStringLiteral("/src/a.cpp"));
+static const QUrl FileB = QUrl::fromLocalFile(QStringLiteral("/src/b.cpp"));
+
+static QList<LSPSymbolInformation> classSymbols(const QString &className, const QStringList &methods)
+{
+    LSPSymbolInformation cls(className, LSPSymbolKind::Class, LSPRange(0, 0, 10, 0), QString());
+    int line = 1;
+    for (const auto &method : methods) {
+        LSPSymbolInformation function(method, LSPSymbolKind::Method, LSPRange(line, 4, line, 20), QString());
+        // locals are not indexed
+        function.children.push_back(LSPSymbolInformation(QStringLiteral("local"), LSPSymbolKind::Variable, LSPRange(line, 8, line, 12), QString()));
+        cls.children.push_back(function);
+        ++line;
+    }
+    return {cls};
+}
+
+static QStringList names(const QVector<LSPSymbolIndex::Symbol> &symbols)
+{
+    QStringList result;
+    for (const auto &symbol : symbols) {
+        result.push_back(symbol.name);
+    }
+    return result;
+}
+
+void SymbolIndexTest::testFind()
+{
+    LSPSymbolIndex index;
+    index.setSymbols(FileA, 1, classSymbols(QStringLiteral("Document"), {QStringLiteral("setText"), QStringLiteral("text"), QStringLiteral("textLength")}));
+    index.setSymbols(FileB, 2, classSymbols(QStringLiteral("TextCursor"), {QStringLiteral("setPosition")}));
+
+    QCOMPARE(index.fileCount(), 2);
+    QCOMPARE(index.symbolCount(), 6);
+    QVERIFY(index.find(QStringLiteral("local"), 10).isEmpty());
+
+    // exact and prefix matches first, shorter names first
+    QCOMPARE(names(index.find(QStringLiteral("text"), 10)), QStringList({QStringLiteral("text"), QStringLiteral("textLength"), QStringLiteral("TextCursor"), QStringLiteral("setText")}));
+
+    // fuzzy, case insensitive, limited
+    const auto found = index.find(QStringLiteral("sp"), 10);
+    QCOMPARE(names(found), QStringList({QStringLiteral("setPosition")}));
+    QCOMPARE(found.first().container, QStringLiteral("TextCursor"));
+    QCOMPARE(found.first().url, FileB);
+    QCOMPARE(found.first().range, LSPRange(1, 4, 1, 20));
+    QCOMPARE(index.find(QStringLiteral("t"), 2).size(), 2);
+}
+
+void SymbolIndexTest::testReplace()
+{
+    LSPSymbolIndex index;
+    index.setSymbols(FileA, 1, classSymbols(QStringLiteral("Document"), {QStringLiteral("setText")}));
+    index.setSymbols(FileB, 1, classSymbols(QStringLiteral("View"), {QStringLiteral("setText")}));
+    QCOMPARE(index.find(QStringLiteral("setText"), 10).size(), 2);
+
+    QVERIFY(index.isUpToDate(FileA, 1));
+    QVERIFY(!index.isUpToDate(FileA, 2));
+    QVERIFY(!index.isUpToDate(QUrl::fromLocalFile(QStringLiteral("/src/c.cpp")), 1));
+
+    // new symbols replace the old ones of the file
+    index.setSymbols(FileA, 2, classSymbols(QStringLiteral("Document"), {QStringLiteral("clear")}));
+    QVERIFY(index.isUpToDate(FileA, 2));
+    QCOMPARE(index.find(QStringLiteral("setText"), 10).size(), 1);
+    QCOMPARE(index.find(QStringLiteral("clear"), 10).size(), 1);
+
+    index.retainFiles({FileA});
+    QCOMPARE(index.fileCount(), 1);
+    QVERIFY(index.find(QStringLiteral("setText"), 10).isEmpty());
+    QVERIFY(index.find(QStringLiteral("View"), 10).isEmpty());
+
+    // a removed file's slot is reused
+    index.setSymbols(FileB, 3, classSymbols(QStringLiteral("View"), {}));
+    QCOMPARE(index.fileCount(), 2);
+    QCOMPARE(index.symbolCount(), 3);
+}
+
+void SymbolIndexTest::testPersistence()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString indexFile = dir.filePath(QStringLiteral("index/project.symbols"));
+
+    LSPSymbolIndex index;
+    index.setSymbols(FileA, 1, classSymbols(QStringLiteral("Document"), {QStringLiteral("setText")}));
+    index.setSymbols(FileB, 5, classSymbols(QStringLiteral("View"), {QStringLiteral("setCursor")}));
+    index.removeFile(FileA);
+    QVERIFY(index.isModified());
+    QVERIFY(index.save(indexFile));
+    QVERIFY(!index.isModified());
+
+    LSPSymbolIndex loaded;
+    QVERIFY(loaded.load(indexFile));
+    QCOMPARE(loaded.fileCount(), 1);
+    QVERIFY(loaded.isUpToDate(FileB, 5));
+    const auto found = loaded.find(QStringLiteral("setCursor"), 10);
+    QCOMPARE(found.size(), 1);
+    QCOMPARE(found.first().container, QStringLiteral("View"));
+    QCOMPARE(found.first().kind, LSPSymbolKind::Method);
+    QCOMPARE(found.first().range, LSPRange(1, 4, 1, 20));
+
+    // anything else is no index
+    QFile broken(indexFile);
+    QVERIFY(broken.open(QIODevice::WriteOnly));
+    broken.write("garbage");
+    broken.close();
+    QVERIFY(!loaded.load(indexFile));
+    QCOMPARE(loaded.fileCount(), 0);
+}
@@ -23,6 +23,7 @@
 */
 
 #include "lspclientcompletion.h"
+#include "lspclientcompletionfilter.h"
 #include "lspclientplugin.h"
 
 #include "lspclient_debug.h"
@@ -32,6 +33,7 @@
 #include <KTextEditor/View>
 
 #include <QIcon>
+#include <QPointer>
 #include <QUrl>
 
 #include <algorithm>
@@ -159,8 +161,28 @@ class LSPClientCompletionImpl : public LSPClientCompletion
     bool m_triggerSignature = false;
 
     QList<LSPClientCompletionItem> m_matches;
+    QList<LSPClientCompletionItem> m_signatures;
     LSPClientServer::RequestHandle m_handle, m_handleSig;
 
+    // result of the last completion request, sorted by sortText
+    // as long as the server reported it complete, it is refiltered locally
+    // while the word at m_cacheStart grows, no new request is needed
+    QList<LSPClientCompletionItem> m_cache;
+    LSPCompletionFilter m_filter;
+    QUrl m_cacheUrl;
+    KTextEditor::Cursor m_cacheStart = KTextEditor::Cursor::invalid();
+    // line text before m_cacheStart and word typed when requested
+    QString m_cacheContext;
+    QString m_cachePrefix;
+    QString m_shownPrefix;
+    bool m_cachePending = false;
+    bool m_cacheComplete = false;
+    // any edit of this document outside of the word at m_cacheStart drops the cache
+    QPointer<KTextEditor::Document> m_cacheDocument;
+
+    // view of the running completion, if any
+    QPointer<KTextEditor::View> m_view;
+
 public:
     LSPClientCompletionImpl(QSharedPointer<LSPClientServerManager> manager)
         : LSPClientCompletion(nullptr)
@@ -171,6 +193,9 @@ public:
 
     void setServer(QSharedPointer<LSPClientServer> server) override
     {
+        if (m_server != server) {
+            resetCache();
+        }
         m_server = server;
         if (m_server) {
             const auto &caps = m_server->capabilities();
@@ -238,36 +263,42 @@ public:
         QChar lastChar = insertedText.at(insertedText.count() - 1);
 
         m_triggerSignature = false;
-        complete = complete || m_triggersCompletion.contains(lastChar);
         if (m_triggersSignature.contains(lastChar)) {
             complete = true;
             m_triggerSignature = true;
+        } else if (m_triggersCompletion.contains(lastChar)) {
+            // ask right away, the reply is likely there once the popup is due
+            complete = true;
+            requestCompletion(view->document(), position, position);
         }
 
         return complete;
     }
 
+    KTextEditor::Range updateCompletionRange(KTextEditor::View *view, const KTextEditor::Range &range) override
+    {
+        const auto newRange = CodeCompletionModelControllerInterface::updateCompletionRange(view, range);
+
+        // re-rank while typing, the view only hides what no longer matches
+        if (m_view == view && m_cacheComplete && !m_triggerSignature && newRange.start() == m_cacheStart) {
+            const auto prefix = currentPrefix(view);
+            if (prefix != m_shownPrefix && prefix.startsWith(m_cachePrefix)) {
+                showCache(prefix);
+            }
+        }
+        return newRange;
+    }
+
     void completionInvoked(KTextEditor::View *view, const KTextEditor::Range &range, InvocationType it) override
     {
         Q_UNUSED(it)
 
         qCInfo(LSPCLIENT) << "completion invoked" << m_server;
 
-        // maybe use WaitForReset ??
-        // but more complex and already looks good anyway
-        auto handler = [this](const QList<LSPCompletionItem> & compl) {
-            beginResetModel();
-            qCInfo(LSPCLIENT) << "adding completions " << compl.size();
-            for (const auto &item : compl)
-                m_matches.push_back(item);
-            std::stable_sort(m_matches.begin(), m_matches.end(), compare_match);
-            setRowCount(m_matches.size());
-            endResetModel();
-        };
-
         auto sigHandler = [this](const LSPSignatureHelp &sig) {
-            beginResetModel();
             qCInfo(LSPCLIENT) << "adding signatures " << sig.signatures.size();
+            const auto completions = m_matches.mid(m_signatures.size());
+            m_signatures.clear();
             int index = 0;
             for (const auto &item : sig.signatures) {
                 int sortIndex = 10 + index;
@@ -277,16 +308,20 @@ public:
                     active = sig.activeParameter;
                 }
                 // trick active first, others after that
-                m_matches.push_back({item, active, QString(QStringLiteral("%1").arg(sortIndex, 3, 10))});
+                m_signatures.push_back({item, active, QString(QStringLiteral("%1").arg(sortIndex, 3, 10))});
                 ++index;
             }
-            std::stable_sort(m_matches.begin(), m_matches.end(), compare_match);
+            std::stable_sort(m_signatures.begin(), m_signatures.end(), compare_match);
+            beginResetModel();
+            m_matches = m_signatures + completions;
             setRowCount(m_matches.size());
             endResetModel();
         };
 
         beginResetModel();
         m_matches.clear();
+        m_signatures.clear();
+        m_view = view;
         auto document = view->document();
         if (m_server && document) {
             // the default range is determined based on a reasonable identifier (word)
@@ -296,7 +331,14 @@ public:
             auto cursor = qMax(range.start(), qMin(range.end(), position));
             m_manager->update(document, false);
             if (!m_triggerSignature) {
-                m_handle = m_server->documentCompletion(document->url(), {cursor.line(), cursor.column()}, this, handler);
+                // a complete or pending result for this word is filtered, anything else is requested
+                if (isCacheFor(document, range.start(), cursor)) {
+                    if (m_cacheComplete) {
+                        filterCache(currentPrefix(view));
+                    }
+                } else {
+                    requestCompletion(document, range.start(), cursor);
+                }
             }
             m_handleSig = m_server->signatureHelp(document->url(), {cursor.line(), cursor.column()}, this, sigHandler);
         }
@@ -315,9 +357,144 @@ public:
         Q_UNUSED(view);
         beginResetModel();
         m_matches.clear();
-        m_handle.cancel();
+        m_signatures.clear();
+        // a completion request is kept, it serves the next invocation for the same word
         m_handleSig.cancel();
         m_triggerSignature = false;
+        m_view.clear();
+        endResetModel();
+    }
+
+private:
+    QString currentPrefix(KTextEditor::View *view) const
+    {
+        const auto cursor = view->cursorPosition();
+        if (cursor.line() != m_cacheStart.line() || cursor.column() < m_cacheStart.column()) {
+            return QString();
+        }
+        return view->document()->line(cursor.line()).mid(m_cacheStart.column(), cursor.column() - m_cacheStart.column());
+    }
+
+    bool isCacheFor(KTextEditor::Document *document, const KTextEditor::Cursor &start, const KTextEditor::Cursor &cursor) const
+    {
+        if (!(m_cachePending || m_cacheComplete) || document->url() != m_cacheUrl || start != m_cacheStart || cursor.line() != start.line()
+            || cursor.column() < start.column()) {
+            return false;
+        }
+        // the server filters as well, the cached items are only good for a longer word
+        const auto line = document->line(start.line());
+        return line.leftRef(start.column()) == m_cacheContext && line.midRef(start.column(), cursor.column() - start.column()).startsWith(m_cachePrefix);
+    }
+
+    void resetCache()
+    {
+        if (m_cacheDocument) {
+            disconnect(m_cacheDocument, nullptr, this, nullptr);
+            m_cacheDocument.clear();
+        }
+        m_handle.cancel();
+        m_cache.clear();
+        m_filter.setItems({});
+        m_cacheUrl.clear();
+        m_cacheStart = KTextEditor::Cursor::invalid();
+        m_shownPrefix.clear();
+        m_cachePending = m_cacheComplete = false;
+    }
+
+    void requestCompletion(KTextEditor::Document *document, const KTextEditor::Cursor &start, const KTextEditor::Cursor &cursor)
+    {
+        if (!m_server) {
+            return;
+        }
+
+        resetCache();
+        const auto line = document->line(start.line());
+        m_cacheUrl = document->url();
+        m_cacheStart = start;
+        m_cacheContext = line.left(start.column());
+        m_cachePrefix = line.mid(start.column(), cursor.column() - start.column());
+        m_cachePending = true;
+
+        // typing the word keeps the cache, other edits may change what the server would complete
+        m_cacheDocument = document;
+        connect(document, &KTextEditor::Document::textInserted, this, &self_type::onCacheTextInserted);
+        connect(document, &KTextEditor::Document::textRemoved, this, &self_type::onCacheTextRemoved);
+        connect(document, &KTextEditor::Document::lineWrapped, this, &self_type::resetCache);
+        connect(document, &KTextEditor::Document::lineUnwrapped, this, &self_type::resetCache);
+
+        // maybe use WaitForReset ??
+        // but more complex and already looks good anyway
+        auto handler = [this](const LSPCompletionList &completions) {
+            qCInfo(LSPCLIENT) << "adding completions " << completions.items.size() << completions.isIncomplete;
+            m_cachePending = false;
+            m_cacheComplete = !completions.isIncomplete;
+            m_cache.reserve(completions.items.size());
+            QVector<QString> filterTexts;
+            filterTexts.reserve(completions.items.size());
+            for (const auto &item : completions.items) {
+                m_cache.push_back(item);
+            }
+            std::stable_sort(m_cache.begin(), m_cache.end(), compare_match);
+            for (const auto &item : qAsConst(m_cache)) {
+                filterTexts.push_back(item.filterText);
+            }
+            m_filter.setItems(filterTexts);
+
+            // filter for what got typed meanwhile, if still completing that word
+            if (m_view && m_view->document()->url() == m_cacheUrl && m_view->cursorPosition().line() == m_cacheStart.line()
+                && m_view->cursorPosition().column() >= m_cacheStart.column()) {
+                showCache(currentPrefix(m_view));
+            }
+        };
+
+        m_manager->update(document, false);
+        m_handle = m_server->documentCompletion(document->url(), {cursor.line(), cursor.column()}, this, handler);
+    }
+
+    bool isInCacheWord(KTextEditor::Document *document, const KTextEditor::Cursor &position) const
+    {
+        if (position.line() != m_cacheStart.line() || position.column() < m_cacheStart.column()) {
+            return false;
+        }
+        const auto line = document->line(position.line());
+        int end = m_cacheStart.column();
+        while (end < line.size() && (line.at(end).isLetterOrNumber() || line.at(end) == QLatin1Char('_'))) {
+            ++end;
+        }
+        return position.column() <= end;
+    }
+
+    void onCacheTextInserted(KTextEditor::Document *document, const KTextEditor::Cursor &position, const QString &text)
+    {
+        if (text.contains(QLatin1Char('\n')) || !isInCacheWord(document, position)) {
+            resetCache();
+        }
+    }
+
+    void onCacheTextRemoved(KTextEditor::Document *document, const KTextEditor::Range &range, const QString &text)
+    {
+        Q_UNUSED(text)
+        if (!range.onSingleLine() || !isInCacheWord(document, range.start())) {
+            resetCache();
+        }
+    }
+
+    void filterCache(const QString &prefix)
+    {
+        const auto &indices = m_filter.filter(prefix);
+        m_shownPrefix = prefix;
+        m_matches = m_signatures;
+        m_matches.reserve(m_matches.size() + indices.size());
+        for (int index : indices) {
+            m_matches.push_back(m_cache.at(index));
+        }
+    }
+
+    void showCache(const QString &prefix)
+    {
+        beginResetModel();
+        filterCache(prefix);
+        setRowCount(m_matches.size());
         endResetModel();
     }
 };
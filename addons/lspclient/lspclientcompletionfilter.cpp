@@ -0,0 +1,112 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lspclientcompletionfilter.h"
+
+#include <algorithm>
+#include <utility>
+
+static bool isWordStart(const QString &text, int i)
+{
+    if (i == 0)
+        return true;
+    const QChar prev = text.at(i - 1);
+    const QChar c = text.at(i);
+    return (c.isUpper() && !prev.isUpper()) || (c.isLetterOrNumber() && !prev.isLetterOrNumber());
+}
+
+int LSPCompletionFilter::score(const QString &pattern, const QString &text)
+{
+    int score = 0;
+    int last = -1;
+    int j = 0;
+    for (const QChar c : pattern) {
+        const QChar lower = c.toLower();
+        while (j < text.size() && text.at(j).toLower() != lower)
+            ++j;
+        if (j == text.size())
+            return -1;
+
+        if (j == 0)
+            score += 16;
+        else if (j == last + 1)
+            score += 8;
+        else if (isWordStart(text, j))
+            score += 4;
+        else
+            score -= qMin(j - last - 1, 3);
+        if (text.at(j) == c)
+            ++score;
+
+        last = j++;
+    }
+    return score;
+}
+
+void LSPCompletionFilter::setItems(const QVector<QString> &filterTexts)
+{
+    m_texts = filterTexts;
+    m_prefix.clear();
+    m_matches.clear();
+    m_filtered = false;
+}
+
+const QVector<int> &LSPCompletionFilter::filter(const QString &prefix)
+{
+    // narrowing down can start from the current matches
+    QVector<int> candidates;
+    if (m_filtered && prefix.startsWith(m_prefix, Qt::CaseInsensitive)) {
+        if (prefix == m_prefix)
+            return m_matches;
+        candidates.swap(m_matches);
+        std::sort(candidates.begin(), candidates.end());
+    } else {
+        candidates.resize(m_texts.size());
+        for (int i = 0; i < candidates.size(); ++i)
+            candidates[i] = i;
+    }
+
+    m_prefix = prefix;
+    m_filtered = true;
+    m_matches.clear();
+    if (prefix.isEmpty()) {
+        m_matches = candidates;
+        return m_matches;
+    }
+
+    QVector<std::pair<int, int>> scored;
+    scored.reserve(candidates.size());
+    for (int i : qAsConst(candidates)) {
+        const int s = score(prefix, m_texts.at(i));
+        if (s >= 0)
+            scored.push_back({-s, i});
+    }
+    std::sort(scored.begin(), scored.end());
+
+    m_matches.reserve(scored.size());
+    for (const auto &s : qAsConst(scored))
+        m_matches.push_back(s.second);
+    return m_matches;
+}
@@ -0,0 +1,66 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LSPCLIENTCOMPLETIONFILTER_H
+#define LSPCLIENTCOMPLETIONFILTER_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * Filters and ranks completion items by the typed prefix.
+ *
+ * Items match if the prefix is a case insensitive subsequence of their
+ * filter text, better matches (prefix, consecutive characters, word starts)
+ * come first, equal matches keep the order they were given in.
+ * If the prefix only got longer since the last call, just the previous
+ * matches are scored again, as nothing else can match any more.
+ */
+class LSPCompletionFilter
+{
+public:
+    /**
+     * Set the filter texts of all items, in the order they rank without a prefix.
+     */
+    void setItems(const QVector<QString> &filterTexts);
+
+    /**
+     * @return indices of the items matching @p prefix, best first
+     */
+    const QVector<int> &filter(const QString &prefix);
+
+    /**
+     * @return score of @p text for @p pattern, higher is better, -1 if it doesn't match
+     */
+    static int score(const QString &pattern, const QString &text);
+
+private:
+    QVector<QString> m_texts;
+    QString m_prefix;
+    QVector<int> m_matches;
+    bool m_filtered = false;
+};
+
+#endif
@@ -0,0 +1,365 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lspclientdiagnosticsmodel.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+static QIcon codeActionIcon()
+{
+    static QIcon icon(QIcon::fromTheme(QStringLiteral("insert-text")));
+    return icon;
+}
+
+QIcon LSPDiagnosticsModel::diagnosticsIcon(LSPDiagnosticSeverity severity)
+{
+    // clang-format off
+#define RETURN_CACHED_ICON(name) \
+    { \
+        static QIcon icon(QIcon::fromTheme(QStringLiteral(name))); \
+        return icon; \
+    }
+    // clang-format on
+    switch (severity) {
+    case LSPDiagnosticSeverity::Error:
+        RETURN_CACHED_ICON("dialog-error")
+    case LSPDiagnosticSeverity::Warning:
+        RETURN_CACHED_ICON("dialog-warning")
+    case LSPDiagnosticSeverity::Information:
+    case LSPDiagnosticSeverity::Hint:
+        RETURN_CACHED_ICON("dialog-information")
+    default:
+        break;
+    }
+    return QIcon();
+}
+
+LSPDiagnosticsModel::LSPDiagnosticsModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+LSPDiagnosticsModel::~LSPDiagnosticsModel()
+{
+    qDeleteAll(m_files);
+}
+
+QModelIndex LSPDiagnosticsModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (row < 0 || column != 0) {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid()) {
+        return row < m_files.size() ? createIndex(row, 0, nullptr) : QModelIndex();
+    }
+
+    auto *node = static_cast<Node *>(parent.internalPointer());
+    if (!node) {
+        auto *file = m_files.value(parent.row());
+        if (!file || row >= file->diagnostics.size()) {
+            return QModelIndex();
+        }
+        return createIndex(row, 0, static_cast<Node *>(file));
+    }
+
+    if (node->level == 0 && row < rowCount(parent)) {
+        auto *file = static_cast<FileEntry *>(node);
+        return createIndex(row, 0, static_cast<Node *>(&file->entries[parent.row()]));
+    }
+    return QModelIndex();
+}
+
+QModelIndex LSPDiagnosticsModel::parent(const QModelIndex &index) const
+{
+    auto *node = index.isValid() ? static_cast<Node *>(index.internalPointer()) : nullptr;
+    if (!node) {
+        return QModelIndex();
+    }
+
+    if (node->level == 0) {
+        return createIndex(fileRow(static_cast<FileEntry *>(node)), 0, nullptr);
+    }
+    auto *entry = static_cast<DiagnosticEntry *>(node);
+    return createIndex(diagnosticRow(entry), 0, static_cast<Node *>(entry->file));
+}
+
+int LSPDiagnosticsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+
+    if (!parent.isValid()) {
+        return m_files.size();
+    }
+
+    auto *node = static_cast<Node *>(parent.internalPointer());
+    if (!node) {
+        return m_files.at(parent.row())->diagnostics.size();
+    }
+
+    if (node->level == 0) {
+        auto *file = static_cast<FileEntry *>(node);
+        return file->diagnostics.at(parent.row()).relatedInformation.size() + file->entries.at(parent.row()).codeActions.size();
+    }
+    return 0;
+}
+
+int LSPDiagnosticsModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant LSPDiagnosticsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    auto *node = static_cast<Node *>(index.internalPointer());
+    if (!node) {
+        if (role == Qt::DisplayRole) {
+            return m_files.at(index.row())->url.path();
+        }
+        return QVariant();
+    }
+
+    if (node->level == 0) {
+        auto *file = static_cast<FileEntry *>(node);
+        const auto &diagnostic = file->diagnostics.at(index.row());
+        switch (role) {
+        case Qt::DisplayRole:
+            if (diagnostic.source.isEmpty()) {
+                return diagnostic.message;
+            }
+            return QStringLiteral("[%1] %2").arg(diagnostic.source, diagnostic.message);
+        case Qt::DecorationRole:
+            return diagnosticsIcon(diagnostic.severity);
+        case FileUrlRole:
+            return file->url;
+        case RangeRole:
+            return QVariant::fromValue(diagnostic.range);
+        default:
+            return QVariant();
+        }
+    }
+
+    auto *entry = static_cast<DiagnosticEntry *>(node);
+    const auto &relatedInformation = entry->file->diagnostics.at(diagnosticRow(entry)).relatedInformation;
+    if (index.row() < relatedInformation.size()) {
+        const auto &related = relatedInformation.at(index.row());
+        switch (role) {
+        case Qt::DisplayRole: {
+            auto basename = QFileInfo(related.location.uri.path()).fileName();
+            auto location = QStringLiteral("%1:%2").arg(basename).arg(related.location.range.start().line());
+            return QStringLiteral("[%1] %2").arg(location).arg(related.message);
+        }
+        case Qt::DecorationRole:
+            return diagnosticsIcon(LSPDiagnosticSeverity::Information);
+        case FileUrlRole:
+            return related.location.uri;
+        case RangeRole:
+            return QVariant::fromValue(related.location.range);
+        default:
+            return QVariant();
+        }
+    }
+
+    const auto &action = entry->codeActions.at(index.row() - relatedInformation.size()).action;
+    switch (role) {
+    case Qt::DisplayRole:
+        return action.kind.size() ? QStringLiteral("[%1] %2").arg(action.kind).arg(action.title) : action.title;
+    case Qt::DecorationRole:
+        return codeActionIcon();
+    default:
+        return QVariant();
+    }
+}
+
+QModelIndex LSPDiagnosticsModel::setDiagnostics(const QUrl &url, const QList<LSPDiagnostic> &diagnostics)
+{
+    auto *file = fileEntry(url);
+    if (diagnostics.isEmpty()) {
+        if (file) {
+            removeFile(fileRow(file));
+        }
+        return QModelIndex();
+    }
+
+    if (!file) {
+        beginInsertRows(QModelIndex(), m_files.size(), m_files.size());
+        file = new FileEntry;
+        file->url = url;
+        m_files.append(file);
+        endInsertRows();
+    }
+
+    const auto parent = createIndex(fileRow(file), 0, nullptr);
+    if (!file->diagnostics.isEmpty()) {
+        beginRemoveRows(parent, 0, file->diagnostics.size() - 1);
+        file->diagnostics.clear();
+        file->entries.clear();
+        endRemoveRows();
+    }
+
+    beginInsertRows(parent, 0, diagnostics.size() - 1);
+    file->diagnostics.reserve(diagnostics.size());
+    for (const auto &diagnostic : diagnostics) {
+        file->diagnostics.push_back(diagnostic);
+        auto &related = file->diagnostics.last().relatedInformation;
+        related.erase(std::remove_if(related.begin(), related.end(), [](const LSPDiagnosticRelatedInformation &info) {
+            return info.location.uri.isEmpty();
+        }), related.end());
+    }
+    file->entries.resize(diagnostics.size());
+    for (auto &entry : file->entries) {
+        entry.file = file;
+    }
+    endInsertRows();
+
+    return parent;
+}
+
+void LSPDiagnosticsModel::retainFiles(const QSet<QString> &paths)
+{
+    for (int row = m_files.size() - 1; row >= 0; --row) {
+        if (!paths.contains(m_files.at(row)->url.path())) {
+            removeFile(row);
+        }
+    }
+}
+
+QModelIndex LSPDiagnosticsModel::fileIndex(const QUrl &url) const
+{
+    auto *file = fileEntry(url);
+    return file ? createIndex(fileRow(file), 0, nullptr) : QModelIndex();
+}
+
+QModelIndex LSPDiagnosticsModel::diagnosticIndex(const QUrl &url, int line) const
+{
+    auto *file = fileEntry(url);
+    if (!file) {
+        return QModelIndex();
+    }
+    for (int i = 0; i < file->diagnostics.size(); ++i) {
+        if (file->diagnostics.at(i).range.start().line() == line) {
+            return createIndex(i, 0, static_cast<Node *>(file));
+        }
+    }
+    return QModelIndex();
+}
+
+const LSPDiagnostic *LSPDiagnosticsModel::diagnostic(const QModelIndex &index) const
+{
+    auto *node = index.isValid() ? static_cast<Node *>(index.internalPointer()) : nullptr;
+    if (!node || node->level != 0) {
+        return nullptr;
+    }
+    return &static_cast<FileEntry *>(node)->diagnostics.at(index.row());
+}
+
+LSPDiagnosticsModel::CodeAction *LSPDiagnosticsModel::codeAction(const QModelIndex &index)
+{
+    auto *node = index.isValid() ? static_cast<Node *>(index.internalPointer()) : nullptr;
+    if (!node || node->level != 1) {
+        return nullptr;
+    }
+    auto *entry = static_cast<DiagnosticEntry *>(node);
+    const int row = index.row() - entry->file->diagnostics.at(diagnosticRow(entry)).relatedInformation.size();
+    return row >= 0 ? &entry->codeActions[row] : nullptr;
+}
+
+bool LSPDiagnosticsModel::hasCodeActions(const QModelIndex &index) const
+{
+    auto *entry = diagnosticEntry(index);
+    return entry && entry->codeActionsAdded;
+}
+
+void LSPDiagnosticsModel::addCodeActions(const QModelIndex &index, const QList<LSPCodeAction> &actions, const QSharedPointer<LSPClientRevisionSnapshot> &snapshot)
+{
+    auto *entry = diagnosticEntry(index);
+    if (!entry) {
+        return;
+    }
+
+    if (!actions.isEmpty()) {
+        const int first = rowCount(index);
+        beginInsertRows(index, first, first + actions.size() - 1);
+        for (const auto &action : actions) {
+            entry->codeActions.push_back({action, snapshot});
+        }
+        endInsertRows();
+    }
+    entry->codeActionsAdded = true;
+}
+
+const QUrl &LSPDiagnosticsModel::fileUrl(int file) const
+{
+    return m_files.at(file)->url;
+}
+
+const QVector<LSPDiagnostic> &LSPDiagnosticsModel::diagnostics(int file) const
+{
+    return m_files.at(file)->diagnostics;
+}
+
+int LSPDiagnosticsModel::fileRow(const FileEntry *file) const
+{
+    return m_files.indexOf(const_cast<FileEntry *>(file));
+}
+
+int LSPDiagnosticsModel::diagnosticRow(const DiagnosticEntry *entry) const
+{
+    return int(entry - entry->file->entries.constData());
+}
+
+LSPDiagnosticsModel::FileEntry *LSPDiagnosticsModel::fileEntry(const QUrl &url) const
+{
+    for (auto *file : m_files) {
+        if (file->url == url) {
+            return file;
+        }
+    }
+    return nullptr;
+}
+
+LSPDiagnosticsModel::DiagnosticEntry *LSPDiagnosticsModel::diagnosticEntry(const QModelIndex &index) const
+{
+    auto *node = index.isValid() ? static_cast<Node *>(index.internalPointer()) : nullptr;
+    if (!node || node->level != 0) {
+        return nullptr;
+    }
+    return &static_cast<FileEntry *>(node)->entries[index.row()];
+}
+
+void LSPDiagnosticsModel::removeFile(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    delete m_files.takeAt(row);
+    endRemoveRows();
+}
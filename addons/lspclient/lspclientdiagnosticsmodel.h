@@ -0,0 +1,160 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LSPCLIENTDIAGNOSTICSMODEL_H
+#define LSPCLIENTDIAGNOSTICSMODEL_H
+
+#include "lspclientprotocol.h"
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <QSet>
+#include <QSharedPointer>
+
+class LSPClientRevisionSnapshot;
+
+/**
+ * Diagnostics of all files, as a tree of file, diagnostic and then its
+ * related information and code actions.
+ *
+ * Each file keeps its diagnostics in a vector, as received. Nothing is
+ * formatted up front, display text is composed when a view asks for it.
+ * A diagnostic only shows the related information that has a location.
+ */
+class LSPDiagnosticsModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    // same roles as the location trees of the plugin
+    enum Role {
+        FileUrlRole = Qt::UserRole + 1,
+        RangeRole,
+    };
+
+    struct CodeAction {
+        LSPCodeAction action;
+        QSharedPointer<LSPClientRevisionSnapshot> snapshot;
+    };
+
+    explicit LSPDiagnosticsModel(QObject *parent = nullptr);
+    ~LSPDiagnosticsModel() override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * Replace the diagnostics of @p url, no diagnostics removes the file.
+     * @return index of the file, invalid if removed
+     */
+    QModelIndex setDiagnostics(const QUrl &url, const QList<LSPDiagnostic> &diagnostics);
+
+    /**
+     * Remove all files but the ones with a path in @p paths.
+     */
+    void retainFiles(const QSet<QString> &paths);
+
+    QModelIndex fileIndex(const QUrl &url) const;
+
+    /**
+     * @return index of the first diagnostic of @p url starting at @p line, invalid if none
+     */
+    QModelIndex diagnosticIndex(const QUrl &url, int line) const;
+
+    /**
+     * @return diagnostic at @p index, nullptr if it is no diagnostic
+     */
+    const LSPDiagnostic *diagnostic(const QModelIndex &index) const;
+
+    /**
+     * @return code action at @p index, nullptr if it is no code action
+     */
+    CodeAction *codeAction(const QModelIndex &index);
+
+    /**
+     * Whether code actions were added below the diagnostic at @p index already.
+     */
+    bool hasCodeActions(const QModelIndex &index) const;
+
+    /**
+     * Add @p actions below the diagnostic at @p index.
+     */
+    void addCodeActions(const QModelIndex &index, const QList<LSPCodeAction> &actions, const QSharedPointer<LSPClientRevisionSnapshot> &snapshot);
+
+    /**
+     * Diagnostics of all files, for marks and ranges.
+     */
+    int fileCount() const
+    {
+        return m_files.size();
+    }
+
+    const QUrl &fileUrl(int file) const;
+    const QVector<LSPDiagnostic> &diagnostics(int file) const;
+
+    static QIcon diagnosticsIcon(LSPDiagnosticSeverity severity);
+
+private:
+    // what the internal pointer of an index points to, the parent of the index
+    struct Node {
+        // 0 for files, 1 for diagnostics
+        int level = 0;
+    };
+
+    struct FileEntry;
+
+    // parent of the related information and code actions of a diagnostic
+    struct DiagnosticEntry : Node {
+        DiagnosticEntry()
+        {
+            level = 1;
+        }
+
+        FileEntry *file = nullptr;
+        QVector<CodeAction> codeActions;
+        bool codeActionsAdded = false;
+    };
+
+    struct FileEntry : Node {
+        QUrl url;
+        QVector<LSPDiagnostic> diagnostics;
+        // same size as diagnostics
+        QVector<DiagnosticEntry> entries;
+    };
+
+    int fileRow(const FileEntry *file) const;
+    int diagnosticRow(const DiagnosticEntry *entry) const;
+    FileEntry *fileEntry(const QUrl &url) const;
+    DiagnosticEntry *diagnosticEntry(const QModelIndex &index) const;
+    void removeFile(int row);
+
+private:
+    QVector<FileEntry *> m_files;
+};
+
+#endif
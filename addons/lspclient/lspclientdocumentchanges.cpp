@@ -0,0 +1,92 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lspclientdocumentchanges.h"
+
+// per change overhead of the JSON encoding, range and member names
+static const int ChangeOverhead = 96;
+
+// end of text when inserted at start
+static LSPPosition endOf(const LSPPosition &start, const QString &text)
+{
+    const int lines = text.count(QLatin1Char('\n'));
+    if (lines == 0) {
+        return {start.line(), start.column() + text.size()};
+    }
+    return {start.line() + lines, text.size() - text.lastIndexOf(QLatin1Char('\n')) - 1};
+}
+
+// offset of position pos in text inserted at start, pos has to be inside of it
+static int offsetIn(const LSPPosition &start, const QString &text, const LSPPosition &pos)
+{
+    if (pos.line() == start.line()) {
+        return pos.column() - start.column();
+    }
+    int offset = 0;
+    for (int line = start.line(); line < pos.line(); ++line) {
+        offset = text.indexOf(QLatin1Char('\n'), offset) + 1;
+    }
+    return offset + pos.column();
+}
+
+void LSPDocumentChanges::add(const LSPRange &range, const QString &text)
+{
+    if (!m_changes.isEmpty()) {
+        auto &last = m_changes.last();
+        const LSPPosition lastStart = last.range.start();
+        const LSPPosition lastEnd = endOf(lastStart, last.text);
+
+        // the edit touches the text of the last change, replace inside of that one
+        if (range.start() <= lastEnd && range.end() >= lastStart) {
+            QString merged;
+            if (range.start() >= lastStart) {
+                merged = last.text.left(offsetIn(lastStart, last.text, range.start()));
+            }
+            merged += text;
+            LSPPosition oldEnd = last.range.end();
+            if (range.end() <= lastEnd) {
+                merged += last.text.mid(offsetIn(lastStart, last.text, range.end()));
+            } else if (range.end().line() == lastEnd.line()) {
+                // behind the last change, map back to the text before it
+                oldEnd = {oldEnd.line(), oldEnd.column() + range.end().column() - lastEnd.column()};
+            } else {
+                oldEnd = {oldEnd.line() + range.end().line() - lastEnd.line(), range.end().column()};
+            }
+
+            m_textSize += merged.size() - last.text.size();
+            last.range = {qMin(range.start(), lastStart), oldEnd};
+            last.text = merged;
+            return;
+        }
+    }
+
+    m_changes.push_back({range, text});
+    m_textSize += text.size();
+}
+
+int LSPDocumentChanges::cost() const
+{
+    return m_textSize + ChangeOverhead * m_changes.size();
+}
@@ -0,0 +1,75 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LSPCLIENTDOCUMENTCHANGES_H
+#define LSPCLIENTDOCUMENTCHANGES_H
+
+#include "lspclientprotocol.h"
+
+#include <QList>
+
+/**
+ * Collects the edits of a document as LSP content change events.
+ *
+ * An edit touching or overlapping the text of the previous change is merged
+ * into that change, so typing, backspacing or pasting in one place yields a
+ * single change covering the whole edited region. Applying the changes in
+ * order gives the same text as applying all edits one by one.
+ */
+class LSPDocumentChanges
+{
+public:
+    /**
+     * Record that @p range of the current document text was replaced by @p text.
+     */
+    void add(const LSPRange &range, const QString &text);
+
+    const QList<LSPTextDocumentContentChangeEvent> &changes() const
+    {
+        return m_changes;
+    }
+
+    bool isEmpty() const
+    {
+        return m_changes.isEmpty();
+    }
+
+    void clear()
+    {
+        m_changes.clear();
+        m_textSize = 0;
+    }
+
+    /**
+     * Rough size of the changes when sent, to compare with the size of the document.
+     */
+    int cost() const;
+
+private:
+    QList<LSPTextDocumentContentChangeEvent> m_changes;
+    int m_textSize = 0;
+};
+
+#endif
@@ -24,8 +24,10 @@
 
 #include "lspclientpluginview.h"
 #include "lspclientcompletion.h"
+#include "lspclientdiagnosticsmodel.h"
 #include "lspclienthover.h"
 #include "lspclientplugin.h"
+#include "lspclientsemantichighlighting.h"
 #include "lspclientservermanager.h"
 #include "lspclientsymbolview.h"
 
@@ -53,10 +55,13 @@
 
 #include <QAction>
 #include <QApplication>
+#include <QClipboard>
 #include <QFileInfo>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QInputDialog>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QKeyEvent>
 #include <QMenu>
@@ -65,14 +70,15 @@
 #include <QTextCodec>
 #include <QTimer>
 #include <QTreeView>
+#include <algorithm>
 #include <utility>
 
 namespace RangeData
 {
 enum {
     // preserve UserRole for generic use where needed
-    FileUrlRole = Qt::UserRole + 1,
-    RangeRole,
+    FileUrlRole = LSPDiagnosticsModel::FileUrlRole,
+    RangeRole = LSPDiagnosticsModel::RangeRole,
     KindRole,
 };
 
@@ -122,35 +128,6 @@ static constexpr KTextEditor::MarkInterface::MarkTypes markTypeDiagAll = KTextEd
 
 }
 
-static QIcon diagnosticsIcon(LSPDiagnosticSeverity severity)
-{
-    // clang-format off
-#define RETURN_CACHED_ICON(name) \
-    { \
-        static QIcon icon(QIcon::fromTheme(QStringLiteral(name))); \
-        return icon; \
-    }
-    // clang-format on
-    switch (severity) {
-    case LSPDiagnosticSeverity::Error:
-        RETURN_CACHED_ICON("dialog-error")
-    case LSPDiagnosticSeverity::Warning:
-        RETURN_CACHED_ICON("dialog-warning")
-    case LSPDiagnosticSeverity::Information:
-    case LSPDiagnosticSeverity::Hint:
-        RETURN_CACHED_ICON("dialog-information")
-    default:
-        break;
-    }
-    return QIcon();
-}
-
-static QIcon codeActionIcon()
-{
-    static QIcon icon(QIcon::fromTheme(QStringLiteral("insert-text")));
-    return icon;
-}
-
 KTextEditor::Document *findDocument(KTextEditor::MainWindow *mainWindow, const QUrl &url)
 {
     auto views = mainWindow->views();
@@ -236,6 +213,7 @@ class LSPClientActionView : public QObject
     QPointer<QAction> m_diagnosticsCloseNon;
     QPointer<QAction> m_restartServer;
     QPointer<QAction> m_restartAll;
+    QPointer<QAction> m_showStatistics;
 
     // toolview
     QScopedPointer<QWidget> m_toolView;
@@ -243,7 +221,8 @@ class LSPClientActionView : public QObject
     // applied search ranges
     typedef QMultiHash<KTextEditor::Document *, KTextEditor::MovingRange *> RangeCollection;
     RangeCollection m_ranges;
-    QHash<KTextEditor::Document *, QHash<int, QVector<KTextEditor::MovingRange*>>> m_semanticHighlightRanges;
+    // semantic highlighting per document
+    QHash<KTextEditor::Document *, LSPSemanticHighlighting *> m_semanticHighlighting;
     // applied marks
     typedef QSet<KTextEditor::Document *> DocumentCollection;
     DocumentCollection m_marks;
@@ -262,12 +241,18 @@ class LSPClientActionView : public QObject
     QPointer<QTreeView> m_diagnosticsTree;
     // tree widget is either owned here or by tab
     QScopedPointer<QTreeView> m_diagnosticsTreeOwn;
-    QScopedPointer<QStandardItemModel> m_diagnosticsModel;
+    QScopedPointer<LSPDiagnosticsModel> m_diagnosticsModel;
+    // diagnostics received but not shown yet
+    QVector<LSPPublishDiagnosticsParams> m_pendingDiagnostics;
+    QTimer m_diagnosticsTimer;
     // diagnostics ranges
     RangeCollection m_diagnosticsRanges;
     // and marks
     DocumentCollection m_diagnosticsMarks;
 
+    // statistics tab, if shown
+    QPointer<QTreeView> m_statisticsTree;
+
     // views on which completions have been registered
     QSet<KTextEditor::View *> m_completionViews;
 
@@ -276,6 +261,8 @@ class LSPClientActionView : public QObject
 
     // outstanding request
     LSPClientServer::RequestHandle m_handle;
+    // outstanding semantic tokens request
+    LSPClientServer::RequestHandle m_semanticTokensHandle;
     // timeout on request
     bool m_req_timeout = false;
 
@@ -358,6 +345,8 @@ public:
         m_restartServer->setText(i18n("Restart LSP Server"));
         m_restartAll = actionCollection()->addAction(QStringLiteral("lspclient_restart_all"), this, &self_type::restartAll);
         m_restartAll->setText(i18n("Restart All LSP Servers"));
+        m_showStatistics = actionCollection()->addAction(QStringLiteral("lspclient_statistics"), this, &self_type::showStatistics);
+        m_showStatistics->setText(i18n("Show LSP Server Statistics"));
 
         // popup menu
         auto menu = new KActionMenu(i18n("LSP Client"), this);
@@ -384,6 +373,7 @@ public:
         menu->addSeparator();
         menu->addAction(m_restartServer);
         menu->addAction(m_restartAll);
+        menu->addAction(m_showStatistics);
 
         // sync with plugin settings if updated
         connect(m_plugin, &LSPClientPlugin::update, this, &self_type::configUpdated);
@@ -401,15 +391,19 @@ public:
         m_diagnosticsTree = new QTreeView();
         m_diagnosticsTree->setAlternatingRowColors(true);
         m_diagnosticsTreeOwn.reset(m_diagnosticsTree);
-        m_diagnosticsModel.reset(new QStandardItemModel());
-        m_diagnosticsModel->setColumnCount(1);
+        m_diagnosticsModel.reset(new LSPDiagnosticsModel());
         m_diagnosticsTree->setModel(m_diagnosticsModel.data());
         configureTreeView(m_diagnosticsTree);
         connect(m_diagnosticsTree, &QTreeView::clicked, this, &self_type::goToItemLocation);
         connect(m_diagnosticsTree, &QTreeView::doubleClicked, this, &self_type::triggerCodeAction);
 
+        // a burst of diagnostics is shown in one go, once per frame
+        m_diagnosticsTimer.setSingleShot(true);
+        m_diagnosticsTimer.setInterval(16);
+        connect(&m_diagnosticsTimer, &QTimer::timeout, this, &self_type::flushDiagnostics);
+
         // track position in view to sync diagnostics list
-        m_viewTracker.reset(LSPClientViewTracker::new_(plugin, mainWin, 0, 500));
+        m_viewTracker.reset(LSPClientViewTracker::new_(plugin, mainWin, 500, 500));
         connect(m_viewTracker.data(), &LSPClientViewTracker::newState, this, &self_type::onViewState);
 
         configUpdated();
@@ -430,6 +424,7 @@ public:
 
         clearAllLocationMarks();
         clearAllDiagnosticsMarks();
+        qDeleteAll(m_semanticHighlighting);
     }
 
     void configureTreeView(QTreeView *treeView)
@@ -501,6 +496,121 @@ public:
         m_serverManager->restart(nullptr);
     }
 
+    void showStatistics()
+    {
+        if (!m_statisticsTree) {
+            auto treeView = new QTreeView();
+            treeView->setFocusPolicy(Qt::NoFocus);
+            treeView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+            treeView->setAlternatingRowColors(true);
+            treeView->setModel(new QStandardItemModel(treeView));
+
+            treeView->setContextMenuPolicy(Qt::CustomContextMenu);
+            auto menu = new QMenu(treeView);
+            menu->addAction(i18n("Copy as JSON"), this, &self_type::copyStatistics);
+            menu->addAction(i18n("Clear"), this, &self_type::clearStatistics);
+            auto h = [menu](const QPoint &) { menu->popup(QCursor::pos()); };
+            connect(treeView, &QTreeView::customContextMenuRequested, h);
+
+            // refresh while shown, the timer goes along with the tab
+            auto timer = new QTimer(treeView);
+            timer->setInterval(1000);
+            connect(timer, &QTimer::timeout, this, [this]() {
+                if (m_statisticsTree && m_statisticsTree->isVisible())
+                    updateStatistics();
+            });
+            timer->start();
+
+            m_statisticsTree = treeView;
+            m_tabWidget->addTab(treeView, i18nc("@title:tab", "Statistics"));
+        }
+
+        updateStatistics();
+        m_tabWidget->setCurrentWidget(m_statisticsTree);
+        m_mainWindow->showToolView(m_toolView.data());
+    }
+
+    void updateStatistics()
+    {
+        if (!m_statisticsTree)
+            return;
+
+        auto model = static_cast<QStandardItemModel *>(m_statisticsTree->model());
+        model->clear();
+        model->setHorizontalHeaderLabels({i18n("Method"),
+                                          i18n("Requests"),
+                                          i18n("Received"),
+                                          i18n("Cancelled"),
+                                          i18n("Timed Out"),
+                                          i18n("Sent KiB"),
+                                          i18n("Received KiB"),
+                                          i18n("Latency ms"),
+                                          i18n("Latency 50%"),
+                                          i18n("Latency 90%"),
+                                          i18n("Latency Max"),
+                                          i18n("Decode ms"),
+                                          i18n("Wait ms"),
+                                          i18n("Handle ms")});
+
+        // times are kept in us, shown in ms
+        auto ms = [](qint64 total, int count) {
+            return new QStandardItem(QString::number(count ? total / 1000.0 / count : 0.0, 'f', 1));
+        };
+        auto number = [](qint64 n) {
+            return new QStandardItem(QString::number(n));
+        };
+        auto bucket = [](int bound) {
+            return new QStandardItem(bound < 0 ? QStringLiteral("> %1").arg(LSPServerStatistics::latencyBuckets().last()) : QStringLiteral("<= %1").arg(bound));
+        };
+
+        for (const auto &server : m_serverManager->servers()) {
+            const auto &stats = server->statistics();
+            auto serverItem = new QStandardItem(i18n("%1 (pending: %2, decode queue: %3)", server->cmdline().join(QLatin1Char(' ')), stats.pendingRequests(), stats.decodeQueue()));
+            model->appendRow(serverItem);
+
+            const auto &methods = stats.methods();
+            for (auto it = methods.cbegin(); it != methods.cend(); ++it) {
+                const auto &m = it.value();
+                const int handled = m.replies + m.received;
+                const bool hasLatency = m.replies > 0;
+                serverItem->appendRow({new QStandardItem(it.key()),
+                                       number(m.requests + m.notifications),
+                                       number(handled),
+                                       number(m.cancelled),
+                                       number(m.expired),
+                                       number(m.bytesSent / 1024),
+                                       number(m.bytesReceived / 1024),
+                                       ms(m.latencyTotal, m.replies),
+                                       hasLatency ? bucket(LSPServerStatistics::percentile(m.histogram, 50)) : new QStandardItem(),
+                                       hasLatency ? bucket(LSPServerStatistics::percentile(m.histogram, 90)) : new QStandardItem(),
+                                       ms(m.latencyMax, 1),
+                                       ms(m.decodeTotal, handled),
+                                       ms(m.waitTotal, handled),
+                                       ms(m.handleTotal, handled)});
+            }
+        }
+
+        m_statisticsTree->expandAll();
+        m_statisticsTree->header()->resizeSections(QHeaderView::ResizeToContents);
+    }
+
+    void copyStatistics()
+    {
+        QJsonArray servers;
+        for (const auto &server : m_serverManager->servers()) {
+            servers.append(QJsonObject {{QStringLiteral("command"), QJsonArray::fromStringList(server->cmdline())}, {QStringLiteral("statistics"), server->statistics().toJson()}});
+        }
+        QApplication::clipboard()->setText(QString::fromUtf8(QJsonDocument(servers).toJson()));
+    }
+
+    void clearStatistics()
+    {
+        for (const auto &server : m_serverManager->servers()) {
+            server->clearStatistics();
+        }
+        updateStatistics();
+    }
+
     static void clearMarks(KTextEditor::Document *doc, RangeCollection &ranges, DocumentCollection &docs, uint markType)
     {
         KTextEditor::MarkInterface *iface = docs.contains(doc) ? qobject_cast<KTextEditor::MarkInterface *>(doc) : nullptr;
@@ -551,20 +661,24 @@ public:
     void addMarks(KTextEditor::Document *doc, QStandardItem *item, RangeCollection *ranges, DocumentCollection *docs)
     {
         Q_ASSERT(item);
+        auto url = item->data(RangeData::FileUrlRole).toUrl();
+        if (url != doc->url())
+            return;
+
+        KTextEditor::Range range = item->data(RangeData::RangeRole).value<LSPRange>();
+        RangeData::KindEnum kind = RangeData::KindEnum(item->data(RangeData::KindRole).toInt());
+        addMark(doc, range, kind, ranges, docs);
+    }
+
+    void addMark(KTextEditor::Document *doc, const KTextEditor::Range &range, RangeData::KindEnum kind, RangeCollection *ranges, DocumentCollection *docs)
+    {
         KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
         Q_ASSERT(miface);
         KTextEditor::MarkInterface *iface = qobject_cast<KTextEditor::MarkInterface *>(doc);
         Q_ASSERT(iface);
         KTextEditor::View *activeView = m_mainWindow->activeView();
         KTextEditor::ConfigInterface *ciface = qobject_cast<KTextEditor::ConfigInterface *>(activeView);
-
-        auto url = item->data(RangeData::FileUrlRole).toUrl();
-        if (url != doc->url())
-            return;
-
-        KTextEditor::Range range = item->data(RangeData::RangeRole).value<LSPRange>();
         auto line = range.start().line();
-        RangeData::KindEnum kind = RangeData::KindEnum(item->data(RangeData::KindRole).toInt());
 
         KTextEditor::Attribute::Ptr attr(new KTextEditor::Attribute());
 
@@ -635,15 +749,15 @@ public:
             break;
         case RangeData::markTypeDiagError:
             iface->setMarkDescription(markType, i18n("Error"));
-            iface->setMarkPixmap(markType, diagnosticsIcon(LSPDiagnosticSeverity::Error).pixmap(ps, ps));
+            iface->setMarkPixmap(markType, LSPDiagnosticsModel::diagnosticsIcon(LSPDiagnosticSeverity::Error).pixmap(ps, ps));
             break;
         case RangeData::markTypeDiagWarning:
             iface->setMarkDescription(markType, i18n("Warning"));
-            iface->setMarkPixmap(markType, diagnosticsIcon(LSPDiagnosticSeverity::Warning).pixmap(ps, ps));
+            iface->setMarkPixmap(markType, LSPDiagnosticsModel::diagnosticsIcon(LSPDiagnosticSeverity::Warning).pixmap(ps, ps));
             break;
         case RangeData::markTypeDiagOther:
             iface->setMarkDescription(markType, i18n("Information"));
-            iface->setMarkPixmap(markType, diagnosticsIcon(LSPDiagnosticSeverity::Information).pixmap(ps, ps));
+            iface->setMarkPixmap(markType, LSPDiagnosticsModel::diagnosticsIcon(LSPDiagnosticSeverity::Information).pixmap(ps, ps));
             break;
         default:
             Q_ASSERT(false);
@@ -685,6 +799,51 @@ public:
         addMarksRec(doc, treeModel->invisibleRootItem(), oranges, odocs);
     }
 
+    // marks and ranges of the diagnostics, and related information, located in doc
+    void addDiagnosticsMarks(KTextEditor::Document *doc)
+    {
+        if (!m_diagnostics || !m_diagnostics->isChecked())
+            return;
+
+        // check if already added
+        auto oranges = m_diagnosticsRanges.contains(doc) ? nullptr : &m_diagnosticsRanges;
+        auto odocs = m_diagnosticsMarks.contains(doc) ? nullptr : &m_diagnosticsMarks;
+
+        if (!oranges && !odocs)
+            return;
+
+        const auto url = doc->url();
+        for (int file = 0; file < m_diagnosticsModel->fileCount(); ++file) {
+            const bool inDocument = m_diagnosticsModel->fileUrl(file) == url;
+            for (const auto &diagnostic : m_diagnosticsModel->diagnostics(file)) {
+                if (inDocument)
+                    addMark(doc, diagnostic.range, diagnostic.severity, oranges, odocs);
+                for (const auto &related : diagnostic.relatedInformation) {
+                    if (related.location.uri == url)
+                        addMark(doc, related.location.range, RangeData::KindEnum::Related, oranges, odocs);
+                }
+            }
+        }
+    }
+
+    bool isShown(KTextEditor::Document *doc) const
+    {
+        for (auto *view : m_mainWindow->views()) {
+            if (view->document() == doc && view->isVisible())
+                return true;
+        }
+        return false;
+    }
+
+    // marks and ranges are only created for documents shown in a view,
+    // others get them when they become the active view
+    void updateDiagnosticsMarks(KTextEditor::Document *doc)
+    {
+        clearMarks(doc, m_diagnosticsRanges, m_diagnosticsMarks, RangeData::markTypeDiagAll);
+        if (isShown(doc))
+            addDiagnosticsMarks(doc);
+    }
+
     void goToDocumentLocation(const QUrl &uri, int line, int column)
     {
         KTextEditor::View *activeView = m_mainWindow->activeView();
@@ -711,31 +870,6 @@ public:
         goToDocumentLocation(url, start.line(), start.column());
     }
 
-    // custom item subclass that captures additional attributes;
-    // a bit more convenient than the variant/role way
-    struct DiagnosticItem : public QStandardItem {
-        LSPDiagnostic m_diagnostic;
-        LSPCodeAction m_codeAction;
-        QSharedPointer<LSPClientRevisionSnapshot> m_snapshot;
-
-        DiagnosticItem(const LSPDiagnostic &d)
-            : m_diagnostic(d)
-        {
-        }
-
-        DiagnosticItem(const LSPCodeAction &c, QSharedPointer<LSPClientRevisionSnapshot> s)
-            : m_codeAction(c)
-            , m_snapshot(std::move(s))
-        {
-            m_diagnostic.range = LSPRange::invalid();
-        }
-
-        bool isCodeAction()
-        {
-            return !m_diagnostic.range.isValid() && m_codeAction.title.size();
-        }
-    };
-
     // double click on:
     // diagnostic item -> request and add actions (below item)
     // code action -> perform action (literal edit and/or execute command)
@@ -745,15 +879,14 @@ public:
         KTextEditor::View *activeView = m_mainWindow->activeView();
         QPointer<KTextEditor::Document> document = activeView->document();
         auto server = m_serverManager->findServer(activeView);
-        auto it = dynamic_cast<DiagnosticItem *>(m_diagnosticsModel->itemFromIndex(index));
-        if (!server || !document || !it)
+        if (!server || !document)
             return;
 
         // click on an action ?
-        if (it->isCodeAction()) {
-            auto &action = it->m_codeAction;
+        if (auto codeAction = m_diagnosticsModel->codeAction(index)) {
+            auto &action = codeAction->action;
             // apply edit before command
-            applyWorkspaceEdit(action.edit, it->m_snapshot.data());
+            applyWorkspaceEdit(action.edit, codeAction->snapshot.data());
             auto &command = action.command;
             if (command.command.size()) {
                 // accept edit requests that may be sent to execute command
@@ -772,40 +905,28 @@ public:
         // only engage action if
         // * active document matches diagnostic document
         // * if really clicked a diagnostic item
-        //   (which is the case as it != nullptr and not a code action)
         // * if no code action invoked and added already
-        //   (note; related items are also children)
-        auto url = it->data(RangeData::FileUrlRole).toUrl();
-        if (url != document->url() || it->data(Qt::UserRole).toBool())
+        auto diagnostic = m_diagnosticsModel->diagnostic(index);
+        auto url = index.data(RangeData::FileUrlRole).toUrl();
+        if (!diagnostic || url != document->url() || m_diagnosticsModel->hasCodeActions(index))
             return;
 
         // store some things to find item safely later on
         QPersistentModelIndex pindex(index);
         QSharedPointer<LSPClientRevisionSnapshot> snapshot(m_serverManager->snapshot(server.data()));
-        auto h = [this, url, snapshot, pindex](const QList<LSPCodeAction> &actions) {
+        auto h = [this, snapshot, pindex](const QList<LSPCodeAction> &actions) {
             if (!pindex.isValid())
                 return;
-            auto child = m_diagnosticsModel->itemFromIndex(pindex);
-            if (!child)
-                return;
             // add actions below diagnostic item
-            for (const auto &action : actions) {
-                auto item = new DiagnosticItem(action, snapshot);
-                child->appendRow(item);
-                auto text = action.kind.size() ? QStringLiteral("[%1] %2").arg(action.kind).arg(action.title) : action.title;
-                item->setData(text, Qt::DisplayRole);
-                item->setData(codeActionIcon(), Qt::DecorationRole);
-            }
-            m_diagnosticsTree->setExpanded(child->index(), true);
-            // mark actions added
-            child->setData(true, Qt::UserRole);
+            m_diagnosticsModel->addCodeActions(pindex, actions, snapshot);
+            m_diagnosticsTree->setExpanded(pindex, true);
         };
 
         auto range = activeView->selectionRange();
         if (!range.isValid()) {
             range = document->documentRange();
         }
-        server->documentCodeAction(url, range, {}, {it->m_diagnostic}, this, h);
+        server->documentCodeAction(url, range, {}, {*diagnostic}, this, h);
     }
 
     void tabCloseRequested(int index)
@@ -1224,7 +1345,7 @@ public:
 
     void delayCancelRequest(LSPClientServer::RequestHandle &&h, int timeout_ms = 4000)
     {
-        QTimer::singleShot(timeout_ms, this, [h]() mutable { h.cancel(); });
+        QTimer::singleShot(timeout_ms, this, [h]() mutable { h.expire(); });
     }
 
     void format(QChar lastChar = QChar())
@@ -1286,54 +1407,29 @@ public:
         delayCancelRequest(std::move(handle));
     }
 
-    static QStandardItem *getItem(const QStandardItemModel &model, const QUrl &url)
-    {
-        auto l = model.findItems(url.path());
-        if (l.length()) {
-            return l.at(0);
-        }
-        return nullptr;
-    }
-
     // select/scroll to diagnostics item for document and (optionally) line
     bool syncDiagnostics(KTextEditor::Document *document, int line, bool allowTop, bool doShow)
     {
         if (!m_diagnosticsTree)
             return false;
 
-        auto hint = QAbstractItemView::PositionAtTop;
-        QStandardItem *targetItem = nullptr;
-        QStandardItem *topItem = getItem(*m_diagnosticsModel, document->url());
-        if (topItem) {
-            int count = topItem->rowCount();
-            // let's not run wild on a linear search in a flood of diagnostics
-            // user is already in enough trouble as it is ;-)
-            if (count > 50)
-                count = 0;
-            for (int i = 0; i < count; ++i) {
-                auto item = topItem->child(i);
-                int itemline = item->data(RangeData::RangeRole).value<LSPRange>().start().line();
-                if (line == itemline && m_diagnosticsTree) {
-                    targetItem = item;
-                    hint = QAbstractItemView::PositionAtCenter;
-                    break;
-                }
-            }
-        }
-        if (!targetItem && allowTop) {
-            targetItem = topItem;
+        auto hint = QAbstractItemView::PositionAtCenter;
+        auto targetIndex = m_diagnosticsModel->diagnosticIndex(document->url(), line);
+        if (!targetIndex.isValid() && allowTop) {
+            hint = QAbstractItemView::PositionAtTop;
+            targetIndex = m_diagnosticsModel->fileIndex(document->url());
         }
-        if (targetItem) {
+        if (targetIndex.isValid()) {
             m_diagnosticsTree->blockSignals(true);
-            m_diagnosticsTree->scrollTo(targetItem->index(), hint);
-            m_diagnosticsTree->setCurrentIndex(targetItem->index());
+            m_diagnosticsTree->scrollTo(targetIndex, hint);
+            m_diagnosticsTree->setCurrentIndex(targetIndex);
             m_diagnosticsTree->blockSignals(false);
             if (doShow) {
                 m_tabWidget->setCurrentWidget(m_diagnosticsTree);
                 m_mainWindow->showToolView(m_toolView.data());
             }
         }
-        return targetItem != nullptr;
+        return targetIndex.isValid();
     }
 
     void onViewState(KTextEditor::View *view, LSPClientViewTracker::State newState)
@@ -1350,6 +1446,9 @@ public:
         case LSPClientViewTracker::LineChanged:
             syncDiagnostics(view->document(), view->cursorPosition().line(), false, false);
             break;
+        case LSPClientViewTracker::TextChanged:
+            requestSemanticTokens(view);
+            break;
         default:
             // should not happen
             break;
@@ -1369,54 +1468,57 @@ public:
         if (!m_diagnosticsTree)
             return;
 
-        QStandardItemModel *model = m_diagnosticsModel.data();
-        QStandardItem *topItem = getItem(*m_diagnosticsModel, diagnostics.uri);
-
-        if (!topItem) {
-            // no need to create an empty one
-            if (diagnostics.diagnostics.empty()) {
-                return;
-            }
-            topItem = new QStandardItem();
-            model->appendRow(topItem);
-            topItem->setText(diagnostics.uri.path());
+        // only the latest diagnostics of a document count
+        auto it = std::find_if(m_pendingDiagnostics.begin(), m_pendingDiagnostics.end(), [&diagnostics](const LSPPublishDiagnosticsParams &pending) {
+            return pending.uri == diagnostics.uri;
+        });
+        if (it != m_pendingDiagnostics.end()) {
+            *it = diagnostics;
         } else {
-            topItem->setRowCount(0);
+            m_pendingDiagnostics.push_back(diagnostics);
         }
+        if (!m_diagnosticsTimer.isActive())
+            m_diagnosticsTimer.start();
+    }
 
-        for (const auto &diag : diagnostics.diagnostics) {
-            auto item = new DiagnosticItem(diag);
-            topItem->appendRow(item);
-            QString source;
-            if (diag.source.length()) {
-                source = QStringLiteral("[%1] ").arg(diag.source);
-            }
-            item->setData(diagnosticsIcon(diag.severity), Qt::DecorationRole);
-            item->setText(source + diag.message);
-            fillItemRoles(item, diagnostics.uri, diag.range, diag.severity);
-            const auto &relatedInfo = diag.relatedInformation;
-            for (const auto &related : relatedInfo) {
-                if (related.location.uri.isEmpty()) {
-                    continue;
-                }
-                auto relatedItemMessage = new QStandardItem();
-                fillItemRoles(relatedItemMessage, related.location.uri, related.location.range, RangeData::KindEnum::Related);
-                auto basename = QFileInfo(related.location.uri.path()).fileName();
-                auto location = QStringLiteral("%1:%2").arg(basename).arg(related.location.range.start().line());
-                relatedItemMessage->setText(QStringLiteral("[%1] %2").arg(location).arg(related.message));
-                relatedItemMessage->setData(diagnosticsIcon(LSPDiagnosticSeverity::Information), Qt::DecorationRole);
-                item->appendRow({relatedItemMessage});
-                m_diagnosticsTree->setExpanded(item->index(), true);
+    void flushDiagnostics()
+    {
+        if (!m_diagnosticsTree)
+            return;
+
+        QSet<KTextEditor::Document *> documents;
+        QModelIndex lastIndex;
+        for (const auto &diagnostics : qAsConst(m_pendingDiagnostics)) {
+            const bool isNew = !m_diagnosticsModel->fileIndex(diagnostics.uri).isValid();
+            auto index = m_diagnosticsModel->setDiagnostics(diagnostics.uri, diagnostics.diagnostics);
+            if (auto doc = findDocument(m_mainWindow, diagnostics.uri))
+                documents.insert(doc);
+            if (!index.isValid())
+                continue;
+
+            // TODO perhaps add some custom delegate that only shows 1 line
+            // and only the whole text when item selected ??
+            if (isNew)
+                m_diagnosticsTree->setExpanded(index, true);
+            for (int row = 0, count = m_diagnosticsModel->rowCount(index); row < count; ++row) {
+                auto child = m_diagnosticsModel->index(row, 0, index);
+                if (m_diagnosticsModel->rowCount(child) > 0)
+                    m_diagnosticsTree->setExpanded(child, true);
             }
+            lastIndex = index;
         }
+        m_pendingDiagnostics.clear();
 
-        // TODO perhaps add some custom delegate that only shows 1 line
-        // and only the whole text when item selected ??
-        m_diagnosticsTree->setExpanded(topItem->index(), true);
-        m_diagnosticsTree->setRowHidden(topItem->row(), QModelIndex(), topItem->rowCount() == 0);
-        m_diagnosticsTree->scrollTo(topItem->index(), QAbstractItemView::PositionAtTop);
+        if (lastIndex.isValid())
+            m_diagnosticsTree->scrollTo(lastIndex, QAbstractItemView::PositionAtTop);
 
-        updateState();
+        // related information may point into any shown document
+        for (auto *view : m_mainWindow->views()) {
+            if (view->isVisible())
+                documents.insert(view->document());
+        }
+        for (auto *doc : qAsConst(documents))
+            updateDiagnosticsMarks(doc);
     }
 
     KTextEditor::View *viewForUrl(const QUrl &url) const
@@ -1430,10 +1532,109 @@ public:
 
     Q_SLOT void clearSemanticHighlighting(KTextEditor::Document *document)
     {
-        auto &documentRanges = m_semanticHighlightRanges[document];
-        for (const auto &lineRanges : documentRanges)
-            qDeleteAll(lineRanges);
-        documentRanges.clear();
+        if (auto *highlighting = m_semanticHighlighting.value(document))
+            highlighting->clear();
+    }
+
+    Q_SLOT void removeSemanticHighlighting(KTextEditor::Document *document)
+    {
+        delete m_semanticHighlighting.take(document);
+    }
+
+    LSPSemanticHighlighting *semanticHighlighting(KTextEditor::Document *document)
+    {
+        auto *&highlighting = m_semanticHighlighting[document];
+        if (!highlighting) {
+            highlighting = new LSPSemanticHighlighting(document);
+            // ensure runtime match
+            connect(document, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
+            connect(document, SIGNAL(aboutToDeleteMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(removeSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
+        }
+        return highlighting;
+    }
+
+    // TODO: make schema attributes accessible via some new interface,
+    // or at least add configuration to the lsp plugin config
+    // FIXME: static attributes break if one e.g. switches the color scheme on the fly!
+    // scopes are those of the semanticHighlighting notification or a semanticTokens token type
+    static KTextEditor::Attribute::Ptr attributeForScopes(KTextEditor::View *view, const QVector<QString> &scopes)
+    {
+        for (const auto &scope : scopes) {
+            if (scope == QLatin1String("entity.name.function.method.cpp") || scope == QLatin1String("method")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsFunction);
+                    attr.detach();
+                    attr->setForeground(Qt::darkYellow);
+                    attr->setFontItalic(true);
+                }
+                return attr;
+            } else if (scope == QLatin1String("entity.name.function.cpp") || scope == QLatin1String("function")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsFunction);
+                    attr.detach();
+                    attr->setForeground(Qt::darkYellow);
+                }
+                return attr;
+            } else if (scope == QLatin1String("variable.other.cpp") || scope == QLatin1String("variable") || scope == QLatin1String("parameter")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsVariable);
+                    attr.detach();
+                    attr->setForeground(Qt::darkCyan);
+                }
+                return attr;
+            } else if (scope == QLatin1String("variable.other.field.cpp") || scope == QLatin1String("property")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsVariable);
+                    attr.detach();
+                    attr->setForeground(Qt::darkCyan);
+                    attr->setFontItalic(true);
+                }
+                return attr;
+            } else if (scope == QLatin1String("entity.name.type.enum.cpp") || scope == QLatin1String("enum")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsConstant);
+                    attr.detach();
+                    attr->setForeground(Qt::darkMagenta);
+                }
+                return attr;
+            } else if (scope == QLatin1String("variable.other.enummember.cpp") || scope == QLatin1String("enumMember")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsConstant);
+                    attr.detach();
+                    attr->setForeground(Qt::darkMagenta);
+                    attr->setFontItalic(true);
+                }
+                return attr;
+            } else if (scope == QLatin1String("entity.name.type.class.cpp")
+                    || scope == QLatin1String("entity.name.type.template.cpp")
+                    || scope == QLatin1String("class") || scope == QLatin1String("type") || scope == QLatin1String("struct")
+                    || scope == QLatin1String("interface") || scope == QLatin1String("typeParameter"))
+            {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsDataType);
+                    attr.detach();
+                    attr->setForeground(Qt::darkMagenta);
+                }
+                return attr;
+            } else if (scope == QLatin1String("entity.name.namespace.cpp") || scope == QLatin1String("namespace")) {
+                static KTextEditor::Attribute::Ptr attr;
+                if (!attr) {
+                    attr = view->defaultStyleAttribute(KTextEditor::dsDataType);
+                    attr.detach();
+                    attr->setForeground(Qt::darkGreen);
+                    attr->setFontItalic(true);
+                }
+                return attr;
+            }
+        }
+        return {};
     }
 
     void onSemanticHighlighting(const LSPSemanticHighlightingParams &params)
@@ -1450,6 +1651,10 @@ public:
             return;
         }
 
+        // semanticTokens are requested instead
+        if (server->capabilities().semanticTokensProvider.full)
+            return;
+
         auto *document = view->document();
         auto *miface = qobject_cast<KTextEditor::MovingInterface *>(document);
         Q_ASSERT(miface);
@@ -1468,126 +1673,80 @@ public:
             return;
         }
 
-        // ensure runtime match
-        connect(document, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
-        connect(document, SIGNAL(aboutToDeleteMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearSemanticHighlighting(KTextEditor::Document *)), Qt::UniqueConnection);
-
-        // TODO: make schema attributes accessible via some new interface,
-        // or at least add configuration to the lsp plugin config
-        // FIXME: static attributes break if one e.g. switches the color scheme on the fly!
-        auto attributeForScopes = [view](const QVector<QString> &scopes) -> KTextEditor::Attribute::Ptr {
-            for (const auto &scope : scopes) {
-                if (scope == QLatin1String("entity.name.function.method.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsFunction);
-                        attr.detach();
-                        attr->setForeground(Qt::darkYellow);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                } else if(scope == QLatin1String("entity.name.function.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsFunction);
-                        attr.detach();
-                        attr->setForeground(Qt::darkYellow);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("variable.other.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsVariable);
-                        attr.detach();
-                        attr->setForeground(Qt::darkCyan);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("variable.other.field.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsVariable);
-                        attr.detach();
-                        attr->setForeground(Qt::darkCyan);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.type.enum.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsConstant);
-                        attr.detach();
-                        attr->setForeground(Qt::darkMagenta);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("variable.other.enummember.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsConstant);
-                        attr.detach();
-                        attr->setForeground(Qt::darkMagenta);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.type.class.cpp")
-                        || scope == QLatin1String("entity.name.type.template.cpp"))
-                {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsDataType);
-                        attr.detach();
-                        attr->setForeground(Qt::darkMagenta);
-                    }
-                    return attr;
-                } else if (scope == QLatin1String("entity.name.namespace.cpp")) {
-                    static KTextEditor::Attribute::Ptr attr;
-                    if (!attr) {
-                        attr = view->defaultStyleAttribute(KTextEditor::dsDataType);
-                        attr.detach();
-                        attr->setForeground(Qt::darkGreen);
-                        attr->setFontItalic(true);
-                    }
-                    return attr;
-                }
-            }
-            return {};
-        };
-
-        // TODO: we should try to recycle the moving ranges instead of recreating them all the time
-
         const auto scopes = server->capabilities().semanticHighlightingProvider.scopes;
         //qDebug() << params.textDocument.uri << scopes;
 
-        auto &documentRanges = m_semanticHighlightRanges[document];
+        // the notification only carries the lines that changed,
+        // a line without tokens lost all of its highlighting
+        auto lines = params.lines;
+        std::sort(lines.begin(), lines.end(), [](const LSPSemanticHighlightingInformation &a, const LSPSemanticHighlightingInformation &b) {
+            return a.line < b.line;
+        });
         QSet<int> handledLines;
-        for (const auto &line : params.lines) {
+        QVector<LSPSemanticHighlighting::Token> tokens;
+        for (const auto &line : qAsConst(lines)) {
             handledLines.insert(line.line);
-            auto &lineRanges = documentRanges[line.line];
-            qDeleteAll(lineRanges);
-            lineRanges.clear();
-            //qDebug() << "line:" << line.line;
             for (const auto &token : line.tokens) {
                 //qDebug() << "token:" << token.character << token.length << token.scope << scopes.value(token.scope);
-                auto attribute = attributeForScopes(scopes.value(token.scope));
+                auto attribute = attributeForScopes(view, scopes.value(token.scope));
                 if (!attribute)
                     continue;
-
-                const auto columnStart = static_cast<int>(token.character);
-                const auto columnEnd = columnStart + static_cast<int>(token.length);
-                constexpr auto expand = KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight;
-                auto *range = miface->newMovingRange({line.line, columnStart, line.line, columnEnd},
-                                                     expand, KTextEditor::MovingRange::InvalidateIfEmpty);
-                range->setAttribute(attribute);
+                tokens.push_back({line.line, static_cast<int>(token.character), static_cast<int>(token.length), attribute});
             }
         }
-        // clear lines that got removed or commented out
-        for (auto it = documentRanges.begin(); it != documentRanges.end();) {
-            if (!handledLines.contains(it.key())) {
-                qDeleteAll(it.value());
-                it = documentRanges.erase(it);
-            } else {
-                ++it;
-            }
+        semanticHighlighting(document)->setLines(handledLines, tokens);
+    }
+
+    void requestSemanticTokens(KTextEditor::View *view)
+    {
+        if (!view || !m_plugin->m_semanticHighlighting)
+            return;
+
+        // also brings the server up to date with the document
+        auto server = m_serverManager->findServer(view);
+        if (!server || !server->capabilities().semanticTokensProvider.full)
+            return;
+
+        auto *document = view->document();
+        auto *miface = qobject_cast<KTextEditor::MovingInterface *>(document);
+        Q_ASSERT(miface);
+        auto *highlighting = semanticHighlighting(document);
+
+        const auto &options = server->capabilities().semanticTokensProvider;
+        const auto revision = miface->revision();
+        QPointer<KTextEditor::Document> doc = document;
+        auto h = [this, doc, revision, options](const LSPSemanticTokensDelta &reply) {
+            if (doc)
+                onSemanticTokens(doc, revision, options, reply);
+        };
+        const auto previousResultId = options.fullDelta ? highlighting->resultId() : QString();
+        m_semanticTokensHandle.cancel() = server->documentSemanticTokensFull(document->url(), previousResultId, this, h);
+    }
+
+    void onSemanticTokens(KTextEditor::Document *document, qint64 revision, const LSPSemanticTokensOptions &options, const LSPSemanticTokensDelta &reply)
+    {
+        auto *highlighting = m_semanticHighlighting.value(document);
+        if (!highlighting)
+            return;
+
+        // the data has to follow every reply, delta requests build on it
+        if (!highlighting->applyTokens(reply)) {
+            qCWarning(LSPCLIENT) << "discarding semantic tokens, delta does not apply to" << document->url();
+            return;
+        }
+
+        // a newer request is on its way otherwise
+        auto *miface = qobject_cast<KTextEditor::MovingInterface *>(document);
+        auto *view = m_mainWindow->activeView();
+        if (miface->revision() != revision || !view || view->document() != document)
+            return;
+
+        QVector<KTextEditor::Attribute::Ptr> attributes;
+        attributes.reserve(options.tokenTypes.size());
+        for (const auto &type : options.tokenTypes) {
+            attributes.push_back(attributeForScopes(view, {type}));
         }
+        highlighting->setAll(LSPSemanticHighlighting::decode(highlighting->tokenData(), attributes));
     }
 
     void onDocumentUrlChanged(KTextEditor::Document *doc)
@@ -1606,16 +1765,7 @@ public:
             }
         }
         // check and clear defunct entries
-        const auto &model = *m_diagnosticsModel;
-        for (int i = 0; i < model.rowCount(); ++i) {
-            auto item = model.item(i);
-            if (item && !fpaths.contains(item->text())) {
-                item->setRowCount(0);
-                if (m_diagnosticsTree) {
-                    m_diagnosticsTree->setRowHidden(item->row(), QModelIndex(), true);
-                }
-            }
-        }
+        m_diagnosticsModel->retainFiles(fpaths);
     }
 
     void onTextChanged(KTextEditor::Document *doc)
@@ -1709,12 +1859,15 @@ public:
             addMarks(doc, m_markModel, m_ranges, m_marks);
         if (m_diagnosticsModel && doc) {
             clearMarks(doc, m_diagnosticsRanges, m_diagnosticsMarks, RangeData::markTypeDiagAll);
-            addMarks(doc, m_diagnosticsModel.data(), m_diagnosticsRanges, m_diagnosticsMarks);
+            addDiagnosticsMarks(doc);
         }
 
         // connect for cleanup stuff
         if (activeView)
             connect(activeView, &KTextEditor::View::destroyed, this, &self_type::viewDestroyed, Qt::UniqueConnection);
+
+        if (server)
+            requestSemanticTokens(activeView);
     }
 
     void viewDestroyed(QObject *view)
@@ -80,6 +80,14 @@ struct LSPSemanticHighlightingOptions {
     QVector<QVector<QString>> scopes;
 };
 
+struct LSPSemanticTokensOptions {
+    bool full = false;
+    // server can send edits against a previous result
+    bool fullDelta = false;
+    QVector<QString> tokenTypes;
+    QVector<QString> tokenModifiers;
+};
+
 struct LSPServerCapabilities {
     LSPDocumentSyncKind textDocumentSync = LSPDocumentSyncKind::None;
     bool hoverProvider = false;
@@ -98,6 +106,7 @@ struct LSPServerCapabilities {
     // CodeActionOptions not useful/considered at present
     bool codeActionProvider = false;
     LSPSemanticHighlightingOptions semanticHighlightingProvider;
+    LSPSemanticTokensOptions semanticTokensProvider;
 };
 
 enum class LSPMarkupKind { None = 0, PlainText = 1, MarkDown = 2 };
@@ -217,6 +226,13 @@ struct LSPCompletionItem {
     LSPMarkupContent documentation;
     QString sortText;
     QString insertText;
+    QString filterText;
+};
+
+struct LSPCompletionList {
+    // if not set, further typing only narrows down the items
+    bool isIncomplete = false;
+    QList<LSPCompletionItem> items;
 };
 
 struct LSPParameterInformation {
@@ -300,6 +316,21 @@ struct LSPSemanticHighlightingParams {
     QVector<LSPSemanticHighlightingInformation> lines;
 };
 
+struct LSPSemanticTokensEdit {
+    int start = 0;
+    int deleteCount = 0;
+    QVector<int> data;
+};
+
+// reply to both semanticTokens/full and semanticTokens/full/delta
+// the former provides data, the latter edits to apply to the previous data
+struct LSPSemanticTokensDelta {
+    QString resultId;
+    bool isDelta = false;
+    QVector<int> data;
+    QVector<LSPSemanticTokensEdit> edits;
+};
+
 struct LSPCommand {
     QString title;
     QString command;
@@ -0,0 +1,256 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lspclientsemantichighlighting.h"
+
+#include <KTextEditor/Document>
+#include <KTextEditor/MovingInterface>
+#include <KTextEditor/MovingRange>
+
+#include <QHash>
+
+#include <algorithm>
+#include <iterator>
+
+// hidden ranges kept around for reuse, the rest is deleted
+static const int MAX_POOLED_RANGES = 1024;
+
+static KTextEditor::Range tokenRange(const LSPSemanticHighlighting::Token &token)
+{
+    return {token.line, token.column, token.line, token.column + token.length};
+}
+
+static bool rangeLessThan(const KTextEditor::Range &a, const KTextEditor::Range &b)
+{
+    return a.start() < b.start() || (a.start() == b.start() && a.end() < b.end());
+}
+
+LSPSemanticHighlighting::LSPSemanticHighlighting(KTextEditor::Document *document)
+    : m_document(document)
+{
+}
+
+LSPSemanticHighlighting::~LSPSemanticHighlighting()
+{
+    clear();
+}
+
+void LSPSemanticHighlighting::setLines(const QSet<int> &lines, const QVector<Token> &tokens)
+{
+    update(tokens, &lines);
+}
+
+void LSPSemanticHighlighting::setAll(const QVector<Token> &tokens)
+{
+    update(tokens, nullptr);
+}
+
+void LSPSemanticHighlighting::clear()
+{
+    qDeleteAll(m_ranges);
+    m_ranges.clear();
+    qDeleteAll(m_pool);
+    m_pool.clear();
+}
+
+void LSPSemanticHighlighting::update(const QVector<Token> &tokens, const QSet<int> *lines)
+{
+    // ranges moved along with the edits since the last update,
+    // so group them by the line they are on now
+    QHash<int, QVector<KTextEditor::MovingRange *>> lineRanges;
+    QVector<KTextEditor::MovingRange *> ranges;
+    ranges.reserve(m_ranges.size());
+    for (auto *range : qAsConst(m_ranges)) {
+        const int line = range->start().line();
+        if (line < 0) {
+            // the text of the token got deleted
+            releaseRange(range);
+        } else if (!lines || lines->contains(line)) {
+            lineRanges[line].push_back(range);
+        } else {
+            ranges.push_back(range);
+        }
+    }
+
+    for (auto begin = tokens.cbegin(); begin != tokens.cend();) {
+        auto end = begin;
+        while (end != tokens.cend() && end->line == begin->line) {
+            ++end;
+        }
+        if (!lines || lines->contains(begin->line)) {
+            auto oldRanges = lineRanges.take(begin->line);
+            updateLine(oldRanges, begin, end, ranges);
+        }
+        begin = end;
+    }
+
+    // lines without any token now
+    for (const auto &oldRanges : qAsConst(lineRanges)) {
+        for (auto *range : oldRanges) {
+            releaseRange(range);
+        }
+    }
+
+    m_ranges.swap(ranges);
+    while (m_pool.size() > MAX_POOLED_RANGES) {
+        delete m_pool.takeLast();
+    }
+}
+
+void LSPSemanticHighlighting::updateLine(QVector<KTextEditor::MovingRange *> &oldRanges, const Token *begin, const Token *end, QVector<KTextEditor::MovingRange *> &ranges)
+{
+    std::sort(oldRanges.begin(), oldRanges.end(), [](const KTextEditor::MovingRange *a, const KTextEditor::MovingRange *b) {
+        return rangeLessThan(a->toRange(), b->toRange());
+    });
+
+    // keep the ranges that are exactly in place, both sides are sorted
+    QVector<KTextEditor::MovingRange *> unmatchedRanges;
+    QVector<const Token *> unmatchedTokens;
+    auto oldIt = oldRanges.cbegin();
+    auto token = begin;
+    while (oldIt != oldRanges.cend() && token != end) {
+        const auto oldRange = (*oldIt)->toRange();
+        const auto newRange = tokenRange(*token);
+        if (oldRange == newRange) {
+            if ((*oldIt)->attribute() != token->attribute) {
+                (*oldIt)->setAttribute(token->attribute);
+            }
+            ranges.push_back(*oldIt++);
+            ++token;
+        } else if (rangeLessThan(oldRange, newRange)) {
+            unmatchedRanges.push_back(*oldIt++);
+        } else {
+            unmatchedTokens.push_back(token++);
+        }
+    }
+    std::copy(oldIt, oldRanges.cend(), std::back_inserter(unmatchedRanges));
+    for (; token != end; ++token) {
+        unmatchedTokens.push_back(token);
+    }
+
+    // move the other ranges of the line to the new tokens
+    int i = 0;
+    for (const Token *t : qAsConst(unmatchedTokens)) {
+        if (i < unmatchedRanges.size()) {
+            auto *range = unmatchedRanges.at(i++);
+            range->setRange(tokenRange(*t));
+            if (range->attribute() != t->attribute) {
+                range->setAttribute(t->attribute);
+            }
+            ranges.push_back(range);
+        } else {
+            ranges.push_back(takeRange(*t));
+        }
+    }
+    for (; i < unmatchedRanges.size(); ++i) {
+        releaseRange(unmatchedRanges.at(i));
+    }
+}
+
+KTextEditor::MovingRange *LSPSemanticHighlighting::takeRange(const Token &token)
+{
+    if (!m_pool.isEmpty()) {
+        auto *range = m_pool.takeLast();
+        // still invalid, so changing the attribute repaints nothing
+        if (range->attribute() != token.attribute) {
+            range->setAttribute(token.attribute);
+        }
+        range->setRange(tokenRange(token));
+        return range;
+    }
+
+    auto *miface = qobject_cast<KTextEditor::MovingInterface *>(m_document);
+    Q_ASSERT(miface);
+    constexpr auto expand = KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight;
+    auto *range = miface->newMovingRange(tokenRange(token), expand, KTextEditor::MovingRange::InvalidateIfEmpty);
+    range->setAttribute(token.attribute);
+    return range;
+}
+
+void LSPSemanticHighlighting::releaseRange(KTextEditor::MovingRange *range)
+{
+    range->setRange(KTextEditor::Range::invalid());
+    m_pool.push_back(range);
+}
+
+bool LSPSemanticHighlighting::applyTokens(const LSPSemanticTokensDelta &reply)
+{
+    if (!reply.isDelta) {
+        m_resultId = reply.resultId;
+        m_data = reply.data;
+        return true;
+    }
+
+    // edits refer to the data before any of them is applied, so apply them back to front
+    auto edits = reply.edits;
+    std::sort(edits.begin(), edits.end(), [](const LSPSemanticTokensEdit &a, const LSPSemanticTokensEdit &b) {
+        return a.start > b.start;
+    });
+    bool valid = !m_resultId.isEmpty();
+    for (const auto &edit : qAsConst(edits)) {
+        if (!valid || edit.start < 0 || edit.deleteCount < 0 || edit.start + edit.deleteCount > m_data.size()) {
+            valid = false;
+            break;
+        }
+        const int grow = edit.data.size() - edit.deleteCount;
+        if (grow > 0) {
+            m_data.insert(edit.start, grow, 0);
+        } else if (grow < 0) {
+            m_data.remove(edit.start, -grow);
+        }
+        std::copy(edit.data.cbegin(), edit.data.cend(), m_data.begin() + edit.start);
+    }
+
+    if (!valid) {
+        m_resultId.clear();
+        m_data.clear();
+        return false;
+    }
+    m_resultId = reply.resultId;
+    return true;
+}
+
+QVector<LSPSemanticHighlighting::Token> LSPSemanticHighlighting::decode(const QVector<int> &data, const QVector<KTextEditor::Attribute::Ptr> &attributes)
+{
+    // each token is [deltaLine, deltaStartChar, length, tokenType, tokenModifiers],
+    // the start is relative to the previous token if on the same line
+    QVector<Token> tokens;
+    tokens.reserve(data.size() / 5);
+    int line = 0;
+    int column = 0;
+    for (int i = 0; i + 4 < data.size(); i += 5) {
+        if (data.at(i) > 0) {
+            line += data.at(i);
+            column = data.at(i + 1);
+        } else {
+            column += data.at(i + 1);
+        }
+        auto attribute = attributes.value(data.at(i + 3));
+        if (attribute) {
+            tokens.push_back({line, column, data.at(i + 2), attribute});
+        }
+    }
+    return tokens;
+}
@@ -0,0 +1,139 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LSPCLIENTSEMANTICHIGHLIGHTING_H
+#define LSPCLIENTSEMANTICHIGHLIGHTING_H
+
+#include "lspclientprotocol.h"
+
+#include <KTextEditor/Attribute>
+
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+namespace KTextEditor
+{
+class Document;
+class MovingRange;
+}
+
+/**
+ * Semantic highlighting of one document, as moving ranges with attributes.
+ *
+ * Updates are diffed against the ranges already in place. A token at the
+ * position of an existing range keeps that range untouched, other ranges of
+ * the line are moved to the remaining tokens. Ranges no longer needed are
+ * hidden in a pool that later updates take from before creating new ones.
+ * So only tokens that changed cause a repaint, and the number of ranges
+ * follows the number of tokens instead of the number of updates.
+ *
+ * Also keeps the token data of the last semanticTokens reply, the edits of
+ * a delta reply are applied to it.
+ */
+class LSPSemanticHighlighting
+{
+public:
+    struct Token {
+        int line;
+        int column;
+        int length;
+        KTextEditor::Attribute::Ptr attribute;
+    };
+
+    explicit LSPSemanticHighlighting(KTextEditor::Document *document);
+    ~LSPSemanticHighlighting();
+
+    /**
+     * Replace the highlighting of @p lines by @p tokens, all other lines are kept.
+     * @p tokens have to be sorted by line and column.
+     */
+    void setLines(const QSet<int> &lines, const QVector<Token> &tokens);
+
+    /**
+     * Replace the whole highlighting by @p tokens, sorted by line and column.
+     */
+    void setAll(const QVector<Token> &tokens);
+
+    /**
+     * Delete all ranges, e.g. before the document invalidates or deletes them.
+     * The token data is kept.
+     */
+    void clear();
+
+    /**
+     * Update the token data with a semanticTokens reply.
+     * @return false if the edits of a delta reply don't fit the data at hand,
+     *         the data is reset then and should be requested in full
+     */
+    bool applyTokens(const LSPSemanticTokensDelta &reply);
+
+    /**
+     * Result id to send along the next delta request, empty if there is no data.
+     */
+    const QString &resultId() const
+    {
+        return m_resultId;
+    }
+
+    const QVector<int> &tokenData() const
+    {
+        return m_data;
+    }
+
+    /**
+     * Decode relative token data, @p attributes are indexed by token type.
+     * Tokens of types without attribute are dropped.
+     */
+    static QVector<Token> decode(const QVector<int> &data, const QVector<KTextEditor::Attribute::Ptr> &attributes);
+
+    int rangeCount() const
+    {
+        return m_ranges.size();
+    }
+
+    int pooledRangeCount() const
+    {
+        return m_pool.size();
+    }
+
+private:
+    void update(const QVector<Token> &tokens, const QSet<int> *lines);
+    void updateLine(QVector<KTextEditor::MovingRange *> &oldRanges, const Token *begin, const Token *end, QVector<KTextEditor::MovingRange *> &ranges);
+    KTextEditor::MovingRange *takeRange(const Token &token);
+    void releaseRange(KTextEditor::MovingRange *range);
+
+private:
+    KTextEditor::Document *const m_document;
+    // ranges in use, their lines follow the edits of the document
+    QVector<KTextEditor::MovingRange *> m_ranges;
+    // invalid ranges ready for reuse
+    QVector<KTextEditor::MovingRange *> m_pool;
+
+    QString m_resultId;
+    QVector<int> m_data;
+};
+
+#endif
@@ -32,10 +32,12 @@
 #include <QVariantMap>
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QThread>
 #include <QTime>
 #include <QtEndian>
 #include <utility>
@@ -294,6 +296,26 @@ static void from_json(LSPSemanticHighlightingOptions &options, const QJsonValue
     }
 }
 
+static void from_json(QVector<QString> &strings, const QJsonValue &json)
+{
+    for (const auto &entry : json.toArray()) {
+        strings.push_back(entry.toString());
+    }
+}
+
+static void from_json(LSPSemanticTokensOptions &options, const QJsonValue &json)
+{
+    if (!json.isObject())
+        return;
+    auto ob = json.toObject();
+    auto full = ob.value(QStringLiteral("full"));
+    options.full = full.toBool() || full.isObject();
+    options.fullDelta = full.toObject().value(QStringLiteral("delta")).toBool();
+    auto legend = ob.value(QStringLiteral("legend")).toObject();
+    from_json(options.tokenTypes, legend.value(QStringLiteral("tokenTypes")));
+    from_json(options.tokenModifiers, legend.value(QStringLiteral("tokenModifiers")));
+}
+
 static void from_json(LSPServerCapabilities &caps, const QJsonObject &json)
 {
     auto sync = json.value(QStringLiteral("textDocumentSync"));
@@ -313,6 +335,7 @@ static void from_json(LSPServerCapabilities &caps, const QJsonObject &json)
     auto codeActionProvider = json.value(QStringLiteral("codeActionProvider"));
     caps.codeActionProvider = codeActionProvider.toBool() || codeActionProvider.isObject();
     from_json(caps.semanticHighlightingProvider, json.value(QStringLiteral("semanticHighlighting")).toObject());
+    from_json(caps.semanticTokensProvider, json.value(QStringLiteral("semanticTokensProvider")));
 }
 
 // follow suit; as performed in kate docmanager
@@ -511,14 +534,17 @@ static QList<LSPLocation> parseDocumentLocation(const QJsonValue &result)
     return ret;
 }
 
-static QList<LSPCompletionItem> parseDocumentCompletion(const QJsonValue &result)
+static LSPCompletionList parseDocumentCompletion(const QJsonValue &result)
 {
-    QList<LSPCompletionItem> ret;
+    LSPCompletionList ret;
     QJsonArray items = result.toArray();
     // might be CompletionList
     if (items.empty()) {
-        items = result.toObject().value(QStringLiteral("items")).toArray();
+        const auto list = result.toObject();
+        items = list.value(QStringLiteral("items")).toArray();
+        ret.isIncomplete = list.value(QStringLiteral("isIncomplete")).toBool();
     }
+    ret.items.reserve(items.size());
     for (const auto &vitem : items) {
         const auto &item = vitem.toObject();
         auto label = item.value(MEMBER_LABEL).toString();
@@ -530,8 +556,11 @@ static QList<LSPCompletionItem> parseDocumentCompletion(const QJsonValue &result
         auto insertText = item.value(QStringLiteral("insertText")).toString();
         if (insertText.isEmpty())
             insertText = label;
+        auto filterText = item.value(QStringLiteral("filterText")).toString();
+        if (filterText.isEmpty())
+            filterText = label;
         auto kind = static_cast<LSPCompletionItemKind>(item.value(MEMBER_KIND).toInt());
-        ret.push_back({label, kind, detail, doc, sortText, insertText});
+        ret.items.push_back({label, kind, detail, doc, sortText, insertText, filterText});
     }
     return ret;
 }
@@ -720,6 +749,39 @@ static LSPSemanticHighlightingParams parseSemanticHighlighting(const QJsonObject
     return ret;
 }
 
+static QVector<int> parseSemanticTokensData(const QJsonValue &json)
+{
+    const auto array = json.toArray();
+    QVector<int> ret;
+    ret.reserve(array.size());
+    for (const auto &value : array) {
+        ret.push_back(value.toInt());
+    }
+    return ret;
+}
+
+static LSPSemanticTokensDelta parseSemanticTokensDelta(const QJsonValue &result)
+{
+    LSPSemanticTokensDelta ret;
+    auto ob = result.toObject();
+    ret.resultId = ob.value(QStringLiteral("resultId")).toString();
+    // a delta request may still be answered with full data
+    if (ob.contains(QStringLiteral("edits"))) {
+        ret.isDelta = true;
+        for (const auto &edit_json : ob.value(QStringLiteral("edits")).toArray()) {
+            const auto edit_obj = edit_json.toObject();
+            LSPSemanticTokensEdit edit;
+            edit.start = edit_obj.value(QStringLiteral("start")).toInt();
+            edit.deleteCount = edit_obj.value(QStringLiteral("deleteCount")).toInt();
+            edit.data = parseSemanticTokensData(edit_obj.value(QStringLiteral("data")));
+            ret.edits.push_back(edit);
+        }
+    } else {
+        ret.data = parseSemanticTokensData(ob.value(QStringLiteral("data")));
+    }
+    return ret;
+}
+
 using GenericReplyType = QJsonValue;
 using GenericReplyHandler = ReplyHandler<GenericReplyType>;
 
@@ -744,11 +806,18 @@ class LSPClientServer::LSPClientServerPrivate
     int m_id = 0;
     // receive buffer
     QByteArray m_receive;
+    // payloads are parsed in the decoder thread
+    QThread m_decodeThread;
+    // lives in the decoder thread, context of the parse jobs
+    QObject m_decoder;
     // registered reply handlers
     QHash<int, GenericReplyHandler> m_handlers;
     // pending request responses
     static constexpr int MAX_REQUESTS = 5;
     QVector<int> m_requests {MAX_REQUESTS + 1};
+    // request and message statistics, timed by m_clock
+    LSPServerStatistics m_statistics;
+    QElapsedTimer m_clock;
 
 public:
     LSPClientServerPrivate(LSPClientServer *_q, const QStringList &server, const QUrl &root, const QJsonValue &init)
@@ -760,11 +829,20 @@ public:
         // setup async reading
         QObject::connect(&m_sproc, &QProcess::readyRead, utils::mem_fun(&self_type::read, this));
         QObject::connect(&m_sproc, &QProcess::stateChanged, utils::mem_fun(&self_type::onStateChanged, this));
+
+        m_decoder.moveToThread(&m_decodeThread);
+        m_decodeThread.setObjectName(QStringLiteral("LSPClientServer decoder"));
+        m_decodeThread.start();
+
+        m_clock.start();
     }
 
     ~LSPClientServerPrivate()
     {
         stop(TIMEOUT_SHUTDOWN, TIMEOUT_SHUTDOWN);
+        // pending payloads are dropped, nothing could handle them anymore
+        m_decodeThread.quit();
+        m_decodeThread.wait();
     }
 
     const QStringList &cmdline() const
@@ -782,9 +860,20 @@ public:
         return m_capabilities;
     }
 
-    int cancel(int reqid)
+    const LSPServerStatistics &statistics() const
+    {
+        return m_statistics;
+    }
+
+    void clearStatistics()
+    {
+        m_statistics.clear();
+    }
+
+    int cancel(int reqid, bool expired)
     {
         if (m_handlers.remove(reqid) > 0) {
+            m_statistics.cancelled(reqid, expired);
             auto params = QJsonObject {{MEMBER_ID, reqid}};
             write(init_request(QStringLiteral("$/cancelRequest"), params));
         }
@@ -792,6 +881,12 @@ public:
     }
 
 private:
+    // in us
+    qint64 now() const
+    {
+        return m_clock.nsecsElapsed() / 1000;
+    }
+
     void setState(State s)
     {
         if (m_state != s) {
@@ -822,7 +917,11 @@ private:
         QJsonDocument json(ob);
         auto sjson = json.toJson();
 
-        qCInfo(LSPCLIENT) << "calling" << msg[MEMBER_METHOD].toString();
+        // responses to server requests have no method
+        const auto method = msg[MEMBER_METHOD].toString();
+        m_statistics.sent(method.isEmpty() ? QStringLiteral("(response)") : method, h ? ret.m_id : -1, sjson.length(), now());
+
+        qCInfo(LSPCLIENT) << "calling" << method;
         qCDebug(LSPCLIENT) << "sending message:\n" << QString::fromUtf8(sjson);
         // some simple parsers expect length header first
         auto hdr = QStringLiteral(CONTENT_LENGTH ": %1\r\n").arg(sjson.length());
@@ -849,16 +948,18 @@ private:
         m_receive.append(m_sproc.readAllStandardOutput());
 
         // try to get one (or more) message
-        QByteArray &buffer = m_receive;
+        // consumed data is only tracked by offset, the buffer is compacted once at the end
+        const QByteArray &buffer = m_receive;
+        int offset = 0;
 
         while (true) {
-            qCDebug(LSPCLIENT) << "buffer size" << buffer.length();
+            qCDebug(LSPCLIENT) << "buffer size" << buffer.length() - offset;
             auto header = QByteArray(CONTENT_LENGTH ":");
-            int index = buffer.indexOf(header);
+            int index = buffer.indexOf(header, offset);
             if (index < 0) {
                 // avoid collecting junk
-                if (buffer.length() > 1 << 20)
-                    buffer.clear();
+                if (buffer.length() - offset > 1 << 20)
+                    offset = buffer.length();
                 break;
             }
             index += header.length();
@@ -874,58 +975,98 @@ private:
             if (!ok) {
                 qCWarning(LSPCLIENT) << "invalid " CONTENT_LENGTH;
                 // flush and try to carry on to some next header
-                buffer.remove(0, msgstart);
+                offset = msgstart;
                 continue;
             }
             // sanity check to avoid extensive buffering
-            if (length > 1 << 29) {
+            if (length < 0 || length > 1 << 29) {
                 qCWarning(LSPCLIENT) << "excessive size";
-                buffer.clear();
+                offset = buffer.length();
                 continue;
             }
             if (msgstart + length > buffer.length())
                 break;
             // now onto payload
-            auto payload = buffer.mid(msgstart, length);
-            buffer.remove(0, msgstart + length);
             qCInfo(LSPCLIENT) << "got message payload size " << length;
-            qCDebug(LSPCLIENT) << "message payload:\n" << payload;
-            QJsonParseError error {};
-            auto msg = QJsonDocument::fromJson(payload, &error);
-            if (error.error != QJsonParseError::NoError || !msg.isObject()) {
-                qCWarning(LSPCLIENT) << "invalid response payload";
-                continue;
-            }
-            auto result = msg.object();
-            // check if it is the expected result
-            int msgid = -1;
-            if (result.contains(MEMBER_ID)) {
-                msgid = result[MEMBER_ID].toInt();
-            } else {
-                processNotification(result);
-                continue;
-            }
-            // could be request
-            if (result.contains(MEMBER_METHOD)) {
-                processRequest(result);
-                continue;
-            }
+            m_statistics.payloadQueued();
+            decode(buffer.mid(msgstart, length), now());
+            offset = msgstart + length;
+        }
 
-            // a valid reply; what to do with it now
-            auto it = m_handlers.find(msgid);
-            if (it != m_handlers.end()) {
-                // copy handler to local storage
-                const auto handler = *it;
+        if (offset > 0) {
+            m_receive.remove(0, offset);
+        }
+    }
+
+    // parse the payload in the decoder thread, large replies would block the GUI otherwise
+    // the decoder thread handles the payloads in order, so the messages are dispatched in order, too
+    void decode(const QByteArray &payload, qint64 received)
+    {
+        QMetaObject::invokeMethod(
+            &m_decoder,
+            [this, payload, received]() {
+                qCDebug(LSPCLIENT) << "message payload:\n" << payload;
+                QElapsedTimer timer;
+                timer.start();
+                QJsonParseError error {};
+                auto msg = QJsonDocument::fromJson(payload, &error);
+                LSPServerStatistics::Message message;
+                message.size = payload.size();
+                message.received = received;
+                message.decodeTime = timer.nsecsElapsed() / 1000;
+                if (error.error != QJsonParseError::NoError || !msg.isObject()) {
+                    qCWarning(LSPCLIENT) << "invalid response payload";
+                    QMetaObject::invokeMethod(
+                        q, [this]() { m_statistics.payloadDequeued(); }, Qt::QueuedConnection);
+                    return;
+                }
+                // q is the context, nothing is dispatched once it is gone
+                auto result = msg.object();
+                QMetaObject::invokeMethod(
+                    q, [this, result, message]() { dispatch(result, message); }, Qt::QueuedConnection);
+            },
+            Qt::QueuedConnection);
+    }
 
-                // remove handler from our set, do this pre handler execution to avoid races
-                m_handlers.erase(it);
+    void dispatch(const QJsonObject &result, LSPServerStatistics::Message message)
+    {
+        m_statistics.payloadDequeued();
+        message.dispatched = now();
 
-                // run handler, might e.g. trigger some new LSP actions for this server
-                handler(result.value(MEMBER_RESULT));
-            } else {
-                // could have been canceled
-                qCDebug(LSPCLIENT) << "unexpected reply id";
-            }
+        // check if it is the expected result
+        int msgid = -1;
+        if (result.contains(MEMBER_ID)) {
+            msgid = result[MEMBER_ID].toInt();
+        } else {
+            processNotification(result);
+            message.handled = now();
+            m_statistics.notified(result[MEMBER_METHOD].toString(), message);
+            return;
+        }
+        // could be request
+        if (result.contains(MEMBER_METHOD)) {
+            processRequest(result);
+            message.handled = now();
+            m_statistics.notified(result[MEMBER_METHOD].toString(), message);
+            return;
+        }
+
+        // a valid reply; what to do with it now
+        auto it = m_handlers.find(msgid);
+        if (it != m_handlers.end()) {
+            // copy handler to local storage
+            const auto handler = *it;
+
+            // remove handler from our set, do this pre handler execution to avoid races
+            m_handlers.erase(it);
+
+            // run handler, might e.g. trigger some new LSP actions for this server
+            handler(result.value(MEMBER_RESULT));
+            message.handled = now();
+            m_statistics.replied(msgid, message);
+        } else {
+            // could have been canceled
+            qCDebug(LSPCLIENT) << "unexpected reply id";
         }
     }
 
@@ -962,6 +1103,7 @@ private:
             qCInfo(LSPCLIENT) << "shutting down" << m_server;
             // cancel all pending
             m_handlers.clear();
+            m_statistics.abandonPending();
             // shutdown sequence
             send(init_request(QStringLiteral("shutdown")));
             // maybe we will get/see reply on the above, maybe not
@@ -991,6 +1133,17 @@ private:
                                                 {QStringLiteral("publishDiagnostics"), QJsonObject {{QStringLiteral("relatedInformation"), true}}},
                                                 {QStringLiteral("codeAction"), codeAction},
                                                 {QStringLiteral("semanticHighlightingCapabilities"), QJsonObject {{QStringLiteral("semanticHighlighting"), !plugin || plugin->m_semanticHighlighting}}}}}};
+        if (!plugin || plugin->m_semanticHighlighting) {
+            // token types we have an attribute for, see LSPClientActionView::attributeForScopes
+            const QJsonArray tokenTypes {QStringLiteral("namespace"), QStringLiteral("type"), QStringLiteral("class"), QStringLiteral("enum"), QStringLiteral("interface"), QStringLiteral("struct"), QStringLiteral("typeParameter"), QStringLiteral("parameter"), QStringLiteral("variable"), QStringLiteral("property"), QStringLiteral("enumMember"), QStringLiteral("function"), QStringLiteral("method")};
+            QJsonObject semanticTokens {{QStringLiteral("requests"), QJsonObject {{QStringLiteral("full"), QJsonObject {{QStringLiteral("delta"), true}}}}},
+                                        {QStringLiteral("tokenTypes"), tokenTypes},
+                                        {QStringLiteral("tokenModifiers"), QJsonArray()},
+                                        {QStringLiteral("formats"), QJsonArray {QStringLiteral("relative")}}};
+            auto textDocument = capabilities.value(QStringLiteral("textDocument")).toObject();
+            textDocument[QStringLiteral("semanticTokens")] = semanticTokens;
+            capabilities[QStringLiteral("textDocument")] = textDocument;
+        }
         // NOTE a typical server does not use root all that much,
         // other than for some corner case (in) requests
         QJsonObject params {{QStringLiteral("processId"), QCoreApplication::applicationPid()},
@@ -1126,6 +1279,16 @@ public:
         return send(init_request(QStringLiteral("textDocument/codeAction"), params), h);
     }
 
+    RequestHandle documentSemanticTokensFull(const QUrl &document, const QString &previousResultId, const GenericReplyHandler &h)
+    {
+        auto params = textDocumentParams(document);
+        if (previousResultId.isEmpty()) {
+            return send(init_request(QStringLiteral("textDocument/semanticTokens/full"), params), h);
+        }
+        params[QStringLiteral("previousResultId")] = previousResultId;
+        return send(init_request(QStringLiteral("textDocument/semanticTokens/full/delta"), params), h);
+    }
+
     void executeCommand(const QString &command, const QJsonValue &args)
     {
         auto params = executeCommandParams(command, args);
@@ -1279,9 +1442,19 @@ void LSPClientServer::stop(int to_t, int to_k)
     return d->stop(to_t, to_k);
 }
 
-int LSPClientServer::cancel(int reqid)
+int LSPClientServer::cancel(int reqid, bool expired)
 {
-    return d->cancel(reqid);
+    return d->cancel(reqid, expired);
+}
+
+const LSPServerStatistics &LSPClientServer::statistics() const
+{
+    return d->statistics();
+}
+
+void LSPClientServer::clearStatistics()
+{
+    d->clearStatistics();
 }
 
 LSPClientServer::RequestHandle LSPClientServer::documentSymbols(const QUrl &document, const QObject *context, const DocumentSymbolsReplyHandler &h)
@@ -1349,6 +1522,11 @@ LSPClientServer::RequestHandle LSPClientServer::documentCodeAction(const QUrl &d
     return d->documentCodeAction(document, range, kinds, std::move(diagnostics), make_handler(h, context, parseCodeAction));
 }
 
+LSPClientServer::RequestHandle LSPClientServer::documentSemanticTokensFull(const QUrl &document, const QString &previousResultId, const QObject *context, const SemanticTokensDeltaReplyHandler &h)
+{
+    return d->documentSemanticTokensFull(document, previousResultId, make_handler(h, context, parseSemanticTokensDelta));
+}
+
 void LSPClientServer::executeCommand(const QString &command, const QJsonValue &args)
 {
     return d->executeCommand(command, args);
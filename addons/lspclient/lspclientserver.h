@@ -26,6 +26,7 @@
 #define LSPCLIENTSERVER_H
 
 #include "lspclientprotocol.h"
+#include "lspclientserverstatistics.h"
 
 #include <QJsonValue>
 #include <QList>
@@ -66,12 +67,13 @@ using DocumentSymbolsReplyHandler = ReplyHandler<QList<LSPSymbolInformation>>;
 using DocumentDefinitionReplyHandler = ReplyHandler<QList<LSPLocation>>;
 using DocumentHighlightReplyHandler = ReplyHandler<QList<LSPDocumentHighlight>>;
 using DocumentHoverReplyHandler = ReplyHandler<LSPHover>;
-using DocumentCompletionReplyHandler = ReplyHandler<QList<LSPCompletionItem>>;
+using DocumentCompletionReplyHandler = ReplyHandler<LSPCompletionList>;
 using SignatureHelpReplyHandler = ReplyHandler<LSPSignatureHelp>;
 using FormattingReplyHandler = ReplyHandler<QList<LSPTextEdit>>;
 using CodeActionReplyHandler = ReplyHandler<QList<LSPCodeAction>>;
 using WorkspaceEditReplyHandler = ReplyHandler<LSPWorkspaceEdit>;
 using ApplyEditReplyHandler = ReplyHandler<LSPApplyWorkspaceEditResponse>;
+using SemanticTokensDeltaReplyHandler = ReplyHandler<LSPSemanticTokensDelta>;
 
 class LSPClientPlugin;
 
@@ -96,6 +98,14 @@ public:
                 m_server->cancel(m_id);
             return *this;
         }
+
+        // cancel as the reply took too long, only tracked apart from cancel()
+        RequestHandle &expire()
+        {
+            if (m_server)
+                m_server->cancel(m_id, true);
+            return *this;
+        }
     };
 
     LSPClientServer(const QStringList &server, const QUrl &root, const QJsonValue &init = QJsonValue());
@@ -107,7 +117,7 @@ public:
     // request shutdown/stop
     // if to_xxx >= 0 -> send signal if not exit'ed after timeout
     void stop(int to_term_ms, int to_kill_ms);
-    int cancel(int id);
+    int cancel(int id, bool expired = false);
 
     // properties
     const QStringList &cmdline() const;
@@ -116,6 +126,10 @@ public:
 
     const LSPServerCapabilities &capabilities() const;
 
+    // request and message statistics
+    const LSPServerStatistics &statistics() const;
+    void clearStatistics();
+
     // language
     RequestHandle documentSymbols(const QUrl &document, const QObject *context, const DocumentSymbolsReplyHandler &h);
     RequestHandle documentDefinition(const QUrl &document, const LSPPosition &pos, const QObject *context, const DocumentDefinitionReplyHandler &h);
@@ -134,6 +148,9 @@ public:
     RequestHandle documentCodeAction(const QUrl &document, const LSPRange &range, const QList<QString> &kinds, QList<LSPDiagnostic> diagnostics, const QObject *context, const CodeActionReplyHandler &h);
     void executeCommand(const QString &command, const QJsonValue &args);
 
+    // delta request if previousResultId is not empty, the reply may carry full data nevertheless
+    RequestHandle documentSemanticTokensFull(const QUrl &document, const QString &previousResultId, const QObject *context, const SemanticTokensDeltaReplyHandler &h);
+
     // sync
     void didOpen(const QUrl &document, int version, const QString &langId, const QString &text);
     // only 1 of text or changes should be non-empty and is considered
@@ -29,8 +29,11 @@
 #include "lspclientservermanager.h"
 
 #include "lspclient_debug.h"
+#include "lspclientdocumentchanges.h"
 
 #include <KLocalizedString>
+#include <KSyntaxHighlighting/Definition>
+#include <KSyntaxHighlighting/Repository>
 #include <KTextEditor/Document>
 #include <KTextEditor/MainWindow>
 #include <KTextEditor/Message>
@@ -38,6 +41,7 @@
 #include <KTextEditor/View>
 
 #include <QDir>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QFileInfo>
 #include <QJsonArray>
@@ -188,6 +192,11 @@ public:
     }
 };
 
+// pending document changes are sent after a typing pause of twice the usual
+// time between edits, within these bounds (ms)
+static constexpr int MIN_CHANGE_DELAY = 50;
+static constexpr int MAX_CHANGE_DELAY = 1000;
+
 // helper class to sync document changes to LSP server
 class LSPClientServerManagerImpl : public LSPClientServerManager
 {
@@ -213,7 +222,7 @@ class LSPClientServerManagerImpl : public LSPClientServerManager
         bool open : 1;
         bool modified : 1;
         // used for incremental update (if non-empty)
-        QList<LSPTextDocumentContentChangeEvent> changes;
+        LSPDocumentChanges changes;
     };
 
     LSPClientPlugin *m_plugin;
@@ -223,7 +232,18 @@ class LSPClientServerManagerImpl : public LSPClientServerManager
     // root -> (mode -> server)
     QMap<QUrl, QMap<QString, ServerInfo>> m_servers;
     QHash<KTextEditor::Document *, DocumentInfo> m_docs;
+    // files opened by openTransient(), without a document
+    QHash<QUrl, QSharedPointer<LSPClientServer>> m_transientDocs;
     bool m_incrementalSync = false;
+    // to tell the mode of files not open, created when needed
+    std::unique_ptr<KSyntaxHighlighting::Repository> m_repository;
+
+    // debounce of document changes, adapted to the typing rate
+    QTimer m_changeTimer;
+    QElapsedTimer m_lastChange;
+    QElapsedTimer m_firstPendingChange;
+    // smoothed time between edits
+    int m_changeInterval = MIN_CHANGE_DELAY;
 
     // highlightingModeRegex => language id
     std::vector<std::pair<QRegularExpression, QString>> m_highlightingModeRegexToLanguageId;
@@ -240,6 +260,9 @@ public:
     {
         connect(plugin, &LSPClientPlugin::update, this, &self_type::updateServerConfig);
         QTimer::singleShot(100, this, &self_type::updateServerConfig);
+
+        m_changeTimer.setSingleShot(true);
+        connect(&m_changeTimer, &QTimer::timeout, this, &self_type::flushChanges);
     }
 
     ~LSPClientServerManagerImpl() override
@@ -355,6 +378,70 @@ public:
         return view ? findServer(view->document(), updatedoc) : nullptr;
     }
 
+    void serverIdForFile(const QUrl &url, QString &langId, QString &serverId) override
+    {
+        langId.clear();
+        serverId.clear();
+
+        if (!m_repository) {
+            m_repository.reset(new KSyntaxHighlighting::Repository());
+        }
+        const auto definition = m_repository->definitionForFileName(url.toLocalFile());
+        if (!definition.isValid())
+            return;
+
+        const auto id = languageId(definition.name());
+        if (id.isEmpty())
+            return;
+
+        // servers are kept by the language id they are configured for
+        auto configId = id;
+        const auto servers = serverConfig().value(QStringLiteral("servers")).toObject();
+        QSet<QString> used {configId};
+        while (true) {
+            const auto base = servers.value(configId).toObject().value(QStringLiteral("use")).toString();
+            if (base.isEmpty() || used.contains(base))
+                break;
+            used << base;
+            configId = base;
+        }
+        if (!servers.value(configId).isObject())
+            return;
+
+        langId = id;
+        serverId = configId;
+    }
+
+    QSharedPointer<LSPClientServer> findRunningServer(const QUrl &url, const QString &serverId) override
+    {
+        for (auto it = m_servers.cbegin(); it != m_servers.cend(); ++it) {
+            const auto &server = it.value().value(serverId).server;
+            if (server && server->state() == LSPClientServer::State::Running && it.key().isParentOf(url)) {
+                return server;
+            }
+        }
+        return nullptr;
+    }
+
+    void openTransient(const QSharedPointer<LSPClientServer> &server, const QUrl &url, const QString &langId, const QString &text) override
+    {
+        if (!server || m_transientDocs.contains(url))
+            return;
+        for (auto it = m_docs.cbegin(); it != m_docs.cend(); ++it) {
+            if (it->open && it->url == url)
+                return;
+        }
+        server->didOpen(url, 0, langId, text);
+        m_transientDocs.insert(url, server);
+    }
+
+    void closeTransient(const QUrl &url) override
+    {
+        auto server = m_transientDocs.take(url);
+        if (server && server->state() == LSPClientServer::State::Running)
+            server->didClose(url);
+    }
+
     // restart a specific server or all servers if server == nullptr
     void restart(LSPClientServer *server) override
     {
@@ -373,6 +460,19 @@ public:
         restart(servers);
     }
 
+    ServerList servers() const override
+    {
+        ServerList servers;
+        for (const auto &m : m_servers) {
+            for (const auto &si : m) {
+                if (si.server) {
+                    servers.push_back(si.server);
+                }
+            }
+        }
+        return servers;
+    }
+
     qint64 revision(KTextEditor::Document *doc) override
     {
         auto it = m_docs.find(doc);
@@ -498,6 +598,15 @@ private:
         }
     }
 
+    // server config merged with the one of the current project
+    QJsonObject serverConfig() const
+    {
+        QObject *projectView = m_mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
+        const auto &projectMap = projectView ? projectView->property("projectMap").toMap() : QVariantMap();
+        auto projectConfig = QJsonDocument::fromVariant(projectMap).object().value(QStringLiteral("lspclient")).toObject();
+        return merge(m_serverConfig, projectConfig);
+    }
+
     QSharedPointer<LSPClientServer> _findServer(KTextEditor::Document *document)
     {
         // compute the LSP standardized language id, none found => no change
@@ -507,11 +616,7 @@ private:
 
         QObject *projectView = m_mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
         const auto projectBase = QDir(projectView ? projectView->property("projectBaseDir").toString() : QString());
-        const auto &projectMap = projectView ? projectView->property("projectMap").toMap() : QVariantMap();
-
-        // merge with project specific
-        auto projectConfig = QJsonDocument::fromVariant(projectMap).object().value(QStringLiteral("lspclient")).toObject();
-        auto serverConfig = merge(m_serverConfig, projectConfig);
+        auto serverConfig = this->serverConfig();
 
         // locate server config
         QJsonValue config;
@@ -728,9 +833,17 @@ private:
             }
             if (it->open) {
                 if (it->modified || force) {
-                    (it->server)->didChange(it->url, it->version, (it->changes.empty()) ? doc->text() : QString(), it->changes);
+                    // a merged delta larger than the document is better sent as full text
+                    const int size = doc->totalCharacters();
+                    if (it->changes.isEmpty() || (size > 0 && it->changes.cost() > size)) {
+                        (it->server)->didChange(it->url, it->version, doc->text());
+                    } else {
+                        (it->server)->didChange(it->url, it->version, QString(), it->changes.changes());
+                    }
                 }
             } else {
+                // the server must not see the file opened twice
+                closeTransient(it->url);
                 (it->server)->didOpen(it->url, it->version, languageId(doc->highlightingMode()), doc->text());
                 it->open = true;
             }
@@ -758,6 +871,36 @@ private:
         auto it = m_docs.find(doc);
         if (it != m_docs.end()) {
             it->modified = true;
+            if (it->open) {
+                scheduleFlush();
+            }
+        }
+    }
+
+    // typing fast waits a bit longer for the next edit, but changes are never held back for long
+    void scheduleFlush()
+    {
+        if (m_lastChange.isValid()) {
+            const int elapsed = int(qMin<qint64>(m_lastChange.restart(), MAX_CHANGE_DELAY));
+            m_changeInterval = (3 * m_changeInterval + elapsed) / 4;
+        } else {
+            m_lastChange.start();
+        }
+        if (!m_firstPendingChange.isValid()) {
+            m_firstPendingChange.start();
+        }
+
+        const int delay = qMin(qBound(MIN_CHANGE_DELAY, 2 * m_changeInterval, MAX_CHANGE_DELAY), MAX_CHANGE_DELAY - int(m_firstPendingChange.elapsed()));
+        m_changeTimer.start(qMax(0, delay));
+    }
+
+    void flushChanges()
+    {
+        m_firstPendingChange.invalidate();
+        for (auto it = m_docs.begin(); it != m_docs.end(); ++it) {
+            if (it->open && it->modified) {
+                update(it, false);
+            }
         }
     }
 
@@ -780,7 +923,7 @@ private:
     {
         auto info = getDocumentInfo(doc);
         if (info) {
-            info->changes.push_back({LSPRange {position, position}, text});
+            info->changes.add({position, position}, text);
         }
     }
 
@@ -789,7 +932,7 @@ private:
         (void)text;
         auto info = getDocumentInfo(doc);
         if (info) {
-            info->changes.push_back({range, QString()});
+            info->changes.add(range, QString());
         }
     }
 
@@ -810,7 +953,7 @@ private:
             LSPRange oldrange {{line - 1, 0}, {line + 1, 0}};
             LSPRange newrange {{line - 1, 0}, {line, 0}};
             auto text = doc->text(newrange);
-            info->changes.push_back({oldrange, text});
+            info->changes.add(oldrange, text);
         }
     }
 };
@@ -61,10 +61,27 @@ public:
 
     virtual QSharedPointer<LSPClientServer> findServer(KTextEditor::View *view, bool updatedoc = true) = 0;
 
+    // language id of a file that need not be open and the id of the server configured for it
+    // both are empty if there is no server for the file
+    virtual void serverIdForFile(const QUrl &url, QString &langId, QString &serverId) = 0;
+
+    // server already running under serverId whose root contains url, nullptr if none
+    virtual QSharedPointer<LSPClientServer> findRunningServer(const QUrl &url, const QString &serverId) = 0;
+
+    // open a file on server for a request without tracking a document for it, e.g. a file not open in the editor
+    // does nothing if a document of url is open on the server already
+    // the file is closed by closeTransient(), or before a document of url is opened on the server
+    virtual void openTransient(const QSharedPointer<LSPClientServer> &server, const QUrl &url, const QString &langId, const QString &text) = 0;
+
+    virtual void closeTransient(const QUrl &url) = 0;
+
     virtual void update(KTextEditor::Document *doc, bool force) = 0;
 
     virtual void restart(LSPClientServer *server) = 0;
 
+    // all servers currently managed
+    virtual QVector<QSharedPointer<LSPClientServer>> servers() const = 0;
+
     virtual void setIncrementalSync(bool inc) = 0;
 
     // latest sync'ed revision of doc (-1 if N/A)
@@ -0,0 +1,198 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lspclientserverstatistics.h"
+
+#include <QJsonArray>
+
+#include <algorithm>
+#include <climits>
+
+const QVector<int> &LSPServerStatistics::latencyBuckets()
+{
+    static const QVector<int> buckets {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
+    return buckets;
+}
+
+LSPServerStatistics::Method &LSPServerStatistics::method(const QString &name)
+{
+    auto &method = m_methods[name];
+    if (method.histogram.isEmpty()) {
+        method.histogram.resize(latencyBuckets().size() + 1);
+    }
+    return method;
+}
+
+void LSPServerStatistics::sent(const QString &name, int id, int size, qint64 time)
+{
+    auto &m = method(name);
+    m.bytesSent += size;
+    if (id < 0) {
+        ++m.notifications;
+        return;
+    }
+
+    ++m.requests;
+    m_pending.insert(id, {name, time});
+    m_maxPending = qMax(m_maxPending, m_pending.size());
+}
+
+void LSPServerStatistics::cancelled(int id, bool expired)
+{
+    const auto it = m_pending.find(id);
+    if (it == m_pending.end()) {
+        return;
+    }
+
+    auto &m = method(it->method);
+    ++(expired ? m.expired : m.cancelled);
+    m_pending.erase(it);
+}
+
+void LSPServerStatistics::abandonPending()
+{
+    m_pending.clear();
+}
+
+void LSPServerStatistics::received(Method &m, const Message &message)
+{
+    m.bytesReceived += message.size;
+    m.decodeTotal += message.decodeTime;
+    m.waitTotal += qMax<qint64>(0, message.dispatched - message.received - message.decodeTime);
+    m.handleTotal += message.handled - message.dispatched;
+}
+
+void LSPServerStatistics::replied(int id, const Message &message)
+{
+    const auto it = m_pending.find(id);
+    if (it == m_pending.end()) {
+        return;
+    }
+
+    auto &m = method(it->method);
+    ++m.replies;
+    received(m, message);
+
+    const qint64 latency = message.received - it->sent;
+    m.latencyTotal += latency;
+    m.latencyMax = qMax(m.latencyMax, latency);
+    const auto &buckets = latencyBuckets();
+    const auto bucket = std::lower_bound(buckets.cbegin(), buckets.cend(), int(qMin<qint64>(latency / 1000, INT_MAX))) - buckets.cbegin();
+    ++m.histogram[bucket];
+
+    m_pending.erase(it);
+}
+
+void LSPServerStatistics::notified(const QString &name, const Message &message)
+{
+    auto &m = method(name);
+    ++m.received;
+    received(m, message);
+}
+
+void LSPServerStatistics::payloadQueued()
+{
+    ++m_decodeQueue;
+    m_maxDecodeQueue = qMax(m_maxDecodeQueue, m_decodeQueue);
+}
+
+void LSPServerStatistics::payloadDequeued()
+{
+    --m_decodeQueue;
+}
+
+int LSPServerStatistics::percentile(const QVector<int> &histogram, int percent)
+{
+    int total = 0;
+    for (int count : histogram) {
+        total += count;
+    }
+    if (total == 0) {
+        return -1;
+    }
+
+    // smallest bucket holding at least the given share of the samples
+    const qint64 needed = (qint64(total) * percent + 99) / 100;
+    qint64 count = 0;
+    for (int i = 0; i < histogram.size(); ++i) {
+        count += histogram.at(i);
+        if (count >= needed) {
+            return i < latencyBuckets().size() ? latencyBuckets().at(i) : -1;
+        }
+    }
+    return -1;
+}
+
+QJsonObject LSPServerStatistics::toJson() const
+{
+    QJsonArray buckets;
+    for (int bucket : latencyBuckets()) {
+        buckets.append(bucket);
+    }
+
+    QJsonObject methods;
+    for (auto it = m_methods.cbegin(); it != m_methods.cend(); ++it) {
+        const auto &m = it.value();
+        QJsonArray histogram;
+        for (int count : m.histogram) {
+            histogram.append(count);
+        }
+        // times in json are in ms
+        auto average = [](qint64 total, int count) {
+            return count ? total / 1000.0 / count : 0.0;
+        };
+        const int handled = m.replies + m.received;
+        methods.insert(it.key(),
+                       QJsonObject {{QStringLiteral("requests"), m.requests},
+                                    {QStringLiteral("notifications"), m.notifications},
+                                    {QStringLiteral("replies"), m.replies},
+                                    {QStringLiteral("received"), m.received},
+                                    {QStringLiteral("cancelled"), m.cancelled},
+                                    {QStringLiteral("expired"), m.expired},
+                                    {QStringLiteral("bytesSent"), m.bytesSent},
+                                    {QStringLiteral("bytesReceived"), m.bytesReceived},
+                                    {QStringLiteral("latencyAverage"), average(m.latencyTotal, m.replies)},
+                                    {QStringLiteral("latencyMax"), m.latencyMax / 1000.0},
+                                    {QStringLiteral("latencyHistogram"), histogram},
+                                    {QStringLiteral("decodeAverage"), average(m.decodeTotal, handled)},
+                                    {QStringLiteral("waitAverage"), average(m.waitTotal, handled)},
+                                    {QStringLiteral("handleAverage"), average(m.handleTotal, handled)}});
+    }
+
+    return QJsonObject {{QStringLiteral("pendingRequests"), m_pending.size()},
+                        {QStringLiteral("maxPendingRequests"), m_maxPending},
+                        {QStringLiteral("decodeQueue"), m_decodeQueue},
+                        {QStringLiteral("maxDecodeQueue"), m_maxDecodeQueue},
+                        {QStringLiteral("latencyBuckets"), buckets},
+                        {QStringLiteral("methods"), methods}};
+}
+
+void LSPServerStatistics::clear()
+{
+    // pending requests are still to be replied to
+    m_methods.clear();
+    m_maxPending = m_pending.size();
+    m_maxDecodeQueue = m_decodeQueue;
+}
@@ -0,0 +1,159 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LSPCLIENTSERVERSTATISTICS_H
+#define LSPCLIENTSERVERSTATISTICS_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+/**
+ * Request and message statistics of one LSP server, per method.
+ *
+ * The latency of a request is the time from sending it until its reply is
+ * read from the server, that is the time spent in the server. Time spent in
+ * the client is split into decoding the payload, waiting to be dispatched
+ * and running the handler. All times are in microseconds, as passed by the
+ * caller, so they can come from any monotonic clock.
+ */
+class LSPServerStatistics
+{
+public:
+    /**
+     * Upper bounds of the latency histogram buckets in ms, the last bucket has none.
+     */
+    static const QVector<int> &latencyBuckets();
+
+    struct Method {
+        // sent by the client
+        int requests = 0;
+        int notifications = 0;
+        // replies to requests, notifications and requests from the server
+        int replies = 0;
+        int received = 0;
+        // cancelled by the client, explicitly or as the reply took too long
+        int cancelled = 0;
+        int expired = 0;
+        qint64 bytesSent = 0;
+        qint64 bytesReceived = 0;
+        qint64 latencyTotal = 0;
+        qint64 latencyMax = 0;
+        qint64 decodeTotal = 0;
+        qint64 waitTotal = 0;
+        qint64 handleTotal = 0;
+        QVector<int> histogram;
+    };
+
+    /**
+     * Times of a message from the server.
+     */
+    struct Message {
+        int size = 0;
+        // read from the server
+        qint64 received = 0;
+        // spent parsing the payload
+        qint64 decodeTime = 0;
+        // handler started and finished
+        qint64 dispatched = 0;
+        qint64 handled = 0;
+    };
+
+    /**
+     * A request with @p id was sent, a negative @p id for notifications and responses.
+     */
+    void sent(const QString &method, int id, int size, qint64 time);
+
+    /**
+     * The request with @p id was cancelled, @p expired if that happened as it took too long.
+     */
+    void cancelled(int id, bool expired);
+
+    /**
+     * Pending requests will not be replied to, e.g. on shutdown.
+     */
+    void abandonPending();
+
+    /**
+     * The reply to request @p id was handled, replies to unknown or cancelled requests are ignored.
+     */
+    void replied(int id, const Message &message);
+
+    /**
+     * A notification or request of @p method from the server was handled.
+     */
+    void notified(const QString &method, const Message &message);
+
+    /**
+     * A payload was read and queued for decoding, or left that queue.
+     */
+    void payloadQueued();
+    void payloadDequeued();
+
+    const QMap<QString, Method> &methods() const
+    {
+        return m_methods;
+    }
+
+    int pendingRequests() const
+    {
+        return m_pending.size();
+    }
+
+    int decodeQueue() const
+    {
+        return m_decodeQueue;
+    }
+
+    /**
+     * @return upper bound in ms of the bucket holding the @p percent percentile, -1 for the last one or no data
+     */
+    static int percentile(const QVector<int> &histogram, int percent);
+
+    QJsonObject toJson() const;
+
+    void clear();
+
+private:
+    Method &method(const QString &name);
+    void received(Method &method, const Message &message);
+
+private:
+    QMap<QString, Method> m_methods;
+
+    struct Pending {
+        QString method;
+        qint64 sent;
+    };
+    QHash<int, Pending> m_pending;
+    int m_maxPending = 0;
+
+    int m_decodeQueue = 0;
+    int m_maxDecodeQueue = 0;
+};
+
+#endif
@@ -0,0 +1,269 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lspclientsymbolindex.h"
+#include "lspclientcompletionfilter.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+/**
+ * magic and version of the index file, bump the version on format changes
+ */
+static const quint32 IndexMagic = 0x4c535049; // "LSPI"
+static const quint32 IndexVersion = 1;
+
+static bool isFunction(LSPSymbolKind kind)
+{
+    return kind == LSPSymbolKind::Function || kind == LSPSymbolKind::Method || kind == LSPSymbolKind::Constructor;
+}
+
+void LSPSymbolIndex::addSymbols(File &file, const QList<LSPSymbolInformation> &symbols, const QString &container)
+{
+    for (const auto &symbol : symbols) {
+        file.symbols.push_back({symbol.name, container, symbol.kind, file.url, symbol.range});
+        if (!isFunction(symbol.kind)) {
+            addSymbols(file, symbol.children, symbol.name);
+        }
+    }
+}
+
+void LSPSymbolIndex::indexFile(int id)
+{
+    const auto &symbols = m_files.at(id).symbols;
+    for (int i = 0; i < symbols.size(); ++i) {
+        m_names[symbols.at(i).name.toLower()].push_back({id, i});
+    }
+}
+
+void LSPSymbolIndex::unindexFile(int id)
+{
+    for (const auto &symbol : qAsConst(m_files.at(id).symbols)) {
+        auto it = m_names.find(symbol.name.toLower());
+        if (it == m_names.end()) {
+            continue;
+        }
+        auto &refs = it.value();
+        refs.erase(std::remove_if(refs.begin(), refs.end(), [id](const Ref &ref) { return ref.file == id; }), refs.end());
+        if (refs.isEmpty()) {
+            m_names.erase(it);
+        }
+    }
+}
+
+void LSPSymbolIndex::setSymbols(const QUrl &url, qint64 lastModified, const QList<LSPSymbolInformation> &symbols)
+{
+    int id = m_fileIds.value(url, -1);
+    if (id >= 0) {
+        unindexFile(id);
+    } else if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+    } else {
+        id = m_files.size();
+        m_files.push_back({});
+    }
+
+    auto &file = m_files[id];
+    file.url = url;
+    file.lastModified = lastModified;
+    file.symbols.clear();
+    addSymbols(file, symbols, QString());
+
+    m_fileIds.insert(url, id);
+    indexFile(id);
+    m_modified = true;
+}
+
+void LSPSymbolIndex::removeFile(const QUrl &url)
+{
+    const auto it = m_fileIds.find(url);
+    if (it == m_fileIds.end()) {
+        return;
+    }
+    const int id = it.value();
+    m_fileIds.erase(it);
+
+    unindexFile(id);
+    m_files[id] = File();
+    m_freeIds.push_back(id);
+    m_modified = true;
+}
+
+void LSPSymbolIndex::retainFiles(const QSet<QUrl> &urls)
+{
+    const auto known = m_fileIds.keys();
+    for (const auto &url : known) {
+        if (!urls.contains(url)) {
+            removeFile(url);
+        }
+    }
+}
+
+bool LSPSymbolIndex::isUpToDate(const QUrl &url, qint64 lastModified) const
+{
+    const int id = m_fileIds.value(url, -1);
+    return id >= 0 && m_files.at(id).lastModified == lastModified;
+}
+
+int LSPSymbolIndex::symbolCount() const
+{
+    int count = 0;
+    for (const auto &file : m_files) {
+        count += file.symbols.size();
+    }
+    return count;
+}
+
+QVector<LSPSymbolIndex::Symbol> LSPSymbolIndex::find(const QString &pattern, int limit) const
+{
+    // score each distinct name once, in the case of its first symbol for the word start bonus
+    struct Match {
+        int score;
+        const QString *name;
+    };
+    QVector<Match> matches;
+    for (auto it = m_names.cbegin(); it != m_names.cend(); ++it) {
+        const auto &ref = it.value().first();
+        const int score = LSPCompletionFilter::score(pattern, m_files.at(ref.file).symbols.at(ref.symbol).name);
+        if (score >= 0) {
+            matches.push_back({score, &it.key()});
+        }
+    }
+
+    // better score, then shorter, then alphabetical
+    std::sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (a.name->size() != b.name->size()) {
+            return a.name->size() < b.name->size();
+        }
+        return *a.name < *b.name;
+    });
+
+    QVector<Symbol> result;
+    for (const auto &match : qAsConst(matches)) {
+        for (const auto &ref : m_names.value(*match.name)) {
+            if (result.size() >= limit) {
+                return result;
+            }
+            result.push_back(m_files.at(ref.file).symbols.at(ref.symbol));
+        }
+    }
+    return result;
+}
+
+bool LSPSymbolIndex::load(const QString &indexFile)
+{
+    clear();
+
+    QFile file(indexFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (magic != IndexMagic || version != IndexVersion) {
+        return false;
+    }
+
+    in.setVersion(QDataStream::Qt_5_0);
+    qint32 fileCount = 0;
+    in >> fileCount;
+    for (qint32 i = 0; i < fileCount && in.status() == QDataStream::Ok; ++i) {
+        File entry;
+        qint32 symbolCount = 0;
+        in >> entry.url >> entry.lastModified >> symbolCount;
+        for (qint32 j = 0; j < symbolCount && in.status() == QDataStream::Ok; ++j) {
+            Symbol symbol;
+            qint32 kind = 0;
+            qint32 startLine = 0, startColumn = 0, endLine = 0, endColumn = 0;
+            in >> symbol.name >> symbol.container >> kind >> startLine >> startColumn >> endLine >> endColumn;
+            symbol.kind = static_cast<LSPSymbolKind>(kind);
+            symbol.url = entry.url;
+            symbol.range = LSPRange(startLine, startColumn, endLine, endColumn);
+            entry.symbols.push_back(symbol);
+        }
+        m_fileIds.insert(entry.url, m_files.size());
+        m_files.push_back(entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+
+    for (int id = 0; id < m_files.size(); ++id) {
+        indexFile(id);
+    }
+    return true;
+}
+
+bool LSPSymbolIndex::save(const QString &indexFile)
+{
+    QDir().mkpath(QFileInfo(indexFile).absolutePath());
+    QSaveFile file(indexFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << IndexMagic << IndexVersion;
+    out.setVersion(QDataStream::Qt_5_0);
+    out << qint32(m_fileIds.size());
+    for (const auto &entry : qAsConst(m_files)) {
+        if (entry.url.isEmpty()) {
+            continue;
+        }
+        out << entry.url << entry.lastModified << qint32(entry.symbols.size());
+        for (const auto &symbol : entry.symbols) {
+            out << symbol.name << symbol.container << qint32(symbol.kind) << qint32(symbol.range.start().line()) << qint32(symbol.range.start().column())
+                << qint32(symbol.range.end().line()) << qint32(symbol.range.end().column());
+        }
+    }
+
+    if (!file.commit()) {
+        return false;
+    }
+    m_modified = false;
+    return true;
+}
+
+void LSPSymbolIndex::clear()
+{
+    m_files.clear();
+    m_freeIds.clear();
+    m_fileIds.clear();
+    m_names.clear();
+    m_modified = false;
+}
@@ -0,0 +1,130 @@
+/*  SPDX-License-Identifier: MIT
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the
+    "Software"), to deal in the Software without restriction, including
+    without limitation the rights to use, copy, modify, merge, publish,
+    distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to
+    the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+    CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LSPCLIENTSYMBOLINDEX_H
+#define LSPCLIENTSYMBOLINDEX_H
+
+#include "lspclientprotocol.h"
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <QVector>
+
+/**
+ * Symbols of all files of a workspace, as reported by documentSymbol.
+ *
+ * Symbols are kept per file along with the modification time of the file
+ * they were taken from, so outdated files can be told and indexed again.
+ * Lookups go through an inverted index of the distinct lower case symbol
+ * names, which are fuzzy matched against the pattern; there are far less
+ * distinct names than symbols. The index can be stored to and loaded from
+ * a file, one per project.
+ */
+class LSPSymbolIndex
+{
+public:
+    struct Symbol {
+        QString name;
+        // name of the enclosing symbol, if any
+        QString container;
+        LSPSymbolKind kind;
+        QUrl url;
+        LSPRange range;
+    };
+
+    /**
+     * Replace the symbols of @p url, taken from the file as of @p lastModified.
+     * Local symbols of functions are not indexed.
+     */
+    void setSymbols(const QUrl &url, qint64 lastModified, const QList<LSPSymbolInformation> &symbols);
+
+    void removeFile(const QUrl &url);
+
+    /**
+     * Drop all files not in @p urls.
+     */
+    void retainFiles(const QSet<QUrl> &urls);
+
+    /**
+     * @return true if the symbols of @p url were taken from the file as of @p lastModified
+     */
+    bool isUpToDate(const QUrl &url, qint64 lastModified) const;
+
+    /**
+     * @return at most @p limit symbols whose name fuzzy matches @p pattern, best first
+     */
+    QVector<Symbol> find(const QString &pattern, int limit) const;
+
+    int fileCount() const
+    {
+        return m_fileIds.size();
+    }
+
+    int symbolCount() const;
+
+    /**
+     * @return true if changed since the last load() or save()
+     */
+    bool isModified() const
+    {
+        return m_modified;
+    }
+
+    bool load(const QString &indexFile);
+    bool save(const QString &indexFile);
+
+    void clear();
+
+private:
+    struct File {
+        QUrl url;
+        qint64 lastModified = 0;
+        QVector<Symbol> symbols;
+    };
+
+    struct Ref {
+        int file;
+        int symbol;
+    };
+
+    void addSymbols(File &file, const QList<LSPSymbolInformation> &symbols, const QString &container);
+    void indexFile(int id);
+    void unindexFile(int id);
+
+private:
+    // removed files leave a free slot
+    QVector<File> m_files;
+    QVector<int> m_freeIds;
+    QHash<QUrl, int> m_fileIds;
+
+    // lower case name => symbols
+    QHash<QString, QVector<Ref>> m_names;
+
+    bool m_modified = false;
+};
+
+#endif
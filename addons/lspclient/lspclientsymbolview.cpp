@@ -24,19 +24,29 @@
 */
 
 #include "lspclientsymbolview.h"
+#include "lspclientsymbolindex.h"
 
 #include <KLineEdit>
 #include <KLocalizedString>
 #include <QSortFilterProxyModel>
 
+#include <KTextEditor/Application>
 #include <KTextEditor/Document>
+#include <KTextEditor/Editor>
 #include <KTextEditor/MainWindow>
 #include <KTextEditor/View>
 
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QHBoxLayout>
+#include <QHash>
 #include <QMenu>
 #include <QPointer>
 #include <QStandardItemModel>
+#include <QStandardPaths>
 #include <QTimer>
 #include <QTreeView>
 
@@ -144,6 +154,7 @@ class LSPClientSymbolViewImpl : public QObject, public LSPClientSymbolView
     QAction *m_expandOn;
     QAction *m_treeOn;
     QAction *m_sortOn;
+    QAction *m_workspaceOn;
     // view tracking
     QScopedPointer<LSPClientViewTracker> m_viewTracker;
     // outstanding request
@@ -162,6 +173,29 @@ class LSPClientSymbolViewImpl : public QObject, public LSPClientSymbolView
     // filter model, setup once
     QSortFilterProxyModel m_filterModel;
 
+    // symbols of all files of the current project, indexed in the background
+    LSPSymbolIndex m_index;
+    QString m_indexProject;
+    QString m_indexFile;
+    QStringList m_indexQueue;
+    // suffix => language id and server id, valid for one pass over the queue
+    QHash<QString, QPair<QString, QString>> m_indexServerIds;
+    QTimer m_indexTimer;
+    // outstanding index request and the file opened for it, if any
+    bool m_indexing = false;
+    LSPClientServer::RequestHandle m_indexHandle;
+    QUrl m_indexOpened;
+    // pause between files and time to wait for a reply
+    static constexpr int INDEX_DELAY = 10;
+    static constexpr int INDEX_TIMEOUT = 5000;
+    // queued files looked at per timer tick
+    static constexpr int INDEX_BATCH = 100;
+    // larger files are left out
+    static constexpr qint64 MAX_INDEX_FILE_SIZE = 4 * 1024 * 1024;
+    // workspace matches are shown instead of the outline
+    bool m_showingWorkspace = false;
+    static constexpr int MAX_WORKSPACE_SYMBOLS = 200;
+
     // cached icons for model
     const QIcon m_icon_pkg = QIcon::fromTheme(QStringLiteral("code-block"));
     const QIcon m_icon_class = QIcon::fromTheme(QStringLiteral("code-class"));
@@ -220,6 +254,8 @@ public:
         m_sortOn->setCheckable(true);
         m_detailsOn = m_popup->addAction(i18n("Show Details"), this, &self_type::displayOptionChanged);
         m_detailsOn->setCheckable(true);
+        m_workspaceOn = m_popup->addAction(i18n("Filter Searches Workspace"), this, [this]() { filterTextChanged(m_filter->text()); });
+        m_workspaceOn->setCheckable(true);
         m_popup->addSeparator();
         m_popup->addAction(i18n("Expand All"), m_symbols.data(), &QTreeView::expandAll);
         m_popup->addAction(i18n("Collapse All"), m_symbols.data(), &QTreeView::collapseAll);
@@ -230,7 +266,14 @@ public:
         // get updated
         m_viewTracker.reset(LSPClientViewTracker::new_(plugin, mainWin, 500, 100));
         connect(m_viewTracker.data(), &LSPClientViewTracker::newState, this, &self_type::onViewState);
-        connect(m_serverManager.data(), &LSPClientServerManager::serverChanged, this, [this]() { refresh(false); });
+        connect(m_serverManager.data(), &LSPClientServerManager::serverChanged, this, [this]() {
+            refresh(false);
+            // a new server may index more files
+            updateIndex(true);
+        });
+
+        m_indexTimer.setSingleShot(true);
+        connect(&m_indexTimer, &QTimer::timeout, this, &self_type::indexNext);
 
         // limit cached models; will not go beyond capacity set here
         m_models.reserve(MAX_MODELS + 1);
@@ -239,6 +282,12 @@ public:
         configUpdated();
     }
 
+    ~LSPClientSymbolViewImpl() override
+    {
+        finishIndexRequest();
+        saveIndex();
+    }
+
     void displayOptionChanged()
     {
         m_expandOn->setEnabled(m_treeOn->isChecked());
@@ -264,6 +313,7 @@ public:
         switch (newState) {
         case LSPClientViewTracker::ViewChanged:
             refresh(true);
+            updateIndex(false);
             break;
         case LSPClientViewTracker::TextChanged:
             refresh(false);
@@ -274,45 +324,39 @@ public:
         }
     }
 
+    const QIcon &symbolIcon(LSPSymbolKind kind) const
+    {
+        switch (kind) {
+        case LSPSymbolKind::File:
+        case LSPSymbolKind::Module:
+        case LSPSymbolKind::Namespace:
+        case LSPSymbolKind::Package:
+            return m_icon_pkg;
+        case LSPSymbolKind::Class:
+        case LSPSymbolKind::Interface:
+            return m_icon_class;
+        case LSPSymbolKind::Enum:
+            return m_icon_typedef;
+        case LSPSymbolKind::Method:
+        case LSPSymbolKind::Function:
+        case LSPSymbolKind::Constructor:
+            return m_icon_function;
+        // all others considered/assumed Variable
+        default:
+            return m_icon_var;
+        }
+    }
+
     void makeNodes(const QList<LSPSymbolInformation> &symbols, bool tree, bool show_detail, QStandardItemModel *model, QStandardItem *parent, bool &details)
     {
-        const QIcon *icon = nullptr;
         for (const auto &symbol : symbols) {
-            switch (symbol.kind) {
-            case LSPSymbolKind::File:
-            case LSPSymbolKind::Module:
-            case LSPSymbolKind::Namespace:
-            case LSPSymbolKind::Package:
-                if (symbol.children.count() == 0)
-                    continue;
-                icon = &m_icon_pkg;
-                break;
-            case LSPSymbolKind::Class:
-            case LSPSymbolKind::Interface:
-                icon = &m_icon_class;
-                break;
-            case LSPSymbolKind::Enum:
-                icon = &m_icon_typedef;
-                break;
-            case LSPSymbolKind::Method:
-            case LSPSymbolKind::Function:
-            case LSPSymbolKind::Constructor:
-                icon = &m_icon_function;
-                break;
-            // all others considered/assumed Variable
-            case LSPSymbolKind::Variable:
-            case LSPSymbolKind::Constant:
-            case LSPSymbolKind::String:
-            case LSPSymbolKind::Number:
-            case LSPSymbolKind::Property:
-            case LSPSymbolKind::Field:
-            default:
-                // skip local variable
-                // property, field, etc unlikely in such case anyway
-                if (parent && parent->icon().cacheKey() == m_icon_function.cacheKey())
-                    continue;
-                icon = &m_icon_var;
-            }
+            const QIcon *icon = &symbolIcon(symbol.kind);
+            if (icon == &m_icon_pkg && symbol.children.count() == 0)
+                continue;
+            // skip local variable
+            // property, field, etc unlikely in such case anyway
+            if (icon == &m_icon_var && parent && parent->icon().cacheKey() == m_icon_function.cacheKey())
+                continue;
 
             auto node = new QStandardItem();
             if (parent && tree)
@@ -336,6 +380,27 @@ public:
         onDocumentSymbolsOrProblem(outline, QString(), true);
     }
 
+    void showWorkspaceSymbols(const QString &pattern)
+    {
+        auto newModel = std::make_shared<QStandardItemModel>();
+        const auto symbols = m_index.find(pattern, MAX_WORKSPACE_SYMBOLS);
+        for (const auto &symbol : symbols) {
+            const auto path = symbol.url.toLocalFile();
+            auto node = new QStandardItem(symbol.name);
+            node->setIcon(symbolIcon(symbol.kind));
+            node->setToolTip(symbol.container.isEmpty() ? path : i18n("%1 in %2", symbol.container, path));
+            node->setData(QVariant::fromValue<KTextEditor::Range>(symbol.range), Qt::UserRole);
+            node->setData(symbol.url, Qt::UserRole + 1);
+            auto location = new QStandardItem(QStringLiteral("%1:%2").arg(QFileInfo(path).fileName()).arg(symbol.range.start().line() + 1));
+            location->setToolTip(node->toolTip());
+            newModel->appendRow({node, location});
+        }
+        newModel->setHorizontalHeaderLabels({i18n("Symbols"), i18n("Location")});
+
+        m_showingWorkspace = true;
+        setModel(newModel);
+    }
+
     void onDocumentSymbolsOrProblem(const QList<LSPSymbolInformation> &outline, const QString &problem = QString(), bool cache = false)
     {
         if (!m_symbols)
@@ -364,7 +429,8 @@ public:
         QStringList headers {i18n("Symbols")};
         newModel->setHorizontalHeaderLabels(headers);
 
-        setModel(newModel);
+        if (!m_showingWorkspace)
+            setModel(newModel);
     }
 
     void setModel(const std::shared_ptr<QStandardItemModel> &newModel)
@@ -377,8 +443,8 @@ public:
         // delete old outline if there, keep our new one alive
         m_outline = newModel;
 
-        // fixup sorting
-        if (m_sortOn->isChecked()) {
+        // fixup sorting, workspace matches stay ranked
+        if (m_sortOn->isChecked() && !m_showingWorkspace) {
             m_symbols->setSortingEnabled(true);
             m_symbols->sortByColumn(0, Qt::AscendingOrder);
         } else {
@@ -397,8 +463,8 @@ public:
         // (as an indication there is nothing to show anyway)
         m_detailsOn->setEnabled(details);
 
-        // hide detail column if not needed/wanted
-        bool showDetails = m_detailsOn->isChecked() && details;
+        // hide detail column if not needed/wanted, workspace matches show their location there
+        bool showDetails = (m_detailsOn->isChecked() && details) || m_showingWorkspace;
         m_symbols->setColumnHidden(1, !showDetails);
 
         // current item tracking
@@ -438,7 +504,8 @@ public:
                 // reloaded document recycles revision number, so avoid stale cache
                 // (clear := view switch)
                 if (revision == model.revision && model.model && (clear || revision > 0)) {
-                    setModel(model.model);
+                    if (!m_showingWorkspace)
+                        setModel(model.model);
                     return;
                 }
                 it->revision = revision;
@@ -449,7 +516,16 @@ public:
                 }
             }
 
-            m_handle = server->documentSymbols(view->document()->url(), this, utils::mem_fun(&self_type::onDocumentSymbols, this));
+            // the outline of a saved document is as good for the index as any
+            const auto url = doc->url();
+            const qint64 lastModified = doc->isModified() ? -1 : QFileInfo(url.toLocalFile()).lastModified().toMSecsSinceEpoch();
+            auto h = [this, url, lastModified](const QList<LSPSymbolInformation> &outline) {
+                onDocumentSymbols(outline);
+                if (lastModified >= 0 && url.isLocalFile() && !m_indexProject.isEmpty()) {
+                    m_index.setSymbols(url, lastModified, outline);
+                }
+            };
+            m_handle = server->documentSymbols(url, this, h);
 
             return;
         }
@@ -477,7 +553,7 @@ public:
     void updateCurrentTreeItem()
     {
         KTextEditor::View *editView = m_mainWindow->activeView();
-        if (!editView || !m_symbols) {
+        if (!editView || !m_symbols || m_showingWorkspace) {
             return;
         }
 
@@ -500,12 +576,173 @@ public:
     void goToSymbol(const QModelIndex &index)
     {
         KTextEditor::View *kv = m_mainWindow->activeView();
-        const auto range = index.data(Qt::UserRole).value<KTextEditor::Range>();
+        const auto symbolIndex = index.sibling(index.row(), 0);
+        const auto url = symbolIndex.data(Qt::UserRole + 1).toUrl();
+        if (!url.isEmpty()) {
+            kv = m_mainWindow->openUrl(url);
+        }
+        const auto range = symbolIndex.data(Qt::UserRole).value<KTextEditor::Range>();
         if (kv && range.isValid()) {
             kv->setCursorPosition(range.start());
         }
     }
 
+    static QString indexFileName(const QString &projectFile)
+    {
+        const auto hash = QCryptographicHash::hash(projectFile.toUtf8(), QCryptographicHash::Sha1).toHex();
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/lspclient/") + QString::fromLatin1(hash) + QStringLiteral(".symbols");
+    }
+
+    void saveIndex()
+    {
+        if (!m_indexFile.isEmpty() && m_index.isModified()) {
+            m_index.save(m_indexFile);
+        }
+    }
+
+    /**
+     * Follow the current project, its files are queued for indexing if
+     * the project changed or if @p requeue is set.
+     */
+    void updateIndex(bool requeue)
+    {
+        QObject *projectView = m_mainWindow->pluginView(QStringLiteral("kateprojectplugin"));
+        const auto project = projectView ? projectView->property("projectFileName").toString() : QString();
+        if (project != m_indexProject) {
+            finishIndexRequest();
+            saveIndex();
+            m_indexProject = project;
+            m_indexFile = project.isEmpty() ? QString() : indexFileName(project);
+            m_index.clear();
+            if (!m_indexFile.isEmpty()) {
+                m_index.load(m_indexFile);
+            }
+            requeue = true;
+        }
+        if (!requeue) {
+            return;
+        }
+
+        m_indexQueue = projectView && !project.isEmpty() ? projectView->property("projectFiles").toStringList() : QStringList();
+        // the configuration or the project might have changed
+        m_indexServerIds.clear();
+
+        // forget files no longer part of the project
+        QSet<QUrl> urls;
+        urls.reserve(m_indexQueue.size());
+        for (const auto &file : qAsConst(m_indexQueue)) {
+            urls.insert(QUrl::fromLocalFile(file));
+        }
+        m_index.retainFiles(urls);
+
+        if (!m_indexing) {
+            m_indexTimer.start(INDEX_DELAY);
+        }
+    }
+
+    // done with the outstanding index request, if any
+    void finishIndexRequest()
+    {
+        if (!m_indexing) {
+            return;
+        }
+        m_indexing = false;
+        m_indexHandle.expire();
+        closeIndexedFile();
+    }
+
+    void closeIndexedFile()
+    {
+        // closed already if a document of it got opened on the server meanwhile
+        if (!m_indexOpened.isEmpty()) {
+            m_serverManager->closeTransient(m_indexOpened);
+        }
+        m_indexOpened.clear();
+    }
+
+    /**
+     * Request the symbols of the next outdated file in the queue.
+     * Files not open on their server are opened for the time of the request,
+     * files without a running server and modified documents are left out.
+     * At most INDEX_BATCH queued files are looked at per call, not to block the GUI.
+     */
+    void indexNext()
+    {
+        // the timer only fires with a request outstanding if the reply took too long
+        finishIndexRequest();
+
+        for (int checked = 0; !m_indexQueue.isEmpty(); ++checked) {
+            if (checked == INDEX_BATCH) {
+                m_indexTimer.start(INDEX_DELAY);
+                return;
+            }
+
+            const QString path = m_indexQueue.takeFirst();
+            const QFileInfo info(path);
+
+            // the server is looked up once per suffix
+            const QString suffix = info.suffix();
+            auto ids = m_indexServerIds.constFind(suffix);
+            if (ids == m_indexServerIds.cend()) {
+                QString langId;
+                QString serverId;
+                m_serverManager->serverIdForFile(QUrl::fromLocalFile(path), langId, serverId);
+                ids = m_indexServerIds.insert(suffix, qMakePair(langId, serverId));
+            }
+            if (ids->second.isEmpty()) {
+                continue;
+            }
+
+            if (!info.isFile() || info.size() > MAX_INDEX_FILE_SIZE) {
+                continue;
+            }
+            const auto url = QUrl::fromLocalFile(path);
+            const qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+            if (m_index.isUpToDate(url, lastModified)) {
+                continue;
+            }
+
+            const QString langId = ids->first;
+            auto server = m_serverManager->findRunningServer(url, ids->second);
+            if (!server || !server->capabilities().documentSymbolProvider) {
+                continue;
+            }
+
+            // the symbols are stored for the file on disk, a modified document is indexed once it is saved
+            // an open document is synced if it is tracked already, otherwise its text is used as is
+            QString text;
+            if (auto document = KTextEditor::Editor::instance()->application()->findUrl(url)) {
+                if (document->isModified()) {
+                    continue;
+                }
+                m_serverManager->update(document, false);
+                text = document->text();
+            } else {
+                QFile file(path);
+                if (!file.open(QIODevice::ReadOnly)) {
+                    continue;
+                }
+                text = QString::fromUtf8(file.readAll());
+            }
+            m_serverManager->openTransient(server, url, langId, text);
+            m_indexOpened = url;
+
+            auto h = [this, url, lastModified](const QList<LSPSymbolInformation> &symbols) {
+                m_index.setSymbols(url, lastModified, symbols);
+                m_indexing = false;
+                closeIndexedFile();
+                m_indexTimer.start(INDEX_DELAY);
+            };
+            m_indexing = true;
+            m_indexHandle = server->documentSymbols(url, this, h);
+            m_indexTimer.start(INDEX_TIMEOUT);
+            return;
+        }
+
+        // all done
+        saveIndex();
+    }
+
 private Q_SLOTS:
     /**
      * React on filter change
@@ -517,6 +754,19 @@ private Q_SLOTS:
             return;
         }
 
+        /**
+         * search the workspace index, its matches are fuzzy
+         */
+        if (m_workspaceOn->isChecked() && !filterText.isEmpty()) {
+            m_filterModel.setFilterFixedString(QString());
+            showWorkspaceSymbols(filterText);
+            return;
+        }
+        if (m_showingWorkspace) {
+            m_showingWorkspace = false;
+            refresh(true);
+        }
+
         /**
          * filter
          */
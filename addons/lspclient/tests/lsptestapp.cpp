@@ -78,8 +78,8 @@ int main(int argc, char **argv)
     lsp.documentDefinition(document, {position[0].toInt(), position[1].toInt()}, &app, def_h);
     q.exec();
 
-    auto comp_h = [&q](const QList<LSPCompletionItem> &completions) {
-        std::cout << "completion count: " << completions.length() << std::endl;
+    auto comp_h = [&q](const LSPCompletionList &completions) {
+        std::cout << "completion count: " << completions.items.length() << std::endl;
         q.quit();
     };
     lsp.documentCompletion(document, {position[0].toInt(), position[1].toInt()}, &app, comp_h);
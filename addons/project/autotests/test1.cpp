@@ -19,12 +19,23 @@
  */
 
 #include "test1.h"
+#include "ctags/ctagsdatabase.h"
+#include "ctags/ctagsgenerator.h"
 #include "fileutil.h"
+#include "kateprojecttree.h"
+#include "kateprojecttrigramindex.h"
 #include "tools/kateprojectcodeanalysistoolshellcheck.h"
 
 #include <QtTest>
 
+#include <QStandardPaths>
 #include <QString>
+#include <QTemporaryDir>
+
+/**
+ * readtags, the baseline for the lookup benchmark
+ */
+#include "ctags/readtags.c"
 
 QTEST_MAIN(Test1)
 
@@ -52,4 +63,331 @@ void Test1::testShellCheckParsing()
     QCOMPARE(outList.size(), 4);
 }
 
+static void writeFile(const QString &fileName, const QByteArray &content)
+{
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+void Test1::testTrigramIndex()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString indexFile = dir.filePath(QStringLiteral("index.trigrams"));
+    const QString a = dir.filePath(QStringLiteral("a.cpp"));
+    const QString b = dir.filePath(QStringLiteral("b.cpp"));
+    const QString c = dir.filePath(QStringLiteral("c.bin"));
+    const QString unknown = dir.filePath(QStringLiteral("unknown.cpp"));
+    writeFile(a, "int fooBar = 42;\n");
+    writeFile(b, "void baz()\r\n{\r\n}\r\n");
+    writeFile(c, QByteArray("binary\0foo", 10));
+    const QStringList files = {a, b, c};
+
+    {
+        KateProjectTrigramIndex index(indexFile, files);
+
+        // candidates, case folded, unindexed and unknown files are kept
+        QCOMPARE(index.filesContaining(files, QStringLiteral("FOOBAR")), QStringList({a, c}));
+        QCOMPARE(index.filesContaining(files, QStringLiteral("baz()")), QStringList({b, c}));
+        QCOMPARE(index.filesContaining(files, QStringLiteral("nowhere")), QStringList({c}));
+        QCOMPARE(index.filesContaining({unknown}, QStringLiteral("nowhere")), QStringList({unknown}));
+
+        // too short or only line end trigrams, nothing to look up
+        QCOMPARE(index.filesContaining(files, QStringLiteral("fo")), files);
+        QCOMPARE(index.filesContaining(files, QStringLiteral(")\n{")), files);
+
+        // ruled out files are kept once they are edited outside of Kate
+        QCOMPARE(index.filesNotContaining(files, QStringLiteral("nowhere")).size(), 2);
+        QVERIFY(index.filesNotContaining(files, QStringLiteral("nowhere")).contains(a));
+        writeFile(a, "// nowhere\n");
+        QCOMPARE(index.filesContaining(files, QStringLiteral("nowhere")), QStringList({a, c}));
+
+        // files changed after indexing are always kept
+        writeFile(b, "int fooBar;\n");
+        QCOMPARE(index.filesContaining(files, QStringLiteral("fooBar")), QStringList({a, b, c}));
+    }
+
+    // reload picks up the change of b and the removal of a
+    KateProjectTrigramIndex index(indexFile, {b, c});
+    QCOMPARE(index.filesContaining({a, b, c}, QStringLiteral("fooBar")), QStringList({a, b, c}));
+    QCOMPARE(index.filesContaining({b, c}, QStringLiteral("baz()")), QStringList({c}));
+}
+
+void Test1::testProjectTree()
+{
+    KateProjectTree tree;
+    const int project = tree.append(KateProjectTree::Root, KateProjectTree::Project, QStringLiteral("project"));
+    const int src = tree.append(project, KateProjectTree::Directory, QStringLiteral("src"), QStringLiteral("/p/src"));
+    const int a = tree.append(src, KateProjectTree::File, QStringLiteral("a.cpp"), QStringLiteral("/p/src"));
+    const int c = tree.append(src, KateProjectTree::File, QStringLiteral("c.cpp"), QStringLiteral("/p/src"));
+    const int readme = tree.append(project, KateProjectTree::File, QStringLiteral("README"), QStringLiteral("/p"));
+    tree.finish();
+
+    // layout and lookups
+    QCOMPARE(tree.rowCount(KateProjectTree::Root), 1);
+    QCOMPARE(tree.rowCount(project), 2);
+    QCOMPARE(tree.child(project, 1), readme);
+    QCOMPARE(tree.child(src, 1), c);
+    QCOMPARE(tree.parent(c), src);
+    QCOMPARE(tree.row(c), 1);
+    QCOMPARE(tree.filePath(a), QStringLiteral("/p/src/a.cpp"));
+    QCOMPARE(tree.file(QStringLiteral("/p/src/c.cpp")), c);
+    QCOMPARE(tree.file(QStringLiteral("/p/src/b.cpp")), -1);
+    QCOMPARE(tree.directory(QStringLiteral("/p/src")), src);
+    QCOMPARE(tree.filesInDirectory(QStringLiteral("/p"), false), QVector<int>({readme}));
+    QCOMPARE(tree.filesInDirectory(QStringLiteral("/p"), true).size(), 3);
+
+    // sorted insertion keeps the following ranges intact
+    const int row = tree.sortedRow(src, QStringLiteral("B.cpp"));
+    QCOMPARE(row, 1);
+    const int b = tree.insert(src, row, KateProjectTree::File, QStringLiteral("B.cpp"), QStringLiteral("/p/src"));
+    QCOMPARE(tree.rowCount(src), 3);
+    QCOMPARE(tree.child(src, 1), b);
+    QCOMPARE(tree.row(c), 2);
+    QCOMPARE(tree.child(project, 0), src);
+    QCOMPARE(tree.child(project, 1), readme);
+
+    // untracked documents are no project files
+    const int untracked = tree.insert(project, 2, KateProjectTree::File, QStringLiteral("x.txt"), QStringLiteral("/q"), true);
+    QCOMPARE(tree.file(QStringLiteral("/q/x.txt")), untracked);
+    QVERIFY(tree.isUntracked(untracked));
+    QCOMPARE(tree.files().size(), 4);
+    QVERIFY(!tree.fileDirectories().contains(QStringLiteral("/q")));
+
+    // removal
+    tree.remove(a);
+    QCOMPARE(tree.rowCount(src), 2);
+    QCOMPARE(tree.child(src, 0), b);
+    QCOMPARE(tree.row(c), 1);
+    QCOMPARE(tree.child(project, 1), readme);
+    QCOMPARE(tree.file(QStringLiteral("/p/src/a.cpp")), -1);
+    QCOMPARE(tree.files().size(), 3);
+}
+
+void Test1::testProjectTreeEmptyProjects()
+{
+    // the range of an empty project starts where the one of the next project does
+    KateProjectTree tree;
+    const int project = tree.append(KateProjectTree::Root, KateProjectTree::Project, QStringLiteral("project"));
+    const int empty = tree.append(project, KateProjectTree::Project, QStringLiteral("empty"));
+    const int sub = tree.append(project, KateProjectTree::Project, QStringLiteral("sub"));
+    const int b = tree.append(sub, KateProjectTree::File, QStringLiteral("b.cpp"), QStringLiteral("/s"));
+    const int last = tree.append(project, KateProjectTree::Project, QStringLiteral("last"));
+    tree.finish();
+
+    const int a = tree.insert(sub, 0, KateProjectTree::File, QStringLiteral("a.cpp"), QStringLiteral("/s"));
+    QCOMPARE(tree.rowCount(empty), 0);
+    QCOMPARE(tree.rowCount(sub), 2);
+    QCOMPARE(tree.child(sub, 0), a);
+    QCOMPARE(tree.child(sub, 1), b);
+
+    const int e = tree.insert(empty, 0, KateProjectTree::File, QStringLiteral("e.cpp"), QStringLiteral("/e"));
+    QCOMPARE(tree.rowCount(empty), 1);
+    QCOMPARE(tree.child(empty, 0), e);
+    QCOMPARE(tree.row(e), 0);
+    QCOMPARE(tree.rowCount(sub), 2);
+    QCOMPARE(tree.child(sub, 0), a);
+    QCOMPARE(tree.child(sub, 1), b);
+    QCOMPARE(tree.row(b), 1);
+
+    // appending leaves the other projects alone
+    const int c = tree.insert(sub, 2, KateProjectTree::File, QStringLiteral("c.cpp"), QStringLiteral("/s"));
+    const int l = tree.insert(last, 0, KateProjectTree::File, QStringLiteral("l.cpp"), QStringLiteral("/l"));
+    QCOMPARE(tree.rowCount(sub), 3);
+    QCOMPARE(tree.child(sub, 2), c);
+    QCOMPARE(tree.rowCount(last), 1);
+    QCOMPARE(tree.child(last, 0), l);
+    QCOMPARE(tree.child(project, 2), last);
+
+    // emptied again, the project keeps its place
+    tree.remove(e);
+    QCOMPARE(tree.rowCount(empty), 0);
+    const int f = tree.insert(sub, 0, KateProjectTree::File, QStringLiteral("0.cpp"), QStringLiteral("/s"));
+    const int g = tree.insert(empty, 0, KateProjectTree::File, QStringLiteral("g.cpp"), QStringLiteral("/e"));
+    QCOMPARE(tree.child(empty, 0), g);
+    QCOMPARE(tree.rowCount(sub), 4);
+    QCOMPARE(tree.child(sub, 0), f);
+    QCOMPARE(tree.child(sub, 3), c);
+    QCOMPARE(tree.child(last, 0), l);
+
+    // removing a child moves up the rows of the siblings behind it
+    tree.remove(a);
+    QCOMPARE(tree.rowCount(sub), 3);
+    QCOMPARE(tree.row(f), 0);
+    QCOMPARE(tree.row(b), 1);
+    QCOMPARE(tree.row(c), 2);
+    QCOMPARE(tree.child(sub, 1), b);
+
+    // the files are sorted, whatever the order of the changes was
+    QCOMPARE(tree.files(), QStringList({QStringLiteral("/e/g.cpp"), QStringLiteral("/l/l.cpp"), QStringLiteral("/s/0.cpp"), QStringLiteral("/s/b.cpp"), QStringLiteral("/s/c.cpp")}));
+}
+
+void Test1::testCTagsDatabase()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString tagsFile = dir.filePath(QStringLiteral("tags"));
+
+    // unsorted, with pseudo tags, CRLF and both kinds of addresses
+    writeFile(tagsFile,
+              "!_TAG_FILE_FORMAT\t2\t/extended format/\n"
+              "fooBar\tb.cpp\t/^int fooBar;$/;\"\tv\tline:7\n"
+              "Foo\ta.h\t/^class Foo$/;\"\tkind:class\tfile:\r\n"
+              "foo\ta.cpp\t12;\"\tf\n"
+              "foo\tb.cpp\t?^void foo()\\?$?;\"\tf\tline:3\n"
+              "zzz\tc.cpp\t1\n");
+
+    auto database = CTagsDatabase::open(tagsFile);
+    QVERIFY(database->isValid());
+    QCOMPARE(database->size(), 5);
+
+    QCOMPARE(database->count("foo"), 2);
+    QCOMPARE(database->count("foo", CTagsDatabase::PartialMatch), 3);
+    QCOMPARE(database->count("FOO", CTagsDatabase::IgnoreCase), 3);
+    QCOMPARE(database->count("fo", CTagsDatabase::PartialMatch | CTagsDatabase::IgnoreCase), 4);
+    QCOMPARE(database->count("fooBarBaz", CTagsDatabase::PartialMatch), 0);
+    QCOMPARE(database->count(QByteArray()), 0);
+
+    // entries keep the file order for equal names
+    auto entries = database->find("foo");
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries[0].file, QByteArray("a.cpp"));
+    QCOMPARE(entries[0].pattern, QByteArray("12"));
+    QCOMPARE(entries[0].line, 12);
+    QCOMPARE(entries[0].kind, QByteArray("f"));
+    QCOMPARE(entries[1].pattern, QByteArray("?^void foo()\\?$?"));
+    QCOMPARE(entries[1].line, 3);
+
+    entries = database->find("Foo");
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries[0].pattern, QByteArray("/^class Foo$/"));
+    QCOMPARE(entries[0].kind, QByteArray("class"));
+
+    entries = database->find("zzz");
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries[0].line, 1);
+    QVERIFY(entries[0].kind.isEmpty());
+
+    // fuzzy, one entry per name, contiguous matches first
+    entries = database->findFuzzy("fb", 10);
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries[0].name, QByteArray("fooBar"));
+    entries = database->findFuzzy("oo", 10);
+    QCOMPARE(entries.size(), 3);
+    QCOMPARE(entries[0].name.toLower(), QByteArray("foo"));
+
+    // shared while unchanged, reloaded after the file was replaced
+    QCOMPARE(CTagsDatabase::open(tagsFile), database);
+    QVERIFY(QFile::remove(tagsFile));
+    writeFile(tagsFile, "bar\tbar.cpp\t1\n");
+    QVERIFY(!database->isUpToDate());
+    QCOMPARE(database->count("foo"), 2);
+    auto reloaded = CTagsDatabase::open(tagsFile);
+    QVERIFY(reloaded != database);
+    QCOMPARE(reloaded->count("foo"), 0);
+    QCOMPARE(reloaded->count("bar"), 1);
+}
+
+void Test1::benchmarkCTagsLookup_data()
+{
+    QTest::addColumn<bool>("readtags");
+    QTest::newRow("readtags") << true;
+    QTest::newRow("database") << false;
+}
+
+void Test1::benchmarkCTagsLookup()
+{
+    QFETCH(bool, readtags);
+
+    static QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString tagsFile = dir.filePath(QStringLiteral("tags"));
+    if (!QFile::exists(tagsFile)) {
+        QByteArray content("!_TAG_FILE_FORMAT\t2\t/extended format/\n!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n");
+        for (int i = 0; i < 50000; ++i) {
+            content += QStringLiteral("name%1\tfile%2.cpp\t/^void name%1()$/;\"\tf\tline:%3\n").arg(i, 6, 10, QLatin1Char('0')).arg(i % 500).arg(i % 1000).toLatin1();
+        }
+        writeFile(tagsFile, content);
+    }
+
+    // one lookup per context menu popup, readtags opens, reads the header and closes the file each time
+    QVector<QByteArray> names;
+    for (int i = 0; i < 1000; ++i) {
+        names.append(QStringLiteral("name%1").arg(i * 50, 6, 10, QLatin1Char('0')).toLatin1());
+    }
+
+    // the database is kept between the lookups, open() only checks if the file changed
+    QSharedPointer<CTagsDatabase> database;
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (const QByteArray &name : qAsConst(names)) {
+            if (readtags) {
+                tagFileInfo info;
+                tagFile *file = tagsOpen(tagsFile.toLocal8Bit().constData(), &info);
+                tagEntry entry;
+                found += (tagsFind(file, &entry, name.constData(), TAG_FULLMATCH | TAG_OBSERVECASE) == TagSuccess);
+                tagsClose(file);
+            } else {
+                database = CTagsDatabase::open(tagsFile);
+                found += database->count(name) > 0;
+            }
+        }
+    }
+    QCOMPARE(found, names.size());
+}
+
+void Test1::testCTagsGenerator()
+{
+    const QString ctags = QStandardPaths::findExecutable(QStringLiteral("ctags"));
+    if (ctags.isEmpty()) {
+        QSKIP("ctags not found");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString a = dir.filePath(QStringLiteral("a.c"));
+    const QString b = dir.filePath(QStringLiteral("b.c"));
+    const QString tagsFile = dir.filePath(QStringLiteral("tags"));
+    writeFile(a, "int alpha(void) { return 0; }\n");
+    writeFile(b, "int beta(void) { return 1; }\n");
+
+    CTagsGenerator generator(tagsFile, ctags, QStringList());
+    QVERIFY(generator.update({a, b}));
+    QVERIFY(generator.changed());
+    QVERIFY(generator.hasState());
+    auto database = CTagsDatabase::open(tagsFile);
+    QCOMPARE(database->count("alpha"), 1);
+    QCOMPARE(database->count("beta"), 1);
+
+    // nothing changed, ctags doesn't run
+    QVERIFY(generator.update({a, b}));
+    QVERIFY(!generator.changed());
+
+    // a saved file gets new tags, the others are kept
+    writeFile(a, "int gammaDelta(void) { return 2; }\n");
+    QVERIFY(generator.updateFiles({a}));
+    QVERIFY(generator.changed());
+    database = CTagsDatabase::open(tagsFile);
+    QCOMPARE(database->count("alpha"), 0);
+    QCOMPARE(database->count("gammaDelta"), 1);
+    QCOMPARE(database->count("beta"), 1);
+
+    // removed files lose their tags
+    QVERIFY(QFile::remove(b));
+    QVERIFY(generator.update({a}));
+    database = CTagsDatabase::open(tagsFile);
+    QCOMPARE(database->count("beta"), 0);
+    QCOMPARE(database->count("gammaDelta"), 1);
+
+    // other options give other tags, the state is not used then
+    CTagsGenerator other(tagsFile, ctags, {QStringLiteral("--fields=+K+n")});
+    QVERIFY(!other.hasState());
+    QVERIFY(!other.updateFiles({a}));
+    QVERIFY(other.update({a}));
+    QVERIFY(other.changed());
+    QVERIFY(other.hasState());
+}
+
 // kate: space-indent on; indent-width 4; replace-tabs on;
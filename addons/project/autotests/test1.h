@@ -34,6 +34,13 @@ public Q_SLOTS:
 private Q_SLOTS:
     void testCommonParent();
     void testShellCheckParsing();
+    void testTrigramIndex();
+    void testProjectTree();
+    void testProjectTreeEmptyProjects();
+    void testCTagsDatabase();
+    void benchmarkCTagsLookup_data();
+    void benchmarkCTagsLookup();
+    void testCTagsGenerator();
 };
 
 #endif
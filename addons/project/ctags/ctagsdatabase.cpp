@@ -0,0 +1,375 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "ctagsdatabase.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWeakPointer>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+/**
+ * fold like readtags does for TAG_IGNORECASE, ASCII only
+ */
+static inline uchar foldChar(char c)
+{
+    const uchar u = static_cast<uchar>(c);
+    return (u >= 'a' && u <= 'z') ? u - ('a' - 'A') : u;
+}
+
+/**
+ * compare the first @p length bytes, optionally case folded
+ */
+static inline int compareBytes(const char *a, const char *b, int length, bool fold)
+{
+    if (!fold) {
+        return memcmp(a, b, length);
+    }
+    for (int i = 0; i < length; ++i) {
+        const int diff = int(foldChar(a[i])) - int(foldChar(b[i]));
+        if (diff) {
+            return diff;
+        }
+    }
+    return 0;
+}
+
+/**
+ * compare a name with a searched name
+ * for prefix matches all names starting with the searched one compare equal
+ */
+static inline int compareName(const char *name, int nameLength, const QByteArray &key, bool prefix, bool fold)
+{
+    const int diff = compareBytes(name, key.constData(), qMin(nameLength, key.size()), fold);
+    if (diff) {
+        return diff;
+    }
+    if (prefix && nameLength >= key.size()) {
+        return 0;
+    }
+    return nameLength - key.size();
+}
+
+CTagsDatabase::CTagsDatabase(const QString &fileName)
+    : m_fileName(fileName)
+    , m_file(fileName)
+{
+    m_lastModified = QFileInfo(fileName).lastModified().toMSecsSinceEpoch();
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    /**
+     * map the file, read it if that is not possible
+     * empty files can't be mapped but are still valid
+     */
+    const qint64 size = m_size = m_file.size();
+    if (size > 0) {
+        m_data = reinterpret_cast<const char *>(m_file.map(0, size));
+    }
+    if (!m_data) {
+        m_buffer = m_file.readAll();
+        m_data = m_buffer.constData();
+    }
+
+    /**
+     * collect the tag lines, pseudo tags start with "!_"
+     */
+    const char *data = m_data;
+    const char *end = m_data + size;
+    bool sorted = true;
+    for (const char *line = data; line < end;) {
+        const char *eol = static_cast<const char *>(memchr(line, '\n', end - line));
+        if (!eol) {
+            eol = end;
+        }
+
+        if (eol > line && !(eol - line >= 2 && line[0] == '!' && line[1] == '_')) {
+            const char *tab = static_cast<const char *>(memchr(line, '\t', eol - line));
+            int nameLength = int((tab ? tab : eol) - line);
+            if (!tab && line[nameLength - 1] == '\r') {
+                --nameLength;
+            }
+
+            const Tag tag = {line - data, nameLength};
+            if (sorted && !m_tags.isEmpty()) {
+                const Tag &last = m_tags.last();
+                sorted = compareName(name(last), last.nameLength, QByteArray::fromRawData(name(tag), nameLength), false, false) <= 0;
+            }
+            m_tags.append(tag);
+        }
+
+        line = eol + 1;
+    }
+
+    /**
+     * ctags sorts by default, don't rely on it
+     */
+    if (!sorted) {
+        std::stable_sort(m_tags.begin(), m_tags.end(), [this](const Tag &a, const Tag &b) {
+            return compareName(name(a), a.nameLength, QByteArray::fromRawData(name(b), b.nameLength), false, false) < 0;
+        });
+    }
+
+    m_folded.resize(m_tags.size());
+    std::iota(m_folded.begin(), m_folded.end(), 0);
+    std::stable_sort(m_folded.begin(), m_folded.end(), [this](int a, int b) {
+        const Tag &tagA = m_tags[a];
+        const Tag &tagB = m_tags[b];
+        return compareName(name(tagA), tagA.nameLength, QByteArray::fromRawData(name(tagB), tagB.nameLength), false, true) < 0;
+    });
+}
+
+QSharedPointer<CTagsDatabase> CTagsDatabase::open(const QString &fileName)
+{
+    static QMutex mutex;
+    static QHash<QString, QWeakPointer<CTagsDatabase>> databases;
+
+    QMutexLocker locker(&mutex);
+    QSharedPointer<CTagsDatabase> database = databases.value(fileName).toStrongRef();
+    if (!database || !database->isUpToDate()) {
+        database.reset(new CTagsDatabase(fileName));
+        databases.insert(fileName, database);
+    }
+
+    /**
+     * drop the entries of databases nobody uses anymore
+     */
+    for (auto it = databases.begin(); it != databases.end();) {
+        if (it.value().isNull()) {
+            it = databases.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return database;
+}
+
+bool CTagsDatabase::isUpToDate() const
+{
+    const QFileInfo info(m_fileName);
+    return info.exists() && info.size() == m_size && info.lastModified().toMSecsSinceEpoch() == m_lastModified;
+}
+
+QPair<int, int> CTagsDatabase::range(const QByteArray &key, MatchFlags flags) const
+{
+    const bool prefix = flags & PartialMatch;
+    const bool fold = flags & IgnoreCase;
+    auto compare = [this, &key, prefix, fold](int position) {
+        const Tag &tag = fold ? m_tags[m_folded[position]] : m_tags[position];
+        return compareName(name(tag), tag.nameLength, key, prefix, fold);
+    };
+
+    /**
+     * binary search for the first and the last matching position
+     */
+    int first = 0;
+    int count = m_tags.size();
+    while (count > 0) {
+        const int step = count / 2;
+        if (compare(first + step) < 0) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    int last = first;
+    count = m_tags.size() - first;
+    while (count > 0) {
+        const int step = count / 2;
+        if (compare(last + step) <= 0) {
+            last += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    return qMakePair(first, last);
+}
+
+int CTagsDatabase::count(const QByteArray &name, MatchFlags flags) const
+{
+    if (name.isEmpty()) {
+        return 0;
+    }
+
+    const auto matches = range(name, flags);
+    return matches.second - matches.first;
+}
+
+QVector<CTagsDatabase::Entry> CTagsDatabase::find(const QByteArray &name, MatchFlags flags) const
+{
+    QVector<Entry> entries;
+    if (name.isEmpty()) {
+        return entries;
+    }
+
+    const auto matches = range(name, flags);
+    entries.reserve(matches.second - matches.first);
+    for (int position = matches.first; position < matches.second; ++position) {
+        entries.append(entry((flags & IgnoreCase) ? m_tags[m_folded[position]] : m_tags[position]));
+    }
+    return entries;
+}
+
+QVector<CTagsDatabase::Entry> CTagsDatabase::findFuzzy(const QByteArray &pattern, int maxResults) const
+{
+    QVector<Entry> entries;
+    if (pattern.isEmpty() || maxResults <= 0) {
+        return entries;
+    }
+
+    /**
+     * score each distinct name, lower is better: gaps between the matched characters
+     * count twice, not matching at the start once, then shorter names win
+     */
+    struct Hit {
+        int score;
+        int nameLength;
+        int tag;
+    };
+    QVector<Hit> hits;
+    for (int i = 0; i < m_tags.size(); ++i) {
+        const Tag &tag = m_tags[i];
+        const char *tagName = name(tag);
+        if (i > 0 && m_tags[i - 1].nameLength == tag.nameLength && memcmp(name(m_tags[i - 1]), tagName, tag.nameLength) == 0) {
+            continue;
+        }
+
+        int score = 0;
+        int matched = 0;
+        int previous = -1;
+        for (int j = 0; j < tag.nameLength && matched < pattern.size(); ++j) {
+            if (foldChar(tagName[j]) == foldChar(pattern[matched])) {
+                if (previous < 0) {
+                    score += (j > 0) ? 1 : 0;
+                } else if (j != previous + 1) {
+                    score += 2;
+                }
+                previous = j;
+                ++matched;
+            }
+        }
+
+        if (matched == pattern.size()) {
+            hits.append({score, tag.nameLength, i});
+        }
+    }
+
+    const int resultCount = qMin(maxResults, hits.size());
+    std::partial_sort(hits.begin(), hits.begin() + resultCount, hits.end(), [](const Hit &a, const Hit &b) {
+        return a.score != b.score ? a.score < b.score : (a.nameLength != b.nameLength ? a.nameLength < b.nameLength : a.tag < b.tag);
+    });
+
+    entries.reserve(resultCount);
+    for (int i = 0; i < resultCount; ++i) {
+        entries.append(entry(m_tags[hits[i].tag]));
+    }
+    return entries;
+}
+
+CTagsDatabase::Entry CTagsDatabase::entry(const Tag &tag) const
+{
+    /**
+     * split the line like readtags does: name, file, address and extension fields
+     */
+    const char *line = m_data + tag.offset;
+    const char *end = static_cast<const char *>(memchr(line, '\n', (m_data + m_size) - line));
+    if (!end) {
+        end = m_data + m_size;
+    }
+    if (end > line && end[-1] == '\r') {
+        --end;
+    }
+
+    Entry entry;
+    entry.name = QByteArray(line, tag.nameLength);
+
+    const char *p = line + tag.nameLength;
+    if (p >= end) {
+        return entry;
+    }
+    ++p;
+    const char *tab = static_cast<const char *>(memchr(p, '\t', end - p));
+    entry.file = QByteArray(p, int((tab ? tab : end) - p));
+    if (!tab) {
+        return entry;
+    }
+
+    /**
+     * address, a pattern with the same delimiter at both ends or a line number
+     */
+    p = tab + 1;
+    const char *addressEnd = p;
+    if (p < end && (*p == '/' || *p == '?')) {
+        const char delimiter = *p;
+        const char *q = p;
+        do {
+            q = static_cast<const char *>(memchr(q + 1, delimiter, end - q - 1));
+        } while (q && q[-1] == '\\');
+        addressEnd = q ? q + 1 : end;
+    } else {
+        while (addressEnd < end && *addressEnd >= '0' && *addressEnd <= '9') {
+            ++addressEnd;
+        }
+        entry.line = QByteArray::fromRawData(p, int(addressEnd - p)).toInt();
+    }
+    entry.pattern = QByteArray(p, int(addressEnd - p));
+
+    /**
+     * extension fields, the kind is the one without a key
+     */
+    if (end - addressEnd < 2 || addressEnd[0] != ';' || addressEnd[1] != '"') {
+        return entry;
+    }
+    p = addressEnd + 2;
+    while (p < end) {
+        while (p < end && *p == '\t') {
+            ++p;
+        }
+        const char *fieldEnd = static_cast<const char *>(memchr(p, '\t', end - p));
+        if (!fieldEnd) {
+            fieldEnd = end;
+        }
+
+        const QByteArray field = QByteArray::fromRawData(p, int(fieldEnd - p));
+        const int colon = field.indexOf(':');
+        if (colon < 0) {
+            if (!field.isEmpty()) {
+                entry.kind = QByteArray(field.constData(), field.size());
+            }
+        } else if (field.startsWith("kind:")) {
+            entry.kind = QByteArray(field.constData() + colon + 1, field.size() - colon - 1);
+        } else if (field.startsWith("line:")) {
+            entry.line = QByteArray::fromRawData(field.constData() + colon + 1, field.size() - colon - 1).toInt();
+        }
+        p = fieldEnd;
+    }
+    return entry;
+}
@@ -0,0 +1,173 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CTAGS_DATABASE_H
+#define CTAGS_DATABASE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+/**
+ * Read only, in memory index of a ctags file.
+ *
+ * The file is mapped into memory once, the names of all tags are sorted into
+ * offset arrays, one case sensitive and one ASCII case folded. Lookups are
+ * binary searches for the range of matching names, entries are only parsed
+ * for the hits. Prefix lookups on the sorted names do what a prefix trie would
+ * do without extra memory per character.
+ *
+ * A database never changes after construction and can be used from several
+ * threads. Use open() to share one database per file, it is reloaded if the
+ * file changed on disk. Rewrite a tags file by replacing it with a new one,
+ * see CTagsGenerator, a mapped file must not be truncated.
+ */
+class CTagsDatabase
+{
+public:
+    /**
+     * Match flags, same values as the ones of readtags
+     */
+    enum MatchFlag { FullMatch = 0x0, PartialMatch = 0x1, IgnoreCase = 0x2 };
+    Q_DECLARE_FLAGS(MatchFlags, MatchFlag)
+
+    /**
+     * One parsed tag line.
+     */
+    struct Entry {
+        QByteArray name;
+        QByteArray file;
+
+        /**
+         * address as in the file, a search pattern with delimiters or a line number
+         */
+        QByteArray pattern;
+        QByteArray kind;
+        int line = 0;
+    };
+
+    /**
+     * Map and index @p fileName.
+     * @param fileName ctags file, sorted or not
+     */
+    explicit CTagsDatabase(const QString &fileName);
+
+    /**
+     * Get the database for @p fileName, shared with all other users of the same file.
+     * A new one is loaded if there is none yet or the file changed since.
+     * @return database, invalid if the file can't be read
+     */
+    static QSharedPointer<CTagsDatabase> open(const QString &fileName);
+
+    const QString &fileName() const
+    {
+        return m_fileName;
+    }
+
+    /**
+     * @return true if the file could be read
+     */
+    bool isValid() const
+    {
+        return m_data;
+    }
+
+    /**
+     * @return false if the file was changed or removed after loading
+     */
+    bool isUpToDate() const;
+
+    /**
+     * @return number of tags
+     */
+    int size() const
+    {
+        return m_tags.size();
+    }
+
+    /**
+     * @return number of tags matching @p name
+     */
+    int count(const QByteArray &name, MatchFlags flags = FullMatch) const;
+
+    /**
+     * @return tags matching @p name, ordered by name and then as in the file
+     */
+    QVector<Entry> find(const QByteArray &name, MatchFlags flags = FullMatch) const;
+
+    /**
+     * Find names containing the characters of @p pattern in order, ignoring case.
+     * Names with the characters close together and at the start come first.
+     * @param maxResults maximal number of names
+     * @return first tag of each matching name
+     */
+    QVector<Entry> findFuzzy(const QByteArray &pattern, int maxResults) const;
+
+private:
+    /**
+     * Offset of a tag line and length of its name
+     */
+    struct Tag {
+        qint64 offset;
+        int nameLength;
+    };
+
+    const char *name(const Tag &tag) const
+    {
+        return m_data + tag.offset;
+    }
+
+    /**
+     * @return range [first, last) of the tags matching @p name,
+     *         positions in m_folded for IgnoreCase, else in m_tags
+     */
+    QPair<int, int> range(const QByteArray &name, MatchFlags flags) const;
+
+    Entry entry(const Tag &tag) const;
+
+private:
+    QString m_fileName;
+    QFile m_file;
+    qint64 m_lastModified = 0;
+    qint64 m_size = -1;
+
+    /**
+     * mapped file content, m_buffer holds it if the file can't be mapped
+     */
+    const char *m_data = nullptr;
+    QByteArray m_buffer;
+
+    /**
+     * tags sorted by name, case sensitive
+     */
+    QVector<Tag> m_tags;
+
+    /**
+     * indices into m_tags sorted by ASCII case folded name
+     */
+    QVector<int> m_folded;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(CTagsDatabase::MatchFlags)
+
+#endif
@@ -0,0 +1,432 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "ctagsgenerator.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QProcess>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/**
+ * magic and version of the state file, bump the version on format changes
+ */
+static const quint32 StateMagic = 0x4b435447; // "KCTG"
+static const quint32 StateVersion = 1;
+
+/**
+ * files per ctags process at least, starting a process costs more than indexing a few files
+ */
+static const int MinFilesPerShard = 32;
+
+/**
+ * interval in which the running ctags processes are served in turn
+ */
+static const int PollInterval = 10;
+
+/**
+ * pseudo tags written to the head of the tags file
+ */
+static const char TagsHeader[] =
+    "!_TAG_FILE_FORMAT\t2\t/extended format; --format=1 will not append ;\" to lines/\n"
+    "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n";
+
+/**
+ * One line of a tags file, without line break
+ */
+struct TagLine {
+    const char *data;
+    int size;
+};
+
+/**
+ * byte wise order of the lines, this sorts by name first as tabs sort before all name characters
+ */
+static inline bool lessThan(const TagLine &a, const TagLine &b)
+{
+    const int diff = memcmp(a.data, b.data, qMin(a.size, b.size));
+    return diff ? diff < 0 : a.size < b.size;
+}
+
+/**
+ * Collect the tag lines of @p tags, skipping pseudo tags and the tags of @p dropped files.
+ */
+static void collectLines(const QByteArray &tags, const QSet<QByteArray> &dropped, std::vector<TagLine> &lines)
+{
+    const char *end = tags.constData() + tags.size();
+    for (const char *line = tags.constData(); line < end;) {
+        const char *eol = static_cast<const char *>(memchr(line, '\n', end - line));
+        if (!eol) {
+            eol = end;
+        }
+
+        int size = int(eol - line);
+        if (size > 0 && line[size - 1] == '\r') {
+            --size;
+        }
+
+        bool keep = size > 0 && !(size >= 2 && line[0] == '!' && line[1] == '_');
+        if (keep && !dropped.isEmpty()) {
+            // the file is the second field
+            const char *tab = static_cast<const char *>(memchr(line, '\t', size));
+            if (tab) {
+                const char *fileEnd = static_cast<const char *>(memchr(tab + 1, '\t', line + size - tab - 1));
+                if (!fileEnd) {
+                    fileEnd = line + size;
+                }
+                keep = !dropped.contains(QByteArray::fromRawData(tab + 1, int(fileEnd - tab - 1)));
+            }
+        }
+
+        if (keep) {
+            lines.push_back({line, size});
+        }
+        line = eol + 1;
+    }
+}
+
+/**
+ * Lock serializing the updates of one tags file.
+ */
+static QMutex *updateMutex(const QString &tagsFile)
+{
+    static QMutex mutex;
+    static QHash<QString, QSharedPointer<QMutex>> mutexes;
+
+    QMutexLocker locker(&mutex);
+    QSharedPointer<QMutex> &fileMutex = mutexes[tagsFile];
+    if (!fileMutex) {
+        fileMutex.reset(new QMutex());
+    }
+    return fileMutex.data();
+}
+
+QDataStream &operator<<(QDataStream &out, const CTagsGenerator::FileState &state)
+{
+    return out << state.lastModified << state.size;
+}
+
+QDataStream &operator>>(QDataStream &in, CTagsGenerator::FileState &state)
+{
+    return in >> state.lastModified >> state.size;
+}
+
+CTagsGenerator::CTagsGenerator(const QString &tagsFile, const QString &program, const QStringList &arguments)
+    : m_tagsFile(tagsFile)
+    , m_stateFile(tagsFile + QStringLiteral(".files"))
+    , m_program(program)
+    , m_arguments(arguments)
+{
+}
+
+bool CTagsGenerator::update(const QStringList &files, bool force)
+{
+    QMutexLocker locker(updateMutex(m_tagsFile));
+    m_changed = false;
+    m_errorString.clear();
+
+    /**
+     * without the state of the last run all files are indexed again
+     */
+    QHash<QString, FileState> oldState;
+    const bool keepOldTags = !force && QFileInfo::exists(m_tagsFile) && loadState(&oldState);
+
+    /**
+     * new and changed files are indexed, changed and removed ones lose their old tags
+     */
+    QHash<QString, FileState> state;
+    state.reserve(files.size());
+    QStringList changedFiles;
+    QSet<QByteArray> dropped;
+    for (const QString &file : files) {
+        const FileState fileState = CTagsGenerator::fileState(file);
+        if (fileState.size < 0 || state.contains(file)) {
+            continue;
+        }
+        state.insert(file, fileState);
+
+        const auto it = oldState.constFind(file);
+        if (it == oldState.cend()) {
+            changedFiles.append(file);
+        } else if (!(it.value() == fileState)) {
+            changedFiles.append(file);
+            dropped.insert(file.toLocal8Bit());
+        }
+    }
+    for (auto it = oldState.cbegin(); it != oldState.cend(); ++it) {
+        if (!state.contains(it.key())) {
+            dropped.insert(it.key().toLocal8Bit());
+        }
+    }
+
+    if (keepOldTags && changedFiles.isEmpty() && dropped.isEmpty()) {
+        return true;
+    }
+
+    if (!regenerate(changedFiles, dropped, keepOldTags)) {
+        return false;
+    }
+    saveState(state);
+    return true;
+}
+
+bool CTagsGenerator::updateFiles(const QStringList &files)
+{
+    QMutexLocker locker(updateMutex(m_tagsFile));
+    m_changed = false;
+    m_errorString.clear();
+
+    QHash<QString, FileState> state;
+    if (!QFileInfo::exists(m_tagsFile) || !loadState(&state)) {
+        return false;
+    }
+
+    QStringList changedFiles;
+    QSet<QByteArray> dropped;
+    for (const QString &file : files) {
+        const FileState fileState = CTagsGenerator::fileState(file);
+        const auto it = state.find(file);
+        if (fileState.size < 0) {
+            if (it != state.end()) {
+                state.erase(it);
+                dropped.insert(file.toLocal8Bit());
+            }
+            continue;
+        }
+
+        if (it != state.end()) {
+            if (it.value() == fileState) {
+                continue;
+            }
+            dropped.insert(file.toLocal8Bit());
+        }
+        state.insert(file, fileState);
+        changedFiles.append(file);
+    }
+
+    if (changedFiles.isEmpty() && dropped.isEmpty()) {
+        return true;
+    }
+
+    if (!regenerate(changedFiles, dropped, true)) {
+        return false;
+    }
+    saveState(state);
+    return true;
+}
+
+bool CTagsGenerator::hasState() const
+{
+    return QFileInfo::exists(m_tagsFile) && loadState(nullptr);
+}
+
+void CTagsGenerator::remove()
+{
+    QMutexLocker locker(updateMutex(m_tagsFile));
+    QFile::remove(m_tagsFile);
+    QFile::remove(m_stateFile);
+}
+
+CTagsGenerator::FileState CTagsGenerator::fileState(const QString &file)
+{
+    FileState state;
+    const QFileInfo info(file);
+    if (info.isFile()) {
+        state.lastModified = info.lastModified().toMSecsSinceEpoch();
+        state.size = info.size();
+    }
+    return state;
+}
+
+bool CTagsGenerator::loadState(QHash<QString, FileState> *state) const
+{
+    QFile file(m_stateFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (magic != StateMagic || version != StateVersion) {
+        return false;
+    }
+
+    /**
+     * other ctags options give other tags, the state is useless then
+     */
+    in.setVersion(QDataStream::Qt_5_0);
+    QString program;
+    QStringList arguments;
+    in >> program >> arguments;
+    if (in.status() != QDataStream::Ok || program != m_program || arguments != m_arguments) {
+        return false;
+    }
+
+    if (state) {
+        in >> *state;
+        if (in.status() != QDataStream::Ok) {
+            state->clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void CTagsGenerator::saveState(const QHash<QString, FileState> &state) const
+{
+    QSaveFile file(m_stateFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << StateMagic << StateVersion;
+    out.setVersion(QDataStream::Qt_5_0);
+    out << m_program << m_arguments << state;
+    file.commit();
+}
+
+bool CTagsGenerator::regenerate(const QStringList &files, const QSet<QByteArray> &dropped, bool keepOldTags)
+{
+    QVector<QByteArray> outputs;
+    if (!files.isEmpty() && !runCTags(files, outputs)) {
+        return false;
+    }
+
+    /**
+     * the old tags are sorted already, only the new ones need sorting before both are merged
+     */
+    QByteArray oldTags;
+    if (keepOldTags) {
+        QFile file(m_tagsFile);
+        if (file.open(QIODevice::ReadOnly)) {
+            oldTags = file.readAll();
+        }
+    }
+    std::vector<TagLine> oldLines;
+    collectLines(oldTags, dropped, oldLines);
+    if (!std::is_sorted(oldLines.begin(), oldLines.end(), lessThan)) {
+        std::stable_sort(oldLines.begin(), oldLines.end(), lessThan);
+    }
+
+    std::vector<TagLine> newLines;
+    for (const QByteArray &output : qAsConst(outputs)) {
+        collectLines(output, QSet<QByteArray>(), newLines);
+    }
+    std::stable_sort(newLines.begin(), newLines.end(), lessThan);
+
+    std::vector<TagLine> lines;
+    lines.reserve(oldLines.size() + newLines.size());
+    std::merge(oldLines.begin(), oldLines.end(), newLines.begin(), newLines.end(), std::back_inserter(lines), lessThan);
+
+    /**
+     * write a new file and move it over the old one
+     */
+    QSaveFile file(m_tagsFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+
+    QByteArray buffer(TagsHeader);
+    for (const TagLine &line : lines) {
+        buffer.append(line.data, line.size);
+        buffer.append('\n');
+        if (buffer.size() >= 1024 * 1024) {
+            file.write(buffer);
+            buffer.clear();
+        }
+    }
+    file.write(buffer);
+
+    if (!file.commit()) {
+        m_errorString = file.errorString();
+        return false;
+    }
+
+    m_changed = true;
+    return true;
+}
+
+bool CTagsGenerator::runCTags(const QStringList &files, QVector<QByteArray> &outputs)
+{
+    /**
+     * one process per core at most, files of the same directory stay together
+     */
+    const int shards = qBound(1, files.size() / MinFilesPerShard, qMax(1, QThread::idealThreadCount()));
+    std::vector<std::unique_ptr<QProcess>> processes;
+    for (int i = 0; i < shards; ++i) {
+        const int begin = files.size() * i / shards;
+        const int end = files.size() * (i + 1) / shards;
+
+        std::unique_ptr<QProcess> process(new QProcess());
+        QStringList args;
+        args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << QStringLiteral("-") << QStringLiteral("--sort=no") << m_arguments;
+        process->start(m_program, args);
+        if (!process->waitForStarted()) {
+            m_errorString = process->errorString();
+            return false;
+        }
+
+        process->write(files.mid(begin, end - begin).join(QLatin1Char('\n')).toLocal8Bit());
+        process->closeWriteChannel();
+        processes.push_back(std::move(process));
+    }
+
+    /**
+     * no event loop in here, serve the pipes of all processes in turn
+     * waiting for one only would block the others once their pipes are full
+     */
+    bool running = true;
+    while (running) {
+        running = false;
+        for (const auto &process : processes) {
+            if (process->state() != QProcess::NotRunning) {
+                process->waitForFinished(PollInterval);
+                running = running || process->state() != QProcess::NotRunning;
+            }
+        }
+    }
+
+    for (const auto &process : processes) {
+        if (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0) {
+            m_errorString = QString::fromLocal8Bit(process->readAllStandardError());
+            if (m_errorString.isEmpty()) {
+                m_errorString = process->errorString();
+            }
+            return false;
+        }
+        outputs.append(process->readAllStandardOutput());
+    }
+    return true;
+}
@@ -0,0 +1,143 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CTAGS_GENERATOR_H
+#define CTAGS_GENERATOR_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QDataStream;
+
+/**
+ * Incremental generation of a sorted ctags file.
+ *
+ * Size and modification time of every indexed file are kept in a state file
+ * next to the tags file. An update only runs ctags on new and changed files,
+ * split over several ctags processes running in parallel, and merges their
+ * output with the still valid lines of the existing tags file.
+ *
+ * The tags file is replaced atomically, databases mapping the old one stay valid.
+ * All calls block until ctags is done, use it from a worker thread.
+ * Updates of the same tags file are serialized.
+ */
+class CTagsGenerator
+{
+public:
+    /**
+     * @param tagsFile tags file to generate
+     * @param program ctags executable
+     * @param arguments extra ctags arguments, without the ones for input and output files
+     */
+    CTagsGenerator(const QString &tagsFile, const QString &program, const QStringList &arguments);
+
+    /**
+     * Bring the tags file up to date for exactly @p files.
+     * Tags of files not in the list anymore are dropped.
+     * @param force ignore the state and run ctags on all files
+     * @return false if ctags could not be run, the tags file is unchanged then
+     */
+    bool update(const QStringList &files, bool force = false);
+
+    /**
+     * Refresh the tags of @p files only, tags of all other files are kept.
+     * Files that are gone lose their tags. Does nothing without a state from an earlier update().
+     * @return false if there is no state or ctags could not be run
+     */
+    bool updateFiles(const QStringList &files);
+
+    /**
+     * @return true if the tags file got rewritten by the last update
+     */
+    bool changed() const
+    {
+        return m_changed;
+    }
+
+    /**
+     * @return true if there is a state from an earlier update() for the tags file
+     */
+    bool hasState() const;
+
+    /**
+     * Remove the tags file and the state, waits for a running update of the same tags file.
+     */
+    void remove();
+
+    /**
+     * @return error output of the last failed update
+     */
+    const QString &errorString() const
+    {
+        return m_errorString;
+    }
+
+private:
+    /**
+     * Per file data, used to detect changes on disk.
+     */
+    struct FileState {
+        qint64 lastModified = 0;
+        qint64 size = -1;
+
+        bool operator==(const FileState &other) const
+        {
+            return lastModified == other.lastModified && size == other.size;
+        }
+    };
+
+    static FileState fileState(const QString &file);
+
+    /**
+     * Load the state, it is only valid if it was written for the same ctags call.
+     * @param state loaded state, only the header is checked if nullptr
+     */
+    bool loadState(QHash<QString, FileState> *state) const;
+    void saveState(const QHash<QString, FileState> &state) const;
+
+    /**
+     * Run ctags on @p files and replace the tags of @p dropped files with the output.
+     * @param keepOldTags merge with the existing tags file, otherwise start from scratch
+     */
+    bool regenerate(const QStringList &files, const QSet<QByteArray> &dropped, bool keepOldTags);
+
+    /**
+     * Run ctags on @p files, split over several processes.
+     * @param outputs output of each process
+     */
+    bool runCTags(const QStringList &files, QVector<QByteArray> &outputs);
+
+    friend QDataStream &operator<<(QDataStream &out, const FileState &state);
+    friend QDataStream &operator>>(QDataStream &in, FileState &state);
+
+private:
+    const QString m_tagsFile;
+    const QString m_stateFile;
+    const QString m_program;
+    const QStringList m_arguments;
+
+    bool m_changed = false;
+    QString m_errorString;
+};
+
+#endif
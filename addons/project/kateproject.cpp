@@ -19,7 +19,9 @@
  */
 
 #include "kateproject.h"
+#include "kateprojectindexupdateworker.h"
 #include "kateprojectplugin.h"
+#include "kateprojectupdateworker.h"
 #include "kateprojectworker.h"
 
 #include <klocalizedstring.h>
@@ -27,30 +29,58 @@
 #include <ktexteditor/document.h>
 
 #include <ThreadWeaver/Queue>
+#include <ThreadWeaver/Sequence>
 
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QPlainTextDocumentLayout>
+#include <QStandardPaths>
+
+#include <algorithm>
 #include <utility>
 
+/**
+ * delay between the last change inside a watched directory and the update of the model
+ */
+static const int UpdateDelay = 500;
+
+/**
+ * delay between saving a file and refreshing its tags, batches saving all documents
+ */
+static const int IndexUpdateDelay = 100;
+
 KateProject::KateProject(ThreadWeaver::Queue *weaver, KateProjectPlugin *plugin)
     : QObject()
     , m_fileLastModified()
     , m_notesDocument(nullptr)
-    , m_untrackedDocumentsRoot(nullptr)
     , m_weaver(weaver)
     , m_plugin(plugin)
 {
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UpdateDelay);
+    connect(&m_updateTimer, &QTimer::timeout, this, &KateProject::startUpdate);
+    m_indexUpdateTimer.setSingleShot(true);
+    m_indexUpdateTimer.setInterval(IndexUpdateDelay);
+    connect(&m_indexUpdateTimer, &QTimer::timeout, this, &KateProject::startIndexUpdate);
+    connect(m_plugin, &KateProjectPlugin::configUpdated, this, &KateProject::slotConfigUpdated);
 }
 
 KateProject::~KateProject()
 {
     saveNotesDocument();
+
+    /**
+     * the default ctags index is only kept while the project is open
+     */
+    if (m_projectIndex) {
+        m_projectIndex->removeIndexFile();
+    }
 }
 
 bool KateProject::loadFromFile(const QString &fileName)
@@ -180,31 +210,42 @@ bool KateProject::load(const QVariantMap &globalProject, bool force)
     QString indexDir;
     if (m_plugin->getIndexEnabled()) {
         indexDir = m_plugin->getIndexDirectory().toLocalFile();
-        // if empty, use regular tempdir
+        // if empty, use our directory in the cache location, unlike the temp dir nobody else can place files there
         if (indexDir.isEmpty()) {
-            indexDir = QDir::tempPath();
+            indexDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/kateproject");
+            QDir().mkpath(indexDir);
         }
     }
     auto w = new KateProjectWorker(m_baseDir, indexDir, m_projectMap, force);
     connect(w, &KateProjectWorker::loadDone, this, &KateProject::loadProjectDone);
     connect(w, &KateProjectWorker::loadIndexDone, this, &KateProject::loadIndexDone);
-    m_weaver->stream() << w;
+    connect(w, &KateProjectWorker::loadTrigramIndexDone, this, &KateProject::loadTrigramIndexDone);
+
+    // enumerate the files of all files entries concurrently, the worker builds the model afterwards
+    auto sequence = new ThreadWeaver::Sequence();
+    *sequence << w->createEnumerationJob() << w;
+    m_weaver->stream() << sequence;
 
     // we are done here
     return true;
 }
 
-void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item)
+void KateProject::loadProjectDone(const KateProjectSharedTree &tree, KateProjectSharedFilesEntries filesEntries)
 {
-    m_model.clear();
-    m_model.invisibleRootItem()->appendColumn(topLevel->takeColumn(0));
+    m_model.setTree(std::move(*tree));
+    m_filesEntries = std::move(filesEntries);
 
-    m_file2Item = std::move(file2Item);
+    /**
+     * watch the directories of the new files for incremental updates
+     */
+    stopWatching();
+    if (m_plugin->watchDirectories()) {
+        startWatching();
+    }
 
     /**
      * readd the documents that are open atm
      */
-    m_untrackedDocumentsRoot = nullptr;
     for (auto i = m_documents.constBegin(); i != m_documents.constEnd(); i++) {
         registerDocument(i.key());
     }
@@ -225,6 +266,81 @@ void KateProject::loadIndexDone(KateProjectSharedProjectIndex projectIndex)
     emit indexChanged();
 }
 
+void KateProject::slotDocumentSaved(KTextEditor::Document *document)
+{
+    /**
+     * only files of the project are in the index
+     */
+    const QString file = document->url().toLocalFile();
+    const int node = m_model.tree().file(file);
+    if (node >= 0 && !m_model.tree().isUntracked(node)) {
+        updateIndex(QStringList(file));
+    }
+}
+
+void KateProject::updateIndex(const QStringList &files)
+{
+    if (!m_projectIndex) {
+        return;
+    }
+
+    for (const QString &file : files) {
+        m_dirtyIndexFiles.insert(file);
+    }
+
+    /**
+     * don't restart the timer, the tags of a saved file should be there soon
+     */
+    if (!m_indexUpdateTimer.isActive()) {
+        m_indexUpdateTimer.start();
+    }
+}
+
+void KateProject::startIndexUpdate()
+{
+    /**
+     * only one update at a time, the next one starts once it is done
+     */
+    if (m_indexUpdateRunning || m_dirtyIndexFiles.isEmpty() || !m_projectIndex) {
+        return;
+    }
+
+    m_indexUpdateRunning = true;
+    auto w = new KateProjectIndexUpdateWorker(m_projectIndex, m_dirtyIndexFiles.values());
+    m_dirtyIndexFiles.clear();
+    connect(w, &KateProjectIndexUpdateWorker::updateIndexDone, this, &KateProject::updateIndexDone);
+    m_weaver->stream() << w;
+}
+
+void KateProject::updateIndexDone(KateProjectSharedProjectIndex sourceIndex, KateProjectSharedProjectIndex projectIndex, QStringList files)
+{
+    m_indexUpdateRunning = false;
+
+    /**
+     * a reload might have replaced or disabled the index meanwhile, the result is outdated then
+     * the files are refreshed once more in the new index
+     */
+    if (m_projectIndex == sourceIndex) {
+        loadIndexDone(std::move(projectIndex));
+    } else if (m_projectIndex) {
+        for (const QString &file : qAsConst(files)) {
+            m_dirtyIndexFiles.insert(file);
+        }
+    }
+
+    /**
+     * files saved during the update
+     */
+    if (!m_dirtyIndexFiles.isEmpty() && !m_indexUpdateTimer.isActive()) {
+        m_indexUpdateTimer.start();
+    }
+}
+
+void KateProject::loadTrigramIndexDone(KateProjectSharedTrigramIndex trigramIndex)
+{
+    m_trigramIndex = std::move(trigramIndex);
+}
+
 QString KateProject::projectLocalFileName(const QString &suffix) const
 {
     /**
@@ -321,24 +437,14 @@ void KateProject::saveNotesDocument()
 
 void KateProject::slotModifiedChanged(KTextEditor::Document *document)
 {
-    KateProjectItem *item = itemForFile(m_documents.value(document));
-
-    if (!item) {
-        return;
-    }
-
-    item->slotModifiedChanged(document);
+    m_model.setDocumentModified(m_documents.value(document), document->isModified());
 }
 
 void KateProject::slotModifiedOnDisk(KTextEditor::Document *document, bool isModified, KTextEditor::ModificationInterface::ModifiedOnDiskReason reason)
 {
-    KateProjectItem *item = itemForFile(m_documents.value(document));
+    Q_UNUSED(isModified)
 
-    if (!item) {
-        return;
-    }
-
-    item->slotModifiedOnDisk(document, isModified, reason);
+    m_model.setDocumentModifiedOnDisk(m_documents.value(document), reason != KTextEditor::ModificationInterface::OnDiskUnmodified);
 }
 
 void KateProject::registerDocument(KTextEditor::Document *document)
@@ -348,104 +454,272 @@ void KateProject::registerDocument(KTextEditor::Document *document)
         m_documents[document] = document->url().toLocalFile();
     }
 
-    // try to get item for the document
-    KateProjectItem *item = itemForFile(document->url().toLocalFile());
+    // documents not in the project tree get a dummy
+    const QString file = document->url().toLocalFile();
+    if (m_model.tree().file(file) < 0) {
+        m_model.addUntrackedFile(file);
+    }
 
-    // if we got one, we are done, else create a dummy!
-    if (item) {
-        disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
-        disconnect(document,
-                   SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
-                   this,
-                   SLOT(slotModifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)));
-        item->slotModifiedChanged(document);
+    disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+    disconnect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
+    disconnect(document,
+               SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
+               this,
+               SLOT(slotModifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)));
+    m_model.setDocumentModified(file, document->isModified());
 
-        /*FIXME    item->slotModifiedOnDisk(document,document->isModified(),qobject_cast<KTextEditor::ModificationInterface*>(document)->modifiedOnDisk()); FIXME*/
+    /*FIXME    item->slotModifiedOnDisk(document,document->isModified(),qobject_cast<KTextEditor::ModificationInterface*>(document)->modifiedOnDisk()); FIXME*/
 
-        connect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
-        connect(document,
-                SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
-                this,
-                SLOT(slotModifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)));
+    connect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+    connect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
+    connect(document,
+            SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
+            this,
+            SLOT(slotModifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)));
+}
 
+void KateProject::unregisterDocument(KTextEditor::Document *document)
+{
+    if (!m_documents.contains(document)) {
         return;
     }
 
-    registerUntrackedDocument(document);
+    disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+    disconnect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
+
+    const QString file = m_documents.value(document);
+    m_model.removeUntrackedFile(file);
+    m_model.setDocumentModified(file, false);
+    m_model.setDocumentModifiedOnDisk(file, false);
+
+    m_documents.remove(document);
 }
 
-void KateProject::registerUntrackedDocument(KTextEditor::Document *document)
+void KateProject::slotConfigUpdated()
 {
-    // perhaps create the parent item
-    if (!m_untrackedDocumentsRoot) {
-        m_untrackedDocumentsRoot = new KateProjectItem(KateProjectItem::Directory, i18n("<untracked>"));
-        m_model.insertRow(0, m_untrackedDocumentsRoot);
+    if (m_plugin->watchDirectories() && !m_directoryWatcher) {
+        startWatching();
+    } else if (!m_plugin->watchDirectories() && m_directoryWatcher) {
+        stopWatching();
     }
+}
 
-    // create document item
-    QFileInfo fileInfo(document->url().toLocalFile());
-    KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, fileInfo.fileName());
-    fileItem->setData(document->url().toLocalFile(), Qt::ToolTipRole);
-    fileItem->slotModifiedChanged(document);
-    connect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
-    connect(document,
-            SIGNAL(modifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
-            this,
-            SLOT(slotModifiedOnDisk(KTextEditor::Document *, bool, KTextEditor::ModificationInterface::ModifiedOnDiskReason)));
+void KateProject::startWatching()
+{
+    if (!m_filesEntries) {
+        return;
+    }
 
-    bool inserted = false;
-    for (int i = 0; i < m_untrackedDocumentsRoot->rowCount(); ++i) {
-        if (m_untrackedDocumentsRoot->child(i)->data(Qt::UserRole).toString() > document->url().toLocalFile()) {
-            m_untrackedDocumentsRoot->insertRow(i, fileItem);
-            inserted = true;
-            break;
+    if (!m_directoryWatcher) {
+        m_directoryWatcher = new QFileSystemWatcher(this);
+        connect(m_directoryWatcher, &QFileSystemWatcher::directoryChanged, this, &KateProject::slotDirectoryChanged);
+    }
+
+    /**
+     * watch the entry directories and all directories containing files, with their parents
+     */
+    for (const KateProjectFilesEntry &entry : qAsConst(*m_filesEntries)) {
+        m_watchedDirectories.insert(entry.directory);
+    }
+    const QStringList fileDirectories = m_model.tree().fileDirectories();
+    for (QString directory : fileDirectories) {
+        while (!directory.isEmpty() && !m_watchedDirectories.contains(directory)) {
+            m_watchedDirectories.insert(directory);
+            directory.truncate(directory.lastIndexOf(QLatin1Char('/')));
         }
     }
-    if (!inserted) {
-        m_untrackedDocumentsRoot->appendRow(fileItem);
+
+    const QStringList directories = m_watchedDirectories.values();
+    if (!directories.isEmpty()) {
+        m_directoryWatcher->addPaths(directories);
     }
+}
 
-    fileItem->setData(document->url().toLocalFile(), Qt::UserRole);
-    fileItem->setData(QVariant(true), Qt::UserRole + 3);
+void KateProject::stopWatching()
+{
+    delete m_directoryWatcher;
+    m_directoryWatcher = nullptr;
+    m_watchedDirectories.clear();
+    m_ignoredDirectories.clear();
+    m_dirtyDirectories.clear();
+    m_updateTimer.stop();
+}
 
-    if (!m_file2Item) {
-        m_file2Item = KateProjectSharedQMapStringItem(new QMap<QString, KateProjectItem *>());
+void KateProject::watchDirectory(const QString &directory)
+{
+    if (!m_directoryWatcher || m_watchedDirectories.contains(directory)) {
+        return;
     }
-    (*m_file2Item)[document->url().toLocalFile()] = fileItem;
+
+    m_watchedDirectories.insert(directory);
+    m_ignoredDirectories.remove(directory);
+    m_directoryWatcher->addPath(directory);
 }
 
-void KateProject::unregisterDocument(KTextEditor::Document *document)
+void KateProject::slotDirectoryChanged(const QString &path)
 {
-    if (!m_documents.contains(document)) {
+    /**
+     * restart the timer on each change, a branch checkout triggers lots of them
+     */
+    m_dirtyDirectories.insert(path);
+    m_updateTimer.start();
+}
+
+void KateProject::startUpdate()
+{
+    /**
+     * only one update at a time, the next one starts once it is done
+     */
+    if (m_updateRunning || m_dirtyDirectories.isEmpty() || !m_filesEntries) {
         return;
     }
 
-    disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+    m_updateRunning = true;
+    QSet<QString> knownDirectories = m_watchedDirectories;
+    knownDirectories.unite(m_ignoredDirectories);
+    auto w = new KateProjectUpdateWorker(*m_filesEntries, m_dirtyDirectories, knownDirectories);
+    m_dirtyDirectories.clear();
+    connect(w, &KateProjectUpdateWorker::updateDone, this, &KateProject::updateDone);
+    m_weaver->stream() << w;
+}
 
-    const QString &file = m_documents.value(document);
+void KateProject::updateDone(KateProjectSharedDirectoryListings listings)
+{
+    m_updateRunning = false;
 
-    if (m_untrackedDocumentsRoot) {
-        KateProjectItem *item = static_cast<KateProjectItem *>(itemForFile(file));
-        if (item && item->data(Qt::UserRole + 3).toBool()) {
-            unregisterUntrackedItem(item);
-            m_file2Item->remove(file);
-        }
+    /**
+     * watching might have been switched off meanwhile
+     */
+    if (!m_directoryWatcher) {
+        return;
     }
 
-    m_documents.remove(document);
+    bool changed = false;
+    for (const KateProjectDirectoryListing &listing : qAsConst(*listings)) {
+        changed = applyListing(listing) || changed;
+    }
+
+    if (changed) {
+        emit modelChanged();
+    }
+
+    /**
+     * changes that came in during the update
+     */
+    if (!m_dirtyDirectories.isEmpty() && !m_updateTimer.isActive()) {
+        m_updateTimer.start();
+    }
 }
 
-void KateProject::unregisterUntrackedItem(const KateProjectItem *item)
+bool KateProject::applyListing(const KateProjectDirectoryListing &listing)
 {
-    for (int i = 0; i < m_untrackedDocumentsRoot->rowCount(); ++i) {
-        if (m_untrackedDocumentsRoot->child(i) == item) {
-            m_untrackedDocumentsRoot->removeRow(i);
-            break;
+    const QString prefix = listing.directory + QLatin1Char('/');
+
+    /**
+     * files of the project that are not there anymore
+     * documents not belonging to the project don't count
+     */
+    QStringList removedFiles;
+    const QVector<int> currentFiles = m_model.tree().filesInDirectory(listing.directory, listing.recursive);
+    for (int node : currentFiles) {
+        const QString file = m_model.tree().filePath(node);
+        if (!std::binary_search(listing.files.cbegin(), listing.files.cend(), file)) {
+            removedFiles.append(file);
         }
     }
+    removedFiles.sort();
+
+    for (const QString &file : qAsConst(removedFiles)) {
+        m_model.removeFile(file);
+    }
 
-    if (m_untrackedDocumentsRoot->rowCount() < 1) {
-        m_model.removeRow(0);
-        m_untrackedDocumentsRoot = nullptr;
+    /**
+     * new files, they replace documents that were not in the project up to now
+     */
+    QStringList addedFiles;
+    for (const QString &file : listing.files) {
+        const int existing = m_model.tree().file(file);
+        if (existing >= 0 && !m_model.tree().isUntracked(existing)) {
+            continue;
+        }
+
+        const KateProjectFilesEntry *entry = filesEntryForFile(file);
+        if (!entry) {
+            continue;
+        }
+
+        if (existing >= 0) {
+            m_model.removeUntrackedFile(file);
+        }
+        m_model.addFile(entry->parent, entry->directory, file);
+        addedFiles.append(file);
+    }
+
+    /**
+     * keep watching up to date
+     */
+    if (listing.watch) {
+        watchDirectory(listing.directory);
+        for (const QString &file : qAsConst(addedFiles)) {
+            QString directory = file.left(file.lastIndexOf(QLatin1Char('/')));
+            while (directory.startsWith(prefix) && !m_watchedDirectories.contains(directory)) {
+                watchDirectory(directory);
+                directory.truncate(directory.lastIndexOf(QLatin1Char('/')));
+            }
+        }
+    } else if (listing.recursive && !QFileInfo(listing.directory).isDir()) {
+        QStringList unwatched;
+        for (auto it = m_watchedDirectories.begin(); it != m_watchedDirectories.end();) {
+            if (*it == listing.directory || it->startsWith(prefix)) {
+                unwatched.append(*it);
+                it = m_watchedDirectories.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = m_ignoredDirectories.begin(); it != m_ignoredDirectories.end();) {
+            if (*it == listing.directory || it->startsWith(prefix)) {
+                it = m_ignoredDirectories.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!unwatched.isEmpty()) {
+            m_directoryWatcher->removePaths(unwatched);
+        }
+    } else if (listing.recursive) {
+        m_ignoredDirectories.insert(listing.directory);
+    }
+
+    if (removedFiles.isEmpty() && addedFiles.isEmpty()) {
+        return false;
+    }
+
+    /**
+     * refresh the tags of the moved files
+     */
+    updateIndex(removedFiles + addedFiles);
+
+    /**
+     * open documents moved in or out of the project
+     */
+    for (auto i = m_documents.constBegin(); i != m_documents.constEnd(); i++) {
+        if (std::binary_search(removedFiles.cbegin(), removedFiles.cend(), i.value()) || std::binary_search(addedFiles.cbegin(), addedFiles.cend(), i.value())) {
+            registerDocument(i.key());
+        }
+    }
+
+    return true;
+}
+
+const KateProjectFilesEntry *KateProject::filesEntryForFile(const QString &file) const
+{
+    const QString directory = file.left(file.lastIndexOf(QLatin1Char('/')));
+    for (const KateProjectFilesEntry &entry : qAsConst(*m_filesEntries)) {
+        const bool recursive = !entry.filesEntry.contains(QLatin1String("recursive")) || entry.filesEntry[QStringLiteral("recursive")].toBool();
+        if (directory == entry.directory || (recursive && directory.startsWith(entry.directory + QLatin1Char('/')))) {
+            return &entry;
+        }
     }
+    return nullptr;
 }
@@ -22,32 +22,89 @@
 #define KATE_PROJECT_H
 
 #include "kateprojectindex.h"
-#include "kateprojectitem.h"
+#include "kateprojectmodel.h"
+#include "kateprojecttrigramindex.h"
 #include <KTextEditor/ModificationInterface>
 #include <QDateTime>
 #include <QMap>
+#include <QSet>
 #include <QSharedPointer>
 #include <QTextDocument>
+#include <QTimer>
+#include <QVector>
 
 /**
  * Shared pointer data types.
  * Used to pass pointers over queued connected slots
  */
-typedef QSharedPointer<QStandardItem> KateProjectSharedQStandardItem;
-Q_DECLARE_METATYPE(KateProjectSharedQStandardItem)
+typedef QSharedPointer<KateProjectTree> KateProjectSharedTree;
+Q_DECLARE_METATYPE(KateProjectSharedTree)
 
-typedef QSharedPointer<QMap<QString, KateProjectItem *>> KateProjectSharedQMapStringItem;
-Q_DECLARE_METATYPE(KateProjectSharedQMapStringItem)
+/**
+ * One loaded files entry of a project.
+ * Needed to update the model for changes on disk without a full reload.
+ */
+struct KateProjectFilesEntry {
+    /**
+     * absolute directory of the entry
+     */
+    QString directory;
+
+    /**
+     * files entry specification from the project map
+     */
+    QVariantMap filesEntry;
+
+    /**
+     * tree node the files of the entry hang in
+     */
+    int parent;
+};
+
+typedef QSharedPointer<QVector<KateProjectFilesEntry>> KateProjectSharedFilesEntries;
+Q_DECLARE_METATYPE(KateProjectSharedFilesEntries)
+
+/**
+ * Current files inside one directory, as listed by the update worker.
+ */
+struct KateProjectDirectoryListing {
+    /**
+     * absolute path of the directory
+     */
+    QString directory;
+
+    /**
+     * true if files of all sub directories are listed, too
+     */
+    bool recursive;
+
+    /**
+     * true if the directory shall be watched for further changes
+     */
+    bool watch;
+
+    /**
+     * sorted absolute paths of all project files
+     */
+    QStringList files;
+};
+
+typedef QSharedPointer<QVector<KateProjectDirectoryListing>> KateProjectSharedDirectoryListings;
+Q_DECLARE_METATYPE(KateProjectSharedDirectoryListings)
 
 typedef QSharedPointer<KateProjectIndex> KateProjectSharedProjectIndex;
 Q_DECLARE_METATYPE(KateProjectSharedProjectIndex)
 
+typedef QSharedPointer<KateProjectTrigramIndex> KateProjectSharedTrigramIndex;
+Q_DECLARE_METATYPE(KateProjectSharedTrigramIndex)
+
 namespace ThreadWeaver
 {
 class Queue;
 }
 
 class KateProjectPlugin;
+class QFileSystemWatcher;
 
 /**
  * Class representing a project.
@@ -135,7 +192,7 @@ public:
      * Accessor for the model.
      * @return model of this project
      */
-    QStandardItemModel *model()
+    KateProjectModel *model()
     {
         return &m_model;
     }
@@ -146,17 +203,18 @@ public:
      */
     QStringList files()
     {
-        return m_file2Item ? m_file2Item->keys() : QStringList();
+        return m_model.tree().files();
     }
 
     /**
-     * get item for file
-     * @param file file to get item for
-     * @return item for given file or 0
+     * Check if a file belongs to the project.
+     * @param file absolute path of the file
+     * @return true if the file is in the project tree, untracked documents don't count
      */
-    KateProjectItem *itemForFile(const QString &file)
+    bool containsFile(const QString &file) const
     {
-        return m_file2Item ? m_file2Item->value(file) : nullptr;
+        const int node = m_model.tree().file(file);
+        return node >= 0 && !m_model.tree().isUntracked(node);
     }
 
     /**
@@ -170,6 +228,17 @@ public:
         return m_projectIndex.data();
     }
 
+    /**
+     * Access to the trigram index used to narrow down searches.
+     * May be null.
+     * Don't store this pointer, might change.
+     * @return trigram index
+     */
+    KateProjectTrigramIndex *trigramIndex()
+    {
+        return m_trigramIndex.data();
+    }
+
     /**
      * Computes a suitable file name for the given suffix.
      * If you e.g. want to store a "notes" file, you could pass "notes" and get
@@ -208,10 +277,32 @@ private Q_SLOTS:
 
     /**
      * Used for worker to send back the results of project loading
-     * @param topLevel new toplevel element for model
-     * @param file2Item new file => item mapping
+     * @param tree new tree for the model
+     * @param filesEntries loaded files entries
+     */
+    void loadProjectDone(const KateProjectSharedTree &tree, KateProjectSharedFilesEntries filesEntries);
+
+    /**
+     * Used for the update worker to send back the current content of changed directories
+     * @param listings listings of all changed directories
      */
-    void loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQMapStringItem file2Item);
+    void updateDone(KateProjectSharedDirectoryListings listings);
+
+    /**
+     * Start or stop watching the project directories, following the plugin configuration.
+     */
+    void slotConfigUpdated();
+
+    /**
+     * A watched directory changed, schedule an update.
+     * @param path changed directory
+     */
+    void slotDirectoryChanged(const QString &path);
+
+    /**
+     * List all changed directories in the background.
+     */
+    void startUpdate();
 
     /**
      * Used for worker to send back the results of index loading
@@ -219,6 +310,31 @@ private Q_SLOTS:
      */
     void loadIndexDone(KateProjectSharedProjectIndex projectIndex);
 
+    /**
+     * Used for worker to send back the results of trigram index loading
+     * @param trigramIndex new trigram index
+     */
+    void loadTrigramIndexDone(KateProjectSharedTrigramIndex trigramIndex);
+
+    /**
+     * Used for the index update worker to send back the refreshed index
+     * @param sourceIndex index the update started from
+     * @param projectIndex new project index
+     * @param files refreshed files
+     */
+    void updateIndexDone(KateProjectSharedProjectIndex sourceIndex, KateProjectSharedProjectIndex projectIndex, QStringList files);
+
+    /**
+     * Refresh the tags of all files saved since the last update in the background.
+     */
+    void startIndexUpdate();
+
+    /**
+     * A document got saved, schedule an update of its tags.
+     * @param document saved document
+     */
+    void slotDocumentSaved(KTextEditor::Document *document);
+
     void slotModifiedChanged(KTextEditor::Document *);
 
     void slotModifiedOnDisk(KTextEditor::Document *document, bool isModified, KTextEditor::ModificationInterface::ModifiedOnDiskReason reason);
@@ -232,7 +348,7 @@ Q_SIGNALS:
 
     /**
      * Emitted on model changes.
-     * This includes the files list, itemForFile mapping!
+     * This includes the files list!
      */
     void modelChanged();
 
@@ -243,10 +359,35 @@ Q_SIGNALS:
     void indexChanged();
 
 private:
-    void registerUntrackedDocument(KTextEditor::Document *document);
-    void unregisterUntrackedItem(const KateProjectItem *item);
     QVariantMap readProjectFile() const;
 
+    /**
+     * Watch all directories containing files of the project.
+     */
+    void startWatching();
+    void stopWatching();
+    void watchDirectory(const QString &directory);
+
+    /**
+     * Bring the model in sync with one directory listing.
+     * @param listing current content of the directory
+     * @return true if files got added or removed
+     */
+    bool applyListing(const KateProjectDirectoryListing &listing);
+
+    /**
+     * Schedule a refresh of the tags of some files.
+     * @param files saved, added or removed files
+     */
+    void updateIndex(const QStringList &files);
+
+    /**
+     * Find the files entry a new file belongs to.
+     * @param file absolute path of the file
+     * @return files entry or nullptr if the file is outside of all entries
+     */
+    const KateProjectFilesEntry *filesEntryForFile(const QString &file) const;
+
 private:
     /**
      * Last modification time of the project file
@@ -274,20 +415,50 @@ private:
     QVariantMap m_projectMap;
 
     /**
-     * standard item model with content of this project
+     * model with content of this project
+     */
+    KateProjectModel m_model;
+
+    /**
+     * files entries the model got loaded from
+     */
+    KateProjectSharedFilesEntries m_filesEntries;
+
+    /**
+     * watcher for the project directories, only there if watching is enabled
+     */
+    QFileSystemWatcher *m_directoryWatcher = nullptr;
+
+    /**
+     * watched directories and the ones found to contain no project files
      */
-    QStandardItemModel m_model;
+    QSet<QString> m_watchedDirectories;
+    QSet<QString> m_ignoredDirectories;
 
     /**
-     * mapping files => items
+     * changed directories, listed after some delay to batch e.g. a branch checkout
      */
-    KateProjectSharedQMapStringItem m_file2Item;
+    QSet<QString> m_dirtyDirectories;
+    QTimer m_updateTimer;
+    bool m_updateRunning = false;
 
     /**
      * project index, if any
      */
     KateProjectSharedProjectIndex m_projectIndex;
 
+    /**
+     * files whose tags need a refresh, refreshed after some delay to batch saving all documents
+     */
+    QSet<QString> m_dirtyIndexFiles;
+    QTimer m_indexUpdateTimer;
+    bool m_indexUpdateRunning = false;
+
+    /**
+     * trigram index for searching, if any
+     */
+    KateProjectSharedTrigramIndex m_trigramIndex;
+
     /**
      * notes buffer for project local notes
      */
@@ -298,11 +469,6 @@ private:
      */
     QMap<KTextEditor::Document *, QString> m_documents;
 
-    /**
-     * Parent item for existing documents that are not in the project tree
-     */
-    QStandardItem *m_untrackedDocumentsRoot;
-
     ThreadWeaver::Queue *m_weaver;
 
     /**
@@ -67,6 +67,15 @@ KateProjectConfigPage::KateProjectConfigPage(QWidget *parent, KateProjectPlugin
     group->setLayout(vbox);
     layout->addWidget(group);
 
+    vbox = new QVBoxLayout;
+    group = new QGroupBox(i18nc("Groupbox title", "Project Files"), this);
+    group->setWhatsThis(i18n("Project plugin is able to update the file list of projects on changes inside their directories"));
+    m_cbWatchDirectories = new QCheckBox(i18n("Update file list on changes in the project directories"), this);
+    vbox->addWidget(m_cbWatchDirectories);
+    vbox->addStretch(1);
+    group->setLayout(vbox);
+    layout->addWidget(group);
+
     vbox = new QVBoxLayout;
     group = new QGroupBox(i18nc("Groupbox title", "Cross-Project Functionality"), this);
     group->setWhatsThis(i18n("Project plugin is able to perform some operations across multiple projects"));
@@ -88,6 +97,7 @@ KateProjectConfigPage::KateProjectConfigPage(QWidget *parent, KateProjectPlugin
     connect(m_cbIndexEnabled, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_indexPath, &KUrlRequester::textChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_indexPath, &KUrlRequester::urlSelected, this, &KateProjectConfigPage::slotMyChanged);
+    connect(m_cbWatchDirectories, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_cbMultiProjectCompletion, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_cbMultiProjectGoto, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
 }
@@ -117,6 +127,7 @@ void KateProjectConfigPage::apply()
 
     m_plugin->setAutoRepository(m_cbAutoGit->checkState() == Qt::Checked, m_cbAutoSubversion->checkState() == Qt::Checked, m_cbAutoMercurial->checkState() == Qt::Checked);
     m_plugin->setIndex(m_cbIndexEnabled->checkState() == Qt::Checked, m_indexPath->url());
+    m_plugin->setWatchDirectories(m_cbWatchDirectories->checkState() == Qt::Checked);
     m_plugin->setMultiProject(m_cbMultiProjectCompletion->checkState() == Qt::Checked, m_cbMultiProjectGoto->checkState() == Qt::Checked);
 }
 
@@ -127,6 +138,7 @@ void KateProjectConfigPage::reset()
     m_cbAutoMercurial->setCheckState(m_plugin->autoMercurial() ? Qt::Checked : Qt::Unchecked);
     m_cbIndexEnabled->setCheckState(m_plugin->getIndexEnabled() ? Qt::Checked : Qt::Unchecked);
     m_indexPath->setUrl(m_plugin->getIndexDirectory());
+    m_cbWatchDirectories->setCheckState(m_plugin->watchDirectories() ? Qt::Checked : Qt::Unchecked);
     m_cbMultiProjectCompletion->setCheckState(m_plugin->multiProjectCompletion() ? Qt::Checked : Qt::Unchecked);
     m_cbMultiProjectGoto->setCheckState(m_plugin->multiProjectGoto() ? Qt::Checked : Qt::Unchecked);
     m_changed = false;
@@ -53,6 +53,7 @@ private:
     QCheckBox *m_cbAutoMercurial;
     QCheckBox *m_cbIndexEnabled;
     KUrlRequester *m_indexPath;
+    QCheckBox *m_cbWatchDirectories;
     QCheckBox *m_cbMultiProjectCompletion;
     QCheckBox *m_cbMultiProjectGoto;
     KateProjectPlugin *m_plugin;
@@ -20,100 +20,78 @@
 
 #include "kateprojectindex.h"
 
-#include <QDir>
-#include <QProcess>
+#include "ctags/ctagsgenerator.h"
 
-/**
- * include ctags reading
- */
-#include "ctags/readtags.c"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
 
 KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force)
-    : m_ctagsIndexHandle(nullptr)
 {
     // allow project to override and specify a (re-usable) indexfile
-    // otherwise fall-back to a temporary file if nothing specified
+    // otherwise fall-back to a file per project base directory in the index directory, it is updated incrementally on the next load
     auto ctagsFile = ctagsMap.value(QStringLiteral("index_file"));
     if (ctagsFile.userType() == QMetaType::QString) {
         auto path = ctagsFile.toString();
         if (!QDir::isAbsolutePath(path)) {
             path = QDir(baseDir).absoluteFilePath(path);
         }
-        m_ctagsIndexFile.reset(new QFile(path));
+        m_ctagsIndexFile = path;
     } else {
-        // indexDir is typically QDir::tempPath() or otherwise specified in configuration
-        m_ctagsIndexFile.reset(new QTemporaryFile(indexDir + QStringLiteral("/kate.project.ctags")));
+        // indexDir is typically the kateproject directory in the cache location or otherwise specified in configuration
+        const QByteArray baseDirHash = QCryptographicHash::hash(baseDir.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+        m_ctagsIndexFile = indexDir + QStringLiteral("/kate.project.") + QString::fromLatin1(baseDirHash) + QStringLiteral(".ctags");
+        m_defaultIndexFile = true;
+    }
+
+    m_ctagsArguments << QStringLiteral("--fields=+K+n");
+    const QString keyOptions = QStringLiteral("options");
+    for (const QVariant &optVariant : ctagsMap[keyOptions].toList()) {
+        m_ctagsArguments << optVariant.toString();
     }
 
     /**
      * load ctags
      */
-    loadCtags(files, ctagsMap, force);
+    loadCtags(files, force);
 }
 
-KateProjectIndex::~KateProjectIndex()
+KateProjectIndex::KateProjectIndex(const KateProjectIndex &index, const QStringList &files)
+    : m_ctagsIndexFile(index.m_ctagsIndexFile)
+    , m_defaultIndexFile(index.m_defaultIndexFile)
+    , m_ctagsArguments(index.m_ctagsArguments)
+    , m_ctagsDatabase(index.m_ctagsDatabase)
 {
     /**
-     * delete ctags handle if any
+     * run ctags for the given files, keep the tags of all others
      */
-    if (m_ctagsIndexHandle) {
-        tagsClose(m_ctagsIndexHandle);
-        m_ctagsIndexHandle = nullptr;
+    CTagsGenerator generator(m_ctagsIndexFile, QStringLiteral("ctags"), m_ctagsArguments);
+    if (generator.updateFiles(files) && generator.changed()) {
+        openCtags();
     }
 }
 
-void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force)
+KateProjectIndex::~KateProjectIndex()
 {
-    /**
-     * only overwrite existing index upon reload
-     * (a temporary index file will never exist)
-     */
-    if (m_ctagsIndexFile->exists() && !force) {
-        openCtags();
-        return;
-    }
-
-    /**
-     * create temporary file
-     * if not possible, fail
-     */
-    if (!m_ctagsIndexFile->open(QIODevice::ReadWrite)) {
-        return;
-    }
+}
 
-    /**
-     * close file again, other process will use it
-     */
-    m_ctagsIndexFile->close();
+void KateProjectIndex::loadCtags(const QStringList &files, bool force)
+{
+    CTagsGenerator generator(m_ctagsIndexFile, QStringLiteral("ctags"), m_ctagsArguments);
 
     /**
-     * try to run ctags for all files in this project
-     * output to our ctags index file
+     * an index file not generated by us is only overwritten upon reload
      */
-    QProcess ctags;
-    QStringList args;
-    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << m_ctagsIndexFile->fileName() << QStringLiteral("--fields=+K+n");
-    const QString keyOptions = QStringLiteral("options");
-    for (const QVariant &optVariant : ctagsMap[keyOptions].toList()) {
-        args << optVariant.toString();
-    }
-    ctags.start(QStringLiteral("ctags"), args);
-    if (!ctags.waitForStarted()) {
+    if (!force && !m_defaultIndexFile && QFileInfo::exists(m_ctagsIndexFile) && !generator.hasState()) {
+        openCtags();
         return;
     }
 
     /**
-     * write files list and close write channel
+     * run ctags for new and changed files only, in parallel
+     * output merged into our ctags index file
      */
-    ctags.write(files.join(QLatin1Char('\n')).toLocal8Bit());
-    ctags.closeWriteChannel();
-
-    /**
-     * wait for done
-     */
-    if (!ctags.waitForFinished(-1)) {
-        return;
-    }
+    generator.update(files);
 
     openCtags();
 }
@@ -121,43 +99,29 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
 void KateProjectIndex::openCtags()
 {
     /**
-     * file not openable, bad
+     * missing or empty file, bad
      */
-    if (!m_ctagsIndexFile->open(QIODevice::ReadOnly)) {
+    if (QFileInfo(m_ctagsIndexFile).size() <= 0) {
         return;
     }
 
     /**
-     * get size
+     * map and index the ctags file, shared with the indexes of the other projects using it
      */
-    qint64 size = m_ctagsIndexFile->size();
-
-    /**
-     * close again
-     */
-    m_ctagsIndexFile->close();
+    m_ctagsDatabase = CTagsDatabase::open(m_ctagsIndexFile);
+}
 
-    /**
-     * empty file, bad
-     */
-    if (!size) {
+void KateProjectIndex::removeIndexFile()
+{
+    if (!m_defaultIndexFile) {
         return;
     }
 
     /**
-     * close current
-     */
-    if (m_ctagsIndexHandle) {
-        tagsClose(m_ctagsIndexHandle);
-        m_ctagsIndexHandle = nullptr;
-    }
-
-    /**
-     * try to open ctags file
+     * unmap our database before, other indexes sharing it keep their mapping
      */
-    tagFileInfo info;
-    memset(&info, 0, sizeof(tagFileInfo));
-    m_ctagsIndexHandle = tagsOpen(m_ctagsIndexFile->fileName().toLocal8Bit().constData(), &info);
+    m_ctagsDatabase.reset();
+    CTagsGenerator(m_ctagsIndexFile, QStringLiteral("ctags"), m_ctagsArguments).remove();
 }
 
 void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &searchWord, MatchType type, int options)
@@ -165,7 +129,7 @@ void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &sea
     /**
      * abort if no ctags index
      */
-    if (!m_ctagsIndexHandle) {
+    if (!m_ctagsDatabase) {
         return;
     }
 
@@ -182,13 +146,13 @@ void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &sea
      * try to search entry
      * fail if none found
      */
-    tagEntry entry;
     if (options == -1) {
         options = TAG_PARTIALMATCH | TAG_OBSERVECASE;
     }
-    if (tagsFind(m_ctagsIndexHandle, &entry, word.constData(), options) != TagSuccess) {
-        return;
-    }
+    CTagsDatabase::MatchFlags flags;
+    flags.setFlag(CTagsDatabase::PartialMatch, options & TAG_PARTIALMATCH);
+    flags.setFlag(CTagsDatabase::IgnoreCase, options & TAG_IGNORECASE);
+    const QVector<CTagsDatabase::Entry> entries = m_ctagsDatabase->find(word, flags);
 
     /**
      * set to show words only once for completion matches
@@ -197,16 +161,8 @@ void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &sea
 
     /**
      * loop over all found tags
-     * first one is filled by above find, others by find next
      */
-    do {
-        /**
-         * skip if no name
-         */
-        if (!entry.name) {
-            continue;
-        }
-
+    for (const CTagsDatabase::Entry &entry : entries) {
         /**
          * get name
          */
@@ -232,11 +188,11 @@ void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &sea
              */
             QList<QStandardItem *> items;
             items << new QStandardItem(name);
-            items << new QStandardItem(entry.kind ? QString::fromLocal8Bit(entry.kind) : QString());
-            items << new QStandardItem(entry.file ? QString::fromLocal8Bit(entry.file) : QString());
-            items << new QStandardItem(QString::number(entry.address.lineNumber));
+            items << new QStandardItem(QString::fromLocal8Bit(entry.kind));
+            items << new QStandardItem(QString::fromLocal8Bit(entry.file));
+            items << new QStandardItem(QString::number(entry.line));
             model.appendRow(items);
             break;
         }
-    } while (tagsFindNext(m_ctagsIndexHandle, &entry) == TagSuccess);
+    }
 }
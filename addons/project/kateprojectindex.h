@@ -24,13 +24,15 @@
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 
+#include <QSharedPointer>
 #include <QStandardItemModel>
+#include <QString>
 #include <QStringList>
-#include <QTemporaryFile>
 
 /**
- * ctags reading
+ * ctags reading, readtags for the match flags
  */
+#include "ctags/ctagsdatabase.h"
 #include "ctags/readtags.h"
 
 /**
@@ -50,6 +52,13 @@ public:
      */
     KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force);
 
+    /**
+     * construct an updated copy of an index, only the tags of the given files are regenerated
+     * @param index index to update
+     * @param files saved, added or removed files
+     */
+    KateProjectIndex(const KateProjectIndex &index, const QStringList &files);
+
     /**
      * deconstruct project
      */
@@ -88,16 +97,23 @@ public:
      */
     bool isValid() const
     {
-        return m_ctagsIndexHandle;
+        return m_ctagsDatabase && m_ctagsDatabase->isValid();
     }
 
+    /**
+     * Remove the index file if it is the default one in the index directory,
+     * an index file given by the project is kept. Called once the project is closed.
+     */
+    void removeIndexFile();
+
 private:
     /**
-     * Load ctags tags.
+     * Load ctags tags, ctags only runs on files changed since the last load.
      * @param files files to index
-     * @param ctagsMap ctags section for extra options
+     * @param force overwrite an index file given by the project that was not generated by us
+     * the default index file is always generated by us, whatever is found there is overwritten
      */
-    void loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force);
+    void loadCtags(const QStringList &files, bool force);
 
     /**
      * Open ctags tags.
@@ -108,12 +124,22 @@ private:
     /**
      * ctags index file
      */
-    QScopedPointer<QFile> m_ctagsIndexFile;
+    QString m_ctagsIndexFile;
+
+    /**
+     * is m_ctagsIndexFile the default file in the index directory?
+     */
+    bool m_defaultIndexFile = false;
+
+    /**
+     * extra ctags arguments
+     */
+    QStringList m_ctagsArguments;
 
     /**
-     * handle to ctags file for querying, if possible
+     * loaded ctags file for querying, if possible
      */
-    tagFile *m_ctagsIndexHandle;
+    QSharedPointer<CTagsDatabase> m_ctagsDatabase;
 };
 
 #endif
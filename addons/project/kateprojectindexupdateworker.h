@@ -0,0 +1,60 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_INDEX_UPDATE_WORKER_H
+#define KATE_PROJECT_INDEX_UPDATE_WORKER_H
+
+#include "kateproject.h"
+
+#include <ThreadWeaver/Job>
+
+#include <QStringList>
+
+/**
+ * Class refreshing the tags of some files of a project index in the background.
+ * Used for saved, added and removed files, this avoids a full reload.
+ */
+class KateProjectIndexUpdateWorker : public QObject, public ThreadWeaver::Job
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param index current index of the project
+     * @param files files to refresh
+     */
+    KateProjectIndexUpdateWorker(const KateProjectSharedProjectIndex &index, const QStringList &files);
+
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+Q_SIGNALS:
+    /**
+     * @param source index the update started from
+     * @param index updated index
+     * @param files refreshed files
+     */
+    void updateIndexDone(KateProjectSharedProjectIndex source, KateProjectSharedProjectIndex index, QStringList files);
+
+private:
+    const KateProjectSharedProjectIndex m_index;
+    const QStringList m_files;
+};
+
+#endif
@@ -0,0 +1,295 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojectmodel.h"
+
+#include <KIconUtils>
+#include <KLocalizedString>
+
+#include <QMimeDatabase>
+#include <QUrl>
+
+KateProjectModel::KateProjectModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+    m_tree.finish();
+}
+
+QModelIndex KateProjectModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const int parentNode = node(parent);
+    if (column != 0 || row < 0 || row >= m_tree.rowCount(parentNode)) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, quintptr(m_tree.child(parentNode, row)));
+}
+
+QModelIndex KateProjectModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+    return indexForNode(m_tree.parent(node(index)));
+}
+
+int KateProjectModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    return m_tree.rowCount(node(parent));
+}
+
+int KateProjectModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant KateProjectModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const int n = node(index);
+    switch (role) {
+    case Qt::DisplayRole:
+        return m_tree.name(n);
+
+    case Qt::ToolTipRole:
+    case Qt::UserRole:
+        if (m_tree.type(n) == KateProjectTree::File) {
+            return m_tree.filePath(n);
+        }
+        break;
+
+    case Qt::UserRole + 3:
+        if (m_tree.isUntracked(n) && m_tree.type(n) == KateProjectTree::File) {
+            return true;
+        }
+        break;
+
+    case Qt::DecorationRole:
+        return icon(n);
+    }
+
+    return QVariant();
+}
+
+QModelIndex KateProjectModel::indexForNode(int node) const
+{
+    if (node <= KateProjectTree::Root) {
+        return QModelIndex();
+    }
+    return createIndex(m_tree.row(node), 0, quintptr(node));
+}
+
+void KateProjectModel::setTree(KateProjectTree &&tree)
+{
+    beginResetModel();
+    m_tree = std::move(tree);
+    m_untrackedRoot = -1;
+    m_mimeIconNames.clear();
+    endResetModel();
+}
+
+QModelIndex KateProjectModel::indexForFile(const QString &file) const
+{
+    const int n = m_tree.file(file);
+    return n < 0 ? QModelIndex() : indexForNode(n);
+}
+
+int KateProjectModel::insertNode(int parent, int row, KateProjectTree::Type type, const QString &name, const QString &directory, bool untracked)
+{
+    beginInsertRows(indexForNode(parent), row, row);
+    const int n = m_tree.insert(parent, row, type, name, directory, untracked);
+    endInsertRows();
+    return n;
+}
+
+void KateProjectModel::removeNode(int node)
+{
+    const int row = m_tree.row(node);
+    beginRemoveRows(indexForNode(m_tree.parent(node)), row, row);
+    m_tree.remove(node);
+    m_mimeIconNames.remove(node);
+    endRemoveRows();
+}
+
+int KateProjectModel::directoryNode(int parent, const QString &parentDirectory, const QString &directory)
+{
+    if (directory == parentDirectory || !directory.startsWith(parentDirectory + QLatin1Char('/'))) {
+        return parent;
+    }
+
+    const int existing = m_tree.directory(directory);
+    if (existing >= 0) {
+        return existing;
+    }
+
+    /**
+     * construct it, with its parents, the untracked documents stay in the first row
+     */
+    const int slashIndex = directory.lastIndexOf(QLatin1Char('/'));
+    const int directoryParent = directoryNode(parent, parentDirectory, directory.left(slashIndex));
+    const QString name = directory.mid(slashIndex + 1);
+    const int firstRow = (directoryParent == KateProjectTree::Root && m_untrackedRoot >= 0) ? 1 : 0;
+    return insertNode(directoryParent, qMax(firstRow, m_tree.sortedRow(directoryParent, name)), KateProjectTree::Directory, name, directory);
+}
+
+void KateProjectModel::addFile(int parent, const QString &directory, const QString &file)
+{
+    const int slashIndex = file.lastIndexOf(QLatin1Char('/'));
+    const QString fileDirectory = file.left(slashIndex);
+    const QString name = file.mid(slashIndex + 1);
+    const int directoryParent = directoryNode(parent, directory, fileDirectory);
+    const int firstRow = (directoryParent == KateProjectTree::Root && m_untrackedRoot >= 0) ? 1 : 0;
+    insertNode(directoryParent, qMax(firstRow, m_tree.sortedRow(directoryParent, name)), KateProjectTree::File, name, fileDirectory);
+}
+
+void KateProjectModel::removeFile(const QString &file)
+{
+    const int n = m_tree.file(file);
+    if (n < 0 || m_tree.isUntracked(n)) {
+        return;
+    }
+
+    int parent = m_tree.parent(n);
+    removeNode(n);
+
+    /**
+     * remove directories that got empty, projects stay
+     */
+    while (parent != KateProjectTree::Root && m_tree.type(parent) == KateProjectTree::Directory && !m_tree.isUntracked(parent) && m_tree.rowCount(parent) == 0) {
+        const int grandParent = m_tree.parent(parent);
+        removeNode(parent);
+        parent = grandParent;
+    }
+}
+
+void KateProjectModel::addUntrackedFile(const QString &file)
+{
+    if (m_untrackedRoot < 0) {
+        m_untrackedRoot = insertNode(KateProjectTree::Root, 0, KateProjectTree::Directory, i18n("<untracked>"), QString(), true);
+    }
+
+    /**
+     * sorted by path
+     */
+    int row = 0;
+    while (row < m_tree.rowCount(m_untrackedRoot) && m_tree.filePath(m_tree.child(m_untrackedRoot, row)) <= file) {
+        ++row;
+    }
+
+    const int slashIndex = file.lastIndexOf(QLatin1Char('/'));
+    insertNode(m_untrackedRoot, row, KateProjectTree::File, file.mid(slashIndex + 1), file.left(slashIndex), true);
+}
+
+void KateProjectModel::removeUntrackedFile(const QString &file)
+{
+    const int n = m_tree.file(file);
+    if (n < 0 || !m_tree.isUntracked(n)) {
+        return;
+    }
+
+    removeNode(n);
+    if (m_tree.rowCount(m_untrackedRoot) == 0) {
+        removeNode(m_untrackedRoot);
+        m_untrackedRoot = -1;
+    }
+}
+
+void KateProjectModel::setDocumentModified(const QString &file, bool modified)
+{
+    setDocumentState(file, 1, modified);
+}
+
+void KateProjectModel::setDocumentModifiedOnDisk(const QString &file, bool modifiedOnDisk)
+{
+    setDocumentState(file, 2, modifiedOnDisk);
+}
+
+void KateProjectModel::setDocumentState(const QString &file, int flag, bool on)
+{
+    const int oldState = m_documentStates.value(file);
+    const int state = on ? (oldState | flag) : (oldState & ~flag);
+    if (state == oldState) {
+        return;
+    }
+
+    if (state) {
+        m_documentStates.insert(file, state);
+    } else {
+        m_documentStates.remove(file);
+    }
+
+    const QModelIndex index = indexForFile(file);
+    if (index.isValid()) {
+        emit dataChanged(index, index, {Qt::DecorationRole});
+    }
+}
+
+QIcon KateProjectModel::icon(int node) const
+{
+    QString iconName;
+    int state = 0;
+    switch (m_tree.type(node)) {
+    case KateProjectTree::Project:
+        iconName = QStringLiteral("folder-documents");
+        break;
+
+    case KateProjectTree::Directory:
+        iconName = QStringLiteral("folder");
+        break;
+
+    case KateProjectTree::File: {
+        const QString path = m_tree.filePath(node);
+        state = m_documentStates.value(path);
+        if (state & 1) {
+            iconName = QStringLiteral("document-save");
+            break;
+        }
+
+        /**
+         * the mime type lookup is too slow for each paint, only do it once per file
+         */
+        auto mimeIt = m_mimeIconNames.find(node);
+        if (mimeIt == m_mimeIconNames.end()) {
+            mimeIt = m_mimeIconNames.insert(node, QMimeDatabase().mimeTypeForUrl(QUrl::fromLocalFile(path)).iconName());
+        }
+        iconName = mimeIt.value();
+        break;
+    }
+    }
+
+    /**
+     * documents changed on disk get an emblem
+     */
+    const QString key = (state & 2) ? iconName + QStringLiteral("+emblem") : iconName;
+    auto it = m_icons.find(key);
+    if (it == m_icons.end()) {
+        QIcon icon = QIcon::fromTheme(iconName);
+        if (state & 2) {
+            icon = KIconUtils::addOverlay(icon, QIcon::fromTheme(QStringLiteral("emblem-important")), Qt::TopLeftCorner);
+        }
+        it = m_icons.insert(key, icon);
+    }
+    return it.value();
+}
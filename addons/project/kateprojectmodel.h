@@ -0,0 +1,149 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_MODEL_H
+#define KATE_PROJECT_MODEL_H
+
+#include "kateprojecttree.h"
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QIcon>
+
+/**
+ * Item model for the project tree, backed by a KateProjectTree.
+ * Provides the display name, the file path as Qt::ToolTipRole and Qt::UserRole and
+ * Qt::UserRole + 3 for untracked documents. Icons are resolved when shown and
+ * shared between all files of the same type.
+ */
+class KateProjectModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit KateProjectModel(QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * Replace the whole tree, e.g. by a new one loaded in the background.
+     * @param tree new tree, must be finished
+     */
+    void setTree(KateProjectTree &&tree);
+
+    const KateProjectTree &tree() const
+    {
+        return m_tree;
+    }
+
+    /**
+     * @return index for the file with the absolute path @p file, invalid if there is none
+     */
+    QModelIndex indexForFile(const QString &file) const;
+
+    /**
+     * Add a file to the tree, sorted into its directory, missing directories are created.
+     * @param parent node the files of @p directory hang in
+     * @param directory absolute directory @p parent stands for
+     * @param file absolute path of the file, must be inside @p directory
+     */
+    void addFile(int parent, const QString &directory, const QString &file);
+
+    /**
+     * Remove a file from the tree, directories getting empty are removed, too.
+     * @param file absolute path of the file
+     */
+    void removeFile(const QString &file);
+
+    /**
+     * Add a document that doesn't belong to the project below the toplevel "<untracked>" node.
+     * @param file absolute path of the document
+     */
+    void addUntrackedFile(const QString &file);
+
+    /**
+     * Remove a document added by addUntrackedFile().
+     * @param file absolute path of the document
+     */
+    void removeUntrackedFile(const QString &file);
+
+    /**
+     * Update the icon of a file for the state of its document.
+     * @param file absolute path of the file
+     * @param modified document is modified
+     */
+    void setDocumentModified(const QString &file, bool modified);
+
+    /**
+     * Update the icon of a file for the state of its document.
+     * @param file absolute path of the file
+     * @param modifiedOnDisk document was changed on disk
+     */
+    void setDocumentModifiedOnDisk(const QString &file, bool modifiedOnDisk);
+
+private:
+    int node(const QModelIndex &index) const
+    {
+        return index.isValid() ? int(index.internalId()) : KateProjectTree::Root;
+    }
+
+    QModelIndex indexForNode(int node) const;
+
+    /**
+     * @return directory node for the absolute @p directory, created if needed
+     */
+    int directoryNode(int parent, const QString &parentDirectory, const QString &directory);
+
+    int insertNode(int parent, int row, KateProjectTree::Type type, const QString &name, const QString &directory = QString(), bool untracked = false);
+    void removeNode(int node);
+
+    void setDocumentState(const QString &file, int flag, bool on);
+
+    QIcon icon(int node) const;
+
+private:
+    KateProjectTree m_tree;
+
+    /**
+     * toplevel node for untracked documents, -1 if there are none
+     */
+    int m_untrackedRoot = -1;
+
+    /**
+     * state of documents: bit 0 modified, bit 1 modified on disk
+     */
+    QHash<QString, int> m_documentStates;
+
+    /**
+     * icons by icon name and document state
+     */
+    mutable QHash<QString, QIcon> m_icons;
+
+    /**
+     * mime type icon names by file node
+     */
+    mutable QHash<int, QString> m_mimeIconNames;
+};
+
+#endif
@@ -67,11 +67,14 @@ KateProjectPlugin::KateProjectPlugin(QObject *parent, const QList<QVariant> &)
     , m_autoGit(true)
     , m_autoSubversion(true)
     , m_autoMercurial(true)
+    , m_watchDirectories(true)
     , m_weaver(new ThreadWeaver::Queue(this))
 {
-    qRegisterMetaType<KateProjectSharedQStandardItem>("KateProjectSharedQStandardItem");
-    qRegisterMetaType<KateProjectSharedQMapStringItem>("KateProjectSharedQMapStringItem");
+    qRegisterMetaType<KateProjectSharedTree>("KateProjectSharedTree");
+    qRegisterMetaType<KateProjectSharedFilesEntries>("KateProjectSharedFilesEntries");
+    qRegisterMetaType<KateProjectSharedDirectoryListings>("KateProjectSharedDirectoryListings");
     qRegisterMetaType<KateProjectSharedProjectIndex>("KateProjectSharedProjectIndex");
+    qRegisterMetaType<KateProjectSharedTrigramIndex>("KateProjectSharedTrigramIndex");
 
     connect(KTextEditor::Editor::instance()->application(), &KTextEditor::Application::documentCreated, this, &KateProjectPlugin::slotDocumentCreated);
     connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, this, &KateProjectPlugin::slotDirectoryChanged);
@@ -343,6 +346,17 @@ QUrl KateProjectPlugin::getIndexDirectory() const
     return m_indexDirectory;
 }
 
+void KateProjectPlugin::setWatchDirectories(bool enabled)
+{
+    m_watchDirectories = enabled;
+    writeConfig();
+}
+
+bool KateProjectPlugin::watchDirectories() const
+{
+    return m_watchDirectories;
+}
+
 bool KateProjectPlugin::multiProjectCompletion() const
 {
     return m_multiProjectCompletion;
@@ -382,6 +396,8 @@ void KateProjectPlugin::readConfig()
     m_indexEnabled = config.readEntry("index", false);
     m_indexDirectory = config.readEntry("indexDirectory", QUrl());
 
+    m_watchDirectories = config.readEntry("watchDirectories", true);
+
     m_multiProjectCompletion = config.readEntry("multiProjectCompletion", false);
     m_multiProjectGoto = config.readEntry("multiProjectCompletion", false);
 
@@ -410,6 +426,8 @@ void KateProjectPlugin::writeConfig()
     config.writeEntry("index", m_indexEnabled);
     config.writeEntry("indexDirectory", m_indexDirectory);
 
+    config.writeEntry("watchDirectories", m_watchDirectories);
+
     config.writeEntry("multiProjectCompletion", m_multiProjectCompletion);
     config.writeEntry("multiProjectGoto", m_multiProjectGoto);
 
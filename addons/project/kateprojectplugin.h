@@ -115,6 +115,9 @@ public:
     bool getIndexEnabled() const;
     QUrl getIndexDirectory() const;
 
+    void setWatchDirectories(bool enabled);
+    bool watchDirectories() const;
+
     void setMultiProject(bool completion, bool gotoSymbol);
     bool multiProjectCompletion() const;
     bool multiProjectGoto() const;
@@ -193,6 +196,7 @@ private:
     bool m_autoSubversion : 1;
     bool m_autoMercurial : 1;
     bool m_indexEnabled : 1;
+    bool m_watchDirectories : 1;
     bool m_multiProjectCompletion : 1;
     bool m_multiProjectGoto : 1;
     QUrl m_indexDirectory;
@@ -311,6 +311,27 @@ QStringList KateProjectPluginView::allProjectsFiles() const
     return fileList;
 }
 
+QVariantHash KateProjectPluginView::filesNotContaining(const QStringList &files, const QString &literal) const
+{
+    /**
+     * a file ruled out by any index can be skipped
+     */
+    QVariantHash ruledOut;
+
+    const auto projectList = m_plugin->projects();
+    for (auto project : projectList) {
+        if (!project->trigramIndex()) {
+            continue;
+        }
+        const auto projectRuledOut = project->trigramIndex()->filesNotContaining(files, literal);
+        for (auto it = projectRuledOut.cbegin(); it != projectRuledOut.cend(); ++it) {
+            ruledOut.insert(it.key(), QVariantList{it.value().lastModified, it.value().size});
+        }
+    }
+
+    return ruledOut;
+}
+
 void KateProjectPluginView::slotViewChanged()
 {
     /**
@@ -93,6 +93,17 @@ public:
      */
     QStringList allProjectsFiles() const;
 
+    /**
+     * The files of a list that can't contain @p literal, using the trigram indices of all open projects.
+     * Used for the Search&Replace plugin to skip files when searching in projects.
+     * A file may only be skipped as long as it didn't change on disk since it got indexed,
+     * the search checks that in its workers, not to stat all these files in the GUI thread.
+     * @param files files to check, e.g. projectFiles()
+     * @param literal literal every match contains
+     * @return ruled out files, mapped to a list of their modification time in ms since the epoch and their size when indexed
+     */
+    Q_INVOKABLE QVariantHash filesNotContaining(const QStringList &files, const QString &literal) const;
+
     /**
      * the main window we belong to
      * @return our main window
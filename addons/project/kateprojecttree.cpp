@@ -0,0 +1,220 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojecttree.h"
+
+KateProjectTree::KateProjectTree()
+{
+    createNode(-1, Project, QString(), QString(), false);
+}
+
+int KateProjectTree::intern(const QString &string, QVector<QString> &strings, QHash<QString, int> &ids)
+{
+    const auto it = ids.constFind(string);
+    if (it != ids.cend()) {
+        return it.value();
+    }
+
+    const int id = strings.size();
+    strings.append(string);
+    ids.insert(string, id);
+    return id;
+}
+
+int KateProjectTree::createNode(int parent, Type type, const QString &name, const QString &directory, bool untracked)
+{
+    Node node;
+    node.parent = parent;
+    node.name = intern(name, m_names, m_nameIds);
+    node.directory = directory.isEmpty() ? -1 : intern(directory, m_directories, m_directoryIds);
+    node.childBegin = m_children.size();
+    node.type = type;
+    node.untracked = untracked;
+
+    const int id = m_nodes.size();
+    m_nodes.append(node);
+
+    /**
+     * remember files and directories for lookups, the first directory node for a path wins
+     */
+    if (type == File) {
+        m_fileNodes.insert(qMakePair(node.directory, node.name), id);
+        if (!untracked) {
+            if (m_directoryFiles.size() <= node.directory) {
+                m_directoryFiles.resize(node.directory + 1);
+            }
+            m_directoryFiles[node.directory].append(id);
+        }
+    } else if (type == Directory && node.directory >= 0 && !m_directoryNodes.contains(node.directory)) {
+        m_directoryNodes.insert(node.directory, id);
+    }
+
+    return id;
+}
+
+QString KateProjectTree::filePath(int node) const
+{
+    const Node &n = m_nodes[node];
+    if (n.type != File) {
+        return QString();
+    }
+    return m_directories[n.directory] + QLatin1Char('/') + m_names[n.name];
+}
+
+int KateProjectTree::file(const QString &path) const
+{
+    const int slashIndex = path.lastIndexOf(QLatin1Char('/'));
+    const int directory = m_directoryIds.value(path.left(slashIndex), -1);
+    const int name = m_nameIds.value(path.mid(slashIndex + 1), -1);
+    if (directory < 0 || name < 0) {
+        return -1;
+    }
+    return m_fileNodes.value(qMakePair(directory, name), -1);
+}
+
+int KateProjectTree::directory(const QString &path) const
+{
+    const int directory = m_directoryIds.value(path, -1);
+    return directory < 0 ? -1 : m_directoryNodes.value(directory, -1);
+}
+
+QStringList KateProjectTree::files() const
+{
+    QStringList files;
+    for (int directory = 0; directory < m_directoryFiles.size(); ++directory) {
+        for (int node : m_directoryFiles[directory]) {
+            files.append(m_directories[directory] + QLatin1Char('/') + m_names[m_nodes[node].name]);
+        }
+    }
+    files.sort();
+    return files;
+}
+
+QVector<int> KateProjectTree::filesInDirectory(const QString &directory, bool recursive) const
+{
+    QVector<int> files;
+    const QString prefix = directory + QLatin1Char('/');
+    for (int id = 0; id < m_directoryFiles.size(); ++id) {
+        if (m_directories[id] == directory || (recursive && m_directories[id].startsWith(prefix))) {
+            files += m_directoryFiles[id];
+        }
+    }
+    return files;
+}
+
+QStringList KateProjectTree::fileDirectories() const
+{
+    QStringList directories;
+    for (int id = 0; id < m_directoryFiles.size(); ++id) {
+        if (!m_directoryFiles[id].isEmpty()) {
+            directories.append(m_directories[id]);
+        }
+    }
+    return directories;
+}
+
+int KateProjectTree::append(int parent, Type type, const QString &name, const QString &directory)
+{
+    Q_ASSERT(m_children.isEmpty());
+
+    const int id = createNode(parent, type, name, directory, false);
+    m_pendingChildren.resize(m_nodes.size());
+    m_pendingChildren[parent].append(id);
+    return id;
+}
+
+void KateProjectTree::finish()
+{
+    /**
+     * lay out the children node by node, every range is contiguous
+     */
+    m_children.reserve(m_nodes.size() - 1);
+    for (int id = 0; id < m_nodes.size(); ++id) {
+        Node &node = m_nodes[id];
+        node.childBegin = m_children.size();
+        if (id < m_pendingChildren.size()) {
+            node.childCount = m_pendingChildren[id].size();
+            for (int child : qAsConst(m_pendingChildren[id])) {
+                m_nodes[child].row = m_children.size() - node.childBegin;
+                m_children.append(child);
+            }
+        }
+    }
+    m_pendingChildren = QVector<QVector<int>>();
+}
+
+QVector<int> &KateProjectTree::ownChildren(int node)
+{
+    Node &n = m_nodes[node];
+    if (n.ownChildren < 0) {
+        n.ownChildren = m_ownChildren.size();
+        m_ownChildren.append(m_children.mid(n.childBegin, n.childCount));
+    }
+    return m_ownChildren[n.ownChildren];
+}
+
+int KateProjectTree::insert(int parent, int row, Type type, const QString &name, const QString &directory, bool untracked)
+{
+    const int id = createNode(parent, type, name, directory, untracked);
+
+    /**
+     * only the siblings behind the new node change their row
+     */
+    QVector<int> &children = ownChildren(parent);
+    children.insert(row, id);
+    for (int i = row; i < children.size(); ++i) {
+        m_nodes[children[i]].row = i;
+    }
+    return id;
+}
+
+void KateProjectTree::remove(int node)
+{
+    Node &n = m_nodes[node];
+    Q_ASSERT(n.parent >= 0 && rowCount(node) == 0);
+
+    if (n.type == File) {
+        m_fileNodes.remove(qMakePair(n.directory, n.name));
+        if (!n.untracked) {
+            m_directoryFiles[n.directory].removeOne(node);
+        }
+    } else if (n.type == Directory && m_directoryNodes.value(n.directory, -1) == node) {
+        m_directoryNodes.remove(n.directory);
+    }
+
+    QVector<int> &children = ownChildren(n.parent);
+    children.remove(n.row);
+    for (int i = n.row; i < children.size(); ++i) {
+        m_nodes[children[i]].row = i;
+    }
+    n.parent = -1;
+    n.row = -1;
+}
+
+int KateProjectTree::sortedRow(int parent, const QString &name) const
+{
+    const int count = rowCount(parent);
+    for (int row = 0; row < count; ++row) {
+        if (m_names[m_nodes[child(parent, row)].name].compare(name, Qt::CaseInsensitive) > 0) {
+            return row;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,221 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_TREE_H
+#define KATE_PROJECT_TREE_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Compact tree of the projects, directories and files of a project.
+ *
+ * Nodes are plain structs in one array and referenced by their index, the
+ * children of a node are a range in one shared array of node indices.
+ * File and directory names as well as the absolute directories of files are
+ * interned, a file costs a node and some lookup entries, no strings.
+ *
+ * Is built in the worker thread, children are appended in order and laid out
+ * by finish(). Afterwards nodes can be inserted and removed one by one, the
+ * first change to a node moves its children into a list of their own, so a
+ * change only costs the siblings of the node and not the whole tree.
+ */
+class KateProjectTree
+{
+public:
+    /**
+     * Possible node types
+     */
+    enum Type : quint8 { Project, Directory, File };
+
+    /**
+     * the invisible root node, the toplevel nodes are its children
+     */
+    static const int Root = 0;
+
+    KateProjectTree();
+
+    int rowCount(int node) const
+    {
+        const Node &n = m_nodes[node];
+        return n.ownChildren < 0 ? n.childCount : m_ownChildren[n.ownChildren].size();
+    }
+
+    int child(int node, int row) const
+    {
+        const Node &n = m_nodes[node];
+        return n.ownChildren < 0 ? m_children[n.childBegin + row] : m_ownChildren[n.ownChildren][row];
+    }
+
+    /**
+     * @return parent of @p node, -1 for the root and removed nodes
+     */
+    int parent(int node) const
+    {
+        return m_nodes[node].parent;
+    }
+
+    /**
+     * @return row of @p node inside its parent
+     */
+    int row(int node) const
+    {
+        return m_nodes[node].row;
+    }
+
+    Type type(int node) const
+    {
+        return m_nodes[node].type;
+    }
+
+    const QString &name(int node) const
+    {
+        return m_names[m_nodes[node].name];
+    }
+
+    /**
+     * @return true for the files and the root of documents that don't belong to the project
+     */
+    bool isUntracked(int node) const
+    {
+        return m_nodes[node].untracked;
+    }
+
+    /**
+     * @return absolute path of a file node, empty for other nodes
+     */
+    QString filePath(int node) const;
+
+    /**
+     * @return node of the file with the absolute @p path, -1 if there is none
+     */
+    int file(const QString &path) const;
+
+    /**
+     * @return first directory node for the absolute @p path, -1 if there is none
+     */
+    int directory(const QString &path) const;
+
+    /**
+     * @return sorted absolute paths of all files that are no untracked documents
+     */
+    QStringList files() const;
+
+    /**
+     * @param directory absolute path of a directory
+     * @param recursive include the files of sub directories
+     * @return file nodes in @p directory that are no untracked documents
+     */
+    QVector<int> filesInDirectory(const QString &directory, bool recursive) const;
+
+    /**
+     * @return absolute paths of all directories containing files that are no untracked documents
+     */
+    QStringList fileDirectories() const;
+
+    /**
+     * Append a child while building the tree.
+     * @param parent parent node
+     * @param type type of the new node
+     * @param name name to display
+     * @param directory absolute directory containing a file or path of a directory, empty for projects
+     * @return new node
+     */
+    int append(int parent, Type type, const QString &name, const QString &directory = QString());
+
+    /**
+     * Lay out the children of all nodes appended so far, must be called once after building.
+     */
+    void finish();
+
+    /**
+     * Insert a child into a finished tree.
+     * @param row row of the new node inside @p parent
+     * @param untracked mark the node as untracked document or root of these
+     * @return new node
+     */
+    int insert(int parent, int row, Type type, const QString &name, const QString &directory = QString(), bool untracked = false);
+
+    /**
+     * Remove a node without children from a finished tree.
+     * @param node node to remove
+     */
+    void remove(int node);
+
+    /**
+     * @return row to insert a child named @p name at, to keep the children sorted
+     */
+    int sortedRow(int parent, const QString &name) const;
+
+private:
+    struct Node {
+        int parent = -1;
+        int name = -1;
+        int directory = -1;
+        int childBegin = 0;
+        int childCount = 0;
+        int ownChildren = -1;
+        int row = -1;
+        Type type = Project;
+        bool untracked = false;
+    };
+
+    int createNode(int parent, Type type, const QString &name, const QString &directory, bool untracked);
+    QVector<int> &ownChildren(int node);
+    static int intern(const QString &string, QVector<QString> &strings, QHash<QString, int> &ids);
+
+private:
+    QVector<Node> m_nodes;
+
+    /**
+     * children laid out by finish(), each node owns the range [childBegin, childBegin + childCount)
+     */
+    QVector<int> m_children;
+
+    /**
+     * children of the nodes changed after finish(), these ignore their range
+     */
+    QVector<QVector<int>> m_ownChildren;
+
+    /**
+     * children appended while building, laid out by finish()
+     */
+    QVector<QVector<int>> m_pendingChildren;
+
+    /**
+     * interned names and absolute directories
+     */
+    QVector<QString> m_names;
+    QHash<QString, int> m_nameIds;
+    QVector<QString> m_directories;
+    QHash<QString, int> m_directoryIds;
+
+    /**
+     * (directory, name) => file node, directory => directory node, directory => file nodes in it
+     */
+    QHash<QPair<int, int>, int> m_fileNodes;
+    QHash<int, int> m_directoryNodes;
+    QVector<QVector<int>> m_directoryFiles;
+};
+
+#endif
@@ -0,0 +1,327 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojecttrigramindex.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/**
+ * magic and version of the index file, bump the version on format changes
+ */
+static const quint32 IndexMagic = 0x4b545249; // "KTRI"
+static const quint32 IndexVersion = 1;
+
+/**
+ * larger files are not indexed, they are always searched
+ */
+static const qint64 MaxIndexedFileSize = 4 * 1024 * 1024;
+
+/**
+ * fold ASCII letters to lower case, all other bytes are kept as they are
+ */
+static inline quint32 foldByte(char c)
+{
+    const uchar u = static_cast<uchar>(c);
+    return (u >= 'A' && u <= 'Z') ? u + ('a' - 'A') : u;
+}
+
+QDataStream &operator<<(QDataStream &out, const KateProjectTrigramIndex::FileEntry &entry)
+{
+    return out << entry.path << entry.lastModified << entry.size << entry.indexed;
+}
+
+QDataStream &operator>>(QDataStream &in, KateProjectTrigramIndex::FileEntry &entry)
+{
+    return in >> entry.path >> entry.lastModified >> entry.size >> entry.indexed;
+}
+
+KateProjectTrigramIndex::KateProjectTrigramIndex(const QString &indexFile, const QStringList &files)
+{
+    /**
+     * load the last state, if any, and take it out of the way
+     */
+    load(indexFile);
+    QVector<FileEntry> oldFiles;
+    QHash<QString, int> oldFileIds;
+    QHash<quint32, QVector<int>> oldPostings;
+    oldFiles.swap(m_files);
+    oldFileIds.swap(m_fileIds);
+    oldPostings.swap(m_postings);
+
+    /**
+     * assign new ids, files unchanged since the last run keep their trigrams
+     */
+    QVector<int> oldToNew(oldFiles.size(), -1);
+    QVector<int> toIndex;
+    int reused = 0;
+    m_files.reserve(files.size());
+    for (const QString &path : files) {
+        if (m_fileIds.contains(path)) {
+            continue;
+        }
+
+        FileEntry entry;
+        entry.path = path;
+        const QFileInfo info(path);
+        if (info.isFile()) {
+            entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+            entry.size = info.size();
+        }
+
+        const int id = m_files.size();
+        const int oldId = oldFileIds.value(path, -1);
+        if (oldId >= 0 && oldFiles[oldId].lastModified == entry.lastModified && oldFiles[oldId].size == entry.size) {
+            entry.indexed = oldFiles[oldId].indexed;
+            oldToNew[oldId] = id;
+            ++reused;
+        } else {
+            toIndex.append(id);
+        }
+
+        m_fileIds.insert(path, id);
+        m_files.append(entry);
+    }
+
+    /**
+     * carry over the postings of the reused files
+     */
+    for (auto it = oldPostings.cbegin(); it != oldPostings.cend(); ++it) {
+        QVector<int> ids;
+        for (int oldId : it.value()) {
+            const int newId = (oldId >= 0 && oldId < oldToNew.size()) ? oldToNew[oldId] : -1;
+            if (newId >= 0) {
+                ids.append(newId);
+            }
+        }
+        if (!ids.isEmpty()) {
+            m_postings.insert(it.key(), ids);
+        }
+    }
+    oldPostings.clear();
+
+    /**
+     * read new and changed files
+     */
+    for (int id : qAsConst(toIndex)) {
+        indexFile(id);
+    }
+
+    /**
+     * ids got shuffled around above, lookups need sorted postings
+     */
+    for (auto it = m_postings.begin(); it != m_postings.end(); ++it) {
+        std::sort(it.value().begin(), it.value().end());
+    }
+
+    /**
+     * only write the index again if something changed
+     */
+    if (!toIndex.isEmpty() || reused != oldFiles.size()) {
+        save(indexFile);
+    }
+}
+
+bool KateProjectTrigramIndex::load(const QString &indexFile)
+{
+    QFile file(indexFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (magic != IndexMagic || version != IndexVersion) {
+        return false;
+    }
+
+    in.setVersion(QDataStream::Qt_5_0);
+    in >> m_files >> m_postings;
+    if (in.status() != QDataStream::Ok) {
+        m_files.clear();
+        m_postings.clear();
+        return false;
+    }
+
+    for (int i = 0; i < m_files.size(); ++i) {
+        m_fileIds.insert(m_files[i].path, i);
+    }
+    return true;
+}
+
+void KateProjectTrigramIndex::save(const QString &indexFile) const
+{
+    QSaveFile file(indexFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << IndexMagic << IndexVersion;
+    out.setVersion(QDataStream::Qt_5_0);
+    out << m_files << m_postings;
+    file.commit();
+}
+
+void KateProjectTrigramIndex::indexFile(int fileId)
+{
+    FileEntry &entry = m_files[fileId];
+    if (entry.size < 0 || entry.size > MaxIndexedFileSize) {
+        return;
+    }
+
+    QFile file(entry.path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QByteArray content = file.readAll();
+    const char *data = content.constData();
+    const int size = content.size();
+
+    /**
+     * the search prefilter only works on ASCII compatible encodings,
+     * UTF-16/32 files and binaries are left unindexed and always searched
+     */
+    if (size >= 2 && ((uchar(data[0]) == 0xFF && uchar(data[1]) == 0xFE) || (uchar(data[0]) == 0xFE && uchar(data[1]) == 0xFF))) {
+        return;
+    }
+    if (memchr(data, 0, qMin(size, 8192))) {
+        return;
+    }
+
+    /**
+     * collect the distinct trigrams of the file
+     */
+    std::vector<quint32> trigrams;
+    trigrams.reserve(size);
+    quint32 trigram = 0;
+    for (int i = 0; i < size; ++i) {
+        trigram = ((trigram << 8) | foldByte(data[i])) & 0xFFFFFF;
+        if (i >= 2) {
+            trigrams.push_back(trigram);
+        }
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    for (quint32 t : trigrams) {
+        m_postings[t].append(fileId);
+    }
+    entry.indexed = true;
+}
+
+bool KateProjectTrigramIndex::isUnchanged(const QString &file, const FileState &state)
+{
+    const QFileInfo info(file);
+    return info.size() == state.size && info.lastModified().toMSecsSinceEpoch() == state.lastModified;
+}
+
+QHash<QString, KateProjectTrigramIndex::FileState> KateProjectTrigramIndex::filesNotContaining(const QStringList &files, const QString &literal) const
+{
+    QHash<QString, FileState> ruledOut;
+    /**
+     * trigrams of the literal
+     * non-ASCII is encoding dependent and line ends might be \r\n on disk, don't use these
+     */
+    const QByteArray needle = literal.toUtf8();
+    std::vector<quint32> trigrams;
+    for (int i = 2; i < needle.size(); ++i) {
+        const char *t = needle.constData() + i - 2;
+        bool usable = true;
+        for (int j = 0; j < 3; ++j) {
+            if (uchar(t[j]) >= 0x80 || t[j] == '\n' || t[j] == '\r') {
+                usable = false;
+            }
+        }
+        if (usable) {
+            trigrams.push_back((foldByte(t[0]) << 16) | (foldByte(t[1]) << 8) | foldByte(t[2]));
+        }
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    if (trigrams.empty()) {
+        return ruledOut;
+    }
+
+    /**
+     * intersect the postings, shortest first
+     * a trigram no file contains leaves no candidates at all
+     */
+    std::vector<const QVector<int> *> postings;
+    bool unknownTrigram = false;
+    for (quint32 t : trigrams) {
+        const auto it = m_postings.constFind(t);
+        if (it == m_postings.cend()) {
+            unknownTrigram = true;
+            break;
+        }
+        postings.push_back(&it.value());
+    }
+
+    std::vector<int> candidates;
+    if (!unknownTrigram) {
+        std::sort(postings.begin(), postings.end(), [](const QVector<int> *a, const QVector<int> *b) {
+            return a->size() < b->size();
+        });
+        candidates.assign(postings.front()->cbegin(), postings.front()->cend());
+        std::vector<int> intersection;
+        for (size_t i = 1; i < postings.size() && !candidates.empty(); ++i) {
+            intersection.clear();
+            std::set_intersection(candidates.cbegin(), candidates.cend(), postings[i]->cbegin(), postings[i]->cend(), std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+    }
+
+    /**
+     * rule out the indexed files that are no candidates
+     */
+    for (const QString &path : files) {
+        const int id = m_fileIds.value(path, -1);
+        if (id >= 0 && m_files[id].indexed && !std::binary_search(candidates.cbegin(), candidates.cend(), id)) {
+            ruledOut.insert(path, {m_files[id].lastModified, m_files[id].size});
+        }
+    }
+    return ruledOut;
+}
+
+QStringList KateProjectTrigramIndex::filesContaining(const QStringList &files, const QString &literal) const
+{
+    /**
+     * files changed since indexing might contain the literal now
+     */
+    const QHash<QString, FileState> ruledOut = filesNotContaining(files, literal);
+    QStringList result;
+    for (const QString &path : files) {
+        const auto it = ruledOut.constFind(path);
+        if (it == ruledOut.cend() || !isUnchanged(path, it.value())) {
+            result.append(path);
+        }
+    }
+    return result;
+}
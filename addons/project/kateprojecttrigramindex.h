@@ -0,0 +1,118 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_TRIGRAM_INDEX_H
+#define KATE_PROJECT_TRIGRAM_INDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QDataStream;
+
+/**
+ * Trigram index over the content of all files of a project.
+ * Maps each (ASCII case folded) byte trigram to the sorted list of files containing it.
+ * The search plugin uses it to skip files that can't contain a literal of the search pattern.
+ *
+ * Is created in Worker thread in the background, stored in the index directory and then
+ * passed to project in the main thread for usage. It is never modified afterwards.
+ */
+class KateProjectTrigramIndex
+{
+public:
+    /**
+     * Load the index from @p indexFile, bring it up to date for @p files and store it again.
+     * Only files that are new or whose size or modification time changed are read.
+     * @param indexFile file to persist the index in
+     * @param files files to index
+     */
+    KateProjectTrigramIndex(const QString &indexFile, const QStringList &files);
+
+    /**
+     * State on disk of a file when it got indexed.
+     */
+    struct FileState {
+        qint64 lastModified = 0;
+        qint64 size = -1;
+    };
+
+    /**
+     * The files of @p files the index rules out for @p literal, with their state when they got indexed.
+     * Doesn't touch the disk, a ruled out file can only be skipped as long as isUnchanged() holds for it.
+     * Files the index doesn't know or couldn't index are never ruled out.
+     * If @p literal is too short to be looked up, nothing is ruled out.
+     * @param files files to check
+     * @param literal literal every match contains
+     * @return ruled out files with their state
+     */
+    QHash<QString, FileState> filesNotContaining(const QStringList &files, const QString &literal) const;
+
+    /**
+     * @return true if @p file is still in @p state on disk
+     */
+    static bool isUnchanged(const QString &file, const FileState &state);
+
+    /**
+     * Narrow @p files down to the ones that may contain @p literal.
+     * Files ruled out by the index are checked on disk, the ones changed since indexing are kept.
+     * That is a stat per ruled out file, better not done in the GUI thread.
+     * @param files files to filter, the order is kept
+     * @param literal literal every match contains
+     * @return filtered files
+     */
+    QStringList filesContaining(const QStringList &files, const QString &literal) const;
+
+private:
+    /**
+     * Per file data, used to detect changes on disk.
+     */
+    struct FileEntry {
+        QString path;
+        qint64 lastModified = 0;
+        qint64 size = -1;
+        bool indexed = false;
+    };
+
+    bool load(const QString &indexFile);
+    void save(const QString &indexFile) const;
+
+    /**
+     * Read the file of the given entry and add its trigrams.
+     * Marks the entry as not indexed if it is too large, binary or not ASCII compatible.
+     */
+    void indexFile(int fileId);
+
+
+    friend QDataStream &operator<<(QDataStream &out, const FileEntry &entry);
+    friend QDataStream &operator>>(QDataStream &in, FileEntry &entry);
+
+private:
+    QVector<FileEntry> m_files;
+    QHash<QString, int> m_fileIds;
+
+    /**
+     * trigram => sorted ids of files containing it
+     */
+    QHash<quint32, QVector<int>> m_postings;
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "kateprojectupdateworker.h"
+#include "kateprojectworker.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+KateProjectUpdateWorker::KateProjectUpdateWorker(const QVector<KateProjectFilesEntry> &filesEntries, const QSet<QString> &directories, const QSet<QString> &knownDirectories)
+    : QObject()
+    , ThreadWeaver::Job()
+    , m_filesEntries(filesEntries)
+    , m_directories(directories)
+    , m_knownDirectories(knownDirectories)
+{
+}
+
+void KateProjectUpdateWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
+{
+    KateProjectSharedDirectoryListings listings(new QVector<KateProjectDirectoryListing>());
+
+    QStringList directories = m_directories.values();
+    directories.sort();
+    for (const QString &directory : qAsConst(directories)) {
+        /**
+         * directory is gone, all files below it are gone, too
+         */
+        const QDir dir(directory);
+        if (!dir.exists()) {
+            listings->append({directory, true, false, QStringList()});
+            continue;
+        }
+
+        bool watch = false;
+        listings->append({directory, false, true, listFiles(directory, false, &watch)});
+
+        /**
+         * sub directories the project doesn't know yet are listed completely
+         * hidden ones are skipped like on loading
+         */
+        const QStringList subDirectories = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+        for (const QString &subDirectory : subDirectories) {
+            const QString path = dir.absoluteFilePath(subDirectory);
+            if (m_knownDirectories.contains(path)) {
+                continue;
+            }
+
+            watch = false;
+            const QStringList files = listFiles(path, true, &watch);
+            listings->append({path, true, watch || !files.isEmpty(), files});
+        }
+
+        /**
+         * known sub directories that vanished
+         */
+        const QString prefix = directory + QLatin1Char('/');
+        for (const QString &known : m_knownDirectories) {
+            if (known.startsWith(prefix) && known.indexOf(QLatin1Char('/'), prefix.size()) < 0 && !QFileInfo(known).isDir()) {
+                listings->append({known, true, false, QStringList()});
+            }
+        }
+    }
+
+    emit updateDone(listings);
+}
+
+QStringList KateProjectUpdateWorker::listFiles(const QString &directory, bool recursive, bool *watch)
+{
+    QSet<QString> files;
+    const QString prefix = directory + QLatin1Char('/');
+
+    for (int i = 0; i < m_filesEntries.size(); ++i) {
+        const KateProjectFilesEntry &entry = m_filesEntries[i];
+
+        /**
+         * skip entries not covering the directory
+         * non recursive ones only cover their own directory
+         */
+        const bool entryRecursive = !entry.filesEntry.contains(QLatin1String("recursive")) || entry.filesEntry[QStringLiteral("recursive")].toBool();
+        if (directory != entry.directory && !(entryRecursive && directory.startsWith(entry.directory + QLatin1Char('/')))) {
+            continue;
+        }
+        const bool listRecursive = recursive && entryRecursive;
+
+        /**
+         * git, subversion and plain directories can list just the given directory
+         * the others list the whole entry once, it is filtered below
+         */
+        const QVariantMap &filesEntry = entry.filesEntry;
+        const bool vcs = filesEntry[QStringLiteral("git")].toBool() || filesEntry[QStringLiteral("hg")].toBool() || filesEntry[QStringLiteral("svn")].toBool()
+            || filesEntry[QStringLiteral("darcs")].toBool();
+        const bool explicitList = !vcs && !filesEntry[QStringLiteral("list")].toStringList().isEmpty();
+        if (!vcs && !explicitList) {
+            *watch = true;
+        }
+
+        QStringList entryFiles;
+        if (explicitList || filesEntry[QStringLiteral("hg")].toBool() || filesEntry[QStringLiteral("darcs")].toBool()) {
+            if (!m_entryFiles.contains(i)) {
+                m_entryFiles.insert(i, KateProjectWorker::findFiles(QDir(entry.directory), filesEntry));
+            }
+            entryFiles = m_entryFiles.value(i);
+        } else {
+            QVariantMap directoryEntry = filesEntry;
+            directoryEntry[QStringLiteral("recursive")] = listRecursive;
+            entryFiles = KateProjectWorker::findFiles(QDir(directory), directoryEntry);
+        }
+
+        for (const QString &file : qAsConst(entryFiles)) {
+            if (!file.startsWith(prefix) || (!listRecursive && file.indexOf(QLatin1Char('/'), prefix.size()) >= 0)) {
+                continue;
+            }
+            if (!files.contains(file) && QFileInfo(file).isFile()) {
+                files.insert(file);
+            }
+        }
+    }
+
+    QStringList result = files.values();
+    result.sort();
+    return result;
+}
@@ -0,0 +1,75 @@
+/*  This file is part of the Kate project.
+ *
+ *  Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KATE_PROJECT_UPDATE_WORKER_H
+#define KATE_PROJECT_UPDATE_WORKER_H
+
+#include "kateproject.h"
+
+#include <ThreadWeaver/Job>
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Class listing changed directories of a project in the background.
+ * The project applies the listings as deltas to its model, this avoids a full reload.
+ */
+class KateProjectUpdateWorker : public QObject, public ThreadWeaver::Job
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param filesEntries files entries of the project
+     * @param directories changed directories
+     * @param knownDirectories directories already known to the project, other sub directories are new
+     */
+    KateProjectUpdateWorker(const QVector<KateProjectFilesEntry> &filesEntries, const QSet<QString> &directories, const QSet<QString> &knownDirectories);
+
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+Q_SIGNALS:
+    void updateDone(KateProjectSharedDirectoryListings listings);
+
+private:
+    /**
+     * List the project files inside one directory.
+     * @param directory absolute path of the directory
+     * @param recursive list the files of all sub directories, too
+     * @param watch set to true if the directory is covered by a plain directory entry
+     * @return sorted absolute paths of the files
+     */
+    QStringList listFiles(const QString &directory, bool recursive, bool *watch);
+
+private:
+    const QVector<KateProjectFilesEntry> m_filesEntries;
+    const QSet<QString> m_directories;
+    const QSet<QString> m_knownDirectories;
+
+    /**
+     * complete listings of entries that can't list single directories
+     */
+    QHash<int, QStringList> m_entryFiles;
+};
+
+#endif
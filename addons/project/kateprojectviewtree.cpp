@@ -82,17 +82,17 @@ KateProjectViewTree::~KateProjectViewTree()
 void KateProjectViewTree::selectFile(const QString &file)
 {
     /**
-     * get item if any
+     * get index if any
      */
-    QStandardItem *item = m_project->itemForFile(file);
-    if (!item) {
+    const QModelIndex sourceIndex = m_project->model()->indexForFile(file);
+    if (!sourceIndex.isValid()) {
         return;
     }
 
     /**
      * select it
      */
-    QModelIndex index = static_cast<QSortFilterProxyModel *>(model())->mapFromSource(m_project->model()->indexFromItem(item));
+    QModelIndex index = static_cast<QSortFilterProxyModel *>(model())->mapFromSource(sourceIndex);
     scrollTo(index, QAbstractItemView::EnsureVisible);
     selectionModel()->setCurrentIndex(index, QItemSelectionModel::Clear | QItemSelectionModel::Select);
 }
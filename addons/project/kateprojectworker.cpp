@@ -21,16 +21,30 @@
 #include "kateprojectworker.h"
 #include "kateproject.h"
 
+#include <ThreadWeaver/Collection>
+#include <ThreadWeaver/Lambda>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
 #include <QProcess>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QSet>
 #include <QSettings>
+#include <QStandardPaths>
 #include <QTime>
 
+/**
+ * magic and version of the git file list cache, bump the version on format changes
+ */
+static const quint32 GitCacheMagic = 0x4b47464c; // "KGFL"
+static const quint32 GitCacheVersion = 1;
+
 KateProjectWorker::KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force)
     : QObject()
     , ThreadWeaver::Job()
@@ -40,30 +54,76 @@ KateProjectWorker::KateProjectWorker(const QString &baseDir, const QString &inde
     , m_force(force)
 {
     Q_ASSERT(!m_baseDir.isEmpty());
+
+    collectFilesEntries(m_projectMap, &m_filesEntryMaps);
+    m_entryFiles.resize(m_filesEntryMaps.size());
+}
+
+ThreadWeaver::JobInterface *KateProjectWorker::createEnumerationJob()
+{
+    /**
+     * each job fills its own list, they are all created here before any job runs
+     */
+    auto collection = new ThreadWeaver::Collection();
+    for (int i = 0; i < m_filesEntryMaps.size(); ++i) {
+        const QVariantMap filesEntry = m_filesEntryMaps[i];
+        QStringList *files = m_entryFiles.data() + i;
+        const QString baseDir = m_baseDir;
+        *collection << ThreadWeaver::make_job([baseDir, filesEntry, files]() {
+            QDir dir(baseDir);
+            if (dir.cd(filesEntry[QStringLiteral("directory")].toString())) {
+                *files = findFiles(dir, filesEntry, true);
+            }
+        });
+    }
+    return collection;
 }
 
 void KateProjectWorker::run(ThreadWeaver::JobPointer, ThreadWeaver::Thread *)
 {
     /**
-     * Create dummy top level parent item and empty map inside shared pointers
+     * Create the tree and the list of files entries inside shared pointers
      * then load the project recursively
      */
-    KateProjectSharedQStandardItem topLevel(new QStandardItem());
-    KateProjectSharedQMapStringItem file2Item(new QMap<QString, KateProjectItem *>());
-    loadProject(topLevel.data(), m_projectMap, file2Item.data());
+    KateProjectSharedTree tree(new KateProjectTree());
+    KateProjectSharedFilesEntries filesEntries(new QVector<KateProjectFilesEntry>());
+    loadProject(tree.data(), KateProjectTree::Root, m_projectMap, filesEntries.data());
+    tree->finish();
 
     /**
      * create some local backup of some data we need for further processing!
      */
-    QStringList files = file2Item->keys();
+    QStringList files = tree->files();
 
-    emit loadDone(topLevel, file2Item);
+    emit loadDone(tree, filesEntries);
 
     // trigger index loading, will internally handle enable/disabled
     loadIndex(files, m_force);
+
+    // same for the trigram index used by the search plugin
+    loadTrigramIndex(files);
 }
 
-void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &project, QMap<QString, KateProjectItem *> *file2Item)
+void KateProjectWorker::collectFilesEntries(const QVariantMap &project, QVector<QVariantMap> *filesEntries)
+{
+    /**
+     * same order as in loadProject: sub-projects with a name first, then own files
+     */
+    const QVariantList subGroups = project[QStringLiteral("projects")].toList();
+    for (const QVariant &subGroupVariant : subGroups) {
+        const QVariantMap subProject = subGroupVariant.toMap();
+        if (!subProject[QStringLiteral("name")].toString().isEmpty()) {
+            collectFilesEntries(subProject, filesEntries);
+        }
+    }
+
+    const QVariantList files = project[QStringLiteral("files")].toList();
+    for (const QVariant &fileVariant : files) {
+        filesEntries->append(fileVariant.toMap());
+    }
+}
+
+void KateProjectWorker::loadProject(KateProjectTree *tree, int parent, const QVariantMap &project, QVector<KateProjectFilesEntry> *filesEntries)
 {
     /**
      * recurse to sub-projects FIRST
@@ -82,9 +142,8 @@ void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &pr
         /**
          * recurse
          */
-        QStandardItem *subProjectItem = new KateProjectItem(KateProjectItem::Project, subProject[keyName].toString());
-        loadProject(subProjectItem, subProject, file2Item);
-        parent->appendRow(subProjectItem);
+        const int subProjectNode = tree->append(parent, KateProjectTree::Project, subProject[keyName].toString());
+        loadProject(tree, subProjectNode, subProject, filesEntries);
     }
 
     /**
@@ -93,17 +152,19 @@ void KateProjectWorker::loadProject(QStandardItem *parent, const QVariantMap &pr
     const QString keyFiles = QStringLiteral("files");
     QVariantList files = project[keyFiles].toList();
     for (const QVariant &fileVariant : files) {
-        loadFilesEntry(parent, fileVariant.toMap(), file2Item);
+        loadFilesEntry(tree, parent, fileVariant.toMap(), filesEntries);
     }
 }
 
 /**
- * small helper to construct directory parent items
- * @param dir2Item map for path => item
- * @param path current path we need item for
- * @return correct parent item for given path, will reuse existing ones
+ * small helper to construct directory parent nodes
+ * @param tree tree to add the nodes to
+ * @param dir2Node map for path => node
+ * @param baseDir absolute directory the paths are relative to
+ * @param path current path we need node for
+ * @return correct parent node for given path, will reuse existing ones
  */
-static QStandardItem *directoryParent(QMap<QString, QStandardItem *> &dir2Item, QString path)
+static int directoryParent(KateProjectTree *tree, QMap<QString, int> &dir2Node, const QString &baseDir, QString path)
 {
     /**
      * throw away simple /
@@ -115,8 +176,9 @@ static QStandardItem *directoryParent(QMap<QString, QStandardItem *> &dir2Item,
     /**
      * quick check: dir already seen?
      */
-    if (dir2Item.contains(path)) {
-        return dir2Item[path];
+    const auto it = dir2Node.constFind(path);
+    if (it != dir2Node.cend()) {
+        return it.value();
     }
 
     /**
@@ -126,12 +188,12 @@ static QStandardItem *directoryParent(QMap<QString, QStandardItem *> &dir2Item,
 
     /**
      * no slash?
-     * simple, no recursion, append new item toplevel
+     * simple, no recursion, append new node toplevel
      */
     if (slashIndex < 0) {
-        dir2Item[path] = new KateProjectItem(KateProjectItem::Directory, path);
-        dir2Item[QString()]->appendRow(dir2Item[path]);
-        return dir2Item[path];
+        const int node = tree->append(dir2Node[QString()], KateProjectTree::Directory, path, baseDir + QLatin1Char('/') + path);
+        dir2Node[path] = node;
+        return node;
     }
 
     /**
@@ -144,25 +206,39 @@ static QStandardItem *directoryParent(QMap<QString, QStandardItem *> &dir2Item,
      * special handling if / with nothing on one side are found
      */
     if (leftPart.isEmpty() || rightPart.isEmpty()) {
-        return directoryParent(dir2Item, leftPart.isEmpty() ? rightPart : leftPart);
+        return directoryParent(tree, dir2Node, baseDir, leftPart.isEmpty() ? rightPart : leftPart);
     }
 
     /**
      * else: recurse on left side
      */
-    dir2Item[path] = new KateProjectItem(KateProjectItem::Directory, rightPart);
-    directoryParent(dir2Item, leftPart)->appendRow(dir2Item[path]);
-    return dir2Item[path];
+    const int node = tree->append(directoryParent(tree, dir2Node, baseDir, leftPart), KateProjectTree::Directory, rightPart, baseDir + QLatin1Char('/') + path);
+    dir2Node[path] = node;
+    return node;
 }
 
-void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QMap<QString, KateProjectItem *> *file2Item)
+void KateProjectWorker::loadFilesEntry(KateProjectTree *tree, int parent, const QVariantMap &filesEntry, QVector<KateProjectFilesEntry> *filesEntries)
 {
+    /**
+     * take the enumerated files, the index must advance for skipped entries, too
+     */
+    const int entryIndex = m_entryIndex++;
+    if (entryIndex >= m_entryFiles.size()) {
+        return;
+    }
+
     QDir dir(m_baseDir);
     if (!dir.cd(filesEntry[QStringLiteral("directory")].toString())) {
         return;
     }
 
-    QStringList files = findFiles(dir, filesEntry);
+    /**
+     * remember the entry, even without files, they might be created later
+     */
+    filesEntries->append({dir.absolutePath(), filesEntry, parent});
+
+    QStringList files;
+    files.swap(m_entryFiles[entryIndex]);
 
     if (files.isEmpty()) {
         return;
@@ -171,62 +247,71 @@ void KateProjectWorker::loadFilesEntry(QStandardItem *parent, const QVariantMap
     files.sort(Qt::CaseInsensitive);
 
     /**
-     * construct paths first in tree and items in a map
+     * git, mercurial, darcs and directory listings only contain files
+     * skip the stat of each of them, only explicit lists and subversion can contain other stuff
      */
-    QMap<QString, QStandardItem *> dir2Item;
-    dir2Item[QString()] = parent;
-    QList<QPair<QStandardItem *, QStandardItem *>> item2ParentPath;
-    for (const QString &filePath : files) {
+    const bool onlyFiles = filesEntry[QStringLiteral("git")].toBool() || filesEntry[QStringLiteral("hg")].toBool() || filesEntry[QStringLiteral("darcs")].toBool()
+        || (!filesEntry[QStringLiteral("svn")].toBool() && filesEntry[QStringLiteral("list")].toStringList().isEmpty());
+    const QString dirPrefix = dir.absolutePath() + QLatin1Char('/');
+
+    /**
+     * construct paths first in tree and remember the files with their parent
+     * directories come before the files inside each directory
+     */
+    const QString baseDir = dir.absolutePath();
+    QMap<QString, int> dir2Node;
+    dir2Node[QString()] = parent;
+    QVector<QPair<int, QString>> parentAndFile;
+    parentAndFile.reserve(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        const QString &filePath = files[i];
+
         /**
-         * skip dupes
+         * skip dupes, of this and of previous entries
          */
-        if (file2Item->contains(filePath)) {
+        if ((i > 0 && files[i - 1] == filePath) || tree->file(filePath) >= 0) {
             continue;
         }
 
         /**
-         * get file info and skip NON-files
+         * skip NON-files, if the listing can contain them
          */
-        QFileInfo fileInfo(filePath);
-        if (!fileInfo.isFile()) {
+        if (!onlyFiles && !QFileInfo(filePath).isFile()) {
             continue;
         }
 
-        /**
-         * construct the item with right directory prefix
-         * already hang in directories in tree
-         */
-        KateProjectItem *fileItem = new KateProjectItem(KateProjectItem::File, fileInfo.fileName());
-        fileItem->setData(filePath, Qt::ToolTipRole);
-
-        // get the directory's relative path to the base directory
-        QString dirRelPath = dir.relativeFilePath(fileInfo.absolutePath());
+        // get the directory's relative path to the base directory, cheap for the common case of files below it
+        const int slashIndex = filePath.lastIndexOf(QLatin1Char('/'));
+        const QString absolutePath = filePath.left(slashIndex);
+        QString dirRelPath;
+        if (filePath.startsWith(dirPrefix)) {
+            dirRelPath = absolutePath.mid(dirPrefix.size());
+        } else if (absolutePath + QLatin1Char('/') != dirPrefix) {
+            dirRelPath = dir.relativeFilePath(absolutePath);
+        }
         // if the relative path is ".", clean it up
         if (dirRelPath == QLatin1Char('.')) {
             dirRelPath = QString();
         }
 
-        item2ParentPath.append(QPair<QStandardItem *, QStandardItem *>(fileItem, directoryParent(dir2Item, dirRelPath)));
-        fileItem->setData(filePath, Qt::UserRole);
-        (*file2Item)[filePath] = fileItem;
+        parentAndFile.append(qMakePair(directoryParent(tree, dir2Node, baseDir, dirRelPath), filePath));
     }
 
     /**
-     * plug in the file items to the tree
+     * plug in the files to the tree
      */
-    auto i = item2ParentPath.constBegin();
-    while (i != item2ParentPath.constEnd()) {
-        i->second->appendRow(i->first);
-        ++i;
+    for (const auto &file : qAsConst(parentAndFile)) {
+        const int slashIndex = file.second.lastIndexOf(QLatin1Char('/'));
+        tree->append(file.first, KateProjectTree::File, file.second.mid(slashIndex + 1), file.second.left(slashIndex));
     }
 }
 
-QStringList KateProjectWorker::findFiles(const QDir &dir, const QVariantMap &filesEntry)
+QStringList KateProjectWorker::findFiles(const QDir &dir, const QVariantMap &filesEntry, bool useCache)
 {
     const bool recursive = !filesEntry.contains(QLatin1String("recursive")) || filesEntry[QStringLiteral("recursive")].toBool();
 
     if (filesEntry[QStringLiteral("git")].toBool()) {
-        return filesFromGit(dir, recursive);
+        return filesFromGit(dir, recursive, useCache);
     } else if (filesEntry[QStringLiteral("hg")].toBool()) {
         return filesFromMercurial(dir, recursive);
     } else if (filesEntry[QStringLiteral("svn")].toBool()) {
@@ -245,12 +330,146 @@ QStringList KateProjectWorker::findFiles(const QDir &dir, const QVariantMap &fil
     }
 }
 
-QStringList KateProjectWorker::filesFromGit(const QDir &dir, bool recursive)
+/**
+ * Find the git directory of a working copy, handles the .git files of worktrees and submodules.
+ * @param dir directory inside of the working copy
+ * @return git directory or empty string if none found
+ */
+static QString gitDirectory(const QDir &dir)
+{
+    QDir current(dir);
+    do {
+        const QFileInfo dotGit(current, QStringLiteral(".git"));
+        if (dotGit.isDir()) {
+            return dotGit.absoluteFilePath();
+        }
+        if (dotGit.isFile()) {
+            QFile file(dotGit.absoluteFilePath());
+            if (!file.open(QIODevice::ReadOnly)) {
+                return QString();
+            }
+            const QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if (!line.startsWith(QLatin1String("gitdir:"))) {
+                return QString();
+            }
+            return current.absoluteFilePath(line.mid(7).trimmed());
+        }
+    } while (current.cdUp());
+    return QString();
+}
+
+static void addGitState(const QString &gitDir, QCryptographicHash &key);
+
+/**
+ * Add the states of the submodule git directories below @p modulesDir.
+ * Submodule names can contain slashes, git directories are found by their HEAD at any depth.
+ */
+static void addSubmoduleStates(const QString &modulesDir, QCryptographicHash &key)
+{
+    const QDir modules(modulesDir);
+    const QStringList entries = modules.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString &entry : entries) {
+        const QString path = modules.absoluteFilePath(entry);
+        key.addData(entry.toUtf8());
+        if (QFileInfo::exists(path + QStringLiteral("/HEAD"))) {
+            addGitState(path, key);
+        } else {
+            addSubmoduleStates(path, key);
+        }
+    }
+}
+
+/**
+ * Add the state of a git directory to the key of the file list cache.
+ * That is the index, which changes on each staging, and HEAD with the commit it points to.
+ * Recurses into the git directories of the submodules.
+ */
+static void addGitState(const QString &gitDir, QCryptographicHash &key)
+{
+    const QDir dir(gitDir);
+    for (const QString &name : {QStringLiteral("index"), QStringLiteral("HEAD"), QStringLiteral("packed-refs")}) {
+        const QFileInfo info(dir, name);
+        key.addData(name.toUtf8());
+        key.addData(QByteArray::number(info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1));
+        key.addData(QByteArray::number(info.size()));
+    }
+
+    QFile head(dir.absoluteFilePath(QStringLiteral("HEAD")));
+    if (head.open(QIODevice::ReadOnly)) {
+        const QByteArray ref = head.readAll().trimmed();
+        key.addData(ref);
+        if (ref.startsWith("ref: ")) {
+            QFile refFile(dir.absoluteFilePath(QString::fromUtf8(ref.mid(5))));
+            if (refFile.open(QIODevice::ReadOnly)) {
+                key.addData(refFile.readAll());
+            }
+        }
+    }
+
+    addSubmoduleStates(dir.absoluteFilePath(QStringLiteral("modules")), key);
+}
+
+QStringList KateProjectWorker::filesFromGit(const QDir &dir, bool recursive, bool useCache)
 {
     /**
-     * query files via ls-files and make them absolute afterwards
+     * the file list only changes with the index or HEAD, reuse the one of the last run if they are the same
+     * key and file name of the cache are hashes of the git state and of the directory
+     */
+    QByteArray cacheKey;
+    QString cacheFile;
+    if (useCache) {
+        const QString gitDir = gitDirectory(dir);
+        if (!gitDir.isEmpty()) {
+            QCryptographicHash key(QCryptographicHash::Sha1);
+            addGitState(gitDir, key);
+            cacheKey = key.result();
+            const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/kateproject");
+            const QByteArray dirHash = QCryptographicHash::hash(dir.absolutePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+            cacheFile = cacheDir + QLatin1Char('/') + QString::fromLatin1(dirHash) + QStringLiteral(".gitfiles");
+        }
+    }
+
+    QStringList relFiles;
+    bool cached = false;
+    if (!cacheFile.isEmpty()) {
+        QFile file(cacheFile);
+        if (file.open(QIODevice::ReadOnly)) {
+            QDataStream in(&file);
+            quint32 magic = 0;
+            quint32 version = 0;
+            QByteArray key;
+            in >> magic >> version;
+            if (magic == GitCacheMagic && version == GitCacheVersion) {
+                in.setVersion(QDataStream::Qt_5_0);
+                in >> key;
+                if (key == cacheKey) {
+                    in >> relFiles;
+                    cached = in.status() == QDataStream::Ok;
+                }
+            }
+        }
+    }
+
+    /**
+     * query files via ls-files and remember them for the next time
+     */
+    if (!cached) {
+        relFiles = gitLsFiles(dir);
+        if (!cacheFile.isEmpty() && !relFiles.isEmpty() && QDir().mkpath(QFileInfo(cacheFile).absolutePath())) {
+            QSaveFile file(cacheFile);
+            if (file.open(QIODevice::WriteOnly)) {
+                QDataStream out(&file);
+                out << GitCacheMagic << GitCacheVersion;
+                out.setVersion(QDataStream::Qt_5_0);
+                out << cacheKey << relFiles;
+                file.commit();
+            }
+        }
+    }
+
+    /**
+     * make them absolute
      */
-    const QStringList relFiles = gitLsFiles(dir);
     QStringList files;
     for (const QString &relFile : relFiles) {
         if (!recursive && (relFile.indexOf(QLatin1Char('/')) != -1)) {
@@ -270,9 +489,12 @@ QStringList KateProjectWorker::gitLsFiles(const QDir &dir)
      *
      * use --recurse-submodules, there since git 2.11 (released 2016)
      * our own submodules handling code leads to file duplicates
+     *
+     * use --stage to get the modes, submodules that are not checked out are listed as gitlinks, no files
+     * with that, the listed files need no check on disk
      */
     QStringList args;
-    args << QStringLiteral("ls-files") << QStringLiteral("-z") << QStringLiteral("--recurse-submodules") << QStringLiteral(".");
+    args << QStringLiteral("ls-files") << QStringLiteral("-z") << QStringLiteral("--stage") << QStringLiteral("--recurse-submodules") << QStringLiteral(".");
 
     QProcess git;
     git.setWorkingDirectory(dir.absolutePath());
@@ -282,9 +504,21 @@ QStringList KateProjectWorker::gitLsFiles(const QDir &dir)
         return files;
     }
 
+    /**
+     * each entry is "<mode> <object> <stage>\t<file>"
+     * files with merge conflicts have one entry per stage, these are consecutive
+     */
     const QList<QByteArray> byteArrayList = git.readAllStandardOutput().split('\0');
     for (const QByteArray &byteArray : byteArrayList) {
-        files << QString::fromUtf8(byteArray);
+        const int tabIndex = byteArray.indexOf('\t');
+        if (tabIndex < 0 || byteArray.startsWith("160000 ")) {
+            continue;
+        }
+
+        const QString file = QString::fromUtf8(byteArray.constData() + tabIndex + 1, byteArray.size() - tabIndex - 1);
+        if (files.isEmpty() || files.last() != file) {
+            files << file;
+        }
     }
 
     return files;
@@ -487,7 +721,52 @@ void KateProjectWorker::loadIndex(const QStringList &files, bool force)
      * create new index, this will do the loading in the constructor
      * wrap it into shared pointer for transfer to main thread
      */
-    KateProjectSharedProjectIndex index(new KateProjectIndex(m_baseDir, m_indexDir, files, ctagsMap, force));
+    KateProjectSharedProjectIndex index(new KateProjectIndex(m_baseDir, indexDirectory(), files, ctagsMap, force));
 
     emit loadIndexDone(index);
 }
+
+QString KateProjectWorker::indexDirectory() const
+{
+    if (!m_indexDir.isEmpty()) {
+        return m_indexDir;
+    }
+
+    const QString indexDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/kateproject");
+    QDir().mkpath(indexDir);
+    return indexDir;
+}
+
+void KateProjectWorker::loadTrigramIndex(const QStringList &files)
+{
+    /**
+     * the trigram index follows the global index setting, too
+     * can be switched on and off and moved per project
+     */
+    const QVariantMap searchIndexMap = m_projectMap[QStringLiteral("search_index")].toMap();
+    bool indexEnabled = !m_indexDir.isEmpty();
+    auto indexValue = searchIndexMap[QStringLiteral("enable")];
+    if (!indexValue.isNull()) {
+        indexEnabled = indexValue.toBool();
+    }
+    if (!indexEnabled) {
+        emit loadTrigramIndexDone(KateProjectSharedTrigramIndex());
+        return;
+    }
+
+    /**
+     * unlike the ctags index this one is always persistent, it is updated incrementally on the next load
+     * default to a file per project base directory inside the index directory
+     */
+    QString indexFile = searchIndexMap[QStringLiteral("index_file")].toString();
+    if (indexFile.isEmpty()) {
+        const QByteArray baseDirHash = QCryptographicHash::hash(m_baseDir.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+        indexFile = indexDirectory() + QStringLiteral("/kate.project.") + QString::fromLatin1(baseDirHash) + QStringLiteral(".trigrams");
+    } else if (!QDir::isAbsolutePath(indexFile)) {
+        indexFile = QDir(m_baseDir).absoluteFilePath(indexFile);
+    }
+
+    KateProjectSharedTrigramIndex index(new KateProjectTrigramIndex(indexFile, files));
+
+    emit loadTrigramIndexDone(index);
+}
@@ -22,12 +22,12 @@
 #define KATE_PROJECT_WORKER_H
 
 #include "kateproject.h"
-#include "kateprojectitem.h"
+#include "kateprojecttree.h"
 
 #include <ThreadWeaver/Job>
 
 #include <QMap>
-#include <QStandardItemModel>
+#include <QVector>
 
 class QDir;
 
@@ -40,36 +40,58 @@ class KateProjectWorker : public QObject, public ThreadWeaver::Job
     Q_OBJECT
 
 public:
-    /**
-     * Type for QueuedConnection
-     */
-    typedef QMap<QString, KateProjectItem *> MapString2Item;
-
     explicit KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force);
 
     void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
 
+    /**
+     * Create the job enumerating the files of all files entries, one job per entry running concurrently.
+     * It must run before this worker, e.g. in a ThreadWeaver::Sequence, the worker only builds the model.
+     * @return new collection job, the caller takes ownership
+     */
+    ThreadWeaver::JobInterface *createEnumerationJob();
+
+    /**
+     * Find the files of one files entry.
+     * @param dir directory of the files entry
+     * @param filesEntry files entry specification
+     * @param useCache use the persistent cache of the file lists of git working copies
+     * @return absolute paths of all found files, might include non-files
+     */
+    static QStringList findFiles(const QDir &dir, const QVariantMap &filesEntry, bool useCache = false);
+
 Q_SIGNALS:
-    void loadDone(KateProjectSharedQStandardItem topLevel, KateProjectSharedQMapStringItem file2Item);
+    void loadDone(KateProjectSharedTree tree, KateProjectSharedFilesEntries filesEntries);
     void loadIndexDone(KateProjectSharedProjectIndex index);
+    void loadTrigramIndexDone(KateProjectSharedTrigramIndex index);
 
 private:
     /**
      * Load one project inside the project tree.
-     * Fill data from JSON storage to model and recurse to sub-projects.
-     * @param parent parent standard item in the model
+     * Fill data from JSON storage to tree and recurse to sub-projects.
+     * @param tree tree to fill
+     * @param parent parent node in the tree
+     * @param project variant map for this group
+     * @param filesEntries all loaded files entries, will be filled
+     */
+    void loadProject(KateProjectTree *tree, int parent, const QVariantMap &project, QVector<KateProjectFilesEntry> *filesEntries);
+
+    /**
+     * Collect all files entries of a project and its sub-projects, in the order loadProject visits them.
      * @param project variant map for this group
-     * @param file2Item mapping file => item, will be filled
+     * @param filesEntries files entries, will be filled
      */
-    void loadProject(QStandardItem *parent, const QVariantMap &project, QMap<QString, KateProjectItem *> *file2Item);
+    static void collectFilesEntries(const QVariantMap &project, QVector<QVariantMap> *filesEntries);
 
     /**
-     * Load one files entry in the current parent item.
-     * @param parent parent standard item in the model
+     * Load one files entry in the current parent node.
+     * Uses the files enumerated for the next files entry by the enumeration job.
+     * @param tree tree to fill
+     * @param parent parent node in the tree
      * @param filesEntry one files entry specification to load
-     * @param file2Item mapping file => item, will be filled
+     * @param filesEntries all loaded files entries, will be filled
      */
-    void loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QMap<QString, KateProjectItem *> *file2Item);
+    void loadFilesEntry(KateProjectTree *tree, int parent, const QVariantMap &filesEntry, QVector<KateProjectFilesEntry> *filesEntries);
 
     /**
      * Load index for whole project.
@@ -77,15 +99,24 @@ private:
      */
     void loadIndex(const QStringList &files, bool force);
 
-    QStringList findFiles(const QDir &dir, const QVariantMap &filesEntry);
+    /**
+     * Load and update the trigram index used to narrow down searches.
+     * @param files list of all project files to index
+     */
+    void loadTrigramIndex(const QStringList &files);
+
+    /**
+     * @return index directory, our directory in the cache location if the index is only enabled by the project
+     */
+    QString indexDirectory() const;
 
-    QStringList filesFromGit(const QDir &dir, bool recursive);
-    QStringList filesFromMercurial(const QDir &dir, bool recursive);
-    QStringList filesFromSubversion(const QDir &dir, bool recursive);
-    QStringList filesFromDarcs(const QDir &dir, bool recursive);
-    QStringList filesFromDirectory(const QDir &dir, bool recursive, const QStringList &filters);
+    static QStringList filesFromGit(const QDir &dir, bool recursive, bool useCache);
+    static QStringList filesFromMercurial(const QDir &dir, bool recursive);
+    static QStringList filesFromSubversion(const QDir &dir, bool recursive);
+    static QStringList filesFromDarcs(const QDir &dir, bool recursive);
+    static QStringList filesFromDirectory(const QDir &dir, bool recursive, const QStringList &filters);
 
-    QStringList gitLsFiles(const QDir &dir);
+    static QStringList gitLsFiles(const QDir &dir);
 
 private:
     /**
@@ -105,6 +136,17 @@ private:
 
     const QVariantMap m_projectMap;
     const bool m_force;
+
+    /**
+     * all files entries and their files, filled by the enumeration job
+     */
+    QVector<QVariantMap> m_filesEntryMaps;
+    QVector<QStringList> m_entryFiles;
+
+    /**
+     * next files entry to load
+     */
+    int m_entryIndex = 0;
 };
 
 #endif
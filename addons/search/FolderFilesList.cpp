@@ -20,39 +20,57 @@
 
 #include "FolderFilesList.h"
 
-#include <QDebug>
 #include <QDir>
+#include <QDirIterator>
+#include <QFile>
 #include <QFileInfo>
-#include <QFileInfoList>
-#include <QMimeDatabase>
-#include <QMimeType>
+#include <QRunnable>
+#include <QThread>
 
-FolderFilesList::FolderFilesList(QObject *parent)
-    : QThread(parent)
+class FolderFilesListJob : public QRunnable
 {
-}
+public:
+    FolderFilesListJob(FolderFilesList *owner, const QString &dirPath)
+        : m_owner(owner)
+        , m_dirPath(dirPath)
+    {
+    }
 
-FolderFilesList::~FolderFilesList()
+    void run() override
+    {
+        m_owner->scanDirectory(m_dirPath);
+    }
+
+private:
+    FolderFilesList *m_owner;
+    QString m_dirPath;
+};
+
+FolderFilesList::FolderFilesList(QObject *parent)
+    : QObject(parent)
 {
-    m_cancelSearch = true;
-    wait();
+    // reading directories mostly waits for the disk, a few jobs in parallel hide that
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
 }
 
-void FolderFilesList::run()
+FolderFilesList::~FolderFilesList()
 {
-    m_files.clear();
-
-    QFileInfo folderInfo(m_folder);
-    checkNextItem(folderInfo);
-
-    if (m_cancelSearch)
-        m_files.clear();
+    m_cancelSearch.storeRelease(1);
+    m_pool.waitForDone();
 }
 
 void FolderFilesList::generateList(const QString &folder, bool recursive, bool hidden, bool symlinks, bool binary, const QString &types, const QString &excludes)
 {
-    m_cancelSearch = false;
-    m_folder = folder;
+    // results of a listing still running are not wanted any more
+    m_cancelSearch.storeRelease(1);
+    m_pool.waitForDone();
+    m_generation.fetchAndAddOrdered(1);
+
+    // without symbolic links all paths below the canonical folder are canonical, too
+    m_folder = QFileInfo(folder).canonicalFilePath();
+    if (m_folder.isEmpty()) {
+        m_folder = folder;
+    }
     if (!m_folder.endsWith(QLatin1Char('/'))) {
         m_folder += QLatin1Char('/');
     }
@@ -61,89 +79,192 @@ void FolderFilesList::generateList(const QString &folder, bool recursive, bool h
     m_symlinks = symlinks;
     m_binary = binary;
 
-    m_types.clear();
-    const auto typesList = types.split(QLatin1Char(','), QString::SkipEmptyParts);
-    for (const QString &type : typesList) {
-        m_types << type.trimmed();
-    }
-    if (m_types.isEmpty()) {
-        m_types << QStringLiteral("*");
+    // all wildcards are compiled into one expression each, instead of matching them one by one
+    QStringList typesList = types.split(QLatin1Char(','), QString::SkipEmptyParts);
+    if (typesList.isEmpty()) {
+        typesList << QStringLiteral("*");
     }
+    m_types = QRegularExpression(wildcardsToRegExp(typesList), QRegularExpression::CaseInsensitiveOption);
+    m_types.optimize();
 
-    QStringList tmpExcludes = excludes.split(QLatin1Char(','));
-    m_excludeList.clear();
-    for (int i = 0; i < tmpExcludes.size(); i++) {
-        QRegExp rx(tmpExcludes[i].trimmed());
-        rx.setPatternSyntax(QRegExp::Wildcard);
-        m_excludeList << rx;
-    }
+    m_excludes = QRegularExpression(wildcardsToRegExp(excludes.split(QLatin1Char(','), QString::SkipEmptyParts)));
+    m_excludes.optimize();
+
+    m_pendingFiles.clear();
+    m_visitedDirs.clear();
+    // a symbolic link back to the folder itself is a loop, too
+    m_visitedDirs.insert(QFileInfo(m_folder).canonicalFilePath());
+    m_flushTime.start();
+    m_time.start();
 
-    m_time.restart();
-    start();
+    m_cancelSearch.storeRelease(0);
+    startDirectory(m_folder);
 }
 
-QStringList FolderFilesList::fileList()
+void FolderFilesList::cancelSearch()
 {
-    return m_files;
+    m_cancelSearch.storeRelease(1);
 }
 
-void FolderFilesList::cancelSearch()
+QString FolderFilesList::wildcardsToRegExp(const QStringList &wildcards)
 {
-    m_cancelSearch = true;
+    // same syntax as QRegExp::Wildcard: * and ? span directories, [...] is a set
+    QStringList alternatives;
+    for (const QString &wildcard : wildcards) {
+        const QString trimmed = wildcard.trimmed();
+        if (trimmed.isEmpty()) {
+            continue;
+        }
+
+        QString rx;
+        for (int i = 0; i < trimmed.size(); ++i) {
+            const QChar c = trimmed.at(i);
+            if (c == QLatin1Char('*')) {
+                rx += QLatin1String(".*");
+            } else if (c == QLatin1Char('?')) {
+                rx += QLatin1Char('.');
+            } else if (c == QLatin1Char('[') && trimmed.indexOf(QLatin1Char(']'), i + 2) > i) {
+                const int end = trimmed.indexOf(QLatin1Char(']'), i + 2);
+                QString set = trimmed.mid(i + 1, end - i - 1);
+                if (set.startsWith(QLatin1Char('!'))) {
+                    set[0] = QLatin1Char('^');
+                }
+                set.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+                rx += QLatin1Char('[') + set + QLatin1Char(']');
+                i = end;
+            } else {
+                rx += QRegularExpression::escape(QString(c));
+            }
+        }
+        alternatives << rx;
+    }
+
+    // an empty pattern would match everything, use one that never matches
+    if (alternatives.isEmpty()) {
+        return QStringLiteral("(?!)");
+    }
+    return QStringLiteral("^(?:%1)$").arg(alternatives.join(QLatin1Char('|')));
 }
 
-void FolderFilesList::checkNextItem(const QFileInfo &item)
+bool FolderFilesList::isBinary(const QString &fileName)
 {
-    if (m_cancelSearch) {
-        return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return true;
     }
-    if (m_time.elapsed() > 100) {
-        m_time.restart();
-        emit searching(item.absoluteFilePath());
+
+    // text files don't contain NUL bytes, unless they are UTF-16 or UTF-32 with a BOM
+    const QByteArray head = file.read(4096);
+    if (head.size() >= 2 && ((uchar(head[0]) == 0xFF && uchar(head[1]) == 0xFE) || (uchar(head[0]) == 0xFE && uchar(head[1]) == 0xFF))) {
+        return false;
     }
-    if (item.isFile()) {
-        if (!m_binary) {
-            QMimeType mimeType = QMimeDatabase().mimeTypeForFile(item);
-            if (!mimeType.inherits(QStringLiteral("text/plain"))) {
-                return;
-            }
-        }
-        m_files << item.canonicalFilePath();
-    } else {
-        QDir currentDir(item.absoluteFilePath());
+    if (head.size() >= 4 && !head[0] && !head[1] && uchar(head[2]) == 0xFE && uchar(head[3]) == 0xFF) {
+        return false;
+    }
+    return head.contains('\0');
+}
 
-        if (!currentDir.isReadable()) {
-            // qDebug() << currentDir.absolutePath() << "Not readable";
-            return;
-        }
+void FolderFilesList::startDirectory(const QString &dirPath)
+{
+    m_runningJobs.ref();
+    m_pool.start(new FolderFilesListJob(this, dirPath));
+}
+
+void FolderFilesList::scanDirectory(const QString &dirPath)
+{
+    QStringList files;
 
+    if (!m_cancelSearch.loadAcquire()) {
         QDir::Filters filter = QDir::Files | QDir::NoDotAndDotDot | QDir::Readable;
         if (m_hidden)
             filter |= QDir::Hidden;
         if (m_recursive)
-            filter |= QDir::AllDirs;
+            filter |= QDir::Dirs;
         if (!m_symlinks)
             filter |= QDir::NoSymLinks;
 
-        // sort the items to have an deterministic order!
-        const QFileInfoList currentItems = currentDir.entryInfoList(m_types, filter, QDir::Name | QDir::LocaleAware);
+        // a plain directory listing, no sorting and no name filters
+        QDirIterator it(dirPath, filter);
+        while (it.hasNext() && !m_cancelSearch.loadAcquire()) {
+            it.next();
+            const QString fileName = it.fileName();
+            const QString path = dirPath + fileName;
 
-        bool skip;
-        for (const auto &currentItem : currentItems) {
-            skip = false;
-            for (const auto &regex : qAsConst(m_excludeList)) {
-                QString matchString = currentItem.filePath();
-                if (currentItem.filePath().startsWith(m_folder)) {
-                    matchString = currentItem.filePath().mid(m_folder.size());
-                }
-                if (regex.exactMatch(matchString)) {
-                    skip = true;
-                    break;
+            if (m_excludes.match(path.midRef(m_folder.size())).hasMatch()) {
+                continue;
+            }
+
+            const QFileInfo info = it.fileInfo();
+            if (info.isDir()) {
+                // symbolic links might lead into a loop
+                if (m_symlinks) {
+                    QMutexLocker locker(&m_pendingMutex);
+                    const QString canonicalPath = info.canonicalFilePath();
+                    if (m_visitedDirs.contains(canonicalPath)) {
+                        continue;
+                    }
+                    m_visitedDirs.insert(canonicalPath);
                 }
+                startDirectory(path + QLatin1Char('/'));
+                continue;
+            }
+
+            if (!m_types.match(fileName).hasMatch()) {
+                continue;
             }
-            if (!skip) {
-                checkNextItem(currentItem);
+            if (!m_binary && isBinary(path)) {
+                continue;
             }
+            files << (m_symlinks ? info.canonicalFilePath() : path);
+        }
+    }
+
+    deliverFiles(files, dirPath, false);
+
+    // the last job to finish ends the listing
+    if (!m_runningJobs.deref()) {
+        deliverFiles(QStringList(), dirPath, true);
+    }
+}
+
+void FolderFilesList::deliverFiles(const QStringList &files, const QString &dirPath, bool last)
+{
+    QStringList batch;
+    bool showStatus = false;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        m_pendingFiles += files;
+        if (last || m_pendingFiles.size() >= 256 || m_flushTime.elapsed() > 50) {
+            batch.swap(m_pendingFiles);
+            m_flushTime.restart();
+        }
+        if (m_time.elapsed() > 100) {
+            m_time.restart();
+            showStatus = true;
         }
     }
+
+    if (showStatus) {
+        emit searching(dirPath);
+    }
+    if (batch.isEmpty() && !last) {
+        return;
+    }
+
+    // hand over to our thread, dropping anything of an abandoned listing
+    const int generation = m_generation.loadAcquire();
+    QMetaObject::invokeMethod(
+        this,
+        [this, batch, last, generation]() {
+            if (generation != m_generation.loadAcquire()) {
+                return;
+            }
+            if (!batch.isEmpty()) {
+                emit filesFound(batch);
+            }
+            if (last) {
+                emit finished();
+            }
+        },
+        Qt::QueuedConnection);
 }
@@ -21,14 +21,23 @@
 #ifndef FolderFilesList_h
 #define FolderFilesList_h
 
+#include <QAtomicInt>
 #include <QElapsedTimer>
-#include <QFileInfo>
-#include <QRegExp>
+#include <QMutex>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSet>
 #include <QStringList>
-#include <QThread>
-#include <QVector>
+#include <QThreadPool>
 
-class FolderFilesList : public QThread
+/**
+ * Lists the files of a folder for searching.
+ *
+ * Every directory is read by its own job in a thread pool, sub-directories are
+ * queued as new jobs. The found files are reported in batches while the listing
+ * runs, in no particular order.
+ */
+class FolderFilesList : public QObject
 {
     Q_OBJECT
 
@@ -36,32 +45,44 @@ public:
     FolderFilesList(QObject *parent = nullptr);
     ~FolderFilesList() override;
 
-    void run() override;
-
     void generateList(const QString &folder, bool recursive, bool hidden, bool symlinks, bool binary, const QString &types, const QString &excludes);
 
-    QStringList fileList();
-
 public Q_SLOTS:
     void cancelSearch();
 
 Q_SIGNALS:
     void searching(const QString &path);
+    void filesFound(const QStringList &files);
+    void finished();
 
 private:
-    void checkNextItem(const QFileInfo &item);
+    friend class FolderFilesListJob;
+
+    void startDirectory(const QString &dirPath);
+    void scanDirectory(const QString &dirPath);
+    void deliverFiles(const QStringList &files, const QString &dirPath, bool last);
+    static bool isBinary(const QString &fileName);
+    static QString wildcardsToRegExp(const QStringList &wildcards);
 
 private:
+    QThreadPool m_pool;
     QString m_folder;
-    QStringList m_files;
-    bool m_cancelSearch;
+    QAtomicInt m_cancelSearch{1};
+    QAtomicInt m_runningJobs;
+    QAtomicInt m_generation;
+
+    bool m_recursive = false;
+    bool m_hidden = false;
+    bool m_symlinks = false;
+    bool m_binary = false;
+    QRegularExpression m_types;
+    QRegularExpression m_excludes;
 
-    bool m_recursive;
-    bool m_hidden;
-    bool m_symlinks;
-    bool m_binary;
-    QStringList m_types;
-    QVector<QRegExp> m_excludeList;
+    // everything below is protected by m_pendingMutex
+    QMutex m_pendingMutex;
+    QStringList m_pendingFiles;
+    QSet<QString> m_visitedDirs;
+    QElapsedTimer m_flushTime;
     QElapsedTimer m_time;
 };
 
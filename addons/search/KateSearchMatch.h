@@ -0,0 +1,44 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef KateSearchMatch_h
+#define KateSearchMatch_h
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+/**
+ * One match inside a file or document, as produced by the search backends.
+ * Matches are handed to the view in batches of one file each.
+ */
+struct KateSearchMatch {
+    QString lineContent;
+    int matchLen;
+    int startLine;
+    int startColumn;
+    int endLine;
+    int endColumn;
+};
+
+Q_DECLARE_METATYPE(KateSearchMatch)
+Q_DECLARE_METATYPE(QVector<KateSearchMatch>)
+
+#endif
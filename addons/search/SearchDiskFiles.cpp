@@ -19,69 +19,229 @@
  */
 
 #include "SearchDiskFiles.h"
+#include "SearchMultiLine.h"
 
 #include <QDir>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QTextCodec>
 #include <QTextStream>
+#include <QThread>
 #include <QUrl>
 
+#include <cstring>
+
+static bool hasUtf16Or32Bom(const char *begin, const char *end)
+{
+    return end - begin >= 2
+        && ((uchar(begin[0]) == 0xFF && uchar(begin[1]) == 0xFE) || (uchar(begin[0]) == 0xFE && uchar(begin[1]) == 0xFF)
+            || (end - begin >= 4 && !begin[0] && !begin[1] && uchar(begin[2]) == 0xFE && uchar(begin[3]) == 0xFF));
+}
+
+class SearchDiskFilesWorker : public QRunnable
+{
+public:
+    explicit SearchDiskFilesWorker(SearchDiskFiles *owner)
+        : m_owner(owner)
+    {
+    }
+
+    void run() override
+    {
+        m_owner->runWorker();
+    }
+
+private:
+    SearchDiskFiles *m_owner;
+};
+
 SearchDiskFiles::SearchDiskFiles(QObject *parent)
-    : QThread(parent)
+    : QObject(parent)
 {
+    qRegisterMetaType<QVector<KateSearchMatch>>("QVector<KateSearchMatch>");
 }
 
 SearchDiskFiles::~SearchDiskFiles()
 {
-    m_cancelSearch = true;
-    wait();
+    cancelSearch();
+    m_pool.waitForDone();
 }
 
-void SearchDiskFiles::startSearch(const QStringList &files, const QRegularExpression &regexp)
+void SearchDiskFiles::startSearch(const QStringList &files, const QRegularExpression &regexp, const UnchangedFiles &skipIfUnchanged)
 {
     if (files.empty()) {
         emit searchDone();
         return;
     }
-    m_cancelSearch = false;
-    m_files = files;
+
+    start(regexp, qBound(1, QThread::idealThreadCount(), files.size()), skipIfUnchanged);
+    addFiles(files);
+    endOfFiles();
+}
+
+void SearchDiskFiles::startSearch(const QRegularExpression &regexp)
+{
+    start(regexp, qMax(1, QThread::idealThreadCount()));
+}
+
+void SearchDiskFiles::start(const QRegularExpression &regexp, int workerCount, const UnchangedFiles &skipIfUnchanged)
+{
+    // a canceled search might still have workers winding down
+    cancelSearch();
+    m_pool.waitForDone();
+
     m_regExp = regexp;
-    m_matchCount = 0;
+    m_skipIfUnchanged = skipIfUnchanged;
+    m_prefilter = SearchPrefilter(m_regExp);
+    m_files.clear();
+    m_nextFile = 0;
+    m_filesComplete = false;
+    m_results.clear();
+    m_fileDone.clear();
+    m_nextToEmit = 0;
+
+    m_pool.setMaxThreadCount(workerCount);
+    m_runningWorkers.storeRelease(workerCount);
+    m_cancelSearch.storeRelease(0);
     m_statusTime.restart();
-    start();
+
+    for (int i = 0; i < workerCount; ++i) {
+        m_pool.start(new SearchDiskFilesWorker(this));
+    }
 }
 
-void SearchDiskFiles::run()
+void SearchDiskFiles::addFiles(const QStringList &files)
 {
-    for (const QString &fileName : qAsConst(m_files)) {
-        if (m_cancelSearch) {
-            break;
+    QMutexLocker locker(&m_resultMutex);
+    if (m_filesComplete || files.isEmpty()) {
+        return;
+    }
+
+    m_files += files;
+    m_results.resize(m_files.size());
+    m_fileDone.resize(m_files.size());
+    m_filesAdded.wakeAll();
+}
+
+void SearchDiskFiles::endOfFiles()
+{
+    QMutexLocker locker(&m_resultMutex);
+    m_filesComplete = true;
+    m_filesAdded.wakeAll();
+}
+
+bool SearchDiskFiles::claimChunk(int &first, QStringList &chunk)
+{
+    QMutexLocker locker(&m_resultMutex);
+
+    while (!m_cancelSearch.loadAcquire() && m_nextFile >= m_files.size() && !m_filesComplete) {
+        m_filesAdded.wait(&m_resultMutex);
+    }
+    if (m_cancelSearch.loadAcquire() || m_nextFile >= m_files.size()) {
+        return false;
+    }
+
+    // small chunks keep the workers balanced, bigger ones keep the publishing overhead down
+    const int available = m_files.size() - m_nextFile;
+    const int chunkSize = qBound(1, available / (m_pool.maxThreadCount() * 16), 64);
+    first = m_nextFile;
+    chunk = m_files.mid(first, chunkSize);
+    m_nextFile += chunk.size();
+    return true;
+}
+
+void SearchDiskFiles::runWorker()
+{
+    const QRegularExpression regExp = m_regExp;
+    QVector<QVector<KateSearchMatch>> chunkResults;
+    QStringList chunk;
+    int first = 0;
+
+    while (claimChunk(first, chunk)) {
+        chunkResults.clear();
+        chunkResults.resize(chunk.size());
+        for (int i = 0; i < chunk.size(); ++i) {
+            if (m_cancelSearch.loadAcquire()) {
+                break;
+            }
+            if (!isUnchanged(chunk.at(i))) {
+                searchFile(chunk.at(i), regExp, chunkResults[i]);
+            }
         }
 
-        if (m_statusTime.elapsed() > 100) {
-            m_statusTime.restart();
-            emit searching(fileName);
+        if (!m_cancelSearch.loadAcquire()) {
+            publishChunk(first, chunkResults);
         }
+    }
+
+    // the last worker to leave reports the end of the search
+    if (m_runningWorkers.fetchAndSubOrdered(1) == 1) {
+        m_cancelSearch.storeRelease(1);
+        emit searchDone();
+    }
+}
+
+void SearchDiskFiles::publishChunk(int first, QVector<QVector<KateSearchMatch>> &chunkResults)
+{
+    QMutexLocker locker(&m_resultMutex);
 
-        if (m_regExp.pattern().contains(QLatin1String("\\n"))) {
-            searchMultiLineRegExp(fileName);
-        } else {
-            searchSingleLineRegExp(fileName);
+    for (int i = 0; i < chunkResults.size(); ++i) {
+        m_results[first + i] = std::move(chunkResults[i]);
+        m_fileDone[first + i] = true;
+    }
+
+    // emit all results that are now available in file list order
+    while (m_nextToEmit < m_fileDone.size() && m_fileDone.at(m_nextToEmit)) {
+        const QVector<KateSearchMatch> matches = std::move(m_results[m_nextToEmit]);
+        m_results[m_nextToEmit] = QVector<KateSearchMatch>();
+
+        if (!matches.isEmpty()) {
+            const QUrl fileUrl = QUrl::fromUserInput(m_files.at(m_nextToEmit));
+            emit matchesFound(fileUrl.toString(), fileUrl.fileName(), matches);
         }
+        m_nextToEmit++;
+    }
+
+    if (m_statusTime.elapsed() > 100) {
+        m_statusTime.restart();
+        emit searching(m_files.at(first));
     }
-    emit searchDone();
-    m_cancelSearch = true;
 }
 
 void SearchDiskFiles::cancelSearch()
 {
-    m_cancelSearch = true;
+    // under the lock, a worker might be about to wait for more files
+    QMutexLocker locker(&m_resultMutex);
+    m_cancelSearch.storeRelease(1);
+    m_filesComplete = true;
+    m_filesAdded.wakeAll();
 }
 
 bool SearchDiskFiles::searching()
 {
-    return !m_cancelSearch;
+    return !m_cancelSearch.loadAcquire();
 }
 
-void SearchDiskFiles::searchSingleLineRegExp(const QString &fileName)
+bool SearchDiskFiles::isUnchanged(const QString &fileName) const
+{
+    const auto it = m_skipIfUnchanged.constFind(fileName);
+    if (it == m_skipIfUnchanged.cend()) {
+        return false;
+    }
+    const QFileInfo info(fileName);
+    return info.lastModified().toMSecsSinceEpoch() == it->first && info.size() == it->second;
+}
+
+void SearchDiskFiles::searchFile(const QString &fileName, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
+{
+    if (regExp.pattern().contains(QLatin1String("\\n"))) {
+        searchMultiLineRegExp(fileName, regExp, matches);
+    } else {
+        searchSingleLineRegExp(fileName, regExp, matches);
+    }
+}
+
+void SearchDiskFiles::searchSingleLineRegExp(const QString &fileName, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
 {
     QFile file(fileName);
 
@@ -89,96 +249,182 @@ void SearchDiskFiles::searchSingleLineRegExp(const QString &fileName)
         return;
     }
 
+    const qint64 size = file.size();
+    if (size <= 0) {
+        // empty or not a regular file
+        searchSingleLineRegExpStream(file, regExp, matches);
+        return;
+    }
+
+    const uchar *mapped = file.map(0, size);
+    QByteArray content;
+    const char *begin;
+    if (mapped) {
+        begin = reinterpret_cast<const char *>(mapped);
+    } else {
+        content = file.readAll();
+        begin = content.constData();
+    }
+    const char *end = begin + (mapped ? size : content.size());
+
+    // UTF-16 and UTF-32 need the codec detection of QTextStream
+    if (hasUtf16Or32Bom(begin, end)) {
+        file.seek(0);
+        searchSingleLineRegExpStream(file, regExp, matches);
+        return;
+    }
+
+    // QTextStream skips the UTF-8 BOM too
+    if (end - begin >= 3 && uchar(begin[0]) == 0xEF && uchar(begin[1]) == 0xBB && uchar(begin[2]) == 0xBF) {
+        begin += 3;
+    }
+
+    searchSingleLineRegExp(begin, end, regExp, matches);
+}
+
+void SearchDiskFiles::searchSingleLineRegExp(const char *begin, const char *end, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
+{
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    int lineNumber = 0;
+    const char *counted = begin;
+    const char *pos = begin;
+
+    while (pos < end) {
+        if (m_cancelSearch.loadAcquire()) {
+            break;
+        }
+
+        // Jump to the next line containing the required literal. Most files and
+        // lines don't, those are never decoded nor seen by the regular expression.
+        const char *hit = m_prefilter.isValid() ? m_prefilter.find(pos, end) : pos;
+        if (!hit) {
+            break;
+        }
+
+        // pos always is at the start of a line
+        const char *lineStart = hit;
+        while (lineStart > pos && lineStart[-1] != '\n') {
+            lineStart--;
+        }
+        const char *lineEnd = static_cast<const char *>(memchr(hit, '\n', end - hit));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        for (const char *nl = counted; (nl = static_cast<const char *>(memchr(nl, '\n', lineStart - nl))); nl++) {
+            lineNumber++;
+        }
+        counted = lineStart;
+
+        // same line splitting as QTextStream::readLine()
+        const char *contentEnd = lineEnd;
+        if (contentEnd > lineStart && contentEnd[-1] == '\r') {
+            contentEnd--;
+        }
+        matchLine(codec->toUnicode(lineStart, int(contentEnd - lineStart)), lineNumber, regExp, matches);
+
+        pos = lineEnd + 1;
+    }
+}
+
+void SearchDiskFiles::searchSingleLineRegExpStream(QFile &file, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
+{
     QTextStream stream(&file);
     QString line;
     int i = 0;
-    int column;
-    QRegularExpressionMatch match;
     while (!(line = stream.readLine()).isNull()) {
-        if (m_cancelSearch)
+        if (m_cancelSearch.loadAcquire())
             break;
-        match = m_regExp.match(line);
-        column = match.capturedStart();
-        while (column != -1 && !match.captured().isEmpty()) {
-            // limit line length
-            if (line.length() > 1024)
-                line = line.left(1024);
-            QUrl fileUrl = QUrl::fromUserInput(fileName);
-            emit matchFound(fileUrl.toString(), fileUrl.fileName(), line, match.capturedLength(), i, column, i, column + match.capturedLength());
-
-            match = m_regExp.match(line, column + match.capturedLength());
-            column = match.capturedStart();
-            m_matchCount++;
-            // NOTE: This sleep is here so that the main thread will get a chance to
-            // handle any stop button clicks if there are a lot of matches
-            if (m_matchCount % 50)
-                msleep(1);
-        }
+        matchLine(line, i, regExp, matches);
         i++;
     }
 }
 
-void SearchDiskFiles::searchMultiLineRegExp(const QString &fileName)
+void SearchDiskFiles::matchLine(QString line, int lineNumber, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
+{
+    QRegularExpressionMatch match = regExp.match(line);
+    int column = match.capturedStart();
+    while (column != -1 && !match.captured().isEmpty()) {
+        // limit line length
+        if (line.length() > 1024)
+            line = line.left(1024);
+        matches.append({line, match.capturedLength(), lineNumber, column, lineNumber, column + match.capturedLength()});
+
+        match = regExp.match(line, column + match.capturedLength());
+        column = match.capturedStart();
+    }
+}
+
+void SearchDiskFiles::searchMultiLineRegExp(const QString &fileName, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
 {
     QFile file(fileName);
-    int column = 0;
-    int line = 0;
-    static QString fullDoc;
-    static QVector<int> lineStart;
-    QRegularExpression tmpRegExp = m_regExp;
 
     if (!file.open(QFile::ReadOnly)) {
         return;
     }
 
-    QTextStream stream(&file);
-    fullDoc = stream.readAll();
-    fullDoc.remove(QLatin1Char('\r'));
-
-    lineStart.clear();
-    lineStart << 0;
-    for (int i = 0; i < fullDoc.size() - 1; i++) {
-        if (fullDoc[i] == QLatin1Char('\n')) {
-            lineStart << i + 1;
-        }
-    }
-    if (tmpRegExp.pattern().endsWith(QLatin1Char('$'))) {
-        fullDoc += QLatin1Char('\n');
-        QString newPatern = tmpRegExp.pattern();
-        newPatern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
-        tmpRegExp.setPattern(newPatern);
+    const SearchMultiLine search(regExp);
+    auto canceled = [this]() {
+        return bool(m_cancelSearch.loadAcquire());
+    };
+
+    const qint64 size = file.size();
+    const uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    QByteArray content;
+    const char *begin;
+    if (mapped) {
+        begin = reinterpret_cast<const char *>(mapped);
+    } else {
+        content = file.readAll();
+        begin = content.constData();
     }
+    const char *end = begin + (mapped ? size : content.size());
 
-    QRegularExpressionMatch match;
-    match = tmpRegExp.match(fullDoc);
-    column = match.capturedStart();
-    while (column != -1 && !match.captured().isEmpty()) {
-        if (m_cancelSearch)
-            break;
-        // search for the line number of the match
-        int i;
-        line = -1;
-        for (i = 1; i < lineStart.size(); i++) {
-            if (lineStart[i] > column) {
-                line = i - 1;
-                break;
+    // UTF-16 and UTF-32 need the codec detection of QTextStream
+    if (hasUtf16Or32Bom(begin, end)) {
+        file.seek(0);
+        QTextStream stream(&file);
+        QStringList lines = stream.readAll().split(QLatin1Char('\n'));
+        for (QString &line : lines) {
+            if (line.endsWith(QLatin1Char('\r'))) {
+                line.chop(1);
             }
         }
-        if (line == -1) {
-            break;
-        }
-        QUrl fileUrl = QUrl::fromUserInput(fileName);
-        int startColumn = (column - lineStart[line]);
-        int endLine = line + match.captured().count(QLatin1Char('\n'));
-        int lastNL = match.captured().lastIndexOf(QLatin1Char('\n'));
-        int endColumn = lastNL == -1 ? startColumn + match.captured().length() : match.captured().length() - lastNL - 1;
-        emit matchFound(fileUrl.toString(), fileUrl.fileName(), fullDoc.mid(lineStart[line], column - lineStart[line]) + match.captured(), match.capturedLength(), line, startColumn, endLine, endColumn);
-        match = tmpRegExp.match(fullDoc, column + match.capturedLength());
-        column = match.capturedStart();
-        m_matchCount++;
-        // NOTE: This sleep is here so that the main thread will get a chance to
-        // handle any stop button clicks if there are a lot of matches
-        if (m_matchCount % 50)
-            msleep(1);
+        search.search(
+            lines.size(),
+            [&lines](int line) {
+                return lines.at(line);
+            },
+            0,
+            matches,
+            canceled);
+        return;
+    }
+
+    // QTextStream skips the UTF-8 BOM too
+    if (end - begin >= 3 && uchar(begin[0]) == 0xEF && uchar(begin[1]) == 0xBB && uchar(begin[2]) == 0xBF) {
+        begin += 3;
     }
+
+    // only the line offsets are collected, lines are decoded when their window is searched
+    QVector<const char *> lineStarts;
+    lineStarts.append(begin);
+    for (const char *nl = begin; (nl = static_cast<const char *>(memchr(nl, '\n', end - nl))); nl++) {
+        lineStarts.append(nl + 1);
+    }
+
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    search.search(
+        lineStarts.size(),
+        [&lineStarts, end, codec](int line) {
+            const char *lineStart = lineStarts.at(line);
+            const char *lineEnd = line + 1 < lineStarts.size() ? lineStarts.at(line + 1) - 1 : end;
+            if (lineEnd > lineStart && lineEnd[-1] == '\r') {
+                lineEnd--;
+            }
+            return codec->toUnicode(lineStart, int(lineEnd - lineStart));
+        },
+        0,
+        matches,
+        canceled);
 }
@@ -21,15 +21,33 @@
 #ifndef SearchDiskFiles_h
 #define SearchDiskFiles_h
 
+#include <QAtomicInt>
 #include <QElapsedTimer>
-#include <QFileInfo>
+#include <QFile>
+#include <QHash>
 #include <QMutex>
+#include <QObject>
+#include <QPair>
 #include <QRegularExpression>
 #include <QStringList>
-#include <QThread>
+#include <QThreadPool>
 #include <QVector>
+#include <QWaitCondition>
 
-class SearchDiskFiles : public QThread
+#include "KateSearchMatch.h"
+#include "SearchPrefilter.h"
+
+/**
+ * Searches a list of files on disk.
+ *
+ * The file list is shared by a set of workers running in a thread pool. Each
+ * worker claims a chunk of files from a common cursor, searches it into a
+ * private result buffer and publishes the buffer when the chunk is done.
+ * The list may still grow while the search runs, idle workers wait for more files.
+ * Published results are emitted strictly in file list order, one batch per
+ * file, so the receiver sees the same order as with a serial search.
+ */
+class SearchDiskFiles : public QObject
 {
     Q_OBJECT
 
@@ -37,28 +55,70 @@ public:
     SearchDiskFiles(QObject *parent = nullptr);
     ~SearchDiskFiles() override;
 
-    void startSearch(const QStringList &iles, const QRegularExpression &regexp);
-    void run() override;
+    /**
+     * Files that need no search as long as they are unchanged on disk, e.g. because an index rules them out.
+     * Maps a file to its modification time in ms since the epoch and its size.
+     */
+    typedef QHash<QString, QPair<qint64, qint64>> UnchangedFiles;
+
+    /**
+     * Search @p files.
+     * @param skipIfUnchanged files to skip if they are still in the given state, the workers check that
+     */
+    void startSearch(const QStringList &files, const QRegularExpression &regexp, const UnchangedFiles &skipIfUnchanged = UnchangedFiles());
+
+    /**
+     * Start a search for files that are not known yet.
+     * The files are passed with addFiles() while the search runs, it is done
+     * once endOfFiles() was called and all files are searched.
+     */
+    void startSearch(const QRegularExpression &regexp);
+    void addFiles(const QStringList &files);
+    void endOfFiles();
 
     bool searching();
 
 private:
-    void searchSingleLineRegExp(const QString &fileName);
-    void searchMultiLineRegExp(const QString &fileName);
+    friend class SearchDiskFilesWorker;
+
+    void start(const QRegularExpression &regexp, int workerCount, const UnchangedFiles &skipIfUnchanged = UnchangedFiles());
+    bool isUnchanged(const QString &fileName) const;
+    void runWorker();
+    bool claimChunk(int &first, QStringList &chunk);
+    void searchFile(const QString &fileName, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    void searchSingleLineRegExp(const QString &fileName, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    void searchSingleLineRegExp(const char *begin, const char *end, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    void searchSingleLineRegExpStream(QFile &file, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    void matchLine(QString line, int lineNumber, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    void searchMultiLineRegExp(const QString &fileName, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
+    void publishChunk(int first, QVector<QVector<KateSearchMatch>> &chunkResults);
 
 public Q_SLOTS:
     void cancelSearch();
 
 Q_SIGNALS:
-    void matchFound(const QString &url, const QString &docName, const QString &lineContent, int matchLen, int line, int column, int endLine, int endColumn);
+    void matchesFound(const QString &url, const QString &docName, const QVector<KateSearchMatch> &matches);
     void searchDone();
     void searching(const QString &file);
 
 private:
+    QThreadPool m_pool;
     QRegularExpression m_regExp;
+    SearchPrefilter m_prefilter;
+    // constant while workers run
+    UnchangedFiles m_skipIfUnchanged;
+    QAtomicInt m_cancelSearch{1};
+    QAtomicInt m_runningWorkers;
+
+    // everything below is protected by m_resultMutex
+    QMutex m_resultMutex;
+    QWaitCondition m_filesAdded;
     QStringList m_files;
-    bool m_cancelSearch = true;
-    int m_matchCount = 0;
+    int m_nextFile = 0;
+    bool m_filesComplete = true;
+    QVector<QVector<KateSearchMatch>> m_results;
+    QVector<bool> m_fileDone;
+    int m_nextToEmit = 0;
     QElapsedTimer m_statusTime;
 };
 
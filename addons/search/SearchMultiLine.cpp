@@ -0,0 +1,226 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "SearchMultiLine.h"
+
+#include <algorithm>
+
+// lines searched per window, the context lines come on top
+static const int WindowLines = 1024;
+
+SearchMultiLine::SearchMultiLine(const QRegularExpression &regExp)
+    : m_regExp(regExp)
+{
+    // a trailing '$' is meant to match at every line end, not only at the end of the text
+    // '$' is replaced with (?=\\n), which needs an extra newline after the last line
+    if (m_regExp.pattern().endsWith(QLatin1Char('$'))) {
+        QString pattern = m_regExp.pattern();
+        pattern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
+        m_regExp.setPattern(pattern);
+        m_keepFinalNewline = true;
+    }
+
+    m_maxLineSpan = maxLineSpan(m_regExp.pattern());
+}
+
+int SearchMultiLine::search(int lineCount,
+                            const std::function<QString(int)> &lineAt,
+                            int startLine,
+                            QVector<KateSearchMatch> &matches,
+                            const std::function<bool()> &shouldStop) const
+{
+    // end of the last match, the next one may not start before it
+    int lastEndLine = -1;
+    int lastEndColumn = 0;
+
+    QString subject;
+    QVector<int> lineStarts;
+
+    int windowStart = startLine;
+    while (windowStart < lineCount) {
+        // context before the window is for look-behinds, the one after it for the longest possible match
+        int contextStart = 0;
+        int windowEnd = lineCount;
+        int subjectEnd = lineCount;
+        if (m_maxLineSpan >= 0) {
+            contextStart = qMax(0, windowStart - m_maxLineSpan - 1);
+            windowEnd = qMin(lineCount, windowStart + WindowLines);
+            subjectEnd = qMin(lineCount, windowEnd + m_maxLineSpan + 1);
+        }
+
+        subject.clear();
+        lineStarts.clear();
+        for (int line = contextStart; line < subjectEnd; ++line) {
+            lineStarts.append(subject.size());
+            subject += lineAt(line);
+            subject += QLatin1Char('\n');
+        }
+        if (subjectEnd == lineCount && !m_keepFinalNewline) {
+            subject.chop(1);
+        }
+
+        // index of the line containing offset, relative to contextStart
+        auto lineIndex = [&lineStarts](int offset) {
+            return int(std::upper_bound(lineStarts.cbegin(), lineStarts.cend(), offset) - lineStarts.cbegin()) - 1;
+        };
+
+        int offset = lineStarts.at(windowStart - contextStart);
+        if (lastEndLine >= contextStart) {
+            offset = qMax(offset, lineStarts.at(lastEndLine - contextStart) + lastEndColumn);
+        }
+        // matches starting after the window are found again with the next one
+        const int windowEndOffset = windowEnd < subjectEnd ? lineStarts.at(windowEnd - contextStart) : subject.size() + 1;
+
+        int stopLine = -1;
+        QRegularExpressionMatch match = m_regExp.match(subject, offset);
+        while (match.hasMatch() && match.capturedStart() < windowEndOffset) {
+            // like the single line search, stop at the first empty match
+            if (match.capturedLength() == 0) {
+                return 0;
+            }
+
+            const int start = match.capturedStart();
+            const int startIndex = lineIndex(start);
+            const int line = contextStart + startIndex;
+            if (stopLine >= 0 && line > stopLine) {
+                break;
+            }
+
+            const int end = match.capturedEnd();
+            const int endIndex = lineIndex(end);
+            const int startColumn = start - lineStarts.at(startIndex);
+            lastEndLine = contextStart + endIndex;
+            lastEndColumn = end - lineStarts.at(endIndex);
+            matches.append({subject.mid(lineStarts.at(startIndex), startColumn) + match.captured(), match.capturedLength(), line, startColumn, lastEndLine, lastEndColumn});
+
+            // finish the line of the match, the caller can only continue at a line start
+            if (stopLine < 0 && shouldStop && shouldStop()) {
+                stopLine = line;
+            }
+            match = m_regExp.match(subject, end);
+        }
+
+        if (stopLine < 0 && !(shouldStop && shouldStop())) {
+            windowStart = windowEnd;
+            continue;
+        }
+
+        // don't continue inside of the last match
+        const int resumeLine = qMax(stopLine >= 0 ? stopLine + 1 : windowEnd, lastEndLine);
+        return resumeLine < lineCount ? resumeLine : 0;
+    }
+
+    return 0;
+}
+
+int SearchMultiLine::maxLineSpan(const QString &pattern)
+{
+    // count the \n of the pattern, alternatives just add up to an upper bound
+    // anything else that can match a line break or repeat one makes the span unknown
+    int span = 0;
+    bool lastAtomNewline = false;
+    QVector<bool> groupNewline;
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+
+        if (c == QLatin1Char('\\')) {
+            if (++i >= pattern.size()) {
+                return -1;
+            }
+            const QChar e = pattern.at(i);
+            if (e == QLatin1Char('n')) {
+                span++;
+                lastAtomNewline = true;
+                if (!groupNewline.isEmpty()) {
+                    groupNewline.last() = true;
+                }
+            } else if (e.isLetterOrNumber() && !QStringLiteral("tfraedwShNbBAzZG").contains(e)) {
+                // \s, \v, \R, \D, \W, \H, \p{..}, \x0a, back-references, ...
+                return -1;
+            } else {
+                lastAtomNewline = false;
+            }
+        } else if (c == QLatin1Char('\n')) {
+            span++;
+            lastAtomNewline = true;
+            if (!groupNewline.isEmpty()) {
+                groupNewline.last() = true;
+            }
+        } else if (c == QLatin1Char('[')) {
+            // a class can't match \n without spelling it or being negated, a literal newline is in no pattern typed in the search bar
+            int j = i + 1;
+            if (j < pattern.size() && pattern.at(j) == QLatin1Char('^')) {
+                return -1;
+            }
+            if (j < pattern.size() && pattern.at(j) == QLatin1Char(']')) {
+                j++;
+            }
+            for (; j < pattern.size() && pattern.at(j) != QLatin1Char(']'); ++j) {
+                if (pattern.at(j) == QLatin1Char('\\')) {
+                    if (++j >= pattern.size() || pattern.at(j).isLetterOrNumber()) {
+                        return -1;
+                    }
+                } else if (pattern.at(j) == QLatin1Char('[') && j + 1 < pattern.size() && pattern.at(j + 1) == QLatin1Char(':')) {
+                    // [:space:] and friends
+                    return -1;
+                }
+            }
+            if (j >= pattern.size()) {
+                return -1;
+            }
+            i = j;
+            lastAtomNewline = false;
+        } else if (c == QLatin1Char('(')) {
+            // only groups and look-arounds, inline options could switch on dot-all or multi-line anchors
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('*')) {
+                return -1;
+            }
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('?')) {
+                if (i + 2 >= pattern.size() || !QStringLiteral(":=!><'P").contains(pattern.at(i + 2))) {
+                    return -1;
+                }
+                // (?P=name) is a back-reference
+                if (pattern.at(i + 2) == QLatin1Char('P') && (i + 3 >= pattern.size() || pattern.at(i + 3) != QLatin1Char('<'))) {
+                    return -1;
+                }
+            }
+            groupNewline.append(false);
+            lastAtomNewline = false;
+        } else if (c == QLatin1Char(')')) {
+            if (groupNewline.isEmpty()) {
+                return -1;
+            }
+            lastAtomNewline = groupNewline.takeLast();
+            if (lastAtomNewline && !groupNewline.isEmpty()) {
+                groupNewline.last() = true;
+            }
+        } else if (c == QLatin1Char('*') || c == QLatin1Char('+') || c == QLatin1Char('{')) {
+            // repeated line breaks, "?" is fine, it only makes them optional
+            if (lastAtomNewline) {
+                return -1;
+            }
+        } else if (c != QLatin1Char('?')) {
+            lastAtomNewline = false;
+        }
+    }
+
+    return groupNewline.isEmpty() ? span : -1;
+}
@@ -0,0 +1,74 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef SearchMultiLine_h
+#define SearchMultiLine_h
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+#include "KateSearchMatch.h"
+
+/**
+ * Search for a regular expression that can match across lines.
+ *
+ * The text is given line by line and searched in windows of lines. Each window
+ * gets enough lines of context before and after it that every match starting
+ * inside the window is found exactly as in the whole text. If the number of
+ * lines a match can span is not bounded, the whole text is one window.
+ * Line numbers are looked up by binary search in the line offsets of the window.
+ *
+ * The object holds no state of a running search, one instance can be used by
+ * several threads at once.
+ */
+class SearchMultiLine
+{
+public:
+    explicit SearchMultiLine(const QRegularExpression &regExp);
+
+    /**
+     * Search lines [@p startLine, @p lineCount).
+     * @param lineAt returns the content of a line, without line break
+     * @param shouldStop polled after each match and window, the search stops at the next line
+     *        boundary once it returns true, may be empty
+     * @return 0 if all lines were searched, otherwise the line to continue at
+     */
+    int search(int lineCount,
+               const std::function<QString(int)> &lineAt,
+               int startLine,
+               QVector<KateSearchMatch> &matches,
+               const std::function<bool()> &shouldStop = std::function<bool()>()) const;
+
+    /**
+     * @return the number of line breaks a match of @p pattern can contain at most,
+     *         -1 if that can't be told
+     */
+    static int maxLineSpan(const QString &pattern);
+
+private:
+    QRegularExpression m_regExp;
+    bool m_keepFinalNewline = false;
+    int m_maxLineSpan = -1;
+};
+
+#endif
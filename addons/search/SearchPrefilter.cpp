@@ -0,0 +1,379 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "SearchPrefilter.h"
+
+#include <climits>
+#include <cstring>
+
+namespace
+{
+bool isAsciiAlpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool isAsciiAlphaNum(QChar c)
+{
+    return c.unicode() < 128 && (isAsciiAlpha(c.toLatin1()) || (c >= QLatin1Char('0') && c <= QLatin1Char('9')));
+}
+
+char asciiToLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+char asciiToUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? char(c - ('a' - 'A')) : c;
+}
+
+/**
+ * Rough frequency rank of a byte in source code and prose, higher is more common.
+ */
+int byteRank(char c)
+{
+    static const char common[] = "ZQJXKVBYWGPFMUCDLHRSNIOATE_zqjxkvbywgpfmucdlhrs9876543210\"'{}\t=();,.nioate ";
+    if (c == 0) {
+        return 0;
+    }
+    const char *p = strchr(common, c);
+    return p ? int(p - common) + 1 : 0;
+}
+
+/**
+ * @return the index of the ']' closing the character class starting at @p start, -1 if there is none
+ */
+int skipCharacterClass(const QString &pattern, int start)
+{
+    const int size = pattern.size();
+    int i = start + 1;
+    if (i < size && pattern.at(i) == QLatin1Char('^')) {
+        i++;
+    }
+    if (i < size && pattern.at(i) == QLatin1Char(']')) {
+        i++;
+    }
+    for (; i < size; i++) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('\\')) {
+            i++;
+        } else if (c == QLatin1Char('[') && i + 1 < size && pattern.at(i + 1) == QLatin1Char(':')) {
+            const int close = pattern.indexOf(QLatin1String(":]"), i + 2);
+            if (close < 0) {
+                return -1;
+            }
+            i = close + 1;
+        } else if (c == QLatin1Char(']')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parse a quantifier starting at @p pos.
+ * @param end receives the index of the last character of the quantifier
+ * @param minCount receives the minimum number of repetitions
+ * @return false if there is no quantifier at @p pos
+ */
+bool parseQuantifier(const QString &pattern, int pos, int *end, int *minCount)
+{
+    const int size = pattern.size();
+    if (pos >= size) {
+        return false;
+    }
+
+    const QChar c = pattern.at(pos);
+    if (c == QLatin1Char('*') || c == QLatin1Char('?')) {
+        *minCount = 0;
+        *end = pos;
+    } else if (c == QLatin1Char('+')) {
+        *minCount = 1;
+        *end = pos;
+    } else if (c == QLatin1Char('{')) {
+        int i = pos + 1;
+        int count = 0;
+        while (i < size && pattern.at(i).isDigit() && pattern.at(i).unicode() < 128) {
+            count = qMin(count * 10 + pattern.at(i).digitValue(), 1000000);
+            i++;
+        }
+        if (i == pos + 1) {
+            return false;
+        }
+        if (i < size && pattern.at(i) == QLatin1Char(',')) {
+            i++;
+            while (i < size && pattern.at(i).isDigit()) {
+                i++;
+            }
+        }
+        if (i >= size || pattern.at(i) != QLatin1Char('}')) {
+            return false;
+        }
+        *minCount = count;
+        *end = i;
+    } else {
+        return false;
+    }
+
+    // lazy and possessive variants
+    if (*end + 1 < size && (pattern.at(*end + 1) == QLatin1Char('?') || pattern.at(*end + 1) == QLatin1Char('+'))) {
+        (*end)++;
+    }
+    return true;
+}
+}
+
+SearchPrefilter::SearchPrefilter(const QRegularExpression &regExp)
+{
+    QString literal = requiredLiteral(regExp.pattern());
+    m_caseInsensitive = regExp.patternOptions() & QRegularExpression::CaseInsensitiveOption;
+
+    // Without case k and s also match the Kelvin sign and the long s, which
+    // have no ASCII bytes. Only the longest part without these is required.
+    if (m_caseInsensitive) {
+        QString part;
+        int start = 0;
+        for (int i = 0; i <= literal.size(); i++) {
+            if (i == literal.size() || QStringLiteral("kKsS").contains(literal.at(i))) {
+                if (i - start > part.size()) {
+                    part = literal.mid(start, i - start);
+                }
+                start = i + 1;
+            }
+        }
+        literal = part;
+    }
+
+    if (literal.isEmpty()) {
+        return;
+    }
+
+    m_needle = literal.toLatin1();
+    if (m_caseInsensitive) {
+        m_needle = m_needle.toLower();
+    }
+
+    // Scan for the rarest byte of the needle, so memchr() does not stop on every
+    // common letter. With case folding letters need two scans, prefer other bytes.
+    int bestRank = INT_MAX;
+    for (int i = 0; i < m_needle.size(); i++) {
+        const char c = m_needle.at(i);
+        int rank = byteRank(c);
+        if (m_caseInsensitive && isAsciiAlpha(c)) {
+            rank += 256;
+        }
+        if (rank < bestRank) {
+            bestRank = rank;
+            m_rareIndex = i;
+        }
+    }
+}
+
+const char *SearchPrefilter::find(const char *begin, const char *end) const
+{
+    const int n = m_needle.size();
+    if (n == 0) {
+        return begin;
+    }
+    if (end - begin < n) {
+        return nullptr;
+    }
+
+    const char *needle = m_needle.constData();
+    const char rare = needle[m_rareIndex];
+    const bool foldRare = m_caseInsensitive && isAsciiAlpha(rare);
+    const char rareUpper = asciiToUpper(rare);
+
+    // the rare byte of the last possible occurrence is right before scanEnd
+    const char *scanEnd = end - n + m_rareIndex + 1;
+    const char *pos = begin + m_rareIndex;
+    const char *nextRare = nullptr;
+    const char *nextRareUpper = nullptr;
+    bool scanned = false;
+
+    while (pos < scanEnd) {
+        // memchr() is vectorized in all libcs we care about, it does the heavy lifting
+        if (!scanned || (nextRare && nextRare < pos)) {
+            nextRare = static_cast<const char *>(memchr(pos, rare, scanEnd - pos));
+        }
+        if (foldRare && (!scanned || (nextRareUpper && nextRareUpper < pos))) {
+            nextRareUpper = static_cast<const char *>(memchr(pos, rareUpper, scanEnd - pos));
+        }
+        scanned = true;
+
+        const char *hit = nextRare;
+        if (foldRare && nextRareUpper && (!hit || nextRareUpper < hit)) {
+            hit = nextRareUpper;
+        }
+        if (!hit) {
+            return nullptr;
+        }
+
+        const char *start = hit - m_rareIndex;
+        bool found;
+        if (m_caseInsensitive) {
+            found = true;
+            for (int i = 0; i < n; i++) {
+                if (asciiToLower(start[i]) != needle[i]) {
+                    found = false;
+                    break;
+                }
+            }
+        } else {
+            found = memcmp(start, needle, n) == 0;
+        }
+        if (found) {
+            return start;
+        }
+        pos = hit + 1;
+    }
+    return nullptr;
+}
+
+QString SearchPrefilter::requiredLiteral(const QString &pattern)
+{
+    // \Q...\E quoting would need a parser of its own, don't bother
+    if (pattern.contains(QLatin1String("\\Q"))) {
+        return QString();
+    }
+
+    QString best;
+    QString current;
+    auto endRun = [&best, &current]() {
+        if (current.size() > best.size()) {
+            best = current;
+        }
+        current.clear();
+    };
+
+    const int size = pattern.size();
+    int depth = 0;
+    for (int i = 0; i < size; i++) {
+        const QChar c = pattern.at(i);
+
+        // only top level atoms are required, inside groups just track the nesting
+        if (depth > 0) {
+            if (c == QLatin1Char('\\')) {
+                i++;
+            } else if (c == QLatin1Char('[')) {
+                i = skipCharacterClass(pattern, i);
+                if (i < 0) {
+                    return QString();
+                }
+            } else if (c == QLatin1Char('(')) {
+                depth++;
+            } else if (c == QLatin1Char(')')) {
+                depth--;
+            }
+            continue;
+        }
+
+        QChar literal;
+        bool isLiteral = false;
+        bool isQuantifiable = true;
+
+        if (c == QLatin1Char('\\')) {
+            if (i + 1 >= size) {
+                return QString();
+            }
+            const QChar e = pattern.at(++i);
+            if (!isAsciiAlphaNum(e)) {
+                literal = e;
+                isLiteral = true;
+            } else if (e == QLatin1Char('t')) {
+                literal = QLatin1Char('\t');
+                isLiteral = true;
+            } else if (!QStringLiteral("dDwWsSbBhHvVRXAzZG").contains(e)) {
+                // escapes with arguments, back references, ...
+                return QString();
+            }
+        } else if (c == QLatin1Char('[')) {
+            i = skipCharacterClass(pattern, i);
+            if (i < 0) {
+                return QString();
+            }
+        } else if (c == QLatin1Char('(')) {
+            if (i + 1 < size && pattern.at(i + 1) == QLatin1Char('*')) {
+                // (*VERB)
+                return QString();
+            }
+            if (i + 2 < size && pattern.at(i + 1) == QLatin1Char('?')) {
+                const QChar o = pattern.at(i + 2);
+                if (o.isLetter() || o == QLatin1Char('-') || o == QLatin1Char('^')) {
+                    // inline options might change the case sensitivity
+                    return QString();
+                }
+            }
+            endRun();
+            depth++;
+            continue;
+        } else if (c == QLatin1Char(')') || c == QLatin1Char('|')) {
+            return QString();
+        } else if (c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$')) {
+            // any character or an anchor, ends the current literal
+        } else if (c == QLatin1Char('*') || c == QLatin1Char('+') || c == QLatin1Char('?')) {
+            // quantifier of a group or of a non-literal atom
+            isQuantifiable = false;
+            if (i + 1 < size && (pattern.at(i + 1) == QLatin1Char('?') || pattern.at(i + 1) == QLatin1Char('+'))) {
+                i++;
+            }
+        } else if (c == QLatin1Char('{')) {
+            int end;
+            int minCount;
+            if (parseQuantifier(pattern, i, &end, &minCount)) {
+                isQuantifiable = false;
+                i = end;
+            } else {
+                literal = c;
+                isLiteral = true;
+            }
+        } else {
+            literal = c;
+            isLiteral = true;
+        }
+
+        const bool ascii = isLiteral && literal.unicode() > 0 && literal.unicode() < 128;
+
+        int end;
+        int minCount;
+        if (isQuantifiable && parseQuantifier(pattern, i + 1, &end, &minCount)) {
+            // the atom is repeated, it is required at least once if minCount > 0
+            if (ascii && minCount > 0) {
+                current += literal;
+            }
+            endRun();
+            i = end;
+            continue;
+        }
+
+        if (ascii) {
+            current += literal;
+        } else {
+            endRun();
+        }
+    }
+
+    if (depth != 0) {
+        return QString();
+    }
+    endRun();
+    return best;
+}
@@ -0,0 +1,70 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef SearchPrefilter_h
+#define SearchPrefilter_h
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+
+/**
+ * Byte level prefilter for a regular expression.
+ *
+ * The prefilter holds a literal every match of the expression has to
+ * contain and finds it in raw bytes, without decoding them. Only ASCII
+ * literals are used, those have the same bytes in UTF-8 and in all the
+ * 8 bit encodings the files are read with.
+ */
+class SearchPrefilter
+{
+public:
+    SearchPrefilter() = default;
+    explicit SearchPrefilter(const QRegularExpression &regExp);
+
+    /**
+     * @return true if a literal could be extracted, false if every byte range has to be searched
+     */
+    bool isValid() const
+    {
+        return !m_needle.isEmpty();
+    }
+
+    /**
+     * Find the first occurrence of the literal in [begin, end).
+     * @return a pointer to the occurrence or nullptr if there is none
+     */
+    const char *find(const char *begin, const char *end) const;
+
+    /**
+     * Extract the longest ASCII literal that is part of every match of @p pattern,
+     * like "git grep" and ripgrep do.
+     * The extraction is conservative, if the pattern uses anything that is not
+     * understood an empty string is returned.
+     */
+    static QString requiredLiteral(const QString &pattern);
+
+private:
+    QByteArray m_needle;
+    bool m_caseInsensitive = false;
+    int m_rareIndex = 0;
+};
+
+#endif
@@ -0,0 +1,172 @@
+/*   Kate search plugin
+ *
+ * Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program in a file called COPYING; if not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "searchprefiltertest.h"
+#include "SearchPrefilter.h"
+
+#include <QtTest>
+
+QTEST_MAIN(SearchPrefilterTest)
+
+/**
+ * @return offset of the prefilter hit in @p data, -1 if there is none
+ */
+static int find(const SearchPrefilter &prefilter, const QByteArray &data, int from = 0, int to = -1)
+{
+    const char *begin = data.constData();
+    const char *hit = prefilter.find(begin + from, begin + (to < 0 ? data.size() : to));
+    return hit ? int(hit - begin) : -1;
+}
+
+void SearchPrefilterTest::testRequiredLiteral_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("literal");
+
+    QTest::newRow("plain") << QStringLiteral("foo") << QStringLiteral("foo");
+    QTest::newRow("escaped") << QStringLiteral("foo\\.bar") << QStringLiteral("foo.bar");
+    QTest::newRow("longest run") << QStringLiteral("ab.longer") << QStringLiteral("longer");
+    QTest::newRow("character class") << QStringLiteral("[fo]+bar") << QStringLiteral("bar");
+    QTest::newRow("group") << QStringLiteral("(foo)bar") << QStringLiteral("bar");
+    QTest::newRow("alternative") << QStringLiteral("foo|bar") << QString();
+    QTest::newRow("quoted") << QStringLiteral("\\Qfoo\\E") << QString();
+    QTest::newRow("inline option") << QStringLiteral("(?i)foo") << QString();
+    QTest::newRow("back reference") << QStringLiteral("(a)foo\\1") << QString();
+
+    // a quantified atom ends the literal, it is only part of it if required at least once
+    QTest::newRow("star") << QStringLiteral("ab*cd") << QStringLiteral("cd");
+    QTest::newRow("plus") << QStringLiteral("xab+c") << QStringLiteral("xab");
+    QTest::newRow("optional") << QStringLiteral("abc?") << QStringLiteral("ab");
+    QTest::newRow("lazy") << QStringLiteral("a*?bcd") << QStringLiteral("bcd");
+    QTest::newRow("possessive") << QStringLiteral("abc++d") << QStringLiteral("abc");
+    QTest::newRow("count") << QStringLiteral("x{3}yz") << QStringLiteral("yz");
+    QTest::newRow("zero count") << QStringLiteral("foo{0,2}bar") << QStringLiteral("bar");
+    QTest::newRow("range") << QStringLiteral("xy{2,5}") << QStringLiteral("xy");
+    QTest::newRow("no count") << QStringLiteral("a{b}") << QStringLiteral("a{b}");
+    QTest::newRow("quantified group") << QStringLiteral("(ab)+cde") << QStringLiteral("cde");
+    QTest::newRow("quantified class") << QStringLiteral("x[ab]{2}yz") << QStringLiteral("yz");
+}
+
+void SearchPrefilterTest::testRequiredLiteral()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, literal);
+
+    QCOMPARE(SearchPrefilter::requiredLiteral(pattern), literal);
+    QCOMPARE(SearchPrefilter(QRegularExpression(pattern)).isValid(), !literal.isEmpty());
+}
+
+void SearchPrefilterTest::testCaseInsensitive()
+{
+    const QByteArray data("say hELLo to Hello");
+
+    const SearchPrefilter sensitive(QRegularExpression(QStringLiteral("Hello")));
+    QCOMPARE(find(sensitive, data), 13);
+
+    const SearchPrefilter insensitive(QRegularExpression(QStringLiteral("Hello"), QRegularExpression::CaseInsensitiveOption));
+    QCOMPARE(find(insensitive, data), 4);
+    QCOMPARE(find(insensitive, data, 5), 13);
+    QCOMPARE(find(insensitive, QByteArray("HELLO")), 0);
+    QCOMPARE(find(insensitive, QByteArray("Hell no")), -1);
+
+    // characters without case are compared as they are
+    const SearchPrefilter symbols(QRegularExpression(QStringLiteral("a_1\\.B"), QRegularExpression::CaseInsensitiveOption));
+    QCOMPARE(find(symbols, QByteArray("A_1.b")), 0);
+    QCOMPARE(find(symbols, QByteArray("A-1.b")), -1);
+
+    // k and s also match non-ASCII characters without case, they are left out of the literal
+    const QByteArray kelvin = QString(QChar(0x212A)).toUtf8() + "elvin";
+    const SearchPrefilter kelvinFilter(QRegularExpression(QStringLiteral("kelvin"), QRegularExpression::CaseInsensitiveOption));
+    QVERIFY(kelvinFilter.isValid());
+    QCOMPARE(find(kelvinFilter, kelvin), 3);
+    const SearchPrefilter sFilter(QRegularExpression(QStringLiteral("s"), QRegularExpression::CaseInsensitiveOption));
+    QVERIFY(!sFilter.isValid());
+
+    // with case they are part of it
+    QCOMPARE(find(SearchPrefilter(QRegularExpression(QStringLiteral("kelvin"))), kelvin), -1);
+}
+
+void SearchPrefilterTest::testNonAscii()
+{
+    // only ASCII has the same bytes in all encodings, anything else needs a full scan
+    const QString umlauts = QString::fromUtf8("\xc3\xa4\xc3\xb6\xc3\xbc");
+    QVERIFY(SearchPrefilter::requiredLiteral(umlauts).isEmpty());
+    const SearchPrefilter prefilter(QRegularExpression(umlauts));
+    QVERIFY(!prefilter.isValid());
+
+    // an invalid prefilter doesn't skip anything
+    const QByteArray data("no umlauts here");
+    QCOMPARE(find(prefilter, data), 0);
+    QCOMPARE(find(prefilter, data, 3), 3);
+
+    // non-ASCII characters end a literal, the ASCII parts are still used
+    QCOMPARE(SearchPrefilter::requiredLiteral(QString::fromUtf8("gr\xc3\xb6\xc3\x9f" "er")), QStringLiteral("gr"));
+    QCOMPARE(SearchPrefilter::requiredLiteral(QString::fromUtf8("\xc3\xa4" "bc\xc3\xa4" "defg")), QStringLiteral("defg"));
+    QCOMPARE(SearchPrefilter::requiredLiteral(QStringLiteral("\\x{e4}foo")), QString());
+}
+
+void SearchPrefilterTest::testBoundaries()
+{
+    const SearchPrefilter prefilter(QRegularExpression(QStringLiteral("needle")));
+    const QByteArray data("needle in a haystack needle");
+
+    // an occurrence has to be completely inside of the range
+    QCOMPARE(find(prefilter, data, 0, 6), 0);
+    QCOMPARE(find(prefilter, data, 0, 5), -1);
+    QCOMPARE(find(prefilter, data, 1), 21);
+    QCOMPARE(find(prefilter, data, 21), 21);
+    QCOMPARE(find(prefilter, data, 22), -1);
+    QCOMPARE(find(prefilter, data, 1, 26), -1);
+    QCOMPARE(find(prefilter, data, 21, 21), -1);
+
+    // the same holds for a large buffer, wherever the range ends inside of the occurrence
+    // the search of a file continues at the start of the line, so the next range contains it
+    QByteArray big(100000, 'x');
+    for (int offset : {4093, 4096, 65533, 99994}) {
+        big.replace(offset, 6, "needle");
+        QCOMPARE(find(prefilter, big, offset - 10, offset + 3), -1);
+        QCOMPARE(find(prefilter, big, offset - 10), offset);
+        big.replace(offset, 6, "xxxxxx");
+    }
+
+    // partial occurrences don't hide the real one behind them, with and without case
+    const SearchPrefilter insensitive(QRegularExpression(QStringLiteral("needle"), QRegularExpression::CaseInsensitiveOption));
+    const QByteArray partial("neeDLneedLneedLE");
+    QCOMPARE(find(prefilter, partial), -1);
+    QCOMPARE(find(insensitive, partial), 10);
+}
+
+void SearchPrefilterTest::testMatchesRegExp()
+{
+    // every line the expression matches has to be found by the prefilter
+    const QStringList patterns = {QStringLiteral("foo\\w+bar"), QStringLiteral("ab+c"), QStringLiteral("x{2}y?z"), QStringLiteral("[0-9]+\\.[0-9]+e"), QStringLiteral("(a|b)cd")};
+    const QStringList lines = {QStringLiteral("foo_bar"), QStringLiteral("fooXbar"), QStringLiteral("abbbc"), QStringLiteral("ac"), QStringLiteral("xxz"), QStringLiteral("xxyz"), QStringLiteral("12.5e"), QStringLiteral("bcd"), QStringLiteral("ABC")};
+    for (const QString &pattern : patterns) {
+        for (const auto option : {QRegularExpression::NoPatternOption, QRegularExpression::CaseInsensitiveOption}) {
+            const QRegularExpression regExp(pattern, option);
+            const SearchPrefilter prefilter(regExp);
+            for (const QString &line : lines) {
+                if (regExp.match(line).hasMatch()) {
+                    QVERIFY2(find(prefilter, line.toUtf8()) >= 0, qPrintable(pattern + QLatin1Char(' ') + line));
+                }
+            }
+        }
+    }
+}
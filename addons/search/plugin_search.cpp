@@ -20,6 +20,7 @@
 
 #include "plugin_search.h"
 
+#include "SearchPrefilter.h"
 #include "htmldelegate.h"
 
 #include <ktexteditor/application.h>
@@ -48,6 +49,7 @@
 #include <QComboBox>
 #include <QCompleter>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QKeyEvent>
 #include <QMenu>
@@ -171,6 +173,15 @@ static void regexHelperActOnAction(QAction *resultAction, const QSet<QAction *>
     }
 }
 
+static const int contextLen = 70;
+
+// interval of adding matches to the tree and the main thread time spent per interval, in ms
+static const int MatchDeliveryInterval = 16;
+static const qint64 MaxMatchDeliveryTime = 8;
+
+// main thread time spent per slice of the search-as-you-type, in ms, keeps typing responsive
+static const qint64 TypingSearchSliceTime = 4;
+
 class TreeWidgetItem : public QTreeWidgetItem
 {
 public:
@@ -187,6 +198,134 @@ public:
     {
     }
 
+    /**
+     * File item, the displayed match count is built from @p header and StartLineRole.
+     */
+    TreeWidgetItem(QTreeWidgetItem *parent, const QString &header)
+        : QTreeWidgetItem(parent)
+        , m_fileHeader(header)
+    {
+    }
+
+    /**
+     * Match item. The match and its check state are kept in plain members,
+     * the item never allocates the role storage of QTreeWidgetItem. The html
+     * shown in the view is only built when the view asks for it. Matches in
+     * the same line share the line content.
+     */
+    TreeWidgetItem(QTreeWidgetItem *parent, const QString &url, const QString &fileName, const KateSearchMatch &match)
+        : QTreeWidgetItem(parent)
+        , m_isMatch(true)
+        , m_url(url)
+        , m_fileName(fileName)
+        , m_lineContent(match.lineContent)
+        , m_contentLine(match.startLine)
+        , m_contentColumn(match.startColumn)
+        , m_matchLen(match.matchLen)
+        , m_startLine(match.startLine)
+        , m_startColumn(match.startColumn)
+        , m_endLine(match.endLine)
+        , m_endColumn(match.endColumn)
+    {
+    }
+
+    QVariant data(int column, int role) const override
+    {
+        if (column != 0) {
+            return QTreeWidgetItem::data(column, role);
+        }
+
+        if (!m_fileHeader.isEmpty() && role == Qt::DisplayRole) {
+            return QStringLiteral("%1: <b>%2</b>").arg(m_fileHeader).arg(QTreeWidgetItem::data(0, ReplaceMatches::StartLineRole).toInt());
+        }
+
+        if (!m_isMatch) {
+            return QTreeWidgetItem::data(column, role);
+        }
+
+        switch (role) {
+        case Qt::DisplayRole: {
+            // replacing sets its own text
+            const QVariant text = QTreeWidgetItem::data(column, role);
+            if (text.isValid()) {
+                return text;
+            }
+            return i18n("Line: <b>%1</b> Column: <b>%2</b>: %3", m_contentLine + 1, m_contentColumn + 1, preMatch() + QStringLiteral("<b>") + match() + QStringLiteral("</b>") + postMatch());
+        }
+        case Qt::ToolTipRole:
+        case ReplaceMatches::FileUrlRole:
+            return m_url;
+        case ReplaceMatches::FileNameRole:
+            return m_fileName;
+        case ReplaceMatches::StartLineRole:
+            return m_startLine;
+        case ReplaceMatches::StartColumnRole:
+            return m_startColumn;
+        case ReplaceMatches::EndLineRole:
+            return m_endLine;
+        case ReplaceMatches::EndColumnRole:
+            return m_endColumn;
+        case ReplaceMatches::MatchLenRole:
+            return m_matchLen;
+        case ReplaceMatches::PreMatchRole:
+            return preMatch();
+        case ReplaceMatches::MatchRole:
+            return match();
+        case ReplaceMatches::PostMatchRole:
+            return postMatch();
+        case ReplaceMatches::ReplacedRole:
+            return m_replaced;
+        case ReplaceMatches::ReplacedTextRole:
+            return m_replaced ? QVariant(m_replacedText) : QVariant();
+        case Qt::CheckStateRole:
+            return int(m_checkState);
+        }
+        return QTreeWidgetItem::data(column, role);
+    }
+
+    void setData(int column, int role, const QVariant &value) override
+    {
+        if (!m_isMatch || column != 0) {
+            QTreeWidgetItem::setData(column, role, value);
+            return;
+        }
+
+        switch (role) {
+        case ReplaceMatches::StartLineRole:
+            m_startLine = value.toInt();
+            break;
+        case ReplaceMatches::StartColumnRole:
+            m_startColumn = value.toInt();
+            break;
+        case ReplaceMatches::EndLineRole:
+            m_endLine = value.toInt();
+            break;
+        case ReplaceMatches::EndColumnRole:
+            m_endColumn = value.toInt();
+            break;
+        case ReplaceMatches::ReplacedRole:
+            m_replaced = value.toBool();
+            break;
+        case ReplaceMatches::ReplacedTextRole:
+            m_replacedText = value.toString();
+            break;
+        case Qt::CheckStateRole:
+            m_checkState = static_cast<Qt::CheckState>(value.toInt());
+            emitDataChanged();
+            // tristate parents show the state of their children, like QTreeWidgetItem::setData() does
+            for (QTreeWidgetItem *p = parent(); p && (p->flags() & Qt::ItemIsAutoTristate); p = p->parent()) {
+                if (TreeWidgetItem *item = dynamic_cast<TreeWidgetItem *>(p)) {
+                    item->emitDataChanged();
+                }
+            }
+            return;
+        default:
+            QTreeWidgetItem::setData(column, role, value);
+            return;
+        }
+        emitDataChanged();
+    }
+
 private:
     bool operator<(const QTreeWidgetItem &other) const override
     {
@@ -211,6 +350,57 @@ private:
             return false;
         return data(0, ReplaceMatches::FileUrlRole).toString().toLower() < other.data(0, ReplaceMatches::FileUrlRole).toString().toLower();
     }
+
+    QString preMatch() const
+    {
+        int preLen = contextLen;
+        int preStart = m_contentColumn - preLen;
+        if (preStart < 0) {
+            preLen += preStart;
+            preStart = 0;
+        }
+        QString pre;
+        if (preLen == contextLen) {
+            pre = QStringLiteral("...");
+        }
+        pre += m_lineContent.mid(preStart, preLen).toHtmlEscaped();
+        return pre;
+    }
+
+    QString match() const
+    {
+        QString match = m_lineContent.mid(m_contentColumn, m_matchLen).toHtmlEscaped();
+        match.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+        return match;
+    }
+
+    QString postMatch() const
+    {
+        QString post = m_lineContent.mid(m_contentColumn + m_matchLen, contextLen);
+        if (post.size() >= contextLen) {
+            post += QStringLiteral("...");
+        }
+        return post.toHtmlEscaped();
+    }
+
+    QString m_fileHeader;
+
+    bool m_isMatch = false;
+    bool m_replaced = false;
+    Qt::CheckState m_checkState = Qt::Unchecked;
+    QString m_url;
+    QString m_fileName;
+    QString m_lineContent;
+    QString m_replacedText;
+    // position of the match inside m_lineContent, as found by the search
+    int m_contentLine = 0;
+    int m_contentColumn = 0;
+    int m_matchLen = 0;
+    // current position in the document, changes when replacing
+    int m_startLine = 0;
+    int m_startColumn = 0;
+    int m_endLine = 0;
+    int m_endColumn = 0;
 };
 
 Results::Results(QWidget *parent)
@@ -446,14 +636,15 @@ KatePluginSearchView::KatePluginSearchView(KTextEditor::Plugin *plugin, KTextEdi
 
     m_ui.displayOptions->setChecked(true);
 
-    connect(&m_searchOpenFiles, &SearchOpenFiles::matchFound, this, &KatePluginSearchView::matchFound);
+    connect(&m_searchOpenFiles, &SearchOpenFiles::matchesFound, this, &KatePluginSearchView::matchesFound);
     connect(&m_searchOpenFiles, &SearchOpenFiles::searchDone, this, &KatePluginSearchView::searchDone);
     connect(&m_searchOpenFiles, static_cast<void (SearchOpenFiles::*)(const QString &)>(&SearchOpenFiles::searching), this, &KatePluginSearchView::searching);
 
+    connect(&m_folderFilesList, &FolderFilesList::filesFound, this, &KatePluginSearchView::folderFilesFound);
     connect(&m_folderFilesList, &FolderFilesList::finished, this, &KatePluginSearchView::folderFileListChanged);
     connect(&m_folderFilesList, &FolderFilesList::searching, this, &KatePluginSearchView::searching);
 
-    connect(&m_searchDiskFiles, &SearchDiskFiles::matchFound, this, &KatePluginSearchView::matchFound);
+    connect(&m_searchDiskFiles, &SearchDiskFiles::matchesFound, this, &KatePluginSearchView::matchesFound);
     connect(&m_searchDiskFiles, &SearchDiskFiles::searchDone, this, &KatePluginSearchView::searchDone);
     connect(&m_searchDiskFiles, static_cast<void (SearchDiskFiles::*)(const QString &)>(&SearchDiskFiles::searching), this, &KatePluginSearchView::searching);
 
@@ -549,6 +740,14 @@ KatePluginSearchView::KatePluginSearchView(KTextEditor::Plugin *plugin, KTextEdi
     m_updateSumaryTimer.setInterval(1);
     m_updateSumaryTimer.setSingleShot(true);
     connect(&m_updateSumaryTimer, &QTimer::timeout, this, &KatePluginSearchView::updateResultsRootItem);
+
+    // results are added to the tree at most once per frame
+    m_matchDeliveryTimer.setInterval(MatchDeliveryInterval);
+    connect(&m_matchDeliveryTimer, &QTimer::timeout, this, &KatePluginSearchView::deliverPendingMatches);
+
+    m_typingSearchTimer.setSingleShot(true);
+    m_typingSearchTimer.setInterval(0);
+    connect(&m_typingSearchTimer, &QTimer::timeout, this, &KatePluginSearchView::continueSearchWhileTyping);
 }
 
 KatePluginSearchView::~KatePluginSearchView()
@@ -723,39 +922,52 @@ QStringList KatePluginSearchView::filterFiles(const QStringList &files) const
     return filteredFiles;
 }
 
-void KatePluginSearchView::folderFileListChanged()
+void KatePluginSearchView::folderFilesFound(const QStringList &files)
 {
-    m_searchDiskFilesDone = false;
-    m_searchOpenFilesDone = false;
+    // open documents are searched in memory once the listing is done, they might be modified
+    QStringList diskFiles;
+    diskFiles.reserve(files.size());
+    for (const QString &file : files) {
+        if (m_folderOpenFiles.contains(file)) {
+            m_folderOpenFilesFound << file;
+        } else {
+            diskFiles << file;
+        }
+    }
+    m_searchDiskFiles.addFiles(diskFiles);
+}
 
-    if (!m_curResults) {
-        qWarning() << "This is a bug";
-        m_searchDiskFilesDone = true;
+void KatePluginSearchView::folderFileListChanged()
+{
+    // the disk search was stopped while listing, nothing left to do
+    if (!m_curResults || !m_searchDiskFiles.searching()) {
+        m_searchDiskFiles.endOfFiles();
         m_searchOpenFilesDone = true;
+        m_folderOpenFiles.clear();
+        m_folderOpenFilesFound.clear();
         searchDone();
         return;
     }
-    QStringList fileList = m_folderFilesList.fileList();
 
     QList<KTextEditor::Document *> openList;
-    for (int i = 0; i < m_kateApp->documents().size(); i++) {
-        int index = fileList.indexOf(m_kateApp->documents()[i]->url().toLocalFile());
-        if (index != -1) {
-            openList << m_kateApp->documents()[i];
-            fileList.removeAt(index);
+    const auto docs = m_kateApp->documents();
+    for (const auto doc : docs) {
+        if (m_folderOpenFilesFound.remove(doc->url().toLocalFile())) {
+            openList << doc;
         }
     }
+    // documents closed meanwhile are searched on disk
+    m_searchDiskFiles.addFiles(m_folderOpenFilesFound.values());
+    m_searchDiskFiles.endOfFiles();
+    m_folderOpenFiles.clear();
+    m_folderOpenFilesFound.clear();
 
-    // search order is important: Open files starts immediately and should finish
-    // earliest after first event loop.
-    // The DiskFile might finish immediately
     if (!openList.empty()) {
         m_searchOpenFiles.startSearch(openList, m_curResults->regExp);
     } else {
         m_searchOpenFilesDone = true;
+        searchDone();
     }
-
-    m_searchDiskFiles.startSearch(fileList, m_curResults->regExp);
 }
 
 void KatePluginSearchView::searchPlaceChanged()
@@ -790,7 +1002,7 @@ void KatePluginSearchView::searchPlaceChanged()
 
 void KatePluginSearchView::addHeaderItem()
 {
-    QTreeWidgetItem *item = new QTreeWidgetItem(m_curResults->tree, QStringList());
+    TreeWidgetItem *item = new TreeWidgetItem(m_curResults->tree, QStringList());
     item->setCheckState(0, Qt::Checked);
     item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
     m_curResults->tree->expandItem(item);
@@ -802,17 +1014,6 @@ QTreeWidgetItem *KatePluginSearchView::rootFileItem(const QString &url, const QS
         return nullptr;
     }
 
-    QUrl fullUrl = QUrl::fromUserInput(url);
-    QString path = fullUrl.isLocalFile() ? localFileDirUp(fullUrl).path() : fullUrl.url();
-    if (!path.isEmpty() && !path.endsWith(QLatin1Char('/'))) {
-        path += QLatin1Char('/');
-    }
-    path.remove(m_resultBaseDir);
-    QString name = fullUrl.fileName();
-    if (url.isEmpty()) {
-        name = fName;
-    }
-
     // make sure we have a root item
     if (m_curResults->tree->topLevelItemCount() == 0) {
         addHeaderItem();
@@ -823,26 +1024,30 @@ QTreeWidgetItem *KatePluginSearchView::rootFileItem(const QString &url, const QS
         return root;
     }
 
-    for (int i = 0; i < root->childCount(); i++) {
-        // qDebug() << root->child(i)->data(0, ReplaceMatches::FileNameRole).toString() << fName;
-        if ((root->child(i)->data(0, ReplaceMatches::FileUrlRole).toString() == url) && (root->child(i)->data(0, ReplaceMatches::FileNameRole).toString() == fName)) {
-            int matches = root->child(i)->data(0, ReplaceMatches::StartLineRole).toInt() + 1;
-            QString tmpUrl = QStringLiteral("%1<b>%2</b>: <b>%3</b>").arg(path, name).arg(matches);
-            root->child(i)->setData(0, Qt::DisplayRole, tmpUrl);
-            root->child(i)->setData(0, ReplaceMatches::StartLineRole, matches);
-            return root->child(i);
-        }
+    QTreeWidgetItem *&fileItem = m_curResults->fileItems[qMakePair(url, fName)];
+    if (fileItem) {
+        return fileItem;
     }
 
     // file item not found create a new one
-    QString tmpUrl = QStringLiteral("%1<b>%2</b>: <b>%3</b>").arg(path, name).arg(1);
+    QUrl fullUrl = QUrl::fromUserInput(url);
+    QString path = fullUrl.isLocalFile() ? localFileDirUp(fullUrl).path() : fullUrl.url();
+    if (!path.isEmpty() && !path.endsWith(QLatin1Char('/'))) {
+        path += QLatin1Char('/');
+    }
+    path.remove(m_resultBaseDir);
+    QString name = fullUrl.fileName();
+    if (url.isEmpty()) {
+        name = fName;
+    }
 
-    TreeWidgetItem *item = new TreeWidgetItem(root, QStringList(tmpUrl));
+    TreeWidgetItem *item = new TreeWidgetItem(root, QStringLiteral("%1<b>%2</b>").arg(path, name));
     item->setData(0, ReplaceMatches::FileUrlRole, url);
     item->setData(0, ReplaceMatches::FileNameRole, fName);
-    item->setData(0, ReplaceMatches::StartLineRole, 1);
+    item->setData(0, ReplaceMatches::StartLineRole, 0);
     item->setCheckState(0, Qt::Checked);
     item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
+    fileItem = item;
     return item;
 }
 
@@ -927,49 +1132,95 @@ void KatePluginSearchView::addMatchMark(KTextEditor::Document *doc, QTreeWidgetI
     connect(doc, SIGNAL(aboutToInvalidateMovingInterfaceContent(KTextEditor::Document *)), this, SLOT(clearMarks()), Qt::UniqueConnection);
 }
 
-static const int contextLen = 70;
-
-void KatePluginSearchView::matchFound(const QString &url, const QString &fName, const QString &lineContent, int matchLen, int startLine, int startColumn, int endLine, int endColumn)
+void KatePluginSearchView::matchesFound(const QString &url, const QString &fileName, const QVector<KateSearchMatch> &searchMatches)
 {
-    if (!m_curResults) {
+    if (!m_curResults || searchMatches.isEmpty()) {
         return;
     }
-    int preLen = contextLen;
-    int preStart = startColumn - preLen;
-    if (preStart < 0) {
-        preLen += preStart;
-        preStart = 0;
-    }
-    QString pre;
-    if (preLen == contextLen) {
-        pre = QStringLiteral("...");
+
+    m_pendingMatches.append({url, fileName, searchMatches, 0});
+    if (!m_matchDeliveryTimer.isActive()) {
+        m_matchDeliveryTimer.start();
     }
-    pre += lineContent.mid(preStart, preLen).toHtmlEscaped();
-    QString match = lineContent.mid(startColumn, matchLen).toHtmlEscaped();
-    match.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
-    QString post = lineContent.mid(startColumn + matchLen, contextLen);
-    if (post.size() >= contextLen) {
-        post += QStringLiteral("...");
+}
+
+void KatePluginSearchView::addPendingMatches(qint64 timeBudget)
+{
+    QElapsedTimer time;
+    time.start();
+
+    while (!m_pendingMatches.isEmpty()) {
+        if (!m_curResults) {
+            m_pendingMatches.clear();
+            return;
+        }
+
+        PendingMatches &pending = m_pendingMatches.first();
+        QTreeWidgetItem *fileItem = rootFileItem(pending.url, pending.fileName);
+
+        QList<QTreeWidgetItem *> items;
+        while (pending.next < pending.matches.size()) {
+            TreeWidgetItem *item = new TreeWidgetItem(nullptr, pending.url, pending.fileName, pending.matches.at(pending.next++));
+            item->setCheckState(0, Qt::Checked);
+            items << item;
+            if (timeBudget >= 0 && items.size() % 64 == 0 && time.elapsed() >= timeBudget) {
+                break;
+            }
+        }
+
+        // one insertion per file and tick instead of one per match
+        fileItem->addChildren(items);
+        m_curResults->matches += items.size();
+        if (!m_isSearchAsYouType) {
+            fileItem->setData(0, ReplaceMatches::StartLineRole, fileItem->data(0, ReplaceMatches::StartLineRole).toInt() + items.size());
+        }
+
+        if (pending.next == pending.matches.size()) {
+            m_pendingMatches.removeFirst();
+        }
+        if (timeBudget >= 0 && time.elapsed() >= timeBudget) {
+            return;
+        }
     }
-    post = post.toHtmlEscaped();
-    QStringList row;
-    row << i18n("Line: <b>%1</b> Column: <b>%2</b>: %3", startLine + 1, startColumn + 1, pre + QStringLiteral("<b>") + match + QStringLiteral("</b>") + post);
+}
 
-    TreeWidgetItem *item = new TreeWidgetItem(rootFileItem(url, fName), row);
-    item->setData(0, ReplaceMatches::FileUrlRole, url);
-    item->setData(0, Qt::ToolTipRole, url);
-    item->setData(0, ReplaceMatches::FileNameRole, fName);
-    item->setData(0, ReplaceMatches::StartLineRole, startLine);
-    item->setData(0, ReplaceMatches::StartColumnRole, startColumn);
-    item->setData(0, ReplaceMatches::MatchLenRole, matchLen);
-    item->setData(0, ReplaceMatches::PreMatchRole, pre);
-    item->setData(0, ReplaceMatches::MatchRole, match);
-    item->setData(0, ReplaceMatches::PostMatchRole, post);
-    item->setData(0, ReplaceMatches::EndLineRole, endLine);
-    item->setData(0, ReplaceMatches::EndColumnRole, endColumn);
-    item->setCheckState(0, Qt::Checked);
+void KatePluginSearchView::deliverPendingMatches()
+{
+    addPendingMatches(MaxMatchDeliveryTime);
+
+    // the progress is coalesced the same way as the matches
+    if (!m_searchingFile.isEmpty() && m_curResults) {
+        QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
+        if (root) {
+            if (m_searchingFile.size() > 70) {
+                root->setData(0, Qt::DisplayRole, i18n("<b>Searching: ...%1</b>", m_searchingFile.right(70)));
+            } else {
+                root->setData(0, Qt::DisplayRole, i18n("<b>Searching: %1</b>", m_searchingFile));
+            }
+        }
+    }
+    m_searchingFile.clear();
+
+    if (m_pendingMatches.isEmpty()) {
+        m_matchDeliveryTimer.stop();
+        if (m_searchDonePending) {
+            m_searchDonePending = false;
+            searchDone();
+        } else if (m_typingSearch.donePending) {
+            m_typingSearch.donePending = false;
+            m_typingSearch.complete = true;
+            m_curResults = m_typingSearch.results;
+            searchWhileTypingDone();
+        }
+    }
+}
 
-    m_curResults->matches++;
+void KatePluginSearchView::clearPendingMatches()
+{
+    m_pendingMatches.clear();
+    m_searchingFile.clear();
+    m_searchDonePending = false;
+    m_matchDeliveryTimer.stop();
 }
 
 void KatePluginSearchView::clearMarks()
@@ -1025,6 +1276,7 @@ void KatePluginSearchView::startSearch()
         return;
     }
 
+    stopSearchWhileTyping();
     m_isSearchAsYouType = false;
 
     QString currentSearchText = m_ui.searchCombo->currentText();
@@ -1085,7 +1337,9 @@ void KatePluginSearchView::startSearch()
     m_ui.currentFolderButton->setDisabled(true);
 
     clearMarks();
+    clearPendingMatches();
     m_curResults->tree->clear();
+    m_curResults->fileItems.clear();
     m_curResults->tree->setCurrentItem(nullptr);
     m_curResults->matches = 0;
     disconnect(m_curResults->tree, &QTreeWidget::itemChanged, &m_updateSumaryTimer, nullptr);
@@ -1120,6 +1374,17 @@ void KatePluginSearchView::startSearch()
         if (!m_resultBaseDir.isEmpty() && !m_resultBaseDir.endsWith(QLatin1Char('/')))
             m_resultBaseDir += QLatin1Char('/');
         addHeaderItem();
+
+        // the files are searched while they are listed
+        m_folderOpenFiles.clear();
+        m_folderOpenFilesFound.clear();
+        const auto docs = m_kateApp->documents();
+        for (const auto doc : docs) {
+            if (doc->url().isLocalFile()) {
+                m_folderOpenFiles.insert(doc->url().toLocalFile());
+            }
+        }
+        m_searchDiskFiles.startSearch(reg);
         m_folderFilesList.generateList(m_ui.folderRequester->text(),
                                        m_ui.recursiveCheckBox->isChecked(),
                                        m_ui.hiddenCheckBox->isChecked(),
@@ -1127,7 +1392,7 @@ void KatePluginSearchView::startSearch()
                                        m_ui.binaryCheckBox->isChecked(),
                                        m_ui.filterCombo->currentText(),
                                        m_ui.excludeCombo->currentText());
-        // the file list will be ready when the thread returns (connected to folderFileListChanged)
+        // the files arrive in batches (folderFilesFound) until the listing is done (folderFileListChanged)
     } else if (inCurrentProject || inAllOpenProjects) {
         /**
          * init search with file list from current project, if any
@@ -1173,7 +1438,31 @@ void KatePluginSearchView::startSearch()
         } else {
             m_searchOpenFilesDone = true;
         }
-        m_searchDiskFiles.startSearch(files, reg);
+
+        // files on disk can only match if they contain the literal part of the pattern,
+        // the trigram index of the project rules out the others as long as they didn't change since indexing
+        // open documents are handled above, they might be modified
+        SearchDiskFiles::UnchangedFiles skipIfUnchanged;
+        if (m_projectPluginView && !files.isEmpty()) {
+            const QString literal = SearchPrefilter::requiredLiteral(reg.pattern());
+            if (literal.size() >= 3) {
+                QVariantHash ruledOut;
+                QMetaObject::invokeMethod(m_projectPluginView,
+                                          "filesNotContaining",
+                                          Qt::DirectConnection,
+                                          Q_RETURN_ARG(QVariantHash, ruledOut),
+                                          Q_ARG(QStringList, files),
+                                          Q_ARG(QString, literal));
+                skipIfUnchanged.reserve(ruledOut.size());
+                for (auto it = ruledOut.cbegin(); it != ruledOut.cend(); ++it) {
+                    const QVariantList state = it.value().toList();
+                    if (state.size() == 2) {
+                        skipIfUnchanged.insert(it.key(), qMakePair(state.at(0).toLongLong(), state.at(1).toLongLong()));
+                    }
+                }
+            }
+        }
+        m_searchDiskFiles.startSearch(files, reg, skipIfUnchanged);
     } else {
         Q_ASSERT_X(false, "KatePluginSearchView::startSearch", "case not handled");
     }
@@ -1247,10 +1536,26 @@ void KatePluginSearchView::startSearchWhileTyping()
     }
     m_ui.searchCombo->blockSignals(false);
 
+    // Only the lines with a match can match the extended text, remember them before clearing the tree
+    QVector<int> refineLines;
+    const bool refine = canRefineSearchWhileTyping(doc, currentSearchText, reg);
+    if (refine) {
+        QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
+        for (int i = 0; i < root->childCount(); i++) {
+            const int line = root->child(i)->data(0, ReplaceMatches::StartLineRole).toInt();
+            if (refineLines.isEmpty() || refineLines.last() != line) {
+                refineLines.append(line);
+            }
+        }
+    }
+
     // Prepare for the new search content
+    stopSearchWhileTyping();
     clearMarks();
     m_resultBaseDir.clear();
+    clearPendingMatches();
     m_curResults->tree->clear();
+    m_curResults->fileItems.clear();
     m_curResults->tree->setCurrentItem(nullptr);
     m_curResults->matches = 0;
 
@@ -1262,22 +1567,94 @@ void KatePluginSearchView::startSearchWhileTyping()
     item->setCheckState(0, Qt::Checked);
     item->setFlags(item->flags() | Qt::ItemIsAutoTristate);
 
-    // Do the search
-    int searchStoppedAt = m_searchOpenFiles.searchOpenFile(doc, reg, 0);
-    searchWhileTypingDone();
+    // Do the search, the first slice right away, the rest from the event loop
+    KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
+    m_typingSearch.results = m_curResults;
+    m_typingSearch.doc = doc;
+    m_typingSearch.revision = miface ? miface->revision() : -1;
+    m_typingSearch.text = currentSearchText;
+    m_typingSearch.regExp = reg;
+    m_typingSearch.plainText = !m_ui.useRegExp->isChecked();
+    m_typingSearch.lines = refineLines;
+    m_typingSearch.refining = refine;
+    m_typingSearch.next = 0;
+    m_typingSearch.running = true;
+    continueSearchWhileTyping();
+}
 
-    if (searchStoppedAt != 0) {
-        delete m_infoMessage;
-        const QString msg = i18n("Searching while you type was interrupted. It would have taken too long.");
-        m_infoMessage = new KTextEditor::Message(msg, KTextEditor::Message::Warning);
-        m_infoMessage->setPosition(KTextEditor::Message::TopInView);
-        m_infoMessage->setAutoHide(3000);
-        m_infoMessage->setAutoHideMode(KTextEditor::Message::Immediate);
-        m_infoMessage->setView(m_mainWindow->activeView());
-        m_mainWindow->activeView()->document()->postMessage(m_infoMessage);
+bool KatePluginSearchView::canRefineSearchWhileTyping(KTextEditor::Document *doc, const QString &text, const QRegularExpression &regExp) const
+{
+    // a plain text that got longer can only match where the shorter one did,
+    // as long as the document and the options did not change in between
+    const TypingSearch &last = m_typingSearch;
+    if (!last.complete || last.results != m_curResults || last.doc != doc || !last.plainText || m_ui.useRegExp->isChecked()) {
+        return false;
+    }
+    if (last.regExp.patternOptions() != regExp.patternOptions() || last.text.isEmpty() || !text.startsWith(last.text)) {
+        return false;
+    }
+    // the multi-line search is not line based
+    if (regExp.pattern().contains(QLatin1String("\\n"))) {
+        return false;
+    }
+    KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
+    return miface && miface->revision() == last.revision && m_curResults->tree->topLevelItemCount() == 1;
+}
+
+void KatePluginSearchView::continueSearchWhileTyping()
+{
+    TypingSearch &search = m_typingSearch;
+    if (!search.running) {
+        return;
+    }
+
+    // the document changed or went away, the next typed character starts over
+    KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(search.doc.data());
+    if (!search.results || !miface || miface->revision() != search.revision) {
+        stopSearchWhileTyping();
+        return;
+    }
+    m_curResults = search.results;
+
+    const bool firstSlice = search.next == 0;
+    int stoppedAt;
+    if (search.refining) {
+        stoppedAt = m_searchOpenFiles.searchOpenFileLines(search.doc, search.regExp, search.lines, search.next, TypingSearchSliceTime);
+    } else {
+        stoppedAt = m_searchOpenFiles.searchOpenFile(search.doc, search.regExp, search.next, TypingSearchSliceTime);
+    }
+
+    if (stoppedAt != 0) {
+        // let the matches stream in and the user type, then go on
+        search.next = stoppedAt;
+        m_typingSearchTimer.start();
+        return;
+    }
+
+    search.running = false;
+    search.lines.clear();
+
+    // a quick search shows all results at once, a long one lets the pending matches drain first
+    // the search can only be refined once all its matches are in the tree
+    if (firstSlice || m_pendingMatches.isEmpty()) {
+        addPendingMatches(-1);
+        m_matchDeliveryTimer.stop();
+        search.complete = true;
+        searchWhileTypingDone();
+    } else {
+        search.donePending = true;
     }
 }
 
+void KatePluginSearchView::stopSearchWhileTyping()
+{
+    m_typingSearchTimer.stop();
+    m_typingSearch.running = false;
+    m_typingSearch.complete = false;
+    m_typingSearch.donePending = false;
+    m_typingSearch.lines.clear();
+}
+
 void KatePluginSearchView::searchDone()
 {
     m_changeTimer.stop(); // avoid "while you type" search directly after
@@ -1293,6 +1670,13 @@ void KatePluginSearchView::searchDone()
         return;
     }
 
+    // finish once all matches are in the tree
+    if (!m_pendingMatches.isEmpty()) {
+        m_searchDonePending = true;
+        return;
+    }
+    m_searchingFile.clear();
+
     QWidget *fw = QApplication::focusWidget();
     // NOTE: we take the focus widget here before the enabling/disabling
     // moves the focus around.
@@ -1389,13 +1773,10 @@ void KatePluginSearchView::searching(const QString &file)
         return;
     }
 
-    QTreeWidgetItem *root = m_curResults->tree->topLevelItem(0);
-    if (root) {
-        if (file.size() > 70) {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Searching: ...%1</b>", file.right(70)));
-        } else {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Searching: %1</b>", file));
-        }
+    // shown by deliverPendingMatches()
+    m_searchingFile = file;
+    if (!m_matchDeliveryTimer.isActive()) {
+        m_matchDeliveryTimer.start();
     }
 }
 
@@ -1527,7 +1908,7 @@ void KatePluginSearchView::replaceChecked()
     m_replacer.replaceChecked(m_curResults->tree, m_curResults->regExp, m_curResults->replaceStr);
 }
 
-void KatePluginSearchView::replaceStatus(const QUrl &url, int replacedInFile, int matchesInFile)
+void KatePluginSearchView::replaceStatus(const QUrl &url, int processedMatches, int totalMatches)
 {
     if (!m_curResults) {
         // qDebug() << "m_curResults == nullptr";
@@ -1537,9 +1918,9 @@ void KatePluginSearchView::replaceStatus(const QUrl &url, int replacedInFile, in
     if (root) {
         QString file = url.toString(QUrl::PreferLocalFile);
         if (file.size() > 70) {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Processed %1 of %2 matches in: ...%3</b>", replacedInFile, matchesInFile, file.right(70)));
+            root->setData(0, Qt::DisplayRole, i18n("<b>Processed %1 of %2 matches in: ...%3</b>", processedMatches, totalMatches, file.right(70)));
         } else {
-            root->setData(0, Qt::DisplayRole, i18n("<b>Processed %1 of %2 matches in: %3</b>", replacedInFile, matchesInFile, file));
+            root->setData(0, Qt::DisplayRole, i18n("<b>Processed %1 of %2 matches in: %3</b>", processedMatches, totalMatches, file));
         }
     }
 }
@@ -2042,9 +2423,11 @@ void KatePluginSearchView::addTab()
 void KatePluginSearchView::tabCloseRequested(int index)
 {
     Results *tmp = qobject_cast<Results *>(m_ui.resultTabWidget->widget(index));
-    if (m_curResults == tmp) {
+    if (m_curResults == tmp || m_typingSearch.results == tmp) {
         m_searchOpenFiles.cancelSearch();
         m_searchDiskFiles.cancelSearch();
+        stopSearchWhileTyping();
+        clearPendingMatches();
     }
     if (m_ui.resultTabWidget->count() > 1) {
         delete tmp; // remove the tab
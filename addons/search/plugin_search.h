@@ -29,6 +29,10 @@
 #include <ktexteditor/mainwindow.h>
 #include <ktexteditor/sessionconfiginterface.h>
 
+#include <QHash>
+#include <QPair>
+#include <QPointer>
+#include <QSet>
 #include <QTimer>
 #include <QTreeWidget>
 
@@ -60,6 +64,8 @@ public:
     QString replaceStr;
     int searchPlaceIndex = 0;
     QString treeRootText;
+    // file items of the tree, keyed by url and document name
+    QHash<QPair<QString, QString>, QTreeWidgetItem *> fileItems;
 };
 
 // This class keeps the focus inside the S&R plugin when pressing tab/shift+tab by overriding focusNextPrevChild()
@@ -130,10 +136,13 @@ private Q_SLOTS:
 
     void searchPlaceChanged();
     void startSearchWhileTyping();
+    void continueSearchWhileTyping();
 
+    void folderFilesFound(const QStringList &files);
     void folderFileListChanged();
 
-    void matchFound(const QString &url, const QString &fileName, const QString &lineContent, int matchLen, int startLine, int startColumn, int endLine, int endColumn);
+    void matchesFound(const QString &url, const QString &fileName, const QVector<KateSearchMatch> &searchMatches);
+    void deliverPendingMatches();
 
     void addMatchMark(KTextEditor::Document *doc, QTreeWidgetItem *item);
 
@@ -151,7 +160,7 @@ private Q_SLOTS:
     void replaceSingleMatch();
     void replaceChecked();
 
-    void replaceStatus(const QUrl &url, int replacedInFile, int matchesInFile);
+    void replaceStatus(const QUrl &url, int processedMatches, int totalMatches);
     void replaceDone();
 
     void docViewChanged();
@@ -175,6 +184,10 @@ protected:
 
 private:
     QTreeWidgetItem *rootFileItem(const QString &url, const QString &fName);
+    void addPendingMatches(qint64 timeBudget);
+    void clearPendingMatches();
+    bool canRefineSearchWhileTyping(KTextEditor::Document *doc, const QString &text, const QRegularExpression &regExp) const;
+    void stopSearchWhileTyping();
     QStringList filterFiles(const QStringList &files) const;
 
     void onResize(const QSize &size);
@@ -196,11 +209,53 @@ private:
     bool m_isSearchAsYouType;
     bool m_isLeftRight;
     QString m_resultBaseDir;
+    QSet<QString> m_folderOpenFiles;
+    QSet<QString> m_folderOpenFilesFound;
     QList<KTextEditor::MovingRange *> m_matchRanges;
     QTimer m_changeTimer;
     QTimer m_updateSumaryTimer;
+
+    /**
+     * Matches reported by the search backends but not yet added to the tree.
+     * They are added by m_matchDeliveryTimer, a limited time per tick.
+     */
+    struct PendingMatches {
+        QString url;
+        QString fileName;
+        QVector<KateSearchMatch> matches;
+        int next;
+    };
+    QList<PendingMatches> m_pendingMatches;
+    QTimer m_matchDeliveryTimer;
+    QString m_searchingFile;
+    bool m_searchDonePending = false;
     QPointer<KTextEditor::Message> m_infoMessage;
 
+    /**
+     * The last search-as-you-type. It runs in time slices started by m_typingSearchTimer.
+     * If the next search text just extends a finished one, only the lines with matches
+     * are searched again.
+     */
+    struct TypingSearch {
+        QPointer<Results> results;
+        QPointer<KTextEditor::Document> doc;
+        qint64 revision = -1;
+        QString text;
+        QRegularExpression regExp;
+        bool plainText = false;
+        // lines to search when refining, otherwise the whole document is searched
+        QVector<int> lines;
+        bool refining = false;
+        // next line or next index into lines
+        int next = 0;
+        bool running = false;
+        // done and all matches are in the results tree
+        bool complete = false;
+        bool donePending = false;
+    };
+    TypingSearch m_typingSearch;
+    QTimer m_typingSearchTimer;
+
     /**
      * current project plugin view, if any
      */
@@ -20,30 +20,142 @@
 
 #include "replace_matches.h"
 
-#include <QTimer>
+#include <QFile>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThread>
 #include <QTreeWidgetItem>
+#include <QTextCodec>
+#include <QUrl>
 #include <klocalizedstring.h>
 
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+class ReplaceMatchesWorker : public QRunnable
+{
+public:
+    ReplaceMatchesWorker(ReplaceMatches *owner, const QSharedPointer<ReplaceMatches::FileReplace> &job)
+        : m_owner(owner)
+        , m_job(job)
+    {
+    }
+
+    void run() override
+    {
+        if (!m_owner->m_cancelReplace.loadAcquire()) {
+            if (m_job->inDocument) {
+                m_owner->computeReplacements(*m_job);
+            } else {
+                m_owner->replaceInFile(*m_job);
+            }
+        }
+
+        ReplaceMatches *owner = m_owner;
+        QSharedPointer<ReplaceMatches::FileReplace> job = m_job;
+        QMetaObject::invokeMethod(
+            owner,
+            [owner, job]() {
+                owner->fileReplaced(job);
+            },
+            Qt::QueuedConnection);
+    }
+
+private:
+    ReplaceMatches *m_owner;
+    QSharedPointer<ReplaceMatches::FileReplace> m_job;
+};
+
 ReplaceMatches::ReplaceMatches(QObject *parent)
     : QObject(parent)
 {
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ReplaceMatches::~ReplaceMatches()
+{
+    cancelReplace();
+    m_pool.waitForDone();
 }
 
 void ReplaceMatches::replaceChecked(QTreeWidget *tree, const QRegularExpression &regexp, const QString &replace)
 {
     if (m_manager == nullptr)
         return;
-    if (m_rootIndex != -1)
+    if (m_replacing)
         return; // already replacing
 
     m_tree = tree;
-    m_rootIndex = 0;
-    m_childStartIndex = 0;
     m_regExp = regexp;
     m_replaceText = replace;
-    m_cancelReplace = false;
+    m_cancelReplace.storeRelease(0);
+    m_processedMatches = 0;
+    m_totalMatches = 0;
+    m_replacing = true;
     m_progressTime.restart();
-    doReplaceNextMatch();
+
+    // collect the checked matches per file
+    QVector<QSharedPointer<FileReplace>> jobs;
+    QTreeWidgetItem *root = tree->topLevelItemCount() == 1 ? tree->topLevelItem(0) : nullptr;
+    for (int i = 0; root && i < root->childCount(); ++i) {
+        QTreeWidgetItem *fileItem = root->child(i);
+        if (!fileItem->data(0, StartColumnRole).toString().isEmpty()) {
+            // this is a search as you type replace, the matches are below the root
+            fileItem = root;
+        }
+
+        if (fileItem->checkState(0) != Qt::Unchecked) {
+            QSharedPointer<FileReplace> job(new FileReplace);
+            job->fileItem = fileItem;
+            job->url = fileItem->data(0, FileUrlRole).toString();
+            for (int j = 0; j < fileItem->childCount(); ++j) {
+                QTreeWidgetItem *item = fileItem->child(j);
+                // don't replace an already replaced item
+                if (item->checkState(0) != Qt::Checked || item->data(0, ReplacedRole).toBool()) {
+                    continue;
+                }
+                job->children.append(j);
+                job->ranges.append(KTextEditor::Range(item->data(0, StartLineRole).toInt(),
+                                                      item->data(0, StartColumnRole).toInt(),
+                                                      item->data(0, EndLineRole).toInt(),
+                                                      item->data(0, EndColumnRole).toInt()));
+            }
+            if (!job->children.isEmpty()) {
+                m_totalMatches += job->children.size();
+                jobs.append(job);
+            }
+        }
+
+        if (fileItem == root) {
+            break;
+        }
+    }
+
+    // open documents are replaced in the editor, all other local files on disk
+    for (const QSharedPointer<FileReplace> &job : qAsConst(jobs)) {
+        if (job->url.isEmpty()) {
+            job->doc = findNamed(job->fileItem->data(0, FileNameRole).toString());
+        } else {
+            const QUrl url = QUrl::fromUserInput(job->url);
+            job->doc = m_manager->findUrl(url);
+            if (!job->doc && !url.isLocalFile()) {
+                job->doc = m_manager->openUrl(url);
+            }
+            if (!job->doc) {
+                job->url = url.toLocalFile();
+            }
+        }
+        if (!job->doc && job->url.isEmpty()) {
+            continue;
+        }
+        startReplace(job);
+    }
+
+    if (m_runningJobs == 0) {
+        m_replacing = false;
+        emit replaceDone();
+    }
 }
 
 void ReplaceMatches::setDocumentManager(KTextEditor::Application *manager)
@@ -53,7 +165,13 @@ void ReplaceMatches::setDocumentManager(KTextEditor::Application *manager)
 
 void ReplaceMatches::cancelReplace()
 {
-    m_cancelReplace = true;
+    m_cancelReplace.storeRelease(1);
+
+    // the document of a pending replace might be about to be deleted
+    for (const QSharedPointer<FileReplace> &job : qAsConst(m_documentJobs)) {
+        clearMovingRanges(*job);
+    }
+    m_documentJobs.clear();
 }
 
 KTextEditor::Document *ReplaceMatches::findNamed(const QString &name)
@@ -68,26 +186,8 @@ KTextEditor::Document *ReplaceMatches::findNamed(const QString &name)
     return nullptr;
 }
 
-bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt)
+QString ReplaceMatches::buildReplaceText(const QRegularExpressionMatch &match, const QString &replaceTxt)
 {
-    if (!doc || !item) {
-        return false;
-    }
-
-    // don't replace an already replaced item
-    if (item->data(0, ReplaceMatches::ReplacedRole).toBool()) {
-        // qDebug() << "not replacing already replaced item";
-        return false;
-    }
-
-    // Check that the text has not been modified and still matches + get captures for the replace
-    QString matchLines = doc->text(range);
-    QRegularExpressionMatch match = regExp.match(matchLines);
-    if (match.capturedStart() != 0) {
-        // qDebug() << matchLines << "Does not match" << regExp.pattern();
-        return false;
-    }
-
     // Modify the replace string according to this match
     QString replaceText = replaceTxt;
     replaceText.replace(QLatin1String("\\\\"), QLatin1String("¤Search&Replace¤"));
@@ -115,16 +215,18 @@ bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *i
     replaceText.replace(QLatin1String("\\n"), QLatin1String("\n"));
     replaceText.replace(QLatin1String("\\t"), QLatin1String("\t"));
     replaceText.replace(QLatin1String("¤Search&Replace¤"), QLatin1String("\\"));
+    return replaceText;
+}
 
-    doc->replaceText(range, replaceText);
-
-    int newEndLine = range.start().line() + replaceText.count(QLatin1Char('\n'));
+void ReplaceMatches::setReplacedItem(QTreeWidgetItem *item, const KTextEditor::Cursor &start, QString replaceText)
+{
+    int newEndLine = start.line() + replaceText.count(QLatin1Char('\n'));
     int lastNL = replaceText.lastIndexOf(QLatin1Char('\n'));
-    int newEndColumn = lastNL == -1 ? range.start().column() + replaceText.length() : replaceText.length() - lastNL - 1;
+    int newEndColumn = lastNL == -1 ? start.column() + replaceText.length() : replaceText.length() - lastNL - 1;
 
     item->setData(0, ReplaceMatches::ReplacedRole, true);
-    item->setData(0, ReplaceMatches::StartLineRole, range.start().line());
-    item->setData(0, ReplaceMatches::StartColumnRole, range.start().column());
+    item->setData(0, ReplaceMatches::StartLineRole, start.line());
+    item->setData(0, ReplaceMatches::StartColumnRole, start.column());
     item->setData(0, ReplaceMatches::EndLineRole, newEndLine);
     item->setData(0, ReplaceMatches::EndColumnRole, newEndColumn);
     item->setData(0, ReplaceMatches::ReplacedTextRole, replaceText);
@@ -136,8 +238,32 @@ bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *i
     html += QLatin1String("<i><s>") + item->data(0, ReplaceMatches::MatchRole).toString() + QLatin1String("</s></i> ");
     html += QLatin1String("<b>") + replaceText + QLatin1String("</b>");
     html += item->data(0, ReplaceMatches::PostMatchRole).toString();
-    item->setData(0, Qt::DisplayRole, i18n("Line: <b>%1</b>: %2", range.start().line() + 1, html));
+    item->setData(0, Qt::DisplayRole, i18n("Line: <b>%1</b>: %2", start.line() + 1, html));
+}
+
+bool ReplaceMatches::replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt)
+{
+    if (!doc || !item) {
+        return false;
+    }
 
+    // don't replace an already replaced item
+    if (item->data(0, ReplaceMatches::ReplacedRole).toBool()) {
+        // qDebug() << "not replacing already replaced item";
+        return false;
+    }
+
+    // Check that the text has not been modified and still matches + get captures for the replace
+    QString matchLines = doc->text(range);
+    QRegularExpressionMatch match = regExp.match(matchLines);
+    if (match.capturedStart() != 0) {
+        // qDebug() << matchLines << "Does not match" << regExp.pattern();
+        return false;
+    }
+
+    const QString replaceText = buildReplaceText(match, replaceTxt);
+    doc->replaceText(range, replaceText);
+    setReplacedItem(item, range.start(), replaceText);
     return true;
 }
 
@@ -199,141 +325,293 @@ bool ReplaceMatches::replaceSingleMatch(KTextEditor::Document *doc, QTreeWidgetI
     return true;
 }
 
-void ReplaceMatches::doReplaceNextMatch()
+void ReplaceMatches::startReplace(const QSharedPointer<FileReplace> &job)
 {
-    if (!m_manager || m_tree->topLevelItemCount() != 1) {
-        updateTreeViewItems(nullptr);
-        m_rootIndex = -1;
-        emit replaceDone();
-        return;
+    if (job->doc) {
+        prepareDocumentReplace(*job);
+        m_documentJobs.append(job);
     }
+    m_runningJobs++;
+    m_pool.start(new ReplaceMatchesWorker(this, job));
+}
 
-    // NOTE The document managers signal documentWillBeDeleted() must be connected to
-    // cancelReplace(). A closed file could lead to a crash if it is not handled.
+void ReplaceMatches::prepareDocumentReplace(FileReplace &job)
+{
+    // the worker only sees the text of the matches, the moving ranges follow edits until the replace is applied
+    job.inDocument = true;
+    job.replaced.clear();
+    job.replaceTexts.clear();
+    job.matchTexts.clear();
+    for (const KTextEditor::Range &range : qAsConst(job.ranges)) {
+        job.matchTexts.append(job.doc->text(range));
+    }
 
-    // Open the file
-    QTreeWidgetItem *fileItem = m_tree->topLevelItem(0)->child(m_rootIndex);
-    if (!fileItem) {
-        updateTreeViewItems(nullptr);
-        m_rootIndex = -1;
-        emit replaceDone();
+    KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(job.doc);
+    if (!miface) {
         return;
     }
-
-    bool isSearchAsYouType = false;
-    if (!fileItem->data(0, StartColumnRole).toString().isEmpty()) {
-        // this is a search as you type replace
-        fileItem = m_tree->topLevelItem(0);
-        isSearchAsYouType = true;
+    for (int j = 0; j < job.fileItem->childCount(); ++j) {
+        QTreeWidgetItem *item = job.fileItem->child(j);
+        int startLine = item->data(0, ReplaceMatches::StartLineRole).toInt();
+        int startColumn = item->data(0, ReplaceMatches::StartColumnRole).toInt();
+        int endLine = item->data(0, ReplaceMatches::EndLineRole).toInt();
+        int endColumn = item->data(0, ReplaceMatches::EndColumnRole).toInt();
+        job.movingRanges.append(miface->newMovingRange(KTextEditor::Range(startLine, startColumn, endLine, endColumn)));
     }
+}
 
-    if (m_cancelReplace) {
-        updateTreeViewItems(fileItem);
-        m_rootIndex = -1;
-        emit replaceDone();
-        return;
+void ReplaceMatches::clearMovingRanges(FileReplace &job)
+{
+    if (job.doc) {
+        qDeleteAll(job.movingRanges);
     }
+    job.movingRanges.clear();
+}
 
-    if (fileItem->checkState(0) == Qt::Unchecked) {
-        updateTreeViewItems(fileItem);
-        QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
-        return;
+void ReplaceMatches::fileReplaced(const QSharedPointer<FileReplace> &job)
+{
+    m_runningJobs--;
+    m_documentJobs.removeOne(job);
+
+    // the tree is gone with its results tab
+    if (!m_tree) {
+        m_cancelReplace.storeRelease(1);
     }
 
-    KTextEditor::Document *doc;
-    QString docUrl = fileItem->data(0, FileUrlRole).toString();
-    if (docUrl.isEmpty()) {
-        doc = findNamed(fileItem->data(0, FileNameRole).toString());
-    } else {
-        doc = m_manager->findUrl(QUrl::fromUserInput(docUrl));
-        if (!doc) {
-            doc = m_manager->openUrl(QUrl::fromUserInput(fileItem->data(0, FileUrlRole).toString()));
+    const bool canceled = m_cancelReplace.loadAcquire();
+    if (!job->inDocument && !job->needsDocument) {
+        // a file the worker rewrote before the cancel stays rewritten, the tree has to show that
+        if (m_tree) {
+            applyFileReplace(*job);
+        }
+    } else if (!canceled) {
+        if (job->needsDocument) {
+            // not rewritten on disk, e.g. because of the encoding, let the editor do it
+            job->needsDocument = false;
+            job->doc = m_manager->openUrl(QUrl::fromLocalFile(job->url));
+            if (job->doc) {
+                startReplace(job);
+                return;
+            }
+        } else {
+            applyDocumentReplace(*job);
         }
     }
 
-    if (!doc) {
-        updateTreeViewItems(fileItem);
-        QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
-        return;
+    if (!canceled) {
+        m_processedMatches += job->children.size();
+        if (m_progressTime.elapsed() > 100) {
+            m_progressTime.restart();
+            emit replaceStatus(job->doc ? job->doc->url() : QUrl::fromLocalFile(job->url), m_processedMatches, m_totalMatches);
+        }
     }
+    clearMovingRanges(*job);
 
-    if (m_progressTime.elapsed() > 100) {
-        m_progressTime.restart();
-        if (m_currentMatches.isEmpty()) {
-            emit replaceStatus(doc->url(), 0, 0);
-        } else {
-            emit replaceStatus(doc->url(), m_childStartIndex, m_currentMatches.count());
-        }
+    if (m_runningJobs == 0) {
+        m_replacing = false;
+        emit replaceDone();
     }
+}
 
-    if (m_childStartIndex == 0) {
-        // Create a vector of moving ranges for updating the tree-view after replace
-        QVector<bool> replaced;
-        KTextEditor::MovingInterface *miface = qobject_cast<KTextEditor::MovingInterface *>(doc);
-
-        for (int j = 0; j < fileItem->childCount(); ++j) {
-            QTreeWidgetItem *item = fileItem->child(j);
-            int startLine = item->data(0, ReplaceMatches::StartLineRole).toInt();
-            int startColumn = item->data(0, ReplaceMatches::StartColumnRole).toInt();
-            int endLine = item->data(0, ReplaceMatches::EndLineRole).toInt();
-            int endColumn = item->data(0, ReplaceMatches::EndColumnRole).toInt();
-            KTextEditor::Range range(startLine, startColumn, endLine, endColumn);
-            KTextEditor::MovingRange *mr = miface->newMovingRange(range);
-            m_currentMatches.append(mr);
-            m_currentReplaced << false;
-        }
+void ReplaceMatches::applyDocumentReplace(FileReplace &job)
+{
+    if (!job.doc || job.movingRanges.size() != job.fileItem->childCount() || job.replaced.size() != job.children.size()) {
+        return;
     }
 
     // Make one transaction for the whole replace to speed up things
     // and get all replacements in one "undo"
-    KTextEditor::Document::EditingTransaction transaction(doc);
+    QVector<bool> replaced(job.movingRanges.size(), false);
+    {
+        KTextEditor::Document::EditingTransaction transaction(job.doc);
+        for (int i = 0; i < job.children.size(); ++i) {
+            const int child = job.children[i];
+            QTreeWidgetItem *item = job.fileItem->child(child);
+            item->setCheckState(0, Qt::PartiallyChecked);
 
-    // now do the replaces
-    int i = m_childStartIndex;
-    for (; i < fileItem->childCount(); ++i) {
-        if (m_progressTime.elapsed() > 100) {
-            break;
+            // the document might have changed while the replacement was computed
+            const KTextEditor::Range range = job.movingRanges[child]->toRange();
+            if (!job.replaced[i] || job.doc->text(range) != job.matchTexts[i]) {
+                continue;
+            }
+            job.doc->replaceText(range, job.replaceTexts[i]);
+            setReplacedItem(item, range.start(), job.replaceTexts[i]);
+            replaced[child] = true;
         }
-        QTreeWidgetItem *item = fileItem->child(i);
+    }
 
-        if (item->checkState(0) == Qt::Checked) {
-            m_currentReplaced[i] = replaceMatch(doc, item, m_currentMatches[i]->toRange(), m_regExp, m_replaceText);
-            item->setCheckState(0, Qt::PartiallyChecked);
+    // Update the positions of the remaining tree-view-items
+    for (int j = 0; j < job.movingRanges.size(); ++j) {
+        if (replaced[j]) {
+            continue;
         }
+        QTreeWidgetItem *item = job.fileItem->child(j);
+        item->setData(0, ReplaceMatches::StartLineRole, job.movingRanges[j]->start().line());
+        item->setData(0, ReplaceMatches::StartColumnRole, job.movingRanges[j]->start().column());
+        item->setData(0, ReplaceMatches::EndLineRole, job.movingRanges[j]->end().line());
+        item->setData(0, ReplaceMatches::EndColumnRole, job.movingRanges[j]->end().column());
     }
+}
 
-    if (i == fileItem->childCount()) {
-        updateTreeViewItems(fileItem);
-        if (isSearchAsYouType) {
-            m_rootIndex = -1;
-            emit replaceDone();
-            return;
+void ReplaceMatches::applyFileReplace(FileReplace &job)
+{
+    if (job.replaced.size() != job.children.size()) {
+        return;
+    }
+
+    for (int i = 0; i < job.children.size(); ++i) {
+        QTreeWidgetItem *item = job.fileItem->child(job.children[i]);
+        item->setCheckState(0, Qt::PartiallyChecked);
+        if (job.replaced[i]) {
+            setReplacedItem(item, job.newStarts[i], job.replaceTexts[i]);
         }
-    } else {
-        m_childStartIndex = i;
     }
-    QTimer::singleShot(0, this, &ReplaceMatches::doReplaceNextMatch);
 }
 
-void ReplaceMatches::updateTreeViewItems(QTreeWidgetItem *fileItem)
+void ReplaceMatches::computeReplacements(FileReplace &job) const
 {
-    if (fileItem && m_currentReplaced.size() == m_currentMatches.size() && m_currentReplaced.size() == fileItem->childCount()) {
-        for (int j = 0; j < m_currentReplaced.size() && j < m_currentMatches.size(); ++j) {
-            QTreeWidgetItem *item = fileItem->child(j);
-
-            if (!m_currentReplaced[j] && item) {
-                item->setData(0, ReplaceMatches::StartLineRole, m_currentMatches[j]->start().line());
-                item->setData(0, ReplaceMatches::StartColumnRole, m_currentMatches[j]->start().column());
-                item->setData(0, ReplaceMatches::EndLineRole, m_currentMatches[j]->end().line());
-                item->setData(0, ReplaceMatches::EndColumnRole, m_currentMatches[j]->end().column());
-            }
-        }
+    job.replaced.reserve(job.matchTexts.size());
+    job.replaceTexts.reserve(job.matchTexts.size());
+    for (const QString &text : qAsConst(job.matchTexts)) {
+        // Check that the text still matches + get captures for the replace
+        const QRegularExpressionMatch match = m_regExp.match(text);
+        const bool matches = match.capturedStart() == 0;
+        job.replaced.append(matches);
+        job.replaceTexts.append(matches ? buildReplaceText(match, m_replaceText) : QString());
+    }
+}
+
+void ReplaceMatches::replaceInFile(FileReplace &job) const
+{
+    job.replaced.fill(false, job.children.size());
+    job.replaceTexts.fill(QString(), job.children.size());
+    job.newStarts.resize(job.children.size());
+
+    QFile file(job.url);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QByteArray content = file.readAll();
+    file.close();
+
+    // same encoding as the search sees, the byte order mark is kept as it is
+    int bomSize = 0;
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    const auto startsWith = [&content](const char *bom, int size) {
+        return content.size() >= size && memcmp(content.constData(), bom, size) == 0;
+    };
+    if (startsWith("\xEF\xBB\xBF", 3)) {
+        bomSize = 3;
+        codec = QTextCodec::codecForName("UTF-8");
+    } else if (startsWith("\x00\x00\xFE\xFF", 4)) {
+        bomSize = 4;
+        codec = QTextCodec::codecForName("UTF-32BE");
+    } else if (startsWith("\xFF\xFE\x00\x00", 4)) {
+        bomSize = 4;
+        codec = QTextCodec::codecForName("UTF-32LE");
+    } else if (startsWith("\xFF\xFE", 2)) {
+        bomSize = 2;
+        codec = QTextCodec::codecForName("UTF-16LE");
+    } else if (startsWith("\xFE\xFF", 2)) {
+        bomSize = 2;
+        codec = QTextCodec::codecForName("UTF-16BE");
+    }
+
+    // only rewrite what survives decoding and encoding again unchanged
+    QTextCodec::ConverterState decodeState(QTextCodec::IgnoreHeader);
+    const QString text = codec->toUnicode(content.constData() + bomSize, content.size() - bomSize, &decodeState);
+    QTextCodec::ConverterState encodeState(QTextCodec::IgnoreHeader);
+    if (decodeState.invalidChars || codec->fromUnicode(text.constData(), text.size(), &encodeState) != content.mid(bomSize)) {
+        job.needsDocument = true;
+        return;
     }
 
-    qDeleteAll(m_currentMatches);
+    // lines as the search splits them, a \r before the \n is not part of the line
+    QVector<int> lineStarts;
+    lineStarts.append(0);
+    for (int nl = 0; (nl = text.indexOf(QLatin1Char('\n'), nl)) != -1; ++nl) {
+        lineStarts.append(nl + 1);
+    }
+    const auto lineEnd = [&text, &lineStarts](int line) {
+        int end = line + 1 < lineStarts.size() ? lineStarts[line + 1] - 1 : text.size();
+        if (end > lineStarts[line] && text.at(end - 1) == QLatin1Char('\r')) {
+            end--;
+        }
+        return end;
+    };
+    const auto offset = [&lineStarts, &lineEnd](const KTextEditor::Cursor &c) {
+        if (c.line() < 0 || c.line() >= lineStarts.size() || c.column() < 0 || lineStarts[c.line()] + c.column() > lineEnd(c.line())) {
+            return -1;
+        }
+        return lineStarts[c.line()] + c.column();
+    };
+
+    QVector<int> order(job.children.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&job](int a, int b) {
+        return job.ranges[a].start() < job.ranges[b].start();
+    });
+
+    // build the new content, keeping track of the position in it
+    QString newText;
+    newText.reserve(text.size());
+    int copied = 0;
+    int newLine = 0;
+    int newLineStart = 0;
+    const auto append = [&newText, &newLine, &newLineStart](const QString &piece) {
+        for (int nl = 0; (nl = piece.indexOf(QLatin1Char('\n'), nl)) != -1; ++nl) {
+            newLine++;
+            newLineStart = newText.size() + nl + 1;
+        }
+        newText += piece;
+    };
+
+    bool changed = false;
+    for (int i : qAsConst(order)) {
+        const int start = offset(job.ranges[i].start());
+        const int end = offset(job.ranges[i].end());
+        if (start < copied || end < start) {
+            continue;
+        }
+
+        // Check that the text has not been modified and still matches + get captures for the replace
+        QString matchText = text.mid(start, end - start);
+        const bool crlf = lineEnd(job.ranges[i].start().line()) < text.size() && text.at(lineEnd(job.ranges[i].start().line())) == QLatin1Char('\r');
+        if (crlf) {
+            matchText.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        }
+        const QRegularExpressionMatch match = m_regExp.match(matchText);
+        if (match.capturedStart() != 0) {
+            continue;
+        }
+
+        const QString replaceText = buildReplaceText(match, m_replaceText);
+        append(text.mid(copied, start - copied));
+        job.newStarts[i] = KTextEditor::Cursor(newLine, newText.size() - newLineStart);
+        if (crlf) {
+            append(QString(replaceText).replace(QLatin1Char('\n'), QLatin1String("\r\n")));
+        } else {
+            append(replaceText);
+        }
+        copied = end;
 
-    m_rootIndex++;
-    m_childStartIndex = 0;
-    m_currentMatches.clear();
-    m_currentReplaced.clear();
+        job.replaced[i] = true;
+        job.replaceTexts[i] = replaceText;
+        changed = true;
+    }
+    if (!changed) {
+        return;
+    }
+    newText += text.midRef(copied);
+
+    // written to a temporary file that replaces the old one on commit
+    QSaveFile saveFile(job.url);
+    bool saved = saveFile.open(QIODevice::WriteOnly);
+    if (saved) {
+        QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+        saved = saveFile.write(content.left(bomSize)) == bomSize && saveFile.write(codec->fromUnicode(newText.constData(), newText.size(), &state)) >= 0 && saveFile.commit();
+    }
+    if (!saved) {
+        job.replaced.fill(false);
+    }
 }
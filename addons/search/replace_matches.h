@@ -21,15 +21,28 @@
 #ifndef _REPLACE_MATCHES_H_
 #define _REPLACE_MATCHES_H_
 
+#include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QObject>
+#include <QPointer>
 #include <QRegularExpression>
+#include <QSharedPointer>
+#include <QThreadPool>
 #include <QTreeWidget>
 #include <ktexteditor/application.h>
 #include <ktexteditor/document.h>
 #include <ktexteditor/movinginterface.h>
 #include <ktexteditor/movingrange.h>
 
+/**
+ * Replaces search matches.
+ *
+ * Replacing the checked matches works per file. The replacement strings are
+ * computed by workers in a thread pool from the match data of the tree and
+ * the regular expression. Open documents get all replacements of a file in one
+ * edit transaction, so one undo reverts them. Files that are not open are
+ * rewritten on disk by the workers, the new content replaces the file atomically.
+ */
 class ReplaceMatches : public QObject
 {
     Q_OBJECT
@@ -51,6 +64,7 @@ public:
     };
 
     ReplaceMatches(QObject *parent = nullptr);
+    ~ReplaceMatches() override;
     void setDocumentManager(KTextEditor::Application *manager);
 
     bool replaceMatch(KTextEditor::Document *doc, QTreeWidgetItem *item, const KTextEditor::Range &range, const QRegularExpression &regExp, const QString &replaceTxt);
@@ -59,29 +73,75 @@ public:
 
     KTextEditor::Document *findNamed(const QString &name);
 
+    /**
+     * @return @p replaceTxt with the captures of @p match and the escape sequences filled in
+     */
+    static QString buildReplaceText(const QRegularExpressionMatch &match, const QString &replaceTxt);
+
 public Q_SLOTS:
     void cancelReplace();
 
-private Q_SLOTS:
-    void doReplaceNextMatch();
-
 Q_SIGNALS:
-    void replaceStatus(const QUrl &url, int replacedInFile, int matchesInFile);
+    void replaceStatus(const QUrl &url, int processedMatches, int totalMatches);
     void replaceDone();
 
 private:
-    void updateTreeViewItems(QTreeWidgetItem *fileItem);
+    friend class ReplaceMatchesWorker;
+
+    /**
+     * The checked matches of one file item.
+     * Created in the main thread, the worker fills in the replacements.
+     */
+    struct FileReplace {
+        QTreeWidgetItem *fileItem = nullptr;
+        QString url;
+        // document to replace in, files on disk are rewritten by the worker
+        QPointer<KTextEditor::Document> doc;
+        bool inDocument = false;
+        // child indices and ranges of the checked matches
+        QVector<int> children;
+        QVector<KTextEditor::Range> ranges;
+        // document text of the ranges when the replace started
+        QStringList matchTexts;
+        // open documents: ranges of all children, keep track of edits until the replacements are applied
+        QVector<KTextEditor::MovingRange *> movingRanges;
+
+        // filled in by the worker
+        QVector<bool> replaced;
+        QVector<QString> replaceTexts;
+        // files on disk: start of the replacements in the new content
+        QVector<KTextEditor::Cursor> newStarts;
+        // the file can't be rewritten as is, it is replaced in an editor document instead
+        bool needsDocument = false;
+    };
+
+    void startReplace(const QSharedPointer<FileReplace> &job);
+    void prepareDocumentReplace(FileReplace &job);
+    void fileReplaced(const QSharedPointer<FileReplace> &job);
+    void applyDocumentReplace(FileReplace &job);
+    void applyFileReplace(FileReplace &job);
+    void clearMovingRanges(FileReplace &job);
+
+    // worker thread
+    void computeReplacements(FileReplace &job) const;
+    void replaceInFile(FileReplace &job) const;
+
+    static void setReplacedItem(QTreeWidgetItem *item, const KTextEditor::Cursor &start, QString replaceText);
 
     KTextEditor::Application *m_manager = nullptr;
-    QTreeWidget *m_tree = nullptr;
-    int m_rootIndex = -1;
-    int m_childStartIndex = -1;
-    QVector<KTextEditor::MovingRange *> m_currentMatches;
-    QVector<bool> m_currentReplaced;
+    QPointer<QTreeWidget> m_tree;
+    QThreadPool m_pool;
 
+    // constant while workers run
     QRegularExpression m_regExp;
     QString m_replaceText;
-    bool m_cancelReplace;
+    QAtomicInt m_cancelReplace;
+
+    bool m_replacing = false;
+    int m_runningJobs = 0;
+    QVector<QSharedPointer<FileReplace>> m_documentJobs;
+    int m_processedMatches = 0;
+    int m_totalMatches = 0;
     QElapsedTimer m_progressTime;
 };
 
@@ -19,6 +19,7 @@
  */
 
 #include "search_open_files.h"
+#include "SearchMultiLine.h"
 
 #include <QElapsedTimer>
 
@@ -78,7 +79,7 @@ void SearchOpenFiles::doSearchNextFile(int startLine)
     }
 }
 
-int SearchOpenFiles::searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine)
+int SearchOpenFiles::searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine, qint64 maxTime)
 {
     if (m_statusTime.elapsed() > 100) {
         m_statusTime.restart();
@@ -86,103 +87,87 @@ int SearchOpenFiles::searchOpenFile(KTextEditor::Document *doc, const QRegularEx
     }
 
     if (regExp.pattern().contains(QLatin1String("\\n"))) {
-        return searchMultiLineRegExp(doc, regExp, startLine);
+        return searchMultiLineRegExp(doc, regExp, startLine, maxTime);
     }
 
-    return searchSingleLineRegExp(doc, regExp, startLine);
+    return searchSingleLineRegExp(doc, regExp, startLine, maxTime);
 }
 
-int SearchOpenFiles::searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine)
+int SearchOpenFiles::searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine, qint64 maxTime)
 {
-    int column;
     QElapsedTimer time;
+    QVector<KateSearchMatch> matches;
+    int stoppedAt = 0;
 
     time.start();
     for (int line = startLine; line < doc->lines(); line++) {
-        if (time.elapsed() > 100) {
+        if (time.elapsed() > maxTime && line > startLine) {
             // qDebug() << "Search time exceeded" << time.elapsed() << line;
-            return line;
-        }
-        QRegularExpressionMatch match;
-        match = regExp.match(doc->line(line));
-        column = match.capturedStart();
-        while (column != -1 && !match.captured().isEmpty()) {
-            emit matchFound(doc->url().toString(), doc->documentName(), doc->line(line), match.capturedLength(), line, column, line, column + match.capturedLength());
-            match = regExp.match(doc->line(line), column + match.capturedLength());
-            column = match.capturedStart();
+            stoppedAt = line;
+            break;
         }
+        matchLine(doc->line(line), line, regExp, matches);
     }
-    return 0;
+
+    if (!matches.isEmpty()) {
+        emit matchesFound(doc->url().toString(), doc->documentName(), matches);
+    }
+    return stoppedAt;
 }
 
-int SearchOpenFiles::searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int inStartLine)
+int SearchOpenFiles::searchOpenFileLines(KTextEditor::Document *doc, const QRegularExpression &regExp, const QVector<int> &lines, int startIndex, qint64 maxTime)
 {
-    int column = 0;
-    int startLine = 0;
     QElapsedTimer time;
+    QVector<KateSearchMatch> matches;
+    int stoppedAt = 0;
+
     time.start();
-    QRegularExpression tmpRegExp = regExp;
-
-    if (inStartLine == 0) {
-        // Copy the whole file to a temporary buffer to be able to search newlines
-        m_fullDoc.clear();
-        m_lineStart.clear();
-        m_lineStart << 0;
-        for (int i = 0; i < doc->lines(); i++) {
-            m_fullDoc += doc->line(i) + QLatin1Char('\n');
-            m_lineStart << m_fullDoc.size();
-        }
-        if (!regExp.pattern().endsWith(QLatin1Char('$'))) {
-            // if regExp ends with '$' leave the extra newline at the end as
-            // '$' will be replaced with (?=\\n), which needs the extra newline
-            m_fullDoc.remove(m_fullDoc.size() - 1, 1);
+    for (int i = startIndex; i < lines.size(); i++) {
+        if (time.elapsed() > maxTime && i > startIndex) {
+            stoppedAt = i;
+            break;
         }
-    } else {
-        if (inStartLine > 0 && inStartLine < m_lineStart.size()) {
-            column = m_lineStart[inStartLine];
-            startLine = inStartLine;
-        } else {
-            return 0;
+        if (lines.at(i) < doc->lines()) {
+            matchLine(doc->line(lines.at(i)), lines.at(i), regExp, matches);
         }
     }
 
-    if (regExp.pattern().endsWith(QLatin1Char('$'))) {
-        QString newPatern = tmpRegExp.pattern();
-        newPatern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
-        tmpRegExp.setPattern(newPatern);
+    if (!matches.isEmpty()) {
+        emit matchesFound(doc->url().toString(), doc->documentName(), matches);
     }
+    return stoppedAt;
+}
 
-    QRegularExpressionMatch match;
-    match = tmpRegExp.match(m_fullDoc, column);
-    column = match.capturedStart();
+void SearchOpenFiles::matchLine(const QString &lineContent, int line, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches)
+{
+    QRegularExpressionMatch match = regExp.match(lineContent);
+    int column = match.capturedStart();
     while (column != -1 && !match.captured().isEmpty()) {
-        // search for the line number of the match
-        int i;
-        startLine = -1;
-        for (i = 1; i < m_lineStart.size(); i++) {
-            if (m_lineStart[i] > column) {
-                startLine = i - 1;
-                break;
-            }
-        }
-        if (startLine == -1) {
-            break;
-        }
-
-        int startColumn = (column - m_lineStart[startLine]);
-        int endLine = startLine + match.captured().count(QLatin1Char('\n'));
-        int lastNL = match.captured().lastIndexOf(QLatin1Char('\n'));
-        int endColumn = lastNL == -1 ? startColumn + match.captured().length() : match.captured().length() - lastNL - 1;
-
-        emit matchFound(doc->url().toString(), doc->documentName(), doc->line(startLine).left(column - m_lineStart[startLine]) + match.captured(), match.capturedLength(), startLine, startColumn, endLine, endColumn);
-
-        match = tmpRegExp.match(m_fullDoc, column + match.capturedLength());
+        matches.append({lineContent, match.capturedLength(), line, column, line, column + match.capturedLength()});
+        match = regExp.match(lineContent, column + match.capturedLength());
         column = match.capturedStart();
+    }
+}
 
-        if (time.elapsed() > 100) {
-            // qDebug() << "Search time exceeded" << time.elapsed() << line;
-            return startLine;
-        }
+int SearchOpenFiles::searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine, qint64 maxTime)
+{
+    QElapsedTimer time;
+    time.start();
+
+    QVector<KateSearchMatch> matches;
+    const int stoppedAt = SearchMultiLine(regExp).search(
+        doc->lines(),
+        [doc](int line) {
+            return doc->line(line);
+        },
+        startLine,
+        matches,
+        [&time, maxTime]() {
+            return time.elapsed() > maxTime;
+        });
+
+    if (!matches.isEmpty()) {
+        emit matchesFound(doc->url().toString(), doc->documentName(), matches);
     }
-    return 0;
+    return stoppedAt;
 }
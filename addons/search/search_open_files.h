@@ -26,6 +26,8 @@
 #include <QRegularExpression>
 #include <ktexteditor/document.h>
 
+#include "KateSearchMatch.h"
+
 class SearchOpenFiles : public QObject
 {
     Q_OBJECT
@@ -39,19 +41,25 @@ public:
 public Q_SLOTS:
     void cancelSearch();
 
+    /// search for at most maxTime ms
     /// return 0 on success or a line number where we stopped.
-    int searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
+    int searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine, qint64 maxTime = 100);
+
+    /// search only the given lines, starting at lines[startIndex], for at most maxTime ms
+    /// return 0 on success or the index into lines where we stopped.
+    int searchOpenFileLines(KTextEditor::Document *doc, const QRegularExpression &regExp, const QVector<int> &lines, int startIndex, qint64 maxTime = 100);
 
 private Q_SLOTS:
     void doSearchNextFile(int startLine);
 
 private:
-    int searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
-    int searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
+    int searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine, qint64 maxTime);
+    int searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine, qint64 maxTime);
+    static void matchLine(const QString &lineContent, int line, const QRegularExpression &regExp, QVector<KateSearchMatch> &matches);
 
 Q_SIGNALS:
     void searchNextFile(int startLine);
-    void matchFound(const QString &url, const QString &fileName, const QString &lineContent, int matchLen, int line, int column, int endLine, int endColumn);
+    void matchesFound(const QString &url, const QString &fileName, const QVector<KateSearchMatch> &matches);
     void searchDone();
     void searching(const QString &file);
 
@@ -60,8 +68,6 @@ private:
     int m_nextIndex = -1;
     QRegularExpression m_regExp;
     bool m_cancelSearch = true;
-    QString m_fullDoc;
-    QVector<int> m_lineStart;
     QElapsedTimer m_statusTime;
 };
 
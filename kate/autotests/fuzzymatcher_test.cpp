@@ -0,0 +1,101 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "fuzzymatcher_test.h"
+#include "katefuzzymatcher.h"
+
+#include <QtTest>
+
+QTEST_MAIN(KateFuzzyMatcherTest)
+
+static bool match(const QString &pattern, const QString &str, int &score)
+{
+    return KateFuzzyMatcher::match(pattern, str, KateFuzzyMatcher::toLower(str), score);
+}
+
+static int score(const QString &pattern, const QString &str)
+{
+    int score = 0;
+    return match(pattern, str, score) ? score : -1000;
+}
+
+void KateFuzzyMatcherTest::matches()
+{
+    int score = 0;
+    QVERIFY(match(QStringLiteral(""), QStringLiteral("katequickopen.cpp"), score));
+    QVERIFY(match(QStringLiteral("kqo"), QStringLiteral("katequickopen.cpp"), score));
+    QVERIFY(match(QStringLiteral("qo"), QStringLiteral("KateQuickOpen.cpp"), score));
+    QVERIFY(match(QStringLiteral("katequickopen.cpp"), QStringLiteral("katequickopen.cpp"), score));
+    QVERIFY(match(QStringLiteral("kate/kqo"), QStringLiteral("/src/kate/kate/katequickopen.cpp"), score));
+}
+
+void KateFuzzyMatcherTest::noMatch()
+{
+    int score = 0;
+    QVERIFY(!match(QStringLiteral("pk"), QStringLiteral("katequickopen.cpp"), score));
+    QVERIFY(!match(QStringLiteral("katequickopen.cpp!"), QStringLiteral("katequickopen.cpp"), score));
+    QVERIFY(!match(QStringLiteral("x"), QStringLiteral(""), score));
+}
+
+void KateFuzzyMatcherTest::lowerCase()
+{
+    // U+0130 is two characters in lower case, the positions in the key must stay the ones in the string
+    const QString str = QStringLiteral("\u0130stanbul/\u0130zmirMap.cpp");
+    QCOMPARE(KateFuzzyMatcher::toLower(str).size(), str.size());
+    int matchScore = 0;
+    QVERIFY(match(QStringLiteral("map"), str, matchScore));
+    QVERIFY(match(QStringLiteral("izm"), str, matchScore));
+    QVERIFY(score(QStringLiteral("map"), str) > score(QStringLiteral("map"), QStringLiteral("\u0130stanbul/\u0130zmirmap.cpp")));
+}
+
+void KateFuzzyMatcherTest::ranking()
+{
+    // consecutive characters beat scattered ones
+    QVERIFY(score(QStringLiteral("quick"), QStringLiteral("katequickopen.cpp")) > score(QStringLiteral("quick"), QStringLiteral("qxuxixcxk.cpp")));
+
+    // word starts beat characters inside of words
+    QVERIFY(score(QStringLiteral("kqo"), QStringLiteral("kate_quick_open.cpp")) > score(QStringLiteral("kqo"), QStringLiteral("kakqaoo.cpp")));
+
+    // camel case humps count as word starts
+    QVERIFY(score(QStringLiteral("qo"), QStringLiteral("KateQuickOpen.cpp")) > score(QStringLiteral("qo"), QStringLiteral("katequickopen.cpp")));
+
+    // in paths the file name counts more than the directories
+    QVERIFY(score(QStringLiteral("main"), QStringLiteral("/src/app/main.cpp")) > score(QStringLiteral("main"), QStringLiteral("/src/main/app.cpp")));
+}
+
+void KateFuzzyMatcherTest::benchmarkMatch()
+{
+    QStringList paths;
+    QStringList keys;
+    for (int i = 0; i < 100000; ++i) {
+        paths << QStringLiteral("/home/user/src/project%1/module%2/SomeSourceFile%3.cpp").arg(i % 7).arg(i % 113).arg(i);
+        keys << KateFuzzyMatcher::toLower(paths.last());
+    }
+
+    const QString pattern = QStringLiteral("m42ssf");
+    QBENCHMARK {
+        int matches = 0;
+        for (int i = 0; i < paths.size(); ++i) {
+            int score = 0;
+            matches += KateFuzzyMatcher::match(pattern, paths.at(i), keys.at(i), score);
+        }
+        QVERIFY(matches > 0);
+    }
+}
@@ -0,0 +1,123 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "katefuzzymatcher.h"
+
+namespace
+{
+const int MatchScore = 16;
+const int ConsecutiveBonus = 8;
+const int SeparatorBonus = 12;
+const int CamelCaseBonus = 10;
+const int FirstCharBonus = 8;
+const int LastComponentBonus = 16;
+
+bool isSeparator(QChar c)
+{
+    return c == QLatin1Char('/') || c == QLatin1Char('\\') || c == QLatin1Char('_') || c == QLatin1Char('-') || c == QLatin1Char('.') || c == QLatin1Char(' ');
+}
+
+int boundaryBonus(const QString &str, int i)
+{
+    if (i == 0 || isSeparator(str.at(i - 1))) {
+        return SeparatorBonus;
+    }
+    if (str.at(i).isUpper() && str.at(i - 1).isLower()) {
+        return CamelCaseBonus;
+    }
+    return 0;
+}
+}
+
+QString KateFuzzyMatcher::toLower(const QString &str)
+{
+    QString lower(str.size(), Qt::Uninitialized);
+    QChar *l = lower.data();
+    for (const QChar c : str) {
+        *l++ = c.toLower();
+    }
+    return lower;
+}
+
+bool KateFuzzyMatcher::match(const QString &pattern, const QString &str, const QString &lowerStr, int &score)
+{
+    const int m = pattern.size();
+    const int n = lowerStr.size();
+    Q_ASSERT(str.size() == n);
+    if (m == 0) {
+        score = 0;
+        return true;
+    }
+    if (m > n) {
+        return false;
+    }
+
+    const QChar *p = pattern.constData();
+    const QChar *s = lowerStr.constData();
+
+    // forward: the first position the whole pattern is matched at
+    int end = -1;
+    for (int i = 0, pi = 0; i < n; ++i) {
+        if (s[i] == p[pi] && ++pi == m) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        return false;
+    }
+
+    // backward: the latest start of a match ending there, this gives the shortest span
+    int start = end;
+    for (int i = end, pi = m - 1; i >= 0; --i) {
+        if (s[i] == p[pi] && --pi < 0) {
+            start = i;
+            break;
+        }
+    }
+
+    // score the characters inside of the span
+    score = 0;
+    int last = -2;
+    for (int i = start, pi = 0; i <= end && pi < m; ++i) {
+        if (s[i] != p[pi]) {
+            continue;
+        }
+        int charScore = MatchScore + boundaryBonus(str, i);
+        if (i == last + 1) {
+            charScore += ConsecutiveBonus;
+        }
+        if (pi == 0) {
+            charScore += boundaryBonus(str, i) ? FirstCharBonus : 0;
+        }
+        score += charScore;
+        last = i;
+        ++pi;
+    }
+    score -= (end - start + 1) - m;
+
+    // prefer matches in the file name part of a path
+    const int lastSeparator = lowerStr.lastIndexOf(QLatin1Char('/'));
+    if (start > lastSeparator) {
+        score += LastComponentBonus;
+    }
+
+    return true;
+}
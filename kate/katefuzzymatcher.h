@@ -0,0 +1,54 @@
+/*  SPDX-License-Identifier: LGPL-2.0-or-later
+
+    Copyright (C) 2020 Kate Developers <kwrite-devel@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KATE_FUZZY_MATCHER_H
+#define KATE_FUZZY_MATCHER_H
+
+#include <QString>
+
+/**
+ * Fuzzy matching as used by quick open.
+ *
+ * A pattern matches a string if all its characters appear in the string in
+ * the same order. Among the possible positions the shortest span ending at the
+ * first possible end is scored. Consecutive characters and characters at word
+ * starts, after path separators and at camel case humps score higher, gaps
+ * between the characters cost a bit.
+ */
+namespace KateFuzzyMatcher
+{
+/**
+ * Lower case @p str character by character.
+ * Unlike QString::toLower() the length stays the same, positions in the result are the ones in @p str.
+ */
+QString toLower(const QString &str);
+
+/**
+ * Match @p pattern against @p str.
+ * @param pattern lower case pattern, from toLower()
+ * @param str string to match, used to find camel case humps
+ * @param lowerStr @p str in lower case from toLower(), the characters are compared against it
+ * @param score set to the score of the match if there is one, higher is better
+ * @return true if @p pattern matches
+ */
+bool match(const QString &pattern, const QString &str, const QString &lowerStr, int &score);
+}
+
+#endif
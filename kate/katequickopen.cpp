@@ -45,7 +45,6 @@
 #include <QHeaderView>
 #include <QLabel>
 #include <QPointer>
-#include <QSortFilterProxyModel>
 #include <QStandardItemModel>
 #include <QTreeView>
 
@@ -69,25 +68,17 @@ KateQuickOpen::KateQuickOpen(QWidget *parent, KateMainWindow *mainWindow)
     m_listView = new QTreeView();
     layout->addWidget(m_listView, 1);
     m_listView->setTextElideMode(Qt::ElideLeft);
+    m_listView->setUniformRowHeights(true);
 
     m_base_model = new KateQuickOpenModel(m_mainWindow, this);
 
-    m_model = new QSortFilterProxyModel(this);
-    m_model->setFilterRole(Qt::DisplayRole);
-    m_model->setSortRole(Qt::DisplayRole);
-    m_model->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    m_model->setSortCaseSensitivity(Qt::CaseInsensitive);
-    m_model->setFilterKeyColumn(0);
-
-    connect(m_inputLine, &KLineEdit::textChanged, m_model, &QSortFilterProxyModel::setFilterWildcard);
+    connect(m_inputLine, &KLineEdit::textChanged, m_base_model, &KateQuickOpenModel::setFilterText);
     connect(m_inputLine, &KLineEdit::returnPressed, this, &KateQuickOpen::slotReturnPressed);
-    connect(m_model, &QSortFilterProxyModel::rowsInserted, this, &KateQuickOpen::reselectFirst);
-    connect(m_model, &QSortFilterProxyModel::rowsRemoved, this, &KateQuickOpen::reselectFirst);
+    connect(m_base_model, &KateQuickOpenModel::modelReset, this, &KateQuickOpen::reselectFirst);
 
     connect(m_listView, &QTreeView::activated, this, &KateQuickOpen::slotReturnPressed);
 
-    m_listView->setModel(m_model);
-    m_model->setSourceModel(m_base_model);
+    m_listView->setModel(m_base_model);
 
     m_inputLine->installEventFilter(this);
     m_listView->installEventFilter(this);
@@ -135,11 +126,12 @@ bool KateQuickOpen::eventFilter(QObject *obj, QEvent *event)
 
 void KateQuickOpen::reselectFirst()
 {
+    // without filter the previous document is the most likely target, otherwise the best match
     int first = 0;
-    if (m_mainWindow->viewManager()->sortedViews().size() > 1)
+    if (m_inputLine->text().isEmpty() && m_mainWindow->viewManager()->sortedViews().size() > 1)
         first = 1;
 
-    QModelIndex index = m_model->index(first, 0);
+    QModelIndex index = m_base_model->index(first, 0);
     m_listView->setCurrentIndex(index);
 }
 
@@ -169,12 +161,12 @@ void KateQuickOpen::slotReturnPressed()
 
 void KateQuickOpen::setMatchMode(int mode)
 {
-    m_model->setFilterKeyColumn(mode);
+    m_base_model->setFilterColumn(mode);
 }
 
 int KateQuickOpen::matchMode()
 {
-    return m_model->filterKeyColumn();
+    return m_base_model->filterColumn();
 }
 
 void KateQuickOpen::setListMode(KateQuickOpenModel::List mode)
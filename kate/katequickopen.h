@@ -28,7 +28,6 @@ class KLineEdit;
 
 class QModelIndex;
 class QStandardItemModel;
-class QSortFilterProxyModel;
 class QTreeView;
 class KateQuickOpenModel;
 enum KateQuickOpenModelList : int;
@@ -68,14 +67,9 @@ private:
     KLineEdit *m_inputLine;
 
     /**
-     * our model we search in
+     * our model we search in, it filters and ranks itself
      */
     KateQuickOpenModel *m_base_model;
-
-    /**
-     * filtered model we search in
-     */
-    QSortFilterProxyModel *m_model;
 };
 
 #endif
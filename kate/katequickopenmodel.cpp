@@ -21,12 +21,19 @@
 #include "katequickopenmodel.h"
 
 #include "kateapp.h"
+#include "katefuzzymatcher.h"
 #include "katemainwindow.h"
 #include "kateviewmanager.h"
 
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 
+#include <QFileInfo>
+#include <QSet>
+
+#include <algorithm>
+#include <climits>
+
 KateQuickOpenModel::KateQuickOpenModel(KateMainWindow *mainWindow, QObject *parent)
     : QAbstractTableModel(parent)
     , m_mainWindow(mainWindow)
@@ -38,7 +45,7 @@ int KateQuickOpenModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid()) {
         return 0;
     }
-    return m_modelEntries.size();
+    return m_filter.isEmpty() ? m_modelEntries.size() : m_filteredRows.size();
 }
 
 int KateQuickOpenModel::columnCount(const QModelIndex &parent) const
@@ -57,7 +64,7 @@ QVariant KateQuickOpenModel::data(const QModelIndex &idx, int role) const
         return {};
     }
 
-    auto entry = m_modelEntries.at(idx.row());
+    const ModelEntry &entry = this->entry(idx.row());
     if (role == Qt::DisplayRole) {
         switch (idx.column()) {
         case Columns::FileName:
@@ -86,23 +93,18 @@ void KateQuickOpenModel::refresh()
     const QStringList projectDocs = projectView ? (m_listMode == CurrentProject ? projectView->property("projectFiles") : projectView->property("allProjectsFiles")).toStringList() : QStringList();
 
     QVector<ModelEntry> allDocuments;
-    allDocuments.reserve(sortedViews.size() + openDocs.size() + projectDocs.size());
+    allDocuments.reserve(sortedViews.size() + openDocs.size());
 
     size_t sort_id = static_cast<size_t>(-1);
     for (auto *view : qAsConst(sortedViews)) {
         auto doc = view->document();
-        allDocuments.push_back({doc->url(), doc->documentName(), doc->url().toDisplayString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile), true, sort_id--});
+        const auto displayUrl = doc->url().toDisplayString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile);
+        allDocuments.push_back({doc->url(), doc->documentName(), displayUrl, true, sort_id--, KateFuzzyMatcher::toLower(doc->documentName()), KateFuzzyMatcher::toLower(displayUrl)});
     }
 
     for (auto *doc : qAsConst(openDocs)) {
         const auto normalizedUrl = doc->url().toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile);
-        allDocuments.push_back({doc->url(), doc->documentName(), normalizedUrl, true, 0});
-    }
-
-    for (const auto &file : qAsConst(projectDocs)) {
-        QFileInfo fi(file);
-        const auto localFile = QUrl::fromLocalFile(fi.absoluteFilePath());
-        allDocuments.push_back({localFile, fi.fileName(), localFile.toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile), false, 0});
+        allDocuments.push_back({doc->url(), doc->documentName(), normalizedUrl, true, 0, KateFuzzyMatcher::toLower(doc->documentName()), KateFuzzyMatcher::toLower(normalizedUrl)});
     }
 
     /** Sort the arrays by filePath. */
@@ -121,7 +123,103 @@ void KateQuickOpenModel::refresh()
         return a.bold > b.bold;
     });
 
+    /** project files, only converted again if they changed since the last refresh */
+    if (projectDocs != m_projectFiles || m_projectEntries.isEmpty()) {
+        m_projectFiles = projectDocs;
+        m_projectEntries.clear();
+        m_projectEntries.reserve(projectDocs.size());
+        for (const auto &file : qAsConst(projectDocs)) {
+            QFileInfo fi(file);
+            const auto localFile = QUrl::fromLocalFile(fi.absoluteFilePath());
+            const auto filePath = localFile.toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile);
+            m_projectEntries.push_back({localFile, fi.fileName(), filePath, false, 0, KateFuzzyMatcher::toLower(fi.fileName()), KateFuzzyMatcher::toLower(filePath)});
+        }
+        std::stable_sort(std::begin(m_projectEntries), std::end(m_projectEntries), [](const ModelEntry &a, const ModelEntry &b) { return a.filePath < b.filePath; });
+        m_projectEntries.erase(std::unique(m_projectEntries.begin(), m_projectEntries.end(), [](const ModelEntry &a, const ModelEntry &b) { return a.filePath == b.filePath; }), std::end(m_projectEntries));
+    }
+
+    /** open documents come first, they hide the project entries of the same file */
+    QSet<QString> openPaths;
+    openPaths.reserve(allDocuments.size());
+    for (const auto &entry : qAsConst(allDocuments)) {
+        openPaths.insert(entry.filePath);
+    }
+    allDocuments.reserve(allDocuments.size() + m_projectEntries.size());
+    for (const auto &entry : qAsConst(m_projectEntries)) {
+        if (!openPaths.contains(entry.filePath)) {
+            allDocuments.push_back(entry);
+        }
+    }
+
     beginResetModel();
     m_modelEntries = allDocuments;
+    updateFilter(false);
     endResetModel();
 }
+
+void KateQuickOpenModel::setFilterText(const QString &text)
+{
+    // wildcards of the old filter syntax and blanks don't need to match
+    QString filter = KateFuzzyMatcher::toLower(text);
+    filter.remove(QLatin1Char('*'));
+    filter.remove(QLatin1Char('?'));
+    filter.remove(QLatin1Char(' '));
+    if (filter == m_filter) {
+        return;
+    }
+
+    // a longer filter can only match rows the shorter one matched
+    const bool narrow = !m_filter.isEmpty() && filter.startsWith(m_filter);
+    m_filter = filter;
+
+    beginResetModel();
+    updateFilter(narrow);
+    endResetModel();
+}
+
+void KateQuickOpenModel::setFilterColumn(int column)
+{
+    if (column == m_filterColumn) {
+        return;
+    }
+    m_filterColumn = column;
+
+    beginResetModel();
+    updateFilter(false);
+    endResetModel();
+}
+
+void KateQuickOpenModel::updateFilter(bool narrow)
+{
+    if (m_filter.isEmpty()) {
+        m_filteredRows.clear();
+        return;
+    }
+
+    const bool matchPath = m_filterColumn == FilePath;
+    const int rowCount = narrow ? m_filteredRows.size() : m_modelEntries.size();
+
+    // score and row in one sort key, best score first and the model order for equal scores
+    // the model order puts recently used documents first
+    std::vector<quint64> ranked;
+    ranked.reserve(rowCount);
+    for (int i = 0; i < rowCount; ++i) {
+        const int row = narrow ? m_filteredRows.at(i) : i;
+        const ModelEntry &entry = m_modelEntries.at(row);
+        int score = 0;
+        const bool matches = matchPath ? KateFuzzyMatcher::match(m_filter, entry.filePath, entry.filePathKey, score) : KateFuzzyMatcher::match(m_filter, entry.fileName, entry.fileNameKey, score);
+        if (matches) {
+            // the most recently used views get a small head start
+            if (entry.sort_id) {
+                score += qMax(0, 8 - int(static_cast<size_t>(-1) - entry.sort_id));
+            }
+            ranked.push_back((quint64(qint64(INT_MAX) - score) << 32) | quint32(row));
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    m_filteredRows.resize(int(ranked.size()));
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        m_filteredRows[int(i)] = int(ranked[i] & 0xFFFFFFFF);
+    }
+}
@@ -22,6 +22,7 @@
 #define KATEQUICKOPENMODEL_H
 
 #include <QAbstractTableModel>
+#include <QStringList>
 #include <QVariant>
 #include <QVector>
 #include <tuple>
@@ -29,11 +30,13 @@
 #include "katemainwindow.h"
 
 struct ModelEntry {
-    QUrl url;         // used for actually opening a selected file (local or remote)
-    QString fileName; // display string for left column
-    QString filePath; // display string for right column
-    bool bold;        // format line in bold text or not
-    size_t sort_id;
+    QUrl url;            // used for actually opening a selected file (local or remote)
+    QString fileName;    // display string for left column
+    QString filePath;    // display string for right column
+    bool bold;           // format line in bold text or not
+    size_t sort_id;      // recently used views are higher
+    QString fileNameKey; // lower case fileName for matching
+    QString filePathKey; // lower case filePath for matching
 };
 
 // needs to be defined outside of class to support forward declaration elsewhere
@@ -60,9 +63,48 @@ public:
         m_listMode = mode;
     }
 
+    /**
+     * Only show the entries matching @p text fuzzily, best matches first.
+     * If @p text extends the last filter, only the entries matching that one are checked again.
+     */
+    void setFilterText(const QString &text);
+
+    /**
+     * Column the filter text is matched against, FileName or FilePath.
+     */
+    int filterColumn() const
+    {
+        return m_filterColumn;
+    }
+    void setFilterColumn(int column);
+
 private:
+    void updateFilter(bool narrow);
+
+    /**
+     * entry of the given visible row
+     */
+    const ModelEntry &entry(int row) const
+    {
+        return m_modelEntries.at(m_filter.isEmpty() ? row : m_filteredRows.at(row));
+    }
+
     QVector<ModelEntry> m_modelEntries;
 
+    /**
+     * project files of the last refresh and their entries, sorted by filePath
+     * converting them is the costly part of a refresh, it is only done if the files changed
+     */
+    QStringList m_projectFiles;
+    QVector<ModelEntry> m_projectEntries;
+
+    /**
+     * lower case filter and the rows of m_modelEntries matching it, best first
+     */
+    QString m_filter;
+    QVector<int> m_filteredRows;
+    int m_filterColumn = FileName;
+
     /* TODO: don't rely in a pointer to the main window.
      * this is bad engineering, but current code is too tight
      * on this and it's hard to untangle without breaking existing